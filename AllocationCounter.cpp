@@ -0,0 +1,97 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace gt
+{
+
+namespace
+{
+
+std::atomic<uint64_t> allocationCount{0};
+
+} // namespace
+
+uint64_t GetAllocationCount()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+#if GT_COUNT_ALLOCATIONS
+namespace
+{
+
+void* CountedAllocate(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* const memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void* CountedAllocate(std::size_t size, std::align_val_t alignment)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    size = size ? size : 1;
+#ifdef _WIN32
+    void* const memory = _aligned_malloc(size, static_cast<std::size_t>(alignment));
+#else
+    void* memory = nullptr;
+    if (posix_memalign(&memory, static_cast<std::size_t>(alignment), size) != 0)
+        memory = nullptr;
+#endif
+    if (memory)
+        return memory;
+    throw std::bad_alloc();
+}
+
+void AlignedFree(void* memory)
+{
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    std::free(memory);
+#endif
+}
+
+} // namespace
+#endif
+
+} // namespace gt
+
+#if GT_COUNT_ALLOCATIONS
+// The array and nothrow forms forward to these by default.
+
+void* operator new(std::size_t size)
+{
+    return gt::CountedAllocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return gt::CountedAllocate(size, alignment);
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t /*size*/) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t /*alignment*/) noexcept
+{
+    gt::AlignedFree(memory);
+}
+
+void operator delete(void* memory, std::size_t /*size*/,
+                     std::align_val_t /*alignment*/) noexcept
+{
+    gt::AlignedFree(memory);
+}
+#endif
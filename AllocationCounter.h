@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+
+// Debug builds replace the global operator new to count heap allocations,
+// which lets the burst loop assert that it does not allocate.
+#ifndef GT_COUNT_ALLOCATIONS
+#ifdef NDEBUG
+#define GT_COUNT_ALLOCATIONS 0
+#else
+#define GT_COUNT_ALLOCATIONS 1
+#endif
+#endif
+
+namespace gt
+{
+
+/// Number of calls to the global operator new so far, on all threads. Always
+/// 0 unless GT_COUNT_ALLOCATIONS is enabled.
+uint64_t GetAllocationCount();
+
+} // namespace gt
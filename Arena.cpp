@@ -0,0 +1,87 @@
+#include "Arena.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace gt
+{
+
+Arena::Arena(size_t chunkSize, FramePool* pool)
+    : pool(pool ? *pool : FramePool::Shared())
+    , chunkSize(chunkSize)
+{
+    // Enough for any realistic peak, so that growing never reallocates the
+    // chunk list itself once warmed up.
+    chunks.reserve(16);
+}
+
+void* Arena::Allocate(size_t bytes, size_t alignment)
+{
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0 &&
+           alignment <= FramePool::Alignment && "Unsupported alignment");
+
+    if (current < chunks.size()) {
+        size_t const aligned = (offset + alignment - 1) & ~(alignment - 1);
+        if (aligned <= chunks[current].Size() &&
+            bytes <= chunks[current].Size() - aligned) {
+            offset = aligned + bytes;
+            return chunks[current].Data() + aligned;
+        }
+    }
+
+    return AllocateFromNextChunk(bytes);
+}
+
+void* Arena::AllocateFromNextChunk(size_t bytes)
+{
+    // Chunk data is aligned to FramePool::Alignment, which covers every
+    // supported alignment. Chunks kept from earlier bursts are reused when
+    // they are large enough; otherwise a new one goes in front of them.
+    size_t const next = current < chunks.size() ? current + 1 : current;
+    if (next == chunks.size() || chunks[next].Size() < bytes) {
+        FrameBlock chunk = pool.Acquire(std::max(bytes, chunkSize));
+        if (!chunk)
+            throw std::bad_alloc();
+        chunks.insert(chunks.begin() + next, std::move(chunk));
+        ++chunkAllocations;
+    }
+
+    current = next;
+    offset = bytes;
+    return chunks[current].Data();
+}
+
+void Arena::Shrink(void* block, size_t bytes, size_t newBytes)
+{
+    assert(newBytes <= bytes);
+    if (current < chunks.size() &&
+        static_cast<std::byte*>(block) + bytes == chunks[current].Data() + offset)
+        offset -= bytes - newBytes;
+}
+
+void Arena::Rewind(Marker marker)
+{
+    assert((marker.chunk < current ||
+            (marker.chunk == current && marker.offset <= offset)) &&
+           "Rewinding past the current position");
+    current = marker.chunk;
+    offset = marker.offset;
+}
+
+size_t Arena::GetBytesUsed() const
+{
+    size_t bytes = offset;
+    for (size_t i = 0; i < current && i < chunks.size(); ++i)
+        bytes += chunks[i].Size();
+    return bytes;
+}
+
+size_t Arena::GetCapacity() const
+{
+    size_t bytes = 0;
+    for (FrameBlock const& chunk : chunks)
+        bytes += chunk.Size();
+    return bytes;
+}
+
+} // namespace gt
@@ -0,0 +1,109 @@
+#pragma once
+#include "FramePool.h"
+#include "Span.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace gt
+{
+
+/// <summary>
+///   Bump-pointer allocator for transient data with a common lifetime, such
+///   as everything built for one glitch burst. Allocating is a pointer
+///   increment; memory is only given back all at once by rewinding to a
+///   <see cref="Marker"/> or resetting the whole arena.
+/// </summary>
+/// <remarks>
+///   Chunks come from a <see cref="FramePool"/> and are kept when the arena
+///   is rewound, so once the arena has grown to the peak usage of a burst,
+///   later bursts never touch the heap. Objects are not destroyed, so only
+///   trivially destructible types can be allocated. Not thread-safe.
+/// </remarks>
+class Arena
+{
+public:
+    static constexpr size_t DefaultChunkSize = 64 * 1024;
+
+    /// Position in the arena to rewind to.
+    struct Marker
+    {
+        size_t chunk = 0;
+        size_t offset = 0;
+    };
+
+    explicit Arena(size_t chunkSize = DefaultChunkSize, FramePool* pool = nullptr);
+
+    Arena(Arena const&) = delete;
+    Arena& operator=(Arena const&) = delete;
+
+    /// Uninitialized memory of <paramref name="bytes"/> bytes. Alignments up
+    /// to <see cref="FramePool::Alignment"/> are supported.
+    void* Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    /// Value-initialized array of <paramref name="count"/> elements.
+    template<typename T>
+    span<T> AllocateArray(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>,
+                      "Arena objects are never destroyed");
+        T* const data = static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+        for (size_t i = 0; i < count; ++i)
+            new (data + i) T();
+        return {data, count};
+    }
+
+    /// Returns the end of the most recent allocation, shrinking it from
+    /// <paramref name="bytes"/> to <paramref name="newBytes"/>. Does nothing
+    /// for older allocations.
+    void Shrink(void* block, size_t bytes, size_t newBytes);
+
+    Marker GetMarker() const { return {current, offset}; }
+
+    /// Frees everything allocated after <paramref name="marker"/>.
+    void Rewind(Marker marker);
+
+    void Reset() { Rewind({}); }
+
+    size_t GetBytesUsed() const;
+    size_t GetCapacity() const;
+
+    /// Number of chunks acquired so far. Changes only while the arena grows.
+    size_t GetChunkAllocations() const { return chunkAllocations; }
+
+private:
+    void* AllocateFromNextChunk(size_t bytes);
+
+    FramePool& pool;
+    size_t chunkSize;
+    std::vector<FrameBlock> chunks;
+    size_t current = 0;
+    size_t offset = 0;
+    size_t chunkAllocations = 0;
+};
+
+/// <summary>
+///   Rewinds an arena to where it was at construction when going out of
+///   scope, freeing everything allocated in between.
+/// </summary>
+class ArenaScope
+{
+public:
+    explicit ArenaScope(Arena& arena)
+        : arena(arena)
+        , marker(arena.GetMarker())
+    {}
+
+    ~ArenaScope() { arena.Rewind(marker); }
+
+    ArenaScope(ArenaScope const&) = delete;
+    ArenaScope& operator=(ArenaScope const&) = delete;
+
+private:
+    Arena& arena;
+    Arena::Marker marker;
+};
+
+} // namespace gt
@@ -0,0 +1,94 @@
+#include "AsyncFrameSink.h"
+
+#include "ErrorHandling.h"
+#include "Metrics.h"
+
+#include <cstring>
+
+namespace gt
+{
+
+AsyncFrameSink::AsyncFrameSink(IFrameSink& target, unsigned bufferCount,
+                               OverflowPolicy overflow)
+    : target(target)
+    , overflow(overflow)
+    , freeBuffers(bufferCount)
+    , pendingFrames(bufferCount, MetricStage::OutputQueue,
+                    MetricGauge::OutputQueueOccupancy)
+{
+    buffers.reserve(bufferCount);
+    for (unsigned i = 0; i < bufferCount; ++i) {
+        buffers.push_back(std::make_unique<ImageBuffer>());
+        freeBuffers.Push(buffers.back().get());
+    }
+
+    writer = std::thread([this] { WriterMain(); });
+}
+
+AsyncFrameSink::~AsyncFrameSink()
+{
+    Finish();
+}
+
+HRESULT AsyncFrameSink::WriteFrame(ImageBuffer const& frame)
+{
+    if (finished)
+        return E_UNEXPECTED;
+
+    HRESULT const hr = writeResult.load();
+    if (FAILED(hr))
+        return hr;
+
+    ImageBuffer* buffer = nullptr;
+    if (!freeBuffers.TryPop(buffer)) {
+        // A dropping renderer only waits if the writer holds the last buffer.
+        if (overflow == OverflowPolicy::DropOldest && pendingFrames.DropOldest(buffer)) {
+            ++drops;
+            AddToCounter(MetricCounter::DroppedFrames);
+        } else {
+            ++stalls;
+            AddToCounter(MetricCounter::WriterStalls);
+            if (!freeBuffers.Pop(buffer))
+                return E_ABORT;
+        }
+    }
+
+    // Buffers only reallocate when the frame size changes.
+    if (buffer->Width() != frame.Width() || buffer->Height() != frame.Height())
+        buffer->Resize(frame.Width(), frame.Height());
+    std::memcpy(buffer->Data(), frame.Data(), frame.SizeBytes());
+
+    pendingFrames.Push(buffer);
+    return S_OK;
+}
+
+HRESULT AsyncFrameSink::Finish()
+{
+    if (!finished) {
+        finished = true;
+        pendingFrames.Close();
+        writer.join();
+    }
+
+    return writeResult.load();
+}
+
+void AsyncFrameSink::WriterMain()
+{
+    SetTraceThreadName("Frame writer");
+    ImageBuffer* buffer = nullptr;
+    while (pendingFrames.Pop(buffer)) {
+        // Keep draining after an error so the renderer never blocks on a
+        // full queue; the error is reported by the next WriteFrame.
+        if (SUCCEEDED(writeResult.load())) {
+            GT_STAGE_SCOPE(MetricStage::WriteFrame);
+            HRESULT const hr = target.WriteFrame(*buffer);
+            if (FAILED(hr))
+                writeResult.store(hr);
+        }
+
+        freeBuffers.Push(buffer);
+    }
+}
+
+} // namespace gt
@@ -0,0 +1,64 @@
+#pragma once
+#include "FrameSink.h"
+#include "ImageBuffer.h"
+#include "SpscQueue.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace gt
+{
+
+/// <summary>
+///   Forwards frames to another sink on a dedicated writer thread, so slow
+///   output does not stall rendering. Presented frames are copied into a
+///   small ring of reused buffers; the renderer only waits when all of them
+///   are still queued for writing, or with <c>OverflowPolicy::DropOldest</c>
+///   replaces the oldest queued frame instead.
+/// </summary>
+class AsyncFrameSink : public IFrameSink
+{
+public:
+    AsyncFrameSink(IFrameSink& target, unsigned bufferCount = 4,
+                   OverflowPolicy overflow = OverflowPolicy::Block);
+    ~AsyncFrameSink() override;
+
+    HRESULT WriteFrame(ImageBuffer const& frame) override;
+
+    /// <summary>
+    ///   Waits until all queued frames are written and stops the writer
+    ///   thread. Returns the first error of the target sink.
+    /// </summary>
+    HRESULT Finish();
+
+    /// Number of frames for which the renderer had to wait for a free buffer.
+    unsigned GetStalls() const { return stalls; }
+
+    /// Number of queued frames replaced by newer ones.
+    unsigned GetDrops() const { return drops; }
+
+    /// Frames queued for the writer thread.
+    QueueStats GetQueueStats() const { return pendingFrames.GetStats(); }
+
+private:
+    void WriterMain();
+
+    IFrameSink& target;
+    OverflowPolicy overflow;
+    std::vector<std::unique_ptr<ImageBuffer>> buffers;
+
+    /// Written buffers from the writer back to the renderer, and presented
+    /// frames from the renderer to the writer.
+    SpscQueue<ImageBuffer*> freeBuffers;
+    SpscQueue<ImageBuffer*> pendingFrames;
+    std::thread writer;
+
+    std::atomic<HRESULT> writeResult{S_OK};
+    unsigned stalls = 0;
+    unsigned drops = 0;
+    bool finished = false;
+};
+
+} // namespace gt
@@ -0,0 +1,178 @@
+#include "BandedGlitch.h"
+
+#include "ErrorHandling.h"
+#include "Metrics.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gt
+{
+
+HRESULT BandedGlitch::Plan(NoiseGrid const& noise, CellDecisions const& decisions,
+                           unsigned newWidth, unsigned newHeight,
+                           BandedGlitchOptions const& newOptions)
+{
+    if (newWidth == 0 || newHeight == 0)
+        return E_INVALIDARG;
+
+    options = newOptions;
+    width = newWidth;
+    height = newHeight;
+    bands.clear();
+    stats = {};
+
+    // Same effect chain as CpuBackend. The split reads up to its vertical
+    // shift above and below every row, from the glitched image.
+    splitting = options.chromaticSplit && options.intensity > 0.0f;
+    split.intensity = options.intensity;
+    split.Update();
+    halo = splitting ? static_cast<unsigned>(std::ceil(CpuChromaticSplit::MaxShiftY)) : 0;
+
+    size_t const bufferCount = splitting ? 2 : 1;
+    size_t const rowBytes = bufferCount * width * sizeof(uint32_t) +
+                            MaxSpansPerRow * sizeof(RowSpan);
+    size_t const budgetRows = options.memoryBudget / rowBytes;
+    if (budgetRows <= 2 * size_t(halo))
+        return E_OUTOFMEMORY;
+    unsigned const bandRows = static_cast<unsigned>(
+        std::min<size_t>({budgetRows - 2 * halo, MaxBandRows, height}));
+
+    blitArena.Reset();
+    plan.sampling = GlitchSampling::Nearest;
+    plan.colorShuffle = options.colorShuffle;
+    plan.Compile(noise, decisions, width, height, &blitArena);
+
+    unsigned const bandCount = (height + bandRows - 1) / bandRows;
+    bands.resize(bandCount);
+    uint64_t sourceBandCount = 0;
+    for (unsigned i = 0; i < bandCount; ++i) {
+        GlitchBand& band = bands[i];
+        band.rowBegin = i * bandRows;
+        band.rowEnd = std::min(band.rowBegin + bandRows, height);
+        band.glitchBegin = band.rowBegin - std::min(band.rowBegin, halo);
+        band.glitchEnd = std::min(band.rowEnd + halo, height);
+
+        for (GlitchBlit const& blit : plan.blits) {
+            unsigned const y0 = std::max(blit.dstY, band.glitchBegin);
+            unsigned const y1 = std::min(blit.dstY + blit.height, band.glitchEnd);
+            if (y0 >= y1)
+                continue;
+
+            BandRead read;
+            read.source = {blit.srcX, blit.srcY + (y0 - blit.dstY), blit.width, y1 - y0};
+            read.bandX = blit.dstX;
+            read.bandY = y0 - band.glitchBegin;
+            read.flags = blit.flags;
+            band.reads.push_back(read);
+
+            unsigned const lastRow = read.source.y + read.source.height - 1;
+            for (unsigned s = read.source.y / bandRows; s <= lastRow / bandRows; ++s)
+                band.sourceBands.push_back(s);
+
+            stats.pixelsRead += uint64_t(read.source.width) * read.source.height;
+            stats.spansRead += read.source.height;
+        }
+
+        std::sort(band.reads.begin(), band.reads.end(),
+                  [](BandRead const& a, BandRead const& b) {
+                      return a.source.y != b.source.y ? a.source.y < b.source.y
+                                                      : a.source.x < b.source.x;
+                  });
+        std::sort(band.sourceBands.begin(), band.sourceBands.end());
+        band.sourceBands.erase(
+            std::unique(band.sourceBands.begin(), band.sourceBands.end()),
+            band.sourceBands.end());
+
+        sourceBandCount += band.sourceBands.size();
+        unsigned const sourceBands = static_cast<unsigned>(band.sourceBands.size());
+        stats.maxSourceBands = std::max(stats.maxSourceBands, sourceBands);
+    }
+
+    stats.bands = bandCount;
+    stats.rowsPerBand = bandRows;
+    stats.bufferBytes = rowBytes * std::min(bandRows + 2 * halo, height);
+    stats.averageSourceBands = double(sourceBandCount) / bandCount;
+    return S_OK;
+}
+
+HRESULT BandedGlitch::Run(ImageFileReader& source, ImageFileWriter& dest)
+{
+    if (bands.empty() || source.Width() != width || source.Height() != height)
+        return E_INVALIDARG;
+
+    unsigned const bufferRows = std::min(stats.rowsPerBand + 2 * halo, height);
+    glitchBuffer.Resize(width, bufferRows);
+    if (splitting)
+        outputBuffer.Resize(width, bufferRows);
+    spans.reserve(MaxSpansPerRow * bufferRows);
+
+    for (GlitchBand const& band : bands) {
+        ImageRect const rows = {0, 0, width, band.glitchEnd - band.glitchBegin};
+        image_view<uint32_t> const glitched = SubView(glitchBuffer.View(), rows);
+        HR(ReadBand(source, band, glitched));
+        ApplyFlags(band, glitched);
+
+        unsigned const first = band.rowBegin - band.glitchBegin;
+        unsigned const count = band.rowEnd - band.rowBegin;
+        if (!splitting) {
+            HR(dest.WriteRows(glitched.subview(0, first, width, count)));
+            continue;
+        }
+
+        // The halo rows make the split clamp at the band edges only where
+        // they are the image edges.
+        image_view<uint32_t> const output = SubView(outputBuffer.View(), rows);
+        ForEachRowBand(pool, count, [&](unsigned rowBegin, unsigned rowEnd) {
+            split.OnRenderImage(glitched, output, first + rowBegin, first + rowEnd);
+        });
+        HR(dest.WriteRows(output.subview(0, first, width, count)));
+    }
+    return S_OK;
+}
+
+HRESULT BandedGlitch::ReadBand(ImageFileReader& source, GlitchBand const& band,
+                               image_view<uint32_t> glitched)
+{
+    GT_TRACE_SCOPE("ReadBand");
+
+    spans.clear();
+    for (BandRead const& read : band.reads) {
+        for (unsigned y = 0; y < read.source.height; ++y) {
+            spans.push_back({read.source.x, read.source.y + y, read.source.width,
+                             &glitched(read.bandX, read.bandY + y)});
+        }
+    }
+
+    // In file order, so that the reader only moves forward and adjacent
+    // spans continue where the previous one ended.
+    std::sort(spans.begin(), spans.end(), [](RowSpan const& a, RowSpan const& b) {
+        return a.y != b.y ? a.y < b.y : a.x < b.x;
+    });
+    for (RowSpan const& span : spans)
+        HR(source.ReadSpan(span.x, span.y, span.count, span.dest));
+    return S_OK;
+}
+
+void BandedGlitch::ApplyFlags(GlitchBand const& band, image_view<uint32_t> glitched)
+{
+    GT_STAGE_SCOPE(MetricStage::DigitalGlitch);
+
+    unsigned const rows = band.glitchEnd - band.glitchBegin;
+    ForEachRowBand(pool, rows, [&](unsigned rowBegin, unsigned rowEnd) {
+        for (BandRead const& read : band.reads) {
+            if (read.flags == 0)
+                continue;
+
+            unsigned const y0 = std::max(read.bandY, rowBegin);
+            unsigned const y1 = std::min(read.bandY + read.source.height, rowEnd);
+            for (unsigned y = y0; y < y1; ++y) {
+                ApplyBlitFlags<PixelFormat::Bgra8>(
+                    read.flags, glitched.row(y).subspan(read.bandX, read.source.width));
+            }
+        }
+    });
+}
+
+} // namespace gt
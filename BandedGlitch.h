@@ -0,0 +1,162 @@
+#pragma once
+#include "Arena.h"
+#include "CpuGlitch.h"
+#include "ImageBuffer.h"
+#include "ImageIO.h"
+#include "NoiseGrid.h"
+#include "Platform.h"
+#include "ThreadPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gt
+{
+
+struct BandedGlitchOptions
+{
+    /// Bytes the band buffers may take, which sets the rows per band.
+    size_t memoryBudget = size_t(256) << 20;
+    float intensity = 0.5f;
+    /// Effect chain: the digital glitch, followed by the RGB split if set.
+    bool chromaticSplit = true;
+    bool colorShuffle = false;
+};
+
+/// <summary>
+///   Part of a <see cref="GlitchBlit"/> inside the rows glitched for one band:
+///   a source rectangle that never wraps, and where its pixels go in the
+///   band buffer.
+/// </summary>
+struct BandRead
+{
+    ImageRect source;
+    unsigned bandX = 0;
+    unsigned bandY = 0;
+    uint8_t flags = 0;
+};
+
+/// <summary>Output rows of one band and the parts of the source it reads.</summary>
+struct GlitchBand
+{
+    unsigned rowBegin = 0;
+    unsigned rowEnd = 0;
+
+    /// Rows glitched for the band: its own, plus those the RGB split reads
+    /// around them.
+    unsigned glitchBegin = 0;
+    unsigned glitchEnd = 0;
+
+    /// Reads of the band, ordered by source row.
+    std::vector<BandRead> reads;
+
+    /// <summary>
+    ///   Source bands, i.e. the same ranges of rows in the source image, that
+    ///   the reads touch. Displaced cells wrap to any row of the image, so a
+    ///   band may read from several distant source bands.
+    /// </summary>
+    std::vector<unsigned> sourceBands;
+};
+
+struct BandedGlitchStats
+{
+    unsigned bands = 0;
+    unsigned rowsPerBand = 0;
+    /// Bytes of the band buffers and read schedule, within the budget.
+    size_t bufferBytes = 0;
+
+    /// Source bands read per band.
+    double averageSourceBands = 0.0;
+    unsigned maxSourceBands = 0;
+
+    /// Pixels read, including the rows read again for the RGB split of
+    /// neighboring bands, and the row spans they were read in.
+    uint64_t pixelsRead = 0;
+    uint64_t spansRead = 0;
+};
+
+/// <summary>
+///   Glitches an image too large for memory one band of rows at a time with
+///   the blit kernel: reads only the source pixels a band needs from an
+///   <see cref="ImageFileReader"/>, glitches them and hands the band to an
+///   <see cref="ImageFileWriter"/> before starting the next. Peak memory is
+///   bounded by the budget, whatever the height of the image.
+/// </summary>
+/// <remarks>
+///   <para>
+///   Runs in two passes. <see cref="Plan"/> clips the blits of the frame to
+///   every band, which tells which source rows the band needs: displaced
+///   cells read from anywhere in the image, so the needs of a band cannot be
+///   known from its position. <see cref="Run"/> then reads them one band at
+///   a time, row by row in file order, straight into the band buffer, and
+///   applies the flags of the blits in place.
+///   </para>
+///   <para>
+///   The result is the same as the blit kernel and RGB split rendering the
+///   whole image in memory, with blank trash frames.
+///   </para>
+/// </remarks>
+class BandedGlitch
+{
+public:
+    /// Rows per band when the budget allows. Larger bands only need more
+    /// memory, since every pixel is read once either way.
+    static constexpr unsigned MaxBandRows = 1024;
+
+    /// Spreads the flags and the RGB split of every band over
+    /// <paramref name="newPool"/>; reads and writes stay on the caller.
+    void SetThreadPool(ThreadPool* newPool) { pool = newPool; }
+
+    /// <summary>
+    ///   First pass: sizes the bands of a <paramref name="width"/> x
+    ///   <paramref name="height"/> image to the budget and plans their reads
+    ///   for the given noise and cells. Fails with <c>E_OUTOFMEMORY</c> if the
+    ///   budget cannot hold a single row.
+    /// </summary>
+    HRESULT Plan(NoiseGrid const& noise, CellDecisions const& decisions, unsigned width,
+                 unsigned height, BandedGlitchOptions const& newOptions);
+
+    /// Second pass: reads, glitches and writes every band.
+    HRESULT Run(ImageFileReader& source, ImageFileWriter& dest);
+
+    std::vector<GlitchBand> const& GetBands() const { return bands; }
+    BandedGlitchStats GetStats() const { return stats; }
+
+private:
+    /// One row of a <see cref="BandRead"/>.
+    struct RowSpan
+    {
+        unsigned x;
+        unsigned y;
+        unsigned count;
+        uint32_t* dest;
+    };
+
+    /// A blit is split into at most two reads per row where it wraps.
+    static constexpr size_t MaxSpansPerRow = NoiseGrid::Width * 2;
+
+    HRESULT ReadBand(ImageFileReader& source, GlitchBand const& band,
+                     image_view<uint32_t> glitched);
+    void ApplyFlags(GlitchBand const& band, image_view<uint32_t> glitched);
+
+    BandedGlitchOptions options;
+    unsigned width = 0;
+    unsigned height = 0;
+    /// Whether the RGB split runs, which skips the clean frame.
+    bool splitting = false;
+    unsigned halo = 0;
+
+    GlitchPlan plan;
+    Arena blitArena;
+    CpuChromaticSplit split;
+    std::vector<GlitchBand> bands;
+    BandedGlitchStats stats;
+
+    ImageBuffer glitchBuffer;
+    ImageBuffer outputBuffer;
+    std::vector<RowSpan> spans;
+    ThreadPool* pool = nullptr;
+};
+
+} // namespace gt
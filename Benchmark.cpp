@@ -0,0 +1,173 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <utility>
+
+namespace gt
+{
+
+namespace
+{
+
+/// Finds <c>"key": </c> in <paramref name="line"/> and returns what follows.
+char const* FindValue(char const* line, char const* key)
+{
+    std::string const pattern = std::string("\"") + key + "\":";
+    char const* found = std::strstr(line, pattern.c_str());
+    if (!found)
+        return nullptr;
+
+    found += pattern.size();
+    while (*found == ' ')
+        ++found;
+    return found;
+}
+
+bool ReadNumber(char const* line, char const* key, double& value)
+{
+    char const* const text = FindValue(line, key);
+    if (!text)
+        return false;
+
+    char* end = nullptr;
+    value = strtod(text, &end);
+    return end != text;
+}
+
+bool ReadString(char const* line, char const* key, std::string& value)
+{
+    char const* text = FindValue(line, key);
+    if (!text || *text != '"')
+        return false;
+
+    value.clear();
+    for (++text; *text && *text != '"'; ++text) {
+        if (*text == '\\' && text[1])
+            ++text;
+        value += *text;
+    }
+    return *text == '"';
+}
+
+void PrintResult(BenchmarkResult const& result)
+{
+    fprintf(stderr, "%-56s %12.1f ns/op", result.name.c_str(), result.nsPerOp);
+    if (result.itemsPerSecond > 0.0)
+        fprintf(stderr, " %10.1f M/s", result.itemsPerSecond / 1e6);
+    fprintf(stderr, "\n");
+}
+
+} // namespace
+
+BenchmarkRunner::BenchmarkRunner(BenchmarkOptions options)
+    : options(std::move(options))
+{
+    this->options.samples = std::max(this->options.samples, 1u);
+}
+
+bool BenchmarkRunner::IsEnabled(std::string const& name) const
+{
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+void BenchmarkRunner::Record(std::string const& name, uint64_t iterations,
+                             std::vector<double>& secondsPerOp, double itemsPerOp)
+{
+    std::sort(secondsPerOp.begin(), secondsPerOp.end());
+    double const median = secondsPerOp[secondsPerOp.size() / 2];
+
+    BenchmarkResult& result = results.emplace_back();
+    result.name = name;
+    result.iterations = iterations;
+    result.nsPerOp = median * 1e9;
+    result.minNsPerOp = secondsPerOp.front() * 1e9;
+    result.itemsPerSecond = itemsPerOp > 0.0 ? itemsPerOp / median : 0.0;
+    PrintResult(result);
+}
+
+void BenchmarkRunner::Add(BenchmarkResult result)
+{
+    if (!IsEnabled(result.name))
+        return;
+
+    PrintResult(result);
+    results.push_back(std::move(result));
+}
+
+void WriteBenchmarkJson(FILE* file, std::vector<BenchmarkResult> const& results)
+{
+    fprintf(file, "{\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        BenchmarkResult const& result = results[i];
+
+        std::string name;
+        for (char const c : result.name) {
+            if (c == '"' || c == '\\')
+                name += '\\';
+            name += c;
+        }
+
+        fprintf(file,
+                "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f, "
+                "\"min_ns_per_op\": %.3f, \"items_per_second\": %.1f}%s\n",
+                name.c_str(), static_cast<unsigned long long>(result.iterations),
+                result.nsPerOp, result.minNsPerOp, result.itemsPerSecond,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
+
+bool ReadBenchmarkJson(FILE* file, std::vector<BenchmarkResult>& results)
+{
+    char line[1024];
+    while (fgets(line, sizeof(line), file)) {
+        BenchmarkResult result;
+        if (!ReadString(line, "name", result.name))
+            continue;
+
+        double iterations = 0.0;
+        if (!ReadNumber(line, "ns_per_op", result.nsPerOp))
+            return false;
+        ReadNumber(line, "iterations", iterations);
+        ReadNumber(line, "min_ns_per_op", result.minNsPerOp);
+        ReadNumber(line, "items_per_second", result.itemsPerSecond);
+        result.iterations = static_cast<uint64_t>(iterations);
+        results.push_back(std::move(result));
+    }
+    return !ferror(file);
+}
+
+unsigned CompareBenchmarks(std::vector<BenchmarkResult> const& baseline,
+                           std::vector<BenchmarkResult> const& current, double threshold,
+                           FILE* out)
+{
+    std::map<std::string, BenchmarkResult const*> baselineByName;
+    for (BenchmarkResult const& result : baseline)
+        baselineByName[result.name] = &result;
+
+    unsigned regressions = 0;
+    unsigned compared = 0;
+    for (BenchmarkResult const& result : current) {
+        auto const found = baselineByName.find(result.name);
+        if (found == baselineByName.end() || found->second->nsPerOp <= 0.0)
+            continue;
+
+        double const change = result.nsPerOp / found->second->nsPerOp - 1.0;
+        bool const regressed = change > threshold;
+        regressions += regressed;
+        ++compared;
+
+        fprintf(out, "%-56s %12.1f -> %12.1f ns/op %+7.1f%%%s\n", result.name.c_str(),
+                found->second->nsPerOp, result.nsPerOp, change * 100.0,
+                regressed ? "  REGRESSION" : "");
+    }
+
+    fprintf(out, "%u benchmarks compared, %u regressed by more than %.1f%%\n", compared,
+            regressions, threshold * 100.0);
+    return regressions;
+}
+
+} // namespace gt
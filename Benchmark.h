@@ -0,0 +1,120 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace gt
+{
+
+struct BenchmarkResult
+{
+    /// Benchmark and parameters, e.g. "glitch/simd/bilinear/1920x1080/i0.75/t8".
+    /// Results are matched by name when comparing runs.
+    std::string name;
+    uint64_t iterations = 0;
+    /// Median and fastest time per operation over all samples.
+    double nsPerOp = 0.0;
+    double minNsPerOp = 0.0;
+    /// Items (pixels, numbers, ...) processed per second, 0 if not applicable.
+    double itemsPerSecond = 0.0;
+};
+
+struct BenchmarkOptions
+{
+    /// Minimum duration of one sample; fast operations are batched up to it.
+    double minSampleTime = 0.02;
+    unsigned samples = 7;
+    /// Runs only benchmarks whose name contains this text.
+    std::string filter;
+};
+
+/// <summary>
+///   Times operations and collects the results. Each benchmark is run in
+///   batches long enough to make the clock resolution irrelevant; the median
+///   over several batches is reported so that a single hiccup does not skew
+///   the result.
+/// </summary>
+class BenchmarkRunner
+{
+public:
+    explicit BenchmarkRunner(BenchmarkOptions options = {});
+
+    /// Whether a benchmark of that name passes the filter. Lets callers skip
+    /// expensive setup.
+    bool IsEnabled(std::string const& name) const;
+
+    /// <summary>
+    ///   Measures <c>body()</c> and records the result under
+    ///   <paramref name="name"/>. <paramref name="itemsPerOp"/> is used for the
+    ///   throughput. Does nothing if the name does not pass the filter.
+    /// </summary>
+    template<typename Body>
+    void Run(std::string const& name, double itemsPerOp, Body&& body)
+    {
+        if (!IsEnabled(name))
+            return;
+
+        auto timeBatch = [&](uint64_t batch) {
+            auto const start = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < batch; ++i)
+                body();
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                 start)
+                .count();
+        };
+
+        // Warm up caches and pools, then grow the batch to the sample time.
+        uint64_t batch = 1;
+        double elapsed = timeBatch(batch);
+        while (elapsed < options.minSampleTime) {
+            batch *= elapsed > 0.0
+                         ? std::max<uint64_t>(2, static_cast<uint64_t>(
+                                                     options.minSampleTime / elapsed))
+                         : 16;
+            elapsed = timeBatch(batch);
+        }
+
+        std::vector<double> samples;
+        samples.reserve(options.samples);
+        for (unsigned i = 0; i < options.samples; ++i)
+            samples.push_back(timeBatch(batch) / batch);
+
+        Record(name, batch * options.samples, samples, itemsPerOp);
+    }
+
+    /// Records a result measured by the caller, for benchmarks that need
+    /// their own timing loop. Filtered like <see cref="Run"/>.
+    void Add(BenchmarkResult result);
+
+    std::vector<BenchmarkResult> const& GetResults() const { return results; }
+
+private:
+    void Record(std::string const& name, uint64_t iterations,
+                std::vector<double>& secondsPerOp, double itemsPerOp);
+
+    BenchmarkOptions options;
+    std::vector<BenchmarkResult> results;
+};
+
+/// Writes results as JSON, one benchmark per line.
+void WriteBenchmarkJson(FILE* file, std::vector<BenchmarkResult> const& results);
+
+/// <summary>
+///   Reads results written by <see cref="WriteBenchmarkJson"/>. Only the
+///   layout produced by that function is understood, not arbitrary JSON.
+/// </summary>
+bool ReadBenchmarkJson(FILE* file, std::vector<BenchmarkResult>& results);
+
+/// <summary>
+///   Prints the change of every benchmark present in both runs and returns
+///   the number of regressions, benchmarks whose median time grew by more
+///   than <paramref name="threshold"/> (e.g. 0.05 for 5%).
+/// </summary>
+unsigned CompareBenchmarks(std::vector<BenchmarkResult> const& baseline,
+                           std::vector<BenchmarkResult> const& current, double threshold,
+                           FILE* out);
+
+} // namespace gt
@@ -0,0 +1,833 @@
+#include "Arena.h"
+#include "Benchmark.h"
+#include "CommandLine.h"
+#include "Conformance.h"
+#include "CpuBackend.h"
+#include "CpuGlitch.h"
+#include "ImageIO.h"
+#include "NoiseGrid.h"
+#include "PixelFormat.h"
+#include "Random.h"
+#include "RenderContext.h"
+#include "ScheduleCheck.h"
+#include "SyntheticDesktop.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace gt
+{
+
+namespace
+{
+
+void PrintUsage()
+{
+    fprintf(stderr,
+            "Usage:\n"
+            "  GlitchBench [run] [options]\n"
+            "\n"
+            "Runs the microbenchmarks and writes the results as JSON.\n"
+            "\n"
+            "Options:\n"
+            "  --output <file|->      JSON output (default: none)\n"
+            "  --baseline <file>      Compare against a stored run and fail on\n"
+            "                         regressions\n"
+            "  --threshold PCT        Slowdown counted as a regression (default: 5)\n"
+            "  --filter TEXT          Only benchmarks whose name contains TEXT\n"
+            "  --sizes LIST           Resolutions, 1080p, 4k, 8k or WxH\n"
+            "                         (default: 1080p,4k,8k)\n"
+            "  --intensities LIST     Glitch intensities (default: 0.25,0.75)\n"
+            "  --threads LIST         Thread counts, 0 for all cores (default: 1,0)\n"
+            "  --kernels LIST         scalar, integer, simd, blit\n"
+            "                         (default: integer,simd,blit)\n"
+            "  --min-time SECONDS     Minimum time per sample (default: 0.02)\n"
+            "  --samples N            Samples per benchmark (default: 7)\n"
+            "\n"
+            "  GlitchBench burst [options] [--dirty LIST] [--bursts N]\n"
+            "\n"
+            "Renders whole glitch bursts of a synthetic desktop through the CPU\n"
+            "backend and reports burst latency percentiles and frames per second,\n"
+            "per size, dirty fraction (default: 0.02,0.1,0.5), thread count and\n"
+            "kernel. --bursts sets the measured bursts per case (default: 30).\n"
+            "\n"
+            "  GlitchBench conform [options]\n"
+            "\n"
+            "Renders fixed-seed bursts through every CPU kernel, in every pixel\n"
+            "format and as 4:2:0, and checks that they match. Exits with 1 on any\n"
+            "mismatch.\n"
+            "\n"
+            "Options:\n"
+            "  --sizes LIST           Resolutions (default: 1080p,4k)\n"
+            "  --bursts N             Bursts per size (default: 2)\n"
+            "  --frames N             Frames per burst (default: 6)\n"
+            "  --tolerance N          Channel difference allowed for the scalar\n"
+            "                         reference, in units of the last bit of the\n"
+            "                         format (default: 2)\n"
+            "  --rows N               Rows of every frame compared, in bands spread\n"
+            "                         over taller frames, 0 for all (default: 1080)\n"
+            "  --scalar-rows N        Same for the scalar reference (default: 270)\n"
+            "  --seed N               Seed of the desktop and noise (default: 1)\n"
+            "  --threads N            Render threads, 0 for all cores (default: 0)\n"
+            "  --mismatch-maps DIR    Save a PPM map of the first failing frame\n"
+            "\n"
+            "  GlitchBench schedule [--bursts N]\n"
+            "\n"
+            "Steps N glitch bursts (default: 20) frame by frame through a scripted\n"
+            "backend on a manual clock and checks the frames they yield, the\n"
+            "capture refreshes and the quality levels the governor picks. Exits\n"
+            "with 1 on any mismatch.\n"
+            "\n"
+            "  GlitchBench compare <baseline> <current> [--threshold PCT]\n"
+            "\n"
+            "Compares two stored runs. Exits with 1 if any benchmark regressed.\n");
+}
+
+struct Size
+{
+    unsigned width;
+    unsigned height;
+};
+
+struct BenchOptions
+{
+    BenchmarkOptions runner;
+    std::vector<Size> sizes = {{1920, 1080}, {3840, 2160}, {7680, 4320}};
+    std::vector<float> intensities = {0.25f, 0.75f};
+    std::vector<unsigned> threads = {1, 0};
+    std::vector<GlitchKernel> kernels = {GlitchKernel::Integer, GlitchKernel::Simd,
+                                         GlitchKernel::Blit};
+    std::vector<float> dirtyFractions = {0.02f, 0.1f, 0.5f};
+    unsigned bursts = 30;
+    char const* output = nullptr;
+    char const* baseline = nullptr;
+    double threshold = 0.05;
+};
+
+bool ParseDouble(char const* text, double& value)
+{
+    char* end = nullptr;
+    value = strtod(text, &end);
+    return end != text && *end == '\0';
+}
+
+bool ParseIntensity(char const* text, float& intensity)
+{
+    double parsed;
+    if (!ParseDouble(text, parsed) || parsed < 0.0 || parsed > 1.0)
+        return false;
+    intensity = static_cast<float>(parsed);
+    return true;
+}
+
+bool ParseResolution(char const* text, Size& size)
+{
+    std::string_view const name = text;
+    if (name == "1080p") {
+        size = {1920, 1080};
+    } else if (name == "4k") {
+        size = {3840, 2160};
+    } else if (name == "8k") {
+        size = {7680, 4320};
+    } else {
+        return ParseSize(text, size.width, size.height);
+    }
+    return true;
+}
+
+char const* GetKernelName(GlitchKernel kernel)
+{
+    switch (kernel) {
+    case GlitchKernel::Scalar:
+        return "scalar";
+    case GlitchKernel::Integer:
+        return "integer";
+    case GlitchKernel::Simd:
+        return "simd";
+    case GlitchKernel::Blit:
+        return "blit";
+    }
+    return "unknown";
+}
+
+bool ParseKernel(char const* text, GlitchKernel& kernel)
+{
+    for (GlitchKernel const candidate : {GlitchKernel::Scalar, GlitchKernel::Integer,
+                                         GlitchKernel::Simd, GlitchKernel::Blit}) {
+        if (std::string_view(text) == GetKernelName(candidate)) {
+            kernel = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Parses a comma separated list with <c>parse(text, value)</c> per item.
+template<typename T, typename Parse>
+bool ParseList(char const* text, std::vector<T>& values, Parse&& parse)
+{
+    values.clear();
+    std::string const list = text;
+    size_t begin = 0;
+    while (begin <= list.size()) {
+        size_t end = list.find(',', begin);
+        if (end == std::string::npos)
+            end = list.size();
+
+        T value;
+        if (!parse(list.substr(begin, end - begin).c_str(), value))
+            return false;
+        values.push_back(value);
+        begin = end + 1;
+    }
+    return !values.empty();
+}
+
+bool ParseBenchOptions(int argc, char** argv, BenchOptions& options)
+{
+    auto const handler = [&](std::string_view arg, char const* value) {
+        if (arg == "--output") {
+            options.output = value;
+        } else if (arg == "--baseline") {
+            options.baseline = value;
+        } else if (arg == "--threshold") {
+            bool const valid = ParseDouble(value, options.threshold);
+            options.threshold /= 100.0;
+            return Check(valid && options.threshold >= 0.0);
+        } else if (arg == "--filter") {
+            options.runner.filter = value;
+        } else if (arg == "--sizes") {
+            return Check(ParseList(value, options.sizes, ParseResolution));
+        } else if (arg == "--intensities") {
+            return Check(ParseList(value, options.intensities, ParseIntensity));
+        } else if (arg == "--threads") {
+            return Check(ParseList(value, options.threads, ParseUnsigned));
+        } else if (arg == "--kernels") {
+            return Check(ParseList(value, options.kernels, ParseKernel));
+        } else if (arg == "--dirty") {
+            return Check(ParseList(value, options.dirtyFractions, ParseIntensity));
+        } else if (arg == "--bursts") {
+            return Check(ParseUnsigned(value, options.bursts) && options.bursts > 0);
+        } else if (arg == "--min-time") {
+            return Check(ParseDouble(value, options.runner.minSampleTime) &&
+                         options.runner.minSampleTime > 0.0);
+        } else if (arg == "--samples") {
+            return Check(ParseUnsigned(value, options.runner.samples) &&
+                         options.runner.samples > 0);
+        } else {
+            return OptionResult::Unknown;
+        }
+        return OptionResult::Valid;
+    };
+    return ParseOptions(argc, argv, handler);
+}
+
+std::string FormatName(char const* format, ...)
+{
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    return buffer;
+}
+
+/// Keeps results of benchmarked code alive without the optimizer noticing.
+uint64_t volatile benchmarkSink;
+
+/// Smooth gradients with some texture, roughly like a desktop.
+void FillTestImage(ImageBuffer& image, uint64_t seed)
+{
+    xorshift128_engine rng(seed, ~seed);
+    for (unsigned y = 0; y < image.Height(); ++y) {
+        uint32_t* const row = image.Row(y);
+        for (unsigned x = 0; x < image.Width(); ++x) {
+            uint32_t const b = (x * 255 / image.Width()) & 0xFF;
+            uint32_t const g = (y * 255 / image.Height()) & 0xFF;
+            uint32_t const r = static_cast<uint32_t>(rng()) & 0x3F;
+            row[x] = b | (g << 8) | ((r + 96) << 16) | 0xFF000000;
+        }
+    }
+}
+
+void BenchRandom(BenchmarkRunner& runner)
+{
+    constexpr unsigned Count = 1024;
+
+    xorshift128_engine rng(1, 2);
+    runner.Run("rng/xorshift128", Count, [&] {
+        uint64_t sum = 0;
+        for (unsigned i = 0; i < Count; ++i)
+            sum += rng();
+        benchmarkSink = sum;
+    });
+
+    runner.Run("rng/RandomFloat", Count, [&] {
+        float sum = 0.0f;
+        for (unsigned i = 0; i < Count; ++i)
+            sum += RandomFloat();
+        benchmarkSink = static_cast<uint64_t>(sum);
+    });
+
+    NoiseGrid noise;
+    runner.Run("noise/generate", static_cast<double>(noise.texels.size()), [&] {
+        noise.Generate();
+        benchmarkSink = noise.texels[0];
+    });
+}
+
+void BenchConversions(BenchmarkRunner& runner, BenchOptions const& options)
+{
+    constexpr unsigned Count = 4096;
+
+    std::vector<float> floats(Count);
+    std::vector<uint16_t> halves(Count);
+    for (unsigned i = 0; i < Count; ++i)
+        floats[i] = static_cast<float>(i) / Count * 4.0f - 1.0f;
+
+    runner.Run("convert/float-to-half", Count, [&] {
+        for (unsigned i = 0; i < Count; ++i)
+            halves[i] = FloatToHalf(floats[i]);
+        benchmarkSink = halves[Count / 2];
+    });
+
+    runner.Run("convert/half-to-float", Count, [&] {
+        for (unsigned i = 0; i < Count; ++i)
+            floats[i] = HalfToFloat(halves[i]);
+        benchmarkSink = static_cast<uint64_t>(floats[Count / 2]);
+    });
+
+    for (Size const size : options.sizes) {
+        std::string const toYuv =
+            FormatName("convert/bgra-to-i420/%ux%u", size.width, size.height);
+        std::string const toBgra =
+            FormatName("convert/i420-to-bgra/%ux%u", size.width, size.height);
+        if (!runner.IsEnabled(toYuv) && !runner.IsEnabled(toBgra))
+            continue;
+
+        double const pixels = double(size.width) * size.height;
+        ImageBuffer image(size.width, size.height);
+        FillTestImage(image, 1);
+        YuvImage yuv;
+
+        runner.Run(toYuv, pixels, [&] { ConvertBgraToI420(image, yuv); });
+        ConvertBgraToI420(image, yuv);
+        runner.Run(toBgra, pixels, [&] { ConvertI420ToBgra(yuv, image); });
+    }
+}
+
+void BenchPlans(BenchmarkRunner& runner, BenchOptions const& options)
+{
+    xorshift128_engine rng(3, 4);
+    NoiseGrid noise;
+    noise.Generate(rng);
+
+    Arena arena;
+    GlitchPlan plan;
+    plan.sampling = GlitchSampling::Nearest;
+
+    for (Size const size : options.sizes) {
+        for (float const intensity : options.intensities) {
+            runner.Run(FormatName("plan/compile/%ux%u/i%.2f", size.width, size.height,
+                                  intensity),
+                       0.0, [&] {
+                           plan.Compile(noise, intensity, size.width, size.height);
+                       });
+
+            runner.Run(FormatName("plan/compile-blits/%ux%u/i%.2f", size.width,
+                                  size.height, intensity),
+                       0.0, [&] {
+                           ArenaScope const scope(arena);
+                           plan.Compile(noise, intensity, size.width, size.height,
+                                        &arena);
+                           benchmarkSink = plan.blits.size();
+                       });
+        }
+    }
+}
+
+/// Times <c>body(rowBegin, rowEnd)</c> over <paramref name="rows"/> rows split
+/// into bands across <paramref name="pool"/>, like the backends do.
+template<typename Body>
+void RunRowBands(BenchmarkRunner& runner, std::string const& name, double pixels,
+                 ThreadPool& pool, unsigned rows, Body&& body)
+{
+    runner.Run(name, pixels, [&] { ForEachRowBand(&pool, rows, body); });
+}
+
+void BenchKernels(BenchmarkRunner& runner, BenchOptions const& options)
+{
+    xorshift128_engine rng(5, 6);
+    NoiseGrid noise;
+    noise.Generate(rng);
+
+    Arena arena;
+
+    for (Size const size : options.sizes) {
+        double const pixels = double(size.width) * size.height;
+
+        ImageBuffer source(size.width, size.height);
+        ImageBuffer trash(size.width, size.height);
+        ImageBuffer dest(size.width, size.height);
+        FillTestImage(source, 7);
+        FillTestImage(trash, 8);
+
+        YuvImage yuvSource;
+        YuvImage yuvTrash;
+        YuvImage yuvDest(size.width, size.height);
+        ConvertBgraToI420(source, yuvSource);
+        ConvertBgraToI420(trash, yuvTrash);
+
+        for (unsigned const threadCount : options.threads) {
+            ThreadPool pool(threadCount);
+            unsigned const threads = pool.ThreadCount();
+
+            for (float const intensity : options.intensities) {
+                for (GlitchKernel const kernel : options.kernels) {
+                    for (GlitchSampling const sampling :
+                         {GlitchSampling::Bilinear, GlitchSampling::Nearest}) {
+                        if (kernel == GlitchKernel::Blit &&
+                            sampling != GlitchSampling::Nearest)
+                            continue;
+
+                        char const* const samplingName =
+                            sampling == GlitchSampling::Nearest ? "nearest" : "bilinear";
+
+                        ArenaScope const scope(arena);
+                        GlitchPlan plan;
+                        plan.sampling = sampling;
+                        plan.Compile(noise, intensity, size.width, size.height,
+                                     kernel == GlitchKernel::Blit ? &arena : nullptr);
+
+                        std::string const name = FormatName(
+                            "%s/%s/%ux%u/i%.2f/t%u", GetKernelName(kernel), samplingName,
+                            size.width, size.height, intensity, threads);
+
+                        RunRowBands(runner, "glitch/" + name, pixels, pool, size.height,
+                                    [&](unsigned rowBegin, unsigned rowEnd) {
+                                        RenderDigitalGlitch<PixelFormat::Bgra8>(
+                                            kernel, plan, source.View(), trash.View(),
+                                            dest.View(), rowBegin, rowEnd);
+                                    });
+
+                        GlitchPlan chromaPlan;
+                        chromaPlan.sampling = sampling;
+                        chromaPlan.Compile(noise, intensity, yuvSource.ChromaWidth(),
+                                           yuvSource.ChromaHeight());
+
+                        RunRowBands(runner, "glitch-yuv/" + name, pixels, pool,
+                                    yuvSource.ChromaHeight(),
+                                    [&](unsigned rowBegin, unsigned rowEnd) {
+                                        RenderDigitalGlitch(kernel, plan, chromaPlan,
+                                                            yuvSource, yuvTrash, yuvDest,
+                                                            rowBegin, rowEnd);
+                                    });
+                    }
+                }
+
+                CpuChromaticSplit split;
+                split.intensity = intensity;
+                split.Update();
+                RunRowBands(runner,
+                            FormatName("split/%ux%u/i%.2f/t%u", size.width, size.height,
+                                       intensity, threads),
+                            pixels, pool, size.height,
+                            [&](unsigned rowBegin, unsigned rowEnd) {
+                                split.OnRenderImage(source, dest, rowBegin, rowEnd);
+                            });
+            }
+        }
+    }
+}
+
+/// <summary>
+///   Same glitch and RGB split cases as <see cref="BenchKernels"/> on frames
+///   of a deeper format, as HDR desktops are glitched in.
+/// </summary>
+template<PixelFormat Format>
+void BenchFormatKernels(BenchmarkRunner& runner, BenchOptions const& options)
+{
+    xorshift128_engine rng(5, 6);
+    NoiseGrid noise;
+    noise.Generate(rng);
+
+    Arena arena;
+    char const* const formatName = GetPixelFormatName(Format);
+
+    for (Size const size : options.sizes) {
+        double const pixels = double(size.width) * size.height;
+
+        BasicImageBuffer<Format> source(size.width, size.height);
+        BasicImageBuffer<Format> trash(size.width, size.height);
+        BasicImageBuffer<Format> dest(size.width, size.height);
+        {
+            ImageBuffer bgra(size.width, size.height);
+            FillTestImage(bgra, 7);
+            ConvertFromBgra<Format>(bgra.View(), source.View());
+            FillTestImage(bgra, 8);
+            ConvertFromBgra<Format>(bgra.View(), trash.View());
+        }
+
+        for (unsigned const threadCount : options.threads) {
+            ThreadPool pool(threadCount);
+            unsigned const threads = pool.ThreadCount();
+
+            for (float const intensity : options.intensities) {
+                for (GlitchKernel const kernel : options.kernels) {
+                    for (GlitchSampling const sampling :
+                         {GlitchSampling::Bilinear, GlitchSampling::Nearest}) {
+                        if (kernel == GlitchKernel::Blit &&
+                            sampling != GlitchSampling::Nearest)
+                            continue;
+
+                        char const* const samplingName =
+                            sampling == GlitchSampling::Nearest ? "nearest" : "bilinear";
+
+                        ArenaScope const scope(arena);
+                        GlitchPlan plan;
+                        plan.sampling = sampling;
+                        plan.Compile(noise, intensity, size.width, size.height,
+                                     kernel == GlitchKernel::Blit ? &arena : nullptr);
+
+                        RunRowBands(runner,
+                                    FormatName("glitch-%s/%s/%s/%ux%u/i%.2f/t%u",
+                                               formatName, GetKernelName(kernel),
+                                               samplingName, size.width, size.height,
+                                               intensity, threads),
+                                    pixels, pool, size.height,
+                                    [&](unsigned rowBegin, unsigned rowEnd) {
+                                        RenderDigitalGlitch<Format>(
+                                            kernel, plan, source.View(), trash.View(),
+                                            dest.View(), rowBegin, rowEnd);
+                                    });
+                    }
+                }
+
+                // Same shifts as CpuChromaticSplit::Update.
+                float const maxShiftX = CpuChromaticSplit::MaxShiftX;
+                float const maxShiftY = CpuChromaticSplit::MaxShiftY;
+                int const shiftX = static_cast<int>(std::lround(intensity * maxShiftX));
+                int const shiftY = static_cast<int>(std::lround(intensity * maxShiftY));
+                RunRowBands(runner,
+                            FormatName("split-%s/%ux%u/i%.2f/t%u", formatName, size.width,
+                                       size.height, intensity, threads),
+                            pixels, pool, size.height,
+                            [&](unsigned rowBegin, unsigned rowEnd) {
+                                RenderChromaticSplit<Format>(source.View(), dest.View(),
+                                                             shiftX, shiftY, rowBegin,
+                                                             rowEnd);
+                            });
+            }
+        }
+    }
+}
+
+/// Nearest-rank percentile of <paramref name="sorted"/>.
+double Percentile(std::vector<double> const& sorted, double fraction)
+{
+    size_t const rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+/// <summary>
+///   Renders <paramref name="bursts"/> bursts of <paramref name="desktop"/>
+///   through the CPU backend, the way the application does with capture
+///   refreshes and all, and records their latency percentiles and the mean
+///   frame time.
+/// </summary>
+void RunBursts(BenchmarkRunner& runner, std::string const& name, ThreadPool& pool,
+               SyntheticDesktopOptions const& desktop, GlitchKernel kernel,
+               unsigned bursts)
+{
+    constexpr unsigned WarmUpBursts = 2;
+
+    auto backend =
+        std::make_unique<CpuBackend>(std::make_unique<SyntheticDesktopSource>(desktop));
+    CpuBackend& cpu = *backend;
+    cpu.SetThreadPool(&pool);
+    cpu.digitalGlitch.kernel = kernel;
+
+    RenderContext rc;
+    HRESULT hr = cpu.Initialize();
+    if (SUCCEEDED(hr))
+        hr = rc.Initialize(std::move(backend));
+    for (unsigned i = 0; i < WarmUpBursts && SUCCEEDED(hr); ++i)
+        hr = rc.RenderFrame();
+
+    unsigned const firstFrame = cpu.GetPresentedFrames();
+    std::vector<double> latencies;
+    latencies.reserve(bursts);
+    for (unsigned i = 0; i < bursts && SUCCEEDED(hr); ++i) {
+        auto const start = std::chrono::steady_clock::now();
+        hr = rc.RenderFrame();
+        latencies.push_back(
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                .count());
+    }
+    if (FAILED(hr)) {
+        fprintf(stderr, "%s failed: 0x%08X\n", name.c_str(), static_cast<unsigned>(hr));
+        return;
+    }
+
+    double total = 0.0;
+    for (double const latency : latencies)
+        total += latency;
+    unsigned const frames = cpu.GetPresentedFrames() - firstFrame;
+    double const framesPerSecond = frames / total;
+    double const pixelsPerSecond = framesPerSecond * desktop.width * desktop.height;
+
+    // Percentiles are per burst; burst lengths are random like in the
+    // application, so they include that spread. The frame time is the mean.
+    std::sort(latencies.begin(), latencies.end());
+    auto const add = [&](char const* statistic, double seconds, uint64_t iterations,
+                         double minSeconds) {
+        BenchmarkResult result;
+        result.name = name + "/" + statistic;
+        result.iterations = iterations;
+        result.nsPerOp = seconds * 1e9;
+        result.minNsPerOp = minSeconds * 1e9;
+        result.itemsPerSecond = pixelsPerSecond;
+        runner.Add(std::move(result));
+    };
+    add("p50", Percentile(latencies, 0.5), bursts, latencies.front());
+    add("p90", Percentile(latencies, 0.9), bursts, latencies.front());
+    add("p99", Percentile(latencies, 0.99), bursts, latencies.front());
+    add("max", latencies.back(), bursts, latencies.front());
+    add("frame", total / frames, frames, total / frames);
+
+    fprintf(stderr, "%s: %u bursts, %u frames, %.1f fps, p50 %.2f ms, p99 %.2f ms\n",
+            name.c_str(), bursts, frames, framesPerSecond,
+            Percentile(latencies, 0.5) * 1e3, Percentile(latencies, 0.99) * 1e3);
+}
+
+void BenchBursts(BenchmarkRunner& runner, BenchOptions const& options)
+{
+    for (unsigned const threadCount : options.threads) {
+        ThreadPool pool(threadCount);
+        unsigned const threads = pool.ThreadCount();
+
+        for (Size const size : options.sizes) {
+            for (float const dirty : options.dirtyFractions) {
+                SyntheticDesktopOptions desktop;
+                desktop.width = size.width;
+                desktop.height = size.height;
+                desktop.dirtyFraction = dirty;
+
+                for (GlitchKernel const kernel : options.kernels) {
+                    std::string const name =
+                        FormatName("burst/%s/%ux%u/d%.2f/t%u", GetKernelName(kernel),
+                                   size.width, size.height, dirty, threads);
+                    if (runner.IsEnabled(name) || runner.IsEnabled(name + "/frame"))
+                        RunBursts(runner, name, pool, desktop, kernel, options.bursts);
+                }
+            }
+        }
+    }
+}
+
+bool LoadResults(char const* path, std::vector<BenchmarkResult>& results)
+{
+    FILE* const file = OpenStream(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+
+    bool const read = ReadBenchmarkJson(file, results);
+    CloseStream(file);
+    if (!read)
+        fprintf(stderr, "Cannot read benchmark results from %s\n", path);
+    return read;
+}
+
+int RunBenchmarks(int argc, char** argv, bool bursts)
+{
+    BenchOptions options;
+    if (!ParseBenchOptions(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<BenchmarkResult> baseline;
+    if (options.baseline && !LoadResults(options.baseline, baseline))
+        return 1;
+
+    BenchmarkRunner runner(options.runner);
+    if (bursts) {
+        BenchBursts(runner, options);
+    } else {
+        BenchRandom(runner);
+        BenchConversions(runner, options);
+        BenchPlans(runner, options);
+        BenchKernels(runner, options);
+        BenchFormatKernels<PixelFormat::Rgb10A2>(runner, options);
+        BenchFormatKernels<PixelFormat::Rgba16>(runner, options);
+        BenchFormatKernels<PixelFormat::Rgba16F>(runner, options);
+    }
+
+    if (options.output) {
+        FILE* const output = OpenStream(options.output, "wb");
+        if (!output) {
+            fprintf(stderr, "Cannot open %s for writing\n", options.output);
+            return 1;
+        }
+        WriteBenchmarkJson(output, runner.GetResults());
+        CloseStream(output);
+    }
+
+    if (options.baseline &&
+        CompareBenchmarks(baseline, runner.GetResults(), options.threshold, stderr) > 0)
+        return 1;
+    return 0;
+}
+
+int RunCompare(int argc, char** argv)
+{
+    if (argc < 2) {
+        PrintUsage();
+        return 1;
+    }
+
+    double threshold = 0.05;
+    auto const handler = [&](std::string_view arg, char const* value) {
+        if (arg == "--threshold") {
+            bool const valid = ParseDouble(value, threshold);
+            threshold /= 100.0;
+            return Check(valid && threshold >= 0.0);
+        }
+        return OptionResult::Unknown;
+    };
+    if (!ParseOptions(argc - 2, argv + 2, handler)) {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<BenchmarkResult> baseline;
+    std::vector<BenchmarkResult> current;
+    if (!LoadResults(argv[0], baseline) || !LoadResults(argv[1], current))
+        return 1;
+
+    return CompareBenchmarks(baseline, current, threshold, stdout) > 0 ? 1 : 0;
+}
+
+int RunConformanceCommand(int argc, char** argv)
+{
+    std::vector<Size> sizes = {{1920, 1080}, {3840, 2160}};
+    ConformanceOptions options;
+    unsigned threads = 0;
+    unsigned seed = 1;
+
+    auto const handler = [&](std::string_view arg, char const* value) {
+        if (arg == "--sizes") {
+            return Check(ParseList(value, sizes, ParseResolution));
+        } else if (arg == "--bursts") {
+            return Check(ParseUnsigned(value, options.bursts) && options.bursts > 0);
+        } else if (arg == "--frames") {
+            return Check(ParseUnsigned(value, options.framesPerBurst) &&
+                         options.framesPerBurst > 0);
+        } else if (arg == "--tolerance") {
+            return Check(ParseUnsigned(value, options.tolerance));
+        } else if (arg == "--rows") {
+            return Check(ParseUnsigned(value, options.kernelRows));
+        } else if (arg == "--scalar-rows") {
+            return Check(ParseUnsigned(value, options.scalarRows));
+        } else if (arg == "--seed") {
+            return Check(ParseUnsigned(value, seed));
+        } else if (arg == "--threads") {
+            return Check(ParseUnsigned(value, threads));
+        } else if (arg == "--mismatch-maps") {
+            options.mismatchMapDir = value;
+            return OptionResult::Valid;
+        }
+        return OptionResult::Unknown;
+    };
+    if (!ParseOptions(argc, argv, handler)) {
+        PrintUsage();
+        return 1;
+    }
+    options.seed = seed;
+
+    ThreadPool pool(threads);
+    unsigned failures = 0;
+    for (Size const size : sizes) {
+        auto const start = std::chrono::steady_clock::now();
+        std::vector<ConformanceResult> const results =
+            RunConformance(size.width, size.height, options, &pool);
+        auto const elapsed = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start);
+
+        for (ConformanceResult const& result : results) {
+            failures += !result.Passed();
+            printf("%s %-40s max %3u  psnr %6.1f dB  %llu mismatches (tolerance %u)\n",
+                   result.Passed() ? "PASS" : "FAIL", result.name.c_str(),
+                   result.diff.maxError, result.diff.GetPsnr(),
+                   static_cast<unsigned long long>(result.diff.mismatches),
+                   result.tolerance);
+        }
+        fprintf(stderr, "%ux%u: %u frames in %.2f s\n", size.width, size.height,
+                options.bursts * options.framesPerBurst, elapsed.count());
+    }
+
+    printf("%u of the comparisons failed\n", failures);
+    return failures > 0 ? 1 : 0;
+}
+
+int RunScheduleCommand(int argc, char** argv)
+{
+    ScheduleCheckOptions options;
+    auto const handler = [&](std::string_view arg, char const* value) {
+        if (arg == "--bursts")
+            return Check(ParseUnsigned(value, options.bursts) && options.bursts > 0);
+        return OptionResult::Unknown;
+    };
+    if (!ParseOptions(argc, argv, handler)) {
+        PrintUsage();
+        return 1;
+    }
+
+    unsigned failures = 0;
+    for (ScheduleCheckResult const& result : RunScheduleCheck(options)) {
+        failures += !result.Passed();
+        printf("%s %-10s %u bursts, %u frames%s%s\n", result.Passed() ? "PASS" : "FAIL",
+               result.name.c_str(), result.bursts, result.frames,
+               result.Passed() ? "" : ": ", result.failure.c_str());
+    }
+
+    printf("%u of the checks failed\n", failures);
+    return failures > 0 ? 1 : 0;
+}
+
+} // namespace
+} // namespace gt
+
+int main(int argc, char** argv)
+{
+    using namespace gt;
+
+    std::string_view const command = argc >= 2 ? argv[1] : "";
+    if (command == "compare")
+        return RunCompare(argc - 2, argv + 2);
+    if (command == "conform")
+        return RunConformanceCommand(argc - 2, argv + 2);
+    if (command == "schedule")
+        return RunScheduleCommand(argc - 2, argv + 2);
+    if (command == "run")
+        return RunBenchmarks(argc - 2, argv + 2, false);
+    if (command == "burst")
+        return RunBenchmarks(argc - 2, argv + 2, true);
+    if (command == "help" || command == "--help") {
+        PrintUsage();
+        return 0;
+    }
+    return RunBenchmarks(argc - 1, argv + 1, false);
+}
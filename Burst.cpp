@@ -0,0 +1,36 @@
+#include "Burst.h"
+
+#include "RenderContext.h"
+
+#include <cassert>
+
+namespace gt
+{
+
+void* BurstStorage::Allocate(size_t bytes)
+{
+    assert(!inUse && "Only one burst per context can be in flight");
+
+    size_t const count = (bytes + sizeof(Header) - 1) / sizeof(Header) + 1;
+    if (count > capacity) {
+        blocks = std::make_unique<Header[]>(count);
+        capacity = count;
+    }
+
+    inUse = true;
+    blocks[0].storage = this;
+    return blocks.get() + 1;
+}
+
+void BurstStorage::Free(void* block)
+{
+    Header* const header = static_cast<Header*>(block) - 1;
+    header->storage->inUse = false;
+}
+
+void* Burst::promise_type::operator new(size_t bytes, RenderContext& context)
+{
+    return context.burstStorage.Allocate(bytes);
+}
+
+} // namespace gt
@@ -0,0 +1,128 @@
+#pragma once
+#include "Platform.h"
+
+#include <coroutine>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace gt
+{
+
+struct RenderContext;
+
+/// <summary>
+///   Memory for the coroutine of the current burst of a
+///   <see cref="RenderContext"/>, kept between bursts so that starting one
+///   does not allocate once warmed up. Holds one burst at a time.
+/// </summary>
+class BurstStorage
+{
+public:
+    void* Allocate(size_t bytes);
+    static void Free(void* block);
+
+private:
+    /// Header in front of every block, so that it can be returned without
+    /// knowing its context.
+    struct alignas(std::max_align_t) Header
+    {
+        BurstStorage* storage;
+    };
+
+    std::unique_ptr<Header[]> blocks;
+    size_t capacity = 0;
+    bool inUse = false;
+};
+
+/// <summary>
+///   Glitch burst that renders one frame each time it is resumed, so that
+///   hosts pace it themselves: a window between its messages, an offline
+///   renderer as fast as it can. Created by
+///   <see cref="RenderContext::StartBurst"/>; nothing is rendered before the
+///   first <see cref="Step"/>.
+/// </summary>
+class Burst
+{
+public:
+    struct promise_type
+    {
+        HRESULT result = S_OK;
+        unsigned frame = 0;
+
+        static void* operator new(size_t bytes, RenderContext& context);
+        static void operator delete(void* block) { BurstStorage::Free(block); }
+
+        Burst get_return_object()
+        {
+            return Burst(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+
+        std::suspend_always yield_value(unsigned renderedFrame) noexcept
+        {
+            frame = renderedFrame;
+            return {};
+        }
+
+        void return_value(HRESULT hr) noexcept { result = hr; }
+        void unhandled_exception() noexcept { result = E_UNEXPECTED; }
+    };
+
+    Burst() = default;
+    ~Burst() { Reset(); }
+
+    Burst(Burst&& other) noexcept
+        : handle(std::exchange(other.handle, nullptr))
+    {}
+
+    Burst& operator=(Burst&& other) noexcept
+    {
+        if (this != &other) {
+            Reset();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    Burst(Burst const&) = delete;
+    Burst& operator=(Burst const&) = delete;
+
+    /// Whether all frames are rendered, the burst failed, or there is none.
+    bool Done() const { return !handle || handle.done(); }
+
+    /// <summary>
+    ///   Renders the next frame. Returns false instead once the burst is
+    ///   over; <see cref="Result"/> then tells whether it succeeded.
+    /// </summary>
+    bool Step()
+    {
+        if (Done())
+            return false;
+        handle.resume();
+        return !handle.done();
+    }
+
+    /// Index of the frame rendered by the last <see cref="Step"/>.
+    unsigned Frame() const { return handle ? handle.promise().frame : 0; }
+
+    HRESULT Result() const { return handle ? handle.promise().result : S_OK; }
+
+    /// Abandons the remaining frames.
+    void Reset()
+    {
+        if (handle)
+            std::exchange(handle, nullptr).destroy();
+    }
+
+private:
+    explicit Burst(std::coroutine_handle<promise_type> handle)
+        : handle(handle)
+    {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+} // namespace gt
@@ -0,0 +1,245 @@
+#include "BurstPlan.h"
+
+#include "MathUtils.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace gt
+{
+
+namespace
+{
+
+/// Streams of random numbers of a job, so that no two choices share one.
+enum class JobStream : uint64_t
+{
+    BurstLength = 1,
+    Frame = 2,
+    Noise = 3,
+};
+
+/// Generator of the choices of one burst or frame of a job, seeded from its
+/// index alone.
+xorshift128_engine MakeEngine(uint64_t seed, JobStream stream, uint64_t index)
+{
+    uint64_t const key =
+        MixBits(MixBits(seed) ^ (static_cast<uint64_t>(stream) << 56) ^ index);
+    return xorshift128_engine(MixBits(key), MixBits(~key));
+}
+
+// Same schedule bursts used to roll as they went, and the same choices as
+// the digital glitch of the backends.
+
+int GetBurstFrames(float random)
+{
+    return static_cast<int>(15 + random * 40) & ~1;
+}
+
+float GetBurstIntensity(int index, int frames)
+{
+    return index < frames ? TriangleSeries(index, frames, 0.0f, 0.75f) : 0.0f;
+}
+
+bool RefreshesCapture(int index, int frames)
+{
+    return index < frames && (index % 10) == 9;
+}
+
+bool RegeneratesNoise(float random, float intensity)
+{
+    return random > Lerp(0.9f, 0.5f, intensity);
+}
+
+bool UsesTrashFrame2(float random)
+{
+    return !(random > 0.5f);
+}
+
+} // namespace
+
+BurstPlanner::BurstPlanner()
+    : uniform(0.0f, std::nextafter(1.0f, FLT_MAX))
+    , current(std::make_unique<BurstPlan>())
+    , next(std::make_unique<BurstPlan>())
+{
+    noise.Generate(rng);
+}
+
+BurstPlanner::~BurstPlanner()
+{
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeWorker.notify_one();
+        worker.join();
+    }
+}
+
+void BurstPlanner::PlanAhead()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (state != State::Idle)
+            return;
+        state = State::Planning;
+    }
+
+    if (worker.joinable())
+        wakeWorker.notify_one();
+    else
+        worker = std::thread([this] { WorkerMain(); });
+}
+
+BurstPlan const& BurstPlanner::TakePlan()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (state == State::Idle) {
+        // The worker only touches the plan while planning.
+        lock.unlock();
+        Plan(*next);
+        lock.lock();
+    } else {
+        planned.wait(lock, [this] { return state == State::Ready; });
+    }
+
+    state = State::Idle;
+    std::swap(current, next);
+    return *current;
+}
+
+void BurstPlanner::Plan(BurstPlan& plan)
+{
+    GT_STAGE_SCOPE(MetricStage::PlanBurst);
+
+    int const frames = GetBurstFrames(RandomFloat());
+    plan.frameCount = static_cast<unsigned>(frames) + 1;
+
+    unsigned noiseCount = 0;
+    plan.noise[noiseCount++] = noise;
+    for (int i = 0; i <= frames; ++i) {
+        BurstFrame& frame = plan.frames[i];
+        frame.intensity = GetBurstIntensity(i, frames);
+        frame.refreshCapture = RefreshesCapture(i, frames);
+
+        frame.noiseChanged = i == 0;
+        if (RegeneratesNoise(RandomFloat(), frame.intensity)) {
+            plan.noise[noiseCount].Generate(rng);
+            ++noiseCount;
+            frame.noiseChanged = true;
+        }
+        frame.noise = &plan.noise[noiseCount - 1];
+        frame.useTrashFrame2 = UsesTrashFrame2(RandomFloat());
+        frame.cells.Evaluate(*frame.noise, frame.intensity);
+    }
+
+    noise = plan.noise[noiseCount - 1];
+}
+
+float BurstPlanner::RandomFloat()
+{
+    return uniform(rng);
+}
+
+void BurstPlanner::WorkerMain()
+{
+    SetTraceThreadName("Burst planner");
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wakeWorker.wait(lock, [this] { return stopping || state == State::Planning; });
+        if (stopping)
+            return;
+
+        lock.unlock();
+        Plan(*next);
+        lock.lock();
+        state = State::Ready;
+        planned.notify_one();
+    }
+}
+
+JobPlanner::JobPlanner(uint64_t seed)
+    : seed(seed)
+    , uniform(0.0f, std::nextafter(1.0f, FLT_MAX))
+    , burstStarts{0}
+{
+    xorshift128_engine rng = MakeEngine(seed, JobStream::Noise, 0);
+    noise.Generate(rng);
+}
+
+BurstFrame const& JobPlanner::PlanFrame(uint64_t frame)
+{
+    GT_STAGE_SCOPE(MetricStage::PlanBurst);
+
+    int burstFrames;
+    int index;
+    Locate(frame, burstFrames, index);
+    planned.intensity = GetBurstIntensity(index, burstFrames);
+    planned.refreshCapture = RefreshesCapture(index, burstFrames);
+
+    // Drawn in the same order as by BurstPlanner.
+    xorshift128_engine rng = MakeEngine(seed, JobStream::Frame, frame);
+    bool const regenerate = RegeneratesNoise(RandomFloat(rng), planned.intensity);
+    planned.useTrashFrame2 = UsesTrashFrame2(RandomFloat(rng));
+
+    uint64_t source = noiseSource;
+    if (regenerate) {
+        source = frame + 1;
+    } else if (frame != nextFrame) {
+        // Out of order: find the noise in effect, that of the last frame
+        // regenerating it, if any.
+        source = 0;
+        for (uint64_t previous = frame; previous-- > 0;) {
+            xorshift128_engine previousRng = MakeEngine(seed, JobStream::Frame, previous);
+            if (RegeneratesNoise(RandomFloat(previousRng), GetIntensity(previous))) {
+                source = previous + 1;
+                break;
+            }
+        }
+    }
+
+    // Backends only track the noise from frame to frame.
+    planned.noiseChanged = frame != nextFrame || source != noiseSource;
+    if (source != noiseSource) {
+        xorshift128_engine noiseRng = MakeEngine(seed, JobStream::Noise, source);
+        noise.Generate(noiseRng);
+        noiseSource = source;
+    }
+    planned.noise = &noise;
+    planned.cells.Evaluate(noise, planned.intensity);
+
+    nextFrame = frame + 1;
+    return planned;
+}
+
+void JobPlanner::Locate(uint64_t frame, int& burstFrames, int& index)
+{
+    while (burstStarts.back() <= frame) {
+        xorshift128_engine rng =
+            MakeEngine(seed, JobStream::BurstLength, burstStarts.size() - 1);
+        burstStarts.push_back(burstStarts.back() + GetBurstFrames(RandomFloat(rng)) + 1);
+    }
+
+    auto const next = std::upper_bound(burstStarts.begin(), burstStarts.end(), frame);
+    burstFrames = static_cast<int>(next[0] - next[-1]) - 1;
+    index = static_cast<int>(frame - next[-1]);
+}
+
+float JobPlanner::GetIntensity(uint64_t frame)
+{
+    int burstFrames;
+    int index;
+    Locate(frame, burstFrames, index);
+    return GetBurstIntensity(index, burstFrames);
+}
+
+float JobPlanner::RandomFloat(xorshift128_engine& rng)
+{
+    return uniform(rng);
+}
+
+} // namespace gt
@@ -0,0 +1,168 @@
+#pragma once
+#include "CpuGlitch.h"
+#include "NoiseGrid.h"
+#include "Random.h"
+
+#include <array>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace gt
+{
+
+/// <summary>
+///   Everything random about one frame of a burst, decided before the burst
+///   starts. Backends render it without touching the random generator.
+/// </summary>
+struct BurstFrame
+{
+    float intensity = 0.0f;
+
+    /// Whether the capture is refreshed before the frame.
+    bool refreshCapture = false;
+
+    /// Whether <see cref="noise"/> differs from the noise of the previous
+    /// frame. Always set for the first frame, since backends may have been
+    /// recreated since the last burst.
+    bool noiseChanged = false;
+
+    bool useTrashFrame2 = false;
+
+    /// Noise of the frame, owned by its <see cref="BurstPlan"/>.
+    NoiseGrid const* noise = nullptr;
+
+    /// Cells evaluated at <see cref="intensity"/>; only their offsets, which
+    /// depend on the image size and sampling, are left to the backends.
+    CellDecisions cells;
+};
+
+/// <summary>
+///   Frames of one burst, including the clean frame closing it.
+/// </summary>
+struct BurstPlan
+{
+    /// Longest burst of <see cref="RenderContext::StartBurst"/> plus its
+    /// closing frame.
+    static constexpr unsigned MaxFrames = 55;
+
+    unsigned frameCount = 0;
+    std::array<BurstFrame, MaxFrames> frames;
+
+    /// Noise carried over from the previous burst, followed by every
+    /// regenerated one.
+    std::array<NoiseGrid, MaxFrames + 1> noise;
+};
+
+/// <summary>
+///   Plans bursts ahead of time on a background thread, so that the time
+///   between the glitch timer and the first frame is spent rendering only.
+///   Two plans are kept: the one being rendered and the one being planned.
+/// </summary>
+/// <remarks>
+///   Not thread-safe; <see cref="PlanAhead"/> and <see cref="TakePlan"/>
+///   are called from the render thread.
+/// </remarks>
+class BurstPlanner
+{
+public:
+    BurstPlanner();
+    ~BurstPlanner();
+
+    BurstPlanner(BurstPlanner const&) = delete;
+    BurstPlanner& operator=(BurstPlanner const&) = delete;
+
+    /// Starts planning the next burst in the background unless it is
+    /// already planned or being planned.
+    void PlanAhead();
+
+    /// <summary>
+    ///   Returns the next burst, waiting for the background thread if it is
+    ///   still planning or planning it inline if nobody asked for it. The
+    ///   plan stays valid until the next call.
+    /// </summary>
+    BurstPlan const& TakePlan();
+
+private:
+    enum class State
+    {
+        Idle,
+        Planning,
+        Ready,
+    };
+
+    void Plan(BurstPlan& plan);
+    float RandomFloat();
+    void WorkerMain();
+
+    xorshift128_engine rng;
+    std::uniform_real_distribution<float> uniform;
+
+    /// Noise in effect at the end of the last planned burst.
+    NoiseGrid noise;
+
+    std::unique_ptr<BurstPlan> current;
+    std::unique_ptr<BurstPlan> next;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wakeWorker;
+    std::condition_variable planned;
+    State state = State::Idle;
+    bool stopping = false;
+};
+
+/// <summary>
+///   Plans an offline job: bursts back to back, with the same choices as
+///   <see cref="BurstPlanner"/>, but with every random number derived from the
+///   seed and the index of its burst or frame instead of drawn in sequence.
+///   Any frame can thus be planned without planning the ones before it, and a
+///   range of frames comes out the same whichever process plans it, so that a
+///   job can be split into frame ranges rendered by separate processes.
+/// </summary>
+/// <remarks>
+///   Processes only agree if they use the same build, since the noise goes
+///   through standard library distributions.
+/// </remarks>
+class JobPlanner
+{
+public:
+    explicit JobPlanner(uint64_t seed);
+
+    JobPlanner(JobPlanner const&) = delete;
+    JobPlanner& operator=(JobPlanner const&) = delete;
+
+    /// <summary>
+    ///   Plans frame <paramref name="frame"/> of the job, valid until the
+    ///   next call. Planning the frames in order is cheapest; any other frame
+    ///   first looks back for the last frame that regenerated the noise, on
+    ///   average a few frames.
+    /// </summary>
+    BurstFrame const& PlanFrame(uint64_t frame);
+
+private:
+    /// Glitched frames of the burst holding a frame, and its index in it.
+    void Locate(uint64_t frame, int& burstFrames, int& index);
+    float GetIntensity(uint64_t frame);
+    float RandomFloat(xorshift128_engine& rng);
+
+    uint64_t seed;
+    std::uniform_real_distribution<float> uniform;
+
+    /// First frame of every burst located so far, followed by the first
+    /// frame after them.
+    std::vector<uint64_t> burstStarts;
+
+    BurstFrame planned;
+    NoiseGrid noise;
+    /// Frame that regenerated <see cref="noise"/> plus one, or zero for the
+    /// noise the job starts with.
+    uint64_t noiseSource = 0;
+    /// Frame after the last one planned.
+    uint64_t nextFrame = UINT64_MAX;
+};
+
+} // namespace gt
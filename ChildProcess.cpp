@@ -0,0 +1,144 @@
+#include "ChildProcess.h"
+
+#ifndef _WIN32
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+#include <cerrno>
+#include <climits>
+
+namespace gt
+{
+
+namespace
+{
+
+#ifdef _WIN32
+/// Appends an argument the way <c>CommandLineToArgvW</c> splits it again.
+void AppendQuoted(std::string& commandLine, std::string const& arg)
+{
+    if (!commandLine.empty())
+        commandLine += ' ';
+    if (!arg.empty() && arg.find_first_of(" \t\"") == std::string::npos) {
+        commandLine += arg;
+        return;
+    }
+
+    // Backslashes are only special in front of a quote.
+    commandLine += '"';
+    size_t backslashes = 0;
+    for (char const c : arg) {
+        if (c == '\\') {
+            ++backslashes;
+            continue;
+        }
+        commandLine.append(c == '"' ? backslashes * 2 + 1 : backslashes, '\\');
+        commandLine += c;
+        backslashes = 0;
+    }
+    commandLine.append(backslashes * 2, '\\');
+    commandLine += '"';
+}
+#endif
+
+} // namespace
+
+ChildProcess::~ChildProcess()
+{
+    int exitCode;
+    Wait(exitCode);
+}
+
+HRESULT ChildProcess::Start(std::string const& program,
+                            std::vector<std::string> const& args)
+{
+#ifdef _WIN32
+    if (process)
+        return E_UNEXPECTED;
+
+    std::string commandLine;
+    AppendQuoted(commandLine, program);
+    for (std::string const& arg : args)
+        AppendQuoted(commandLine, arg);
+
+    STARTUPINFOA startup = {};
+    startup.cb = sizeof(startup);
+    PROCESS_INFORMATION info;
+    if (!CreateProcessA(program.c_str(), commandLine.data(), nullptr, nullptr, TRUE, 0,
+                        nullptr, nullptr, &startup, &info)) {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+    CloseHandle(info.hThread);
+    process = info.hProcess;
+#else
+    if (pid)
+        return E_UNEXPECTED;
+
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(program.c_str()));
+    for (std::string const& arg : args)
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    pid_t child;
+    if (posix_spawn(&child, program.c_str(), nullptr, nullptr, argv.data(), environ) != 0)
+        return E_FAIL;
+    pid = child;
+#endif
+    return S_OK;
+}
+
+HRESULT ChildProcess::Wait(int& exitCode)
+{
+#ifdef _WIN32
+    if (!process)
+        return E_UNEXPECTED;
+
+    DWORD code = 0;
+    WaitForSingleObject(process, INFINITE);
+    BOOL const result = GetExitCodeProcess(process, &code);
+    CloseHandle(process);
+    process = nullptr;
+    if (!result)
+        return E_FAIL;
+    exitCode = static_cast<int>(code);
+#else
+    if (!pid)
+        return E_UNEXPECTED;
+
+    int status;
+    pid_t result;
+    do {
+        result = waitpid(pid, &status, 0);
+    } while (result < 0 && errno == EINTR);
+    pid = 0;
+    if (result < 0)
+        return E_FAIL;
+    if (!WIFEXITED(status))
+        return E_ABORT;
+    exitCode = WEXITSTATUS(status);
+#endif
+    return S_OK;
+}
+
+std::string GetProgramPath(char const* argv0)
+{
+#ifdef _WIN32
+    char path[MAX_PATH];
+    DWORD const length = GetModuleFileNameA(nullptr, path, MAX_PATH);
+    if (length > 0 && length < MAX_PATH)
+        return std::string(path, length);
+#else
+    char path[PATH_MAX];
+    ssize_t const length = readlink("/proc/self/exe", path, sizeof(path));
+    if (length > 0 && static_cast<size_t>(length) < sizeof(path))
+        return std::string(path, static_cast<size_t>(length));
+#endif
+    return argv0;
+}
+
+} // namespace gt
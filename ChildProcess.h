@@ -0,0 +1,48 @@
+#pragma once
+#include "Platform.h"
+
+#include <string>
+#include <vector>
+
+namespace gt
+{
+
+/// <summary>
+///   Another process running a program to completion, such as a GlitchCli
+///   worker rendering part of a job. It inherits the standard streams.
+/// </summary>
+class ChildProcess
+{
+public:
+    ChildProcess() = default;
+    ~ChildProcess();
+
+    ChildProcess(ChildProcess const&) = delete;
+    ChildProcess& operator=(ChildProcess const&) = delete;
+
+    /// Starts <paramref name="program"/> with <paramref name="args"/>, which
+    /// do not include the program itself.
+    HRESULT Start(std::string const& program, std::vector<std::string> const& args);
+
+    /// <summary>
+    ///   Waits for the process to exit and returns its exit code in
+    ///   <paramref name="exitCode"/>; a process killed by a signal returns
+    ///   <c>E_ABORT</c>.
+    /// </summary>
+    HRESULT Wait(int& exitCode);
+
+private:
+#ifdef _WIN32
+    HANDLE process = nullptr;
+#else
+    int pid = 0;
+#endif
+};
+
+/// <summary>
+///   Path of the running program, to start more of it; falls back to
+///   <paramref name="argv0"/> where the system cannot tell.
+/// </summary>
+std::string GetProgramPath(char const* argv0);
+
+} // namespace gt
@@ -0,0 +1,26 @@
+struct VOutput
+{
+    float4 Position : SV_POSITION;
+    half2 UV : TEXCOORD0;
+};
+
+Texture2D mainTex : register(t0);
+SamplerState mainSampler : register(s0);
+
+cbuffer Constants : register(b0)
+{
+    float2 redOffset;
+    float2 blueOffset;
+};
+
+float4 main(VOutput input) : SV_Target
+{
+    // Green and alpha stay in place, red and blue are gathered from positions
+    // shifted in opposite directions. All three taps are recombined in a single
+    // pass.
+    float4 center = mainTex.Sample(mainSampler, input.UV);
+    float red = mainTex.Sample(mainSampler, input.UV + redOffset).r;
+    float blue = mainTex.Sample(mainSampler, input.UV + blueOffset).b;
+
+    return float4(red, center.g, blue, center.a);
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+namespace gt
+{
+
+/// Parses a decimal number that makes up all of <paramref name="text"/>.
+inline bool ParseUnsigned(char const* text, unsigned& value)
+{
+    char* end = nullptr;
+    unsigned long const parsed = strtoul(text, &end, 10);
+    if (end == text || *end != '\0')
+        return false;
+    value = static_cast<unsigned>(parsed);
+    return true;
+}
+
+/// Parses a size written as "WxH", both parts nonzero.
+inline bool ParseSize(char const* text, unsigned& width, unsigned& height)
+{
+    char* end = nullptr;
+    width = static_cast<unsigned>(strtoul(text, &end, 10));
+    if (end == text || (*end != 'x' && *end != 'X'))
+        return false;
+
+    char const* heightText = end + 1;
+    height = static_cast<unsigned>(strtoul(heightText, &end, 10));
+    return end != heightText && *end == '\0' && width > 0 && height > 0;
+}
+
+/// Parses a rectangle written as "WxH+X+Y", like X11 geometry, with a
+/// nonzero size.
+inline bool ParseRect(char const* text, unsigned& x, unsigned& y, unsigned& width,
+                      unsigned& height)
+{
+    auto const next = [&](unsigned& value, char separator) {
+        char* end = nullptr;
+        value = static_cast<unsigned>(strtoul(text, &end, 10));
+        bool const valid = end != text && *end == separator;
+        text = end + 1;
+        return valid;
+    };
+    return next(width, 'x') && next(height, '+') && next(x, '+') && next(y, '\0') &&
+           width > 0 && height > 0;
+}
+
+/// Outcome of handling one command line option.
+enum class OptionResult
+{
+    Valid,
+    Invalid,
+    Unknown,
+};
+
+/// <summary>
+///   Calls <c>handler(name, value)</c> for every "--name value" pair and
+///   reports missing values, unknown options and invalid values.
+/// </summary>
+template<typename Handler>
+bool ParseOptions(int argc, char** argv, Handler&& handler)
+{
+    for (int i = 0; i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return false;
+        }
+
+        switch (handler(std::string_view(argv[i]), argv[i + 1])) {
+        case OptionResult::Valid:
+            break;
+        case OptionResult::Invalid:
+            fprintf(stderr, "Invalid value for %s: %s\n", argv[i], argv[i + 1]);
+            return false;
+        case OptionResult::Unknown:
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+OptionResult Check(bool valid)
+{
+    return valid ? OptionResult::Valid : OptionResult::Invalid;
+}
+
+} // namespace gt
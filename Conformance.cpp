@@ -0,0 +1,535 @@
+#include "Conformance.h"
+
+#include "Arena.h"
+#include "BurstPlan.h"
+#include "CpuBackend.h"
+#include "CpuGlitch.h"
+#include "ImageIO.h"
+#include "MathUtils.h"
+#include "NoiseGrid.h"
+#include "SyntheticDesktop.h"
+#include "ThreadPool.h"
+#include "YuvImage.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+namespace gt
+{
+
+namespace
+{
+
+char const* GetSamplingName(GlitchSampling sampling)
+{
+    return sampling == GlitchSampling::Nearest ? "nearest" : "bilinear";
+}
+
+/// <summary>
+///   Rows of a frame that the kernels render and compare: all of them, or
+///   bands of <see cref="RowGrain"/> rows spread evenly from the first row to
+///   the last, adding up to about the rows asked for.
+/// </summary>
+class RowSample
+{
+public:
+    RowSample(unsigned height, unsigned rows)
+        : height(height)
+        , full(rows == 0 || rows >= height)
+        , bandCount(full ? 1 : std::max(2u, (rows + RowGrain - 1) / RowGrain))
+    {}
+
+    bool IsFull() const { return full; }
+
+    unsigned GetBandCount() const { return bandCount; }
+
+    unsigned GetBandBegin(unsigned band) const
+    {
+        if (full)
+            return 0;
+        return static_cast<unsigned>(uint64_t(band) * (height - RowGrain) /
+                                     (bandCount - 1));
+    }
+
+    unsigned GetBandEnd(unsigned band) const
+    {
+        return full ? height : GetBandBegin(band) + RowGrain;
+    }
+
+    /// Calls <c>body(rowBegin, rowEnd)</c> for the sampled rows, across
+    /// <paramref name="pool"/> like <see cref="ForEachRowBand"/>.
+    template<typename Body>
+    void ForEachBand(ThreadPool* pool, Body&& body) const
+    {
+        if (full) {
+            ForEachRowBand(pool, height, body);
+            return;
+        }
+
+        auto const bands = [&](unsigned first, unsigned last) {
+            for (unsigned band = first; band < last; ++band)
+                body(GetBandBegin(band), GetBandEnd(band));
+        };
+        if (pool)
+            pool->ParallelFor(bandCount, 1, bands);
+        else
+            bands(0, bandCount);
+    }
+
+private:
+    unsigned height;
+    bool full;
+    unsigned bandCount;
+};
+
+/// <summary>
+///   Accumulates the comparisons of all frames, one result per format,
+///   sampling and kernel, and saves the mismatch map of the first frame that
+///   fails each of them.
+/// </summary>
+class ConformanceChecker
+{
+public:
+    ConformanceChecker(unsigned width, unsigned height, ConformanceOptions const& options)
+        : width(width)
+        , height(height)
+        , options(options)
+        , wholeRows(height, 0)
+        , kernelRows(height, options.kernelRows)
+        , scalarRows(height, options.scalarRows)
+        , chromaRows((height + 1) / 2, options.kernelRows / 2)
+    {
+        if (options.mismatchMapDir) {
+            map.Resize(width, height);
+            yuvMap.Resize(width, height);
+        }
+    }
+
+    /// Rows of every frame, for the comparisons of the backends.
+    RowSample const& WholeRows() const { return wholeRows; }
+    RowSample const& KernelRows() const { return kernelRows; }
+    RowSample const& ScalarRows() const { return scalarRows; }
+    /// Chroma rows of 4:2:0 frames the kernels render and compare.
+    RowSample const& ChromaRows() const { return chromaRows; }
+
+    /// Compares the rows of <paramref name="sample"/>.
+    template<PixelFormat Format>
+    void Compare(std::string const& name, unsigned tolerance,
+                 BasicImageBuffer<Format> const& expected,
+                 BasicImageBuffer<Format> const& actual, RowSample const& sample)
+    {
+        ClearMaps(sample);
+        ImageDiff diff;
+        for (unsigned band = 0; band < sample.GetBandCount(); ++band) {
+            unsigned const rowBegin = sample.GetBandBegin(band);
+            unsigned const rowEnd = sample.GetBandEnd(band);
+            auto const rowsA = expected.View().rows(rowBegin, rowEnd);
+            auto const rowsB = actual.View().rows(rowBegin, rowEnd);
+            image_view<uint32_t> const mapRows =
+                options.mismatchMapDir ? map.View().rows(rowBegin, rowEnd)
+                                       : image_view<uint32_t>();
+            ImageDiff bandDiff;
+            if constexpr (Format == PixelFormat::Bgra8)
+                bandDiff = DiffImages(rowsA, rowsB, tolerance, mapRows);
+            else
+                bandDiff = DiffImages<Format>(rowsA, rowsB, tolerance, mapRows);
+            bandDiff.Merge(diff);
+            diff = bandDiff;
+        }
+        Record(name, tolerance, diff);
+    }
+
+    /// Compares the chroma rows of <paramref name="sample"/> and the luma rows
+    /// sharing them.
+    void Compare(std::string const& name, unsigned tolerance, YuvImage const& expected,
+                 YuvImage const& actual, RowSample const& sample)
+    {
+        ClearMaps(sample);
+        ImageDiff diff;
+        for (YuvPlane const plane : {YuvPlane::Y, YuvPlane::U, YuvPlane::V}) {
+            image_view<uint8_t const> const planeA = expected.PlaneView(plane);
+            image_view<uint8_t const> const planeB = actual.PlaneView(plane);
+            unsigned const scale = plane == YuvPlane::Y ? 2 : 1;
+            for (unsigned band = 0; band < sample.GetBandCount(); ++band) {
+                unsigned const rowBegin = sample.GetBandBegin(band) * scale;
+                unsigned const rowEnd = std::min<unsigned>(
+                    sample.GetBandEnd(band) * scale, unsigned(planeA.height()));
+                image_view<uint8_t> const planeMap =
+                    options.mismatchMapDir
+                        ? yuvMap.PlaneView(plane).rows(rowBegin, rowEnd)
+                        : image_view<uint8_t>();
+                diff.Merge(DiffImages(planeA.rows(rowBegin, rowEnd),
+                                      planeB.rows(rowBegin, rowEnd), tolerance,
+                                      planeMap));
+            }
+        }
+        if (options.mismatchMapDir && diff.mismatches > 0)
+            CombinePlaneMaps();
+        Record(name, tolerance, diff);
+    }
+
+    void NextFrame() { ++frame; }
+
+    std::vector<ConformanceResult> TakeResults() { return std::move(results); }
+
+private:
+    /// Blacks out the mismatch maps of earlier comparisons outside the rows
+    /// of <paramref name="sample"/>.
+    void ClearMaps(RowSample const& sample)
+    {
+        if (options.mismatchMapDir && !sample.IsFull()) {
+            map.Resize(width, height);
+            std::memset(yuvMap.Data(), 0, yuvMap.SizeBytes());
+        }
+    }
+
+    void Record(std::string const& name, unsigned tolerance, ImageDiff const& diff)
+    {
+        std::string const fullName =
+            name + "~integer/" + std::to_string(width) + "x" + std::to_string(height);
+        auto it = std::find_if(
+            results.begin(), results.end(),
+            [&](ConformanceResult const& result) { return result.name == fullName; });
+        if (it == results.end()) {
+            it = results.insert(results.end(), ConformanceResult());
+            it->name = fullName;
+            it->tolerance = tolerance;
+            it->diff.peak = diff.peak;
+        }
+
+        bool const firstFailure = it->Passed() && diff.mismatches > 0;
+        it->diff.Merge(diff);
+        ++it->frames;
+
+        if (firstFailure && options.mismatchMapDir)
+            SaveMap(fullName);
+    }
+
+    /// Gray picture of the plane maps, each pixel showing the brightest of
+    /// its luma sample and the chroma samples it shares.
+    void CombinePlaneMaps()
+    {
+        image_view<uint8_t const> const luma = yuvMap.PlaneView(YuvPlane::Y);
+        image_view<uint8_t const> const cb = yuvMap.PlaneView(YuvPlane::U);
+        image_view<uint8_t const> const cr = yuvMap.PlaneView(YuvPlane::V);
+        for (unsigned y = 0; y < height; ++y) {
+            uint32_t* const row = map.Row(y);
+            for (unsigned x = 0; x < width; ++x) {
+                uint32_t const value =
+                    std::max({luma(x, y), cb(x / 2, y / 2), cr(x / 2, y / 2)});
+                row[x] = value | value << 8 | value << 16 | 0xFF000000u;
+            }
+        }
+    }
+
+    void SaveMap(std::string const& name)
+    {
+        std::string fileName = name;
+        std::replace(fileName.begin(), fileName.end(), '/', '_');
+        std::replace(fileName.begin(), fileName.end(), '~', '-');
+        std::string const path = std::string(options.mismatchMapDir) + "/" + fileName +
+                                 "-f" + std::to_string(frame) + ".ppm";
+        if (FAILED(SavePpmFile(path.c_str(), map.View())))
+            fprintf(stderr, "Cannot write mismatch map %s\n", path.c_str());
+    }
+
+    unsigned width;
+    unsigned height;
+    ConformanceOptions const& options;
+    unsigned frame = 0;
+    RowSample wholeRows;
+    RowSample kernelRows;
+    RowSample scalarRows;
+    RowSample chromaRows;
+    ImageBuffer map;
+    YuvImage yuvMap;
+    std::vector<ConformanceResult> results;
+};
+
+/// <summary>
+///   Lends the frames of a conformance run to a CPU backend in place, as a
+///   shared memory source would.
+/// </summary>
+template<PixelFormat Format>
+class ViewFrameSource : public IBasicFrameSource<Format>
+{
+public:
+    using Pixel = PixelType<Format>;
+
+    explicit ViewFrameSource(cimage_view<Pixel> frame)
+        : frame(frame)
+    {}
+
+    void GetSize(unsigned& width, unsigned& height) const override
+    {
+        width = unsigned(frame.width());
+        height = unsigned(frame.height());
+    }
+
+    HRESULT Capture(image_view<Pixel> dest) override
+    {
+        CopyImage(frame, dest);
+        return S_OK;
+    }
+
+    HRESULT MapFrame(unsigned width, unsigned height, cimage_view<Pixel>& mapped) override
+    {
+        if (width != frame.width() || height != frame.height())
+            return E_NOTIMPL;
+
+        mapped = frame;
+        return S_OK;
+    }
+
+private:
+    cimage_view<Pixel> frame;
+};
+
+/// <summary>
+///   Source, trash and output frames of a deeper format, which the kernels
+///   glitch in that format instead of BGRA8, and a CPU backend glitching the
+///   source in the same format.
+/// </summary>
+template<PixelFormat Format>
+struct FormatFrames
+{
+    FormatFrames(unsigned width, unsigned height, ThreadPool* pool)
+        : source(width, height)
+        , trash(width, height)
+        , blank(width, height)
+        , glitched(width, height)
+        , expected(width, height)
+        , actual(width, height)
+        , backend(std::make_unique<ViewFrameSource<Format>>(source.View()))
+    {
+        backend.digitalGlitch.kernel = GlitchKernel::Integer;
+        backend.SetThreadPool(pool);
+        backend.Initialize(width, height);
+    }
+
+    BasicImageBuffer<Format> source;
+    BasicImageBuffer<Format> trash;
+    /// Cleared like the trash frames of the backend.
+    BasicImageBuffer<Format> blank;
+    BasicImageBuffer<Format> glitched;
+    BasicImageBuffer<Format> expected;
+    BasicImageBuffer<Format> actual;
+    BasicCpuBackend<Format> backend;
+};
+
+/// Renders the frame of <paramref name="plan"/> in <typeparamref name="Format"/>
+/// through every kernel and compares them.
+template<PixelFormat Format>
+void CheckFormat(ConformanceChecker& checker, ConformanceOptions const& options,
+                 GlitchPlan const& plan, FormatFrames<Format>& frames, ThreadPool* pool)
+{
+    auto const render = [&](GlitchKernel kernel, BasicImageBuffer<Format>& dest,
+                            RowSample const& rows) {
+        rows.ForEachBand(pool, [&](unsigned rowBegin, unsigned rowEnd) {
+            RenderDigitalGlitch<Format>(kernel, plan, frames.source.View(),
+                                        frames.trash.View(), dest.View(), rowBegin,
+                                        rowEnd);
+        });
+    };
+
+    std::string const name = std::string(GetPixelFormatName(Format)) + "/" +
+                             GetSamplingName(plan.sampling);
+    RowSample const& rows = checker.KernelRows();
+    RowSample const& scalarRows = checker.ScalarRows();
+    render(GlitchKernel::Integer, frames.expected, rows);
+    if (!rows.IsFull())
+        render(GlitchKernel::Integer, frames.expected, scalarRows);
+    render(GlitchKernel::Scalar, frames.actual, scalarRows);
+    checker.Compare(name + "/scalar", options.tolerance, frames.expected, frames.actual,
+                    scalarRows);
+    render(GlitchKernel::Simd, frames.actual, rows);
+    checker.Compare(name + "/simd", 0, frames.expected, frames.actual, rows);
+    if (plan.sampling == GlitchSampling::Nearest) {
+        render(GlitchKernel::Blit, frames.actual, rows);
+        checker.Compare(name + "/blit", 0, frames.expected, frames.actual, rows);
+    }
+}
+
+/// <summary>
+///   Renders the frame of <paramref name="plan"/> end to end through the CPU
+///   backend of <typeparamref name="Format"/>, as a planned frame, and
+///   compares its output with the integer kernel and the RGB split run on the
+///   source directly. Nearest sampling is reached through the blit quality
+///   level, as the quality governor would.
+/// </summary>
+template<PixelFormat Format>
+void CheckPipeline(ConformanceChecker& checker, GlitchPlan const& plan,
+                   NoiseGrid const& noise, float intensity, Arena& arena,
+                   FormatFrames<Format>& frames, ThreadPool* pool)
+{
+    BasicCpuChromaticSplit<Format> split;
+    split.intensity = intensity;
+    split.Update();
+    ForEachRowBand(pool, plan.height, [&](unsigned rowBegin, unsigned rowEnd) {
+        RenderDigitalGlitch<Format>(GlitchKernel::Integer, plan, frames.source.View(),
+                                    frames.blank.View(), frames.glitched.View(),
+                                    rowBegin, rowEnd);
+    });
+    ForEachRowBand(pool, plan.height, [&](unsigned rowBegin, unsigned rowEnd) {
+        split.OnRenderImage(frames.glitched, frames.expected, rowBegin, rowEnd);
+    });
+
+    BurstFrame planned;
+    planned.intensity = intensity;
+    planned.noiseChanged = true;
+    planned.noise = &noise;
+    planned.cells.Evaluate(noise, intensity);
+
+    FrameParams params;
+    params.intensity = intensity;
+    params.quality = plan.sampling == GlitchSampling::Nearest ? QualityLevel::Blit
+                                                               : QualityLevel::Full;
+    params.arena = &arena;
+    params.planned = &planned;
+
+    BasicCpuBackend<Format>& backend = frames.backend;
+    backend.digitalGlitch.colorShuffle = plan.colorShuffle;
+    if (FAILED(backend.RefreshCapture()) || FAILED(backend.Render(params)) ||
+        FAILED(backend.Present())) {
+        fprintf(stderr, "The %s backend failed to render\n", GetPixelFormatName(Format));
+    }
+
+    std::string const name = std::string(GetPixelFormatName(Format)) + "/" +
+                             GetSamplingName(plan.sampling);
+    checker.Compare(name + "/pipeline", 0, frames.expected, backend.GetOutput(),
+                    checker.WholeRows());
+}
+
+} // namespace
+
+std::vector<ConformanceResult> RunConformance(unsigned width, unsigned height,
+                                              ConformanceOptions const& options,
+                                              ThreadPool* pool)
+{
+    SyntheticDesktopOptions desktopOptions;
+    desktopOptions.width = width;
+    desktopOptions.height = height;
+    desktopOptions.seed = options.seed;
+    SyntheticDesktopSource desktop(desktopOptions);
+
+    desktopOptions.seed = ~options.seed;
+    desktopOptions.dirtyFraction = 0.0f;
+    SyntheticDesktopSource trashDesktop(desktopOptions);
+
+    ImageBuffer source(width, height);
+    ImageBuffer trash(width, height);
+    ImageBuffer expected(width, height);
+    ImageBuffer actual(width, height);
+    trashDesktop.Capture(trash.View());
+
+    YuvImage yuvSource;
+    YuvImage yuvTrash;
+    YuvImage yuvExpected(width, height);
+    YuvImage yuvActual(width, height);
+    ConvertBgraToI420(trash, yuvTrash);
+
+    FormatFrames<PixelFormat::Rgb10A2> rgb10a2(width, height, pool);
+    FormatFrames<PixelFormat::Rgba16> rgba16(width, height, pool);
+    FormatFrames<PixelFormat::Rgba16F> rgba16f(width, height, pool);
+    ConvertFromBgra<PixelFormat::Rgb10A2>(trash.View(), rgb10a2.trash.View());
+    ConvertFromBgra<PixelFormat::Rgba16>(trash.View(), rgba16.trash.View());
+    ConvertFromBgra<PixelFormat::Rgba16F>(trash.View(), rgba16f.trash.View());
+
+    xorshift128_engine rng(options.seed, ~options.seed);
+    NoiseGrid noise;
+    Arena arena;
+    ConformanceChecker checker(width, height, options);
+    RowSample const& rows = checker.KernelRows();
+    RowSample const& scalarRows = checker.ScalarRows();
+    RowSample const& chromaRows = checker.ChromaRows();
+
+    for (unsigned burst = 0; burst < options.bursts; ++burst) {
+        for (unsigned i = 0; i < options.framesPerBurst; ++i, checker.NextFrame()) {
+            desktop.Capture(source.View());
+            ConvertBgraToI420(source, yuvSource);
+            ConvertFromBgra<PixelFormat::Rgb10A2>(source.View(), rgb10a2.source.View());
+            ConvertFromBgra<PixelFormat::Rgba16>(source.View(), rgba16.source.View());
+            ConvertFromBgra<PixelFormat::Rgba16F>(source.View(), rgba16f.source.View());
+            noise.Generate(rng);
+
+            // Skip the clean frames at both ends of the burst.
+            int const steps = static_cast<int>(options.framesPerBurst) + 1;
+            float const intensity = TriangleSeries(static_cast<int>(i) + 1, steps, 0.0f,
+                                                   0.75f);
+
+            for (GlitchSampling const sampling :
+                 {GlitchSampling::Bilinear, GlitchSampling::Nearest}) {
+                bool const nearest = sampling == GlitchSampling::Nearest;
+
+                ArenaScope const scope(arena);
+                GlitchPlan plan;
+                plan.sampling = sampling;
+                plan.colorShuffle = burst % 2 != 0;
+                plan.Compile(noise, intensity, width, height, nearest ? &arena : nullptr);
+
+                GlitchPlan chromaPlan;
+                chromaPlan.sampling = sampling;
+                chromaPlan.colorShuffle = plan.colorShuffle;
+                chromaPlan.Compile(noise, intensity, yuvSource.ChromaWidth(),
+                                   yuvSource.ChromaHeight());
+
+                auto const render = [&](GlitchKernel kernel, ImageBuffer& dest,
+                                         RowSample const& rows) {
+                    rows.ForEachBand(pool, [&](unsigned rowBegin, unsigned rowEnd) {
+                        RenderDigitalGlitch<PixelFormat::Bgra8>(
+                            kernel, plan, source.View(), trash.View(), dest.View(),
+                            rowBegin, rowEnd);
+                    });
+                };
+                auto const renderYuv = [&](GlitchKernel kernel, YuvImage& dest) {
+                    chromaRows.ForEachBand(pool, [&](unsigned rowBegin, unsigned rowEnd) {
+                        RenderDigitalGlitch(kernel, plan, chromaPlan, yuvSource, yuvTrash,
+                                            dest, rowBegin, rowEnd);
+                    });
+                };
+
+                std::string const bgra = std::string("bgra/") + GetSamplingName(sampling);
+                render(GlitchKernel::Integer, expected, rows);
+                if (!rows.IsFull())
+                    render(GlitchKernel::Integer, expected, scalarRows);
+                render(GlitchKernel::Scalar, actual, scalarRows);
+                checker.Compare(bgra + "/scalar", options.tolerance, expected, actual,
+                                scalarRows);
+                render(GlitchKernel::Simd, actual, rows);
+                checker.Compare(bgra + "/simd", 0, expected, actual, rows);
+                if (nearest) {
+                    render(GlitchKernel::Blit, actual, rows);
+                    checker.Compare(bgra + "/blit", 0, expected, actual, rows);
+                }
+
+                std::string const i420 = std::string("i420/") + GetSamplingName(sampling);
+                renderYuv(GlitchKernel::Integer, yuvExpected);
+                renderYuv(GlitchKernel::Simd, yuvActual);
+                checker.Compare(i420 + "/simd", 0, yuvExpected, yuvActual, chromaRows);
+                if (nearest) {
+                    renderYuv(GlitchKernel::Blit, yuvActual);
+                    checker.Compare(i420 + "/blit", 0, yuvExpected, yuvActual,
+                                    chromaRows);
+                }
+
+                CheckFormat(checker, options, plan, rgb10a2, pool);
+                CheckFormat(checker, options, plan, rgba16, pool);
+                CheckFormat(checker, options, plan, rgba16f, pool);
+
+                // The backends render whole frames, so frames with sampled rows
+                // take turns at the two samplings.
+                if (rows.IsFull() || (i % 2 != 0) == nearest) {
+                    CheckPipeline(checker, plan, noise, intensity, arena, rgb10a2, pool);
+                    CheckPipeline(checker, plan, noise, intensity, arena, rgba16, pool);
+                    CheckPipeline(checker, plan, noise, intensity, arena, rgba16f, pool);
+                }
+            }
+        }
+    }
+
+    return checker.TakeResults();
+}
+
+} // namespace gt
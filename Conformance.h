@@ -0,0 +1,64 @@
+#pragma once
+#include "ImageDiff.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gt
+{
+
+class ThreadPool;
+
+struct ConformanceOptions
+{
+    unsigned bursts = 2;
+    unsigned framesPerBurst = 6;
+    /// Largest channel difference allowed between the floating point scalar
+    /// kernel and the fixed point kernels, in units of the last bit of the
+    /// format (see <see cref="DiffImages"/>). Fast paths must match the
+    /// integer kernel exactly.
+    unsigned tolerance = 2;
+    /// Rows of every frame the kernels render and compare, in bands spread
+    /// evenly from the top of the frame to the bottom, so that large frames
+    /// check in seconds; all rows of frames up to this tall, or if 0.
+    unsigned kernelRows = 1080;
+    /// Same for the scalar reference, which is several times slower.
+    unsigned scalarRows = 270;
+    uint64_t seed = 1;
+    /// Directory receiving a PPM mismatch map of the first failing frame of
+    /// every comparison, none if null.
+    char const* mismatchMapDir = nullptr;
+};
+
+struct ConformanceResult
+{
+    /// Image format, sampling and the two kernels compared, e.g.
+    /// "bgra/bilinear/simd~integer/1920x1080".
+    std::string name;
+    unsigned tolerance = 0;
+    unsigned frames = 0;
+    ImageDiff diff;
+
+    bool Passed() const { return diff.mismatches == 0; }
+};
+
+/// <summary>
+///   Renders fixed-seed glitch bursts of a synthetic desktop at the given
+///   size through every CPU kernel, for frames of every
+///   <see cref="PixelFormat"/> and 4:2:0 frames and both samplings, and
+///   compares each kernel against the integer kernel. The fixed point
+///   kernels must match it exactly, the scalar reference within
+///   <see cref="ConformanceOptions::tolerance"/>. Frames of the deeper
+///   formats are also rendered end to end through a
+///   <see cref="BasicCpuBackend"/> of their format, which must match the
+///   integer kernel followed by the RGB split exactly. Kernels are compared
+///   on the rows sampled by <see cref="ConformanceOptions::kernelRows"/> and
+///   <see cref="ConformanceOptions::scalarRows"/>, the backends on whole
+///   frames, alternating between the samplings when rows are sampled.
+/// </summary>
+std::vector<ConformanceResult> RunConformance(unsigned width, unsigned height,
+                                              ConformanceOptions const& options,
+                                              ThreadPool* pool);
+
+} // namespace gt
@@ -0,0 +1,302 @@
+#include "CpuBackend.h"
+
+#include "BurstPlan.h"
+#include "ErrorHandling.h"
+#include "Metrics.h"
+#include "Resample.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace gt
+{
+
+template<PixelFormat Format>
+BasicCpuBackend<Format>::BasicCpuBackend(
+    std::unique_ptr<IBasicFrameSource<Format>> source)
+    : source(std::move(source))
+{}
+
+template<PixelFormat Format>
+HRESULT BasicCpuBackend<Format>::Initialize(unsigned width, unsigned height)
+{
+    if (!source)
+        return E_UNEXPECTED;
+
+    if (width == 0 || height == 0)
+        source->GetSize(width, height);
+
+    HR(Resize(width, height));
+    return S_OK;
+}
+
+template<PixelFormat Format>
+HRESULT BasicCpuBackend<Format>::RefreshCapture()
+{
+    HRESULT const mapped = source->MapFrame(renderWidth, renderHeight, capture);
+    if (mapped == E_NOTIMPL) {
+        // Sources that cannot lend their frames are copied into the snapshot,
+        // which is only allocated for them.
+        if (snapshot.Width() != renderWidth || snapshot.Height() != renderHeight)
+            snapshot.Resize(renderWidth, renderHeight);
+        capture = snapshot.View();
+        if (HasRegion() && !fullCapturePending)
+            HR(source->CaptureRects(snapshot.View(), captureRects));
+        else
+            HR(source->Capture(snapshot.View()));
+    } else {
+        HR(mapped);
+    }
+
+    // Outside of the region, the output shows the capture as it is.
+    if (HasRegion() && fullCapturePending)
+        copy_pixels(capture, output.View());
+    fullCapturePending = false;
+
+    for (GlitchArea& area : areas)
+        area.scaledSnapshotStale = true;
+    return S_OK;
+}
+
+template<PixelFormat Format>
+HRESULT BasicCpuBackend<Format>::SetProcessingScale(unsigned factor)
+{
+    if (factor != 1 && factor != 2 && factor != 4)
+        return E_INVALIDARG;
+
+    processingScale = factor;
+    for (GlitchArea& area : areas)
+        ResizeScaled(area);
+    return S_OK;
+}
+
+template<PixelFormat Format>
+HRESULT BasicCpuBackend<Format>::SetRegion(GlitchRegion const& newRegion)
+{
+    regionRects = newRegion.rects;
+    regionMask = ImageBuffer();
+    if (!newRegion.mask.empty()) {
+        regionMask.Resize(unsigned(newRegion.mask.width()),
+                          unsigned(newRegion.mask.height()));
+        copy_pixels(newRegion.mask, regionMask.View());
+    }
+
+    if (renderWidth == 0)
+        return S_OK;
+
+    UpdateAreas();
+    HR(RefreshCapture());
+    return S_OK;
+}
+
+template<PixelFormat Format>
+HRESULT BasicCpuBackend<Format>::Resize(unsigned newWidth, unsigned newHeight)
+{
+    newWidth = std::max(newWidth, 1u);
+    newHeight = std::max(newHeight, 1u);
+    if (newWidth == renderWidth && newHeight == renderHeight)
+        return S_OK;
+
+    renderWidth = newWidth;
+    renderHeight = newHeight;
+
+    effectTarget.Resize(renderWidth, renderHeight);
+    output.Resize(renderWidth, renderHeight);
+    UpdateAreas();
+
+    HR(RefreshCapture());
+    return S_OK;
+}
+
+template<PixelFormat Format>
+void BasicCpuBackend<Format>::UpdateAreas()
+{
+    if (!regionMask.Empty() &&
+        (regionMask.Width() != renderWidth || regionMask.Height() != renderHeight)) {
+        ImageBuffer resized(renderWidth, renderHeight);
+        CopyImage(regionMask.View(), resized.View());
+        regionMask = std::move(resized);
+    }
+
+    captureRects.clear();
+    for (ImageRect const& rect : regionRects) {
+        ImageRect const clipped = ClipRect(rect, renderWidth, renderHeight);
+        if (!clipped.Empty())
+            captureRects.push_back(clipped);
+    }
+    if (regionRects.empty() && !regionMask.Empty()) {
+        ImageRect const bounds = GetMaskBounds(regionMask.View());
+        if (!bounds.Empty())
+            captureRects.push_back(bounds);
+    }
+
+    // Without a region, a single area covers the whole frame.
+    size_t const oldCount = areas.size();
+    areas.resize(HasRegion() ? captureRects.size() : 1);
+    for (size_t i = 0; i < areas.size(); ++i) {
+        GlitchArea& area = areas[i];
+        area.rect =
+            HasRegion() ? captureRects[i] : ImageRect{0, 0, renderWidth, renderHeight};
+        if (i >= oldCount) {
+            area.glitch.noise.Generate();
+            area.scaledGlitch.noise.Generate();
+        }
+        area.glitch.Resize(area.rect.width, area.rect.height);
+        ResizeScaled(area);
+    }
+    fullCapturePending = true;
+}
+
+template<PixelFormat Format>
+void BasicCpuBackend<Format>::ResizeScaled(GlitchArea& area)
+{
+    unsigned const width = GetScaledSize(area.rect.width, GetScaledFactor());
+    unsigned const height = GetScaledSize(area.rect.height, GetScaledFactor());
+    area.scaledSnapshot.Resize(width, height);
+    area.scaledTarget.Resize(width, height);
+    area.scaledGlitch.Resize(width, height);
+    area.scaledSnapshotStale = true;
+}
+
+template<PixelFormat Format>
+HRESULT BasicCpuBackend<Format>::Render(FrameParams const& params)
+{
+    // Same effect chain as the D3D11 backend: the RGB split reads the output
+    // of the digital glitch and is skipped for the clean frame.
+    bool const split =
+        params.intensity > 0.0f && params.quality < QualityLevel::SingleEffect;
+
+    // Cheaper quality levels override the configured kernel and sampling
+    // for this frame only.
+    GlitchKernel kernel = digitalGlitch.kernel;
+    GlitchSampling sampling = digitalGlitch.sampling;
+    if (params.quality >= QualityLevel::NearestSampling)
+        sampling = GlitchSampling::Nearest;
+    if (params.quality >= QualityLevel::Blit)
+        kernel = GlitchKernel::Blit;
+
+    bool const scaled =
+        processingScale > 1 || params.quality >= QualityLevel::HalfResolution;
+
+    assert(params.arena && "Frames need an arena for their scratch data");
+    {
+        GT_STAGE_SCOPE(MetricStage::GlitchUpdate);
+        for (size_t i = 0; i < areas.size(); ++i) {
+            GlitchArea& area = areas[i];
+            BasicCpuDigitalGlitch<Format>& glitch =
+                scaled ? area.scaledGlitch : area.glitch;
+            glitch.kernel = kernel;
+            glitch.sampling = sampling;
+            glitch.colorShuffle = digitalGlitch.colorShuffle;
+            glitch.intensity = params.intensity;
+
+            BurstFrame const* planned = params.planned;
+            if (!planned) {
+                glitch.Update(*params.arena);
+            } else if (i == 0) {
+                glitch.Update(*params.arena, *planned->noise, planned->cells,
+                              planned->useTrashFrame2);
+            } else {
+                area.plannedNoise.Derive(*planned->noise, static_cast<uint32_t>(i));
+                area.plannedCells.Evaluate(area.plannedNoise, params.intensity);
+                glitch.Update(*params.arena, area.plannedNoise, area.plannedCells,
+                              planned->useTrashFrame2);
+            }
+        }
+    }
+
+    {
+        GT_STAGE_SCOPE(MetricStage::DigitalGlitch);
+        Image& glitchTarget = split ? effectTarget : output;
+        for (GlitchArea& area : areas) {
+            if (scaled) {
+                RenderScaledGlitch(area, glitchTarget);
+                continue;
+            }
+
+            ImageRect const& rect = area.rect;
+            cimage_view<Pixel> const areaSource = SubView(capture, rect);
+            image_view<Pixel> const areaTarget = SubView(glitchTarget.View(), rect);
+            ForEachRowBand(pool, rect.height, [&](unsigned rowBegin, unsigned rowEnd) {
+                area.glitch.OnRenderImage(areaSource, areaTarget, rowBegin, rowEnd);
+            });
+        }
+    }
+
+    if (split) {
+        GT_STAGE_SCOPE(MetricStage::ChromaticSplit);
+        chromaticSplit.intensity = params.intensity;
+        chromaticSplit.Update();
+        for (GlitchArea const& area : areas) {
+            ImageRect const& rect = area.rect;
+            cimage_view<Pixel> const areaSource = SubView(effectTarget.View(), rect);
+            image_view<Pixel> const areaTarget = SubView(output.View(), rect);
+            ForEachRowBand(pool, rect.height, [&](unsigned rowBegin, unsigned rowEnd) {
+                chromaticSplit.OnRenderImage(areaSource, areaTarget, rowBegin, rowEnd);
+            });
+        }
+    }
+
+    if (!regionMask.Empty()) {
+        GT_TRACE_SCOPE("RegionMask");
+        for (GlitchArea const& area : areas) {
+            ImageRect const& rect = area.rect;
+            cimage_view<uint32_t> const areaMask = SubView(regionMask.View(), rect);
+            cimage_view<Pixel> const areaSource = SubView(capture, rect);
+            image_view<Pixel> const areaTarget = SubView(output.View(), rect);
+            ForEachRowBand(pool, rect.height, [&](unsigned rowBegin, unsigned rowEnd) {
+                ApplyRegionMask(areaMask, areaSource, areaTarget, rowBegin, rowEnd);
+            });
+        }
+    }
+
+    return S_OK;
+}
+
+template<PixelFormat Format>
+void BasicCpuBackend<Format>::RenderScaledGlitch(GlitchArea& area, Image& target)
+{
+    unsigned const factor = GetScaledFactor();
+    BasicCpuDigitalGlitch<Format> const& glitch = area.scaledGlitch;
+    Image& scaledSnapshot = area.scaledSnapshot;
+    Image& scaledTarget = area.scaledTarget;
+
+    cimage_view<Pixel> const areaSource = SubView(capture, area.rect);
+    if (area.scaledSnapshotStale) {
+        ForEachRowBand(pool, scaledSnapshot.Height(),
+                       [&](unsigned rowBegin, unsigned rowEnd) {
+                           DownsampleBox<Format>(areaSource, scaledSnapshot.View(),
+                                                 factor, rowBegin, rowEnd);
+                       });
+        area.scaledSnapshotStale = false;
+    }
+
+    ForEachRowBand(pool, scaledTarget.Height(), [&](unsigned rowBegin, unsigned rowEnd) {
+        glitch.OnRenderImage(scaledSnapshot, scaledTarget, rowBegin, rowEnd);
+    });
+
+    image_view<Pixel> const areaTarget = SubView(target.View(), area.rect);
+    ForEachRowBand(pool, area.rect.height, [&](unsigned rowBegin, unsigned rowEnd) {
+        ComposeScaledGlitch(glitch.plan, factor, areaSource, scaledTarget.View(),
+                            areaTarget, rowBegin, rowEnd);
+    });
+}
+
+template<PixelFormat Format>
+HRESULT BasicCpuBackend<Format>::Present()
+{
+    GT_STAGE_SCOPE(MetricStage::Present);
+    if (sink)
+        HR(sink->WriteFrame(output));
+
+    ++presentedFrames;
+    return S_OK;
+}
+
+template class BasicCpuBackend<PixelFormat::Bgra8>;
+template class BasicCpuBackend<PixelFormat::Rgb10A2>;
+template class BasicCpuBackend<PixelFormat::Rgba16>;
+template class BasicCpuBackend<PixelFormat::Rgba16F>;
+
+} // namespace gt
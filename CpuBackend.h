@@ -0,0 +1,143 @@
+#pragma once
+#include "CpuGlitch.h"
+#include "FrameSink.h"
+#include "FrameSource.h"
+#include "GlitchRegion.h"
+#include "ImageBuffer.h"
+#include "RenderBackend.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace gt
+{
+
+/// <summary>
+///   Backend rendering into system memory without a GPU or a window. Frames
+///   are captured from an <see cref="IBasicFrameSource"/>, and presented
+///   frames are handed to an optional sink. All frames and intermediates
+///   have <typeparamref name="Format"/>, so deeper captures are glitched
+///   without a round trip through BGRA8.
+/// </summary>
+template<PixelFormat Format>
+class BasicCpuBackend : public IRenderBackend
+{
+public:
+    using Pixel = PixelType<Format>;
+    using Image = BasicImageBuffer<Format>;
+    using Sink = IBasicFrameSink<Image>;
+
+    explicit BasicCpuBackend(std::unique_ptr<IBasicFrameSource<Format>> source);
+
+    /// <summary>
+    ///   Allocates the frame buffers and captures the first frame. A zero
+    ///   size renders at the native size of the frame source.
+    /// </summary>
+    HRESULT Initialize(unsigned width = 0, unsigned height = 0);
+
+    HRESULT RefreshCapture() override;
+    HRESULT Resize(unsigned newWidth, unsigned newHeight) override;
+    HRESULT Render(FrameParams const& params) override;
+    HRESULT Present() override;
+
+    void SetSink(Sink* newSink) { sink = newSink; }
+
+    /// Splits the effect passes into row bands across <paramref name="newPool"/>.
+    /// Without a pool the passes run on the calling thread.
+    void SetThreadPool(ThreadPool* newPool) { pool = newPool; }
+
+    /// <summary>
+    ///   Runs the digital glitch on the capture downsampled by
+    ///   <paramref name="factor"/>, 1 (full resolution), 2 or 4, and upscales
+    ///   it into the glitched cells only; clean cells keep the full
+    ///   resolution capture. <see cref="QualityLevel::HalfResolution"/>
+    ///   frames use at least a factor of 2.
+    /// </summary>
+    HRESULT SetProcessingScale(unsigned factor);
+
+    /// <summary>
+    ///   Limits the effects to <paramref name="newRegion"/>, or to the whole
+    ///   frame again if it is empty. Every rectangle is glitched as an image
+    ///   of its own, with its own noise and trash frames, so the work and the
+    ///   memory of the effects scale with the area of the region. Planned
+    ///   frames bring the noise of the first rectangle; the others derive
+    ///   theirs from it, so planning a burst ahead does not change how the
+    ///   rectangles glitch relative to each other. Captures
+    ///   then only refresh the region; the rest of the output keeps the
+    ///   frame captured when the region was set.
+    /// </summary>
+    HRESULT SetRegion(GlitchRegion const& newRegion);
+
+    Image const& GetOutput() const { return output; }
+    unsigned GetPresentedFrames() const { return presentedFrames; }
+
+    /// Kernel, sampling and color shuffle of the digital glitch, shared by
+    /// every rectangle of the region.
+    BasicCpuDigitalGlitch<Format> digitalGlitch;
+    BasicCpuChromaticSplit<Format> chromaticSplit;
+
+private:
+    /// Effect state of one rectangle of the region, or of the whole frame.
+    struct GlitchArea
+    {
+        ImageRect rect;
+        BasicCpuDigitalGlitch<Format> glitch;
+
+        /// Noise derived from that of a planned frame, and its cells.
+        NoiseGrid plannedNoise;
+        CellDecisions plannedCells;
+
+        /// Reduced resolution copy of the snapshot and the digital glitch of
+        /// it. Kept at the scaled factor even at full quality, so that
+        /// stepping down to half resolution in the middle of a burst does not
+        /// allocate.
+        BasicCpuDigitalGlitch<Format> scaledGlitch;
+        Image scaledSnapshot;
+        Image scaledTarget;
+        /// Whether the snapshot changed since it was last downsampled, which
+        /// only happens once a frame needs it.
+        bool scaledSnapshotStale = true;
+    };
+
+    bool HasRegion() const { return !regionRects.empty() || !regionMask.Empty(); }
+
+    /// Downsampling factor of the reduced resolution frames.
+    unsigned GetScaledFactor() const { return std::max(processingScale, 2u); }
+    void UpdateAreas();
+    void ResizeScaled(GlitchArea& area);
+    void RenderScaledGlitch(GlitchArea& area, Image& target);
+
+    std::unique_ptr<IBasicFrameSource<Format>> source;
+    Sink* sink = nullptr;
+    ThreadPool* pool = nullptr;
+
+    /// Frame the effects read: the snapshot, or a frame the source lends in
+    /// place until the next capture.
+    cimage_view<Pixel> capture;
+    Image snapshot;
+    Image effectTarget;
+    Image output;
+
+    unsigned processingScale = 1;
+    std::vector<GlitchArea> areas;
+
+    /// Region as given, with its mask resampled to the render size, and the
+    /// rectangles of the areas it covers in the current frame size. The mask
+    /// stays BGRA8 whatever the format of the frames.
+    std::vector<ImageRect> regionRects;
+    ImageBuffer regionMask;
+    std::vector<ImageRect> captureRects;
+    /// Set when the output outside of the region no longer shows the
+    /// snapshot, so that the next capture takes the whole frame.
+    bool fullCapturePending = true;
+
+    unsigned renderWidth = 0;
+    unsigned renderHeight = 0;
+    unsigned presentedFrames = 0;
+};
+
+using CpuBackend = BasicCpuBackend<PixelFormat::Bgra8>;
+
+} // namespace gt
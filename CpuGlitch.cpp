@@ -0,0 +1,866 @@
+#include "CpuGlitch.h"
+
+#include "MathUtils.h"
+#include "Metrics.h"
+#include "PixelFormat.h"
+#include "Random.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define GT_HAVE_SSE2 1
+#else
+#define GT_HAVE_SSE2 0
+#endif
+
+namespace gt
+{
+
+namespace
+{
+
+constexpr unsigned ScratchPixels = 1024;
+
+/// Computes the first pixel of every cell when <paramref name="cells"/> cells
+/// are point-sampled across <paramref name="size"/> pixel centers.
+template<size_t N>
+void ComputeCellBounds(std::array<uint32_t, N>& bounds, unsigned size)
+{
+    unsigned const cells = N - 1;
+    for (unsigned c = 0; c <= cells; ++c) {
+        int64_t const num = 2 * int64_t(c) * size - cells;
+        int64_t const first = num <= 0 ? 0 : (num + 2 * cells - 1) / (2 * cells);
+        bounds[c] = static_cast<uint32_t>(std::min<int64_t>(first, size));
+    }
+}
+
+/// Converts a displacement in UV units to wrapped 1/256 pixel units.
+int32_t FixedOffset(float uv, unsigned size, GlitchSampling sampling)
+{
+    int64_t const wrap = int64_t(size) * 256;
+    int64_t offset;
+    if (sampling == GlitchSampling::Nearest)
+        offset = static_cast<int64_t>(std::floor(0.5f + uv * size)) * 256;
+    else
+        offset = std::llround(static_cast<double>(uv) * size * 256);
+    return static_cast<int32_t>(offset % wrap);
+}
+
+/// Source position (in 1/256 pixels, relative to pixel centers) sampled for
+/// pixel <paramref name="x"/> displaced by <paramref name="offset"/>. The
+/// result is in [-128, wrap - 128).
+int32_t WrapCoord(unsigned x, int32_t offset, int32_t wrap)
+{
+    return static_cast<int32_t>((int64_t(x) * 256 + 128 + offset) % wrap) - 128;
+}
+
+unsigned ClampIndex(int32_t i, unsigned size)
+{
+    return static_cast<unsigned>(std::clamp<int32_t>(i, 0, int32_t(size) - 1));
+}
+
+/// Traits for one 8-bit plane of a planar image.
+struct PlaneTraits
+{
+    using Pixel = uint8_t;
+
+    static constexpr bool ByteChannels = true;
+
+    static Pixel Lerp(Pixel a, Pixel b, unsigned w)
+    {
+        return static_cast<Pixel>(details::LerpChannel(a, b, w));
+    }
+};
+
+template<typename Traits>
+typename Traits::Pixel Bilerp(typename Traits::Pixel p00, typename Traits::Pixel p01,
+                              typename Traits::Pixel p10, typename Traits::Pixel p11,
+                              unsigned wx, unsigned wy)
+{
+    return Traits::Lerp(Traits::Lerp(p00, p01, wx), Traits::Lerp(p10, p11, wx), wy);
+}
+
+/// Bilinear interpolation of <paramref name="count"/> pixels where both
+/// horizontal taps are inside the rows. Formats with byte channels (BGRA8
+/// and 8-bit planes) are vectorized byte by byte, regardless of the channel
+/// order.
+template<typename Traits>
+void LerpRun(typename Traits::Pixel* dst, typename Traits::Pixel const* row0,
+             typename Traits::Pixel const* row1, unsigned wx, unsigned wy, unsigned count,
+             bool simd)
+{
+    using Pixel = typename Traits::Pixel;
+
+    if (wx == 0 && wy == 0) {
+        std::memcpy(dst, row0, count * sizeof(Pixel));
+        return;
+    }
+
+    unsigned i = 0;
+#if GT_HAVE_SSE2
+    if constexpr (Traits::ByteChannels) {
+        if (simd) {
+            constexpr unsigned PixelsPerVector = sizeof(__m128i) / sizeof(Pixel);
+
+            __m128i const zero = _mm_setzero_si128();
+            __m128i const round = _mm_set1_epi16(128);
+            __m128i const vwx = _mm_set1_epi16(static_cast<short>(wx));
+            __m128i const viwx = _mm_set1_epi16(static_cast<short>(256 - wx));
+            __m128i const vwy = _mm_set1_epi16(static_cast<short>(wy));
+            __m128i const viwy = _mm_set1_epi16(static_cast<short>(256 - wy));
+
+            auto lerp = [&](__m128i a, __m128i b, __m128i w, __m128i iw) {
+                __m128i const sum = _mm_add_epi16(
+                    _mm_add_epi16(_mm_mullo_epi16(a, iw), _mm_mullo_epi16(b, w)), round);
+                return _mm_srli_epi16(sum, 8);
+            };
+
+            auto load = [](Pixel const* p) {
+                return _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+            };
+
+            for (; i + PixelsPerVector <= count; i += PixelsPerVector) {
+                __m128i const p00 = load(row0 + i);
+                __m128i const p01 = load(row0 + i + 1);
+                __m128i const p10 = load(row1 + i);
+                __m128i const p11 = load(row1 + i + 1);
+
+                __m128i const top0 = lerp(_mm_unpacklo_epi8(p00, zero),
+                                          _mm_unpacklo_epi8(p01, zero), vwx, viwx);
+                __m128i const top1 = lerp(_mm_unpackhi_epi8(p00, zero),
+                                          _mm_unpackhi_epi8(p01, zero), vwx, viwx);
+                __m128i const bot0 = lerp(_mm_unpacklo_epi8(p10, zero),
+                                          _mm_unpacklo_epi8(p11, zero), vwx, viwx);
+                __m128i const bot1 = lerp(_mm_unpackhi_epi8(p10, zero),
+                                          _mm_unpackhi_epi8(p11, zero), vwx, viwx);
+
+                __m128i const lo = lerp(top0, bot0, vwy, viwy);
+                __m128i const hi = lerp(top1, bot1, vwy, viwy);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                                 _mm_packus_epi16(lo, hi));
+            }
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+        dst[i] = Bilerp<Traits>(row0[i], row0[i + 1], row1[i], row1[i + 1], wx, wy);
+}
+
+/// Samples <paramref name="count"/> consecutive pixels starting at source
+/// position <paramref name="sx"/> (see <see cref="WrapCoord"/>), wrapping
+/// around the right edge like the displacement in DigitalGlitchPS.
+template<typename Traits>
+void SampleSpan(typename Traits::Pixel* dst, typename Traits::Pixel const* row0,
+                typename Traits::Pixel const* row1, unsigned wy, int32_t sx,
+                unsigned count, unsigned width, bool simd)
+{
+    int32_t const wrap = int32_t(width) * 256;
+
+    while (count > 0) {
+        int32_t const x0 = sx >> 8;
+        unsigned const wx = sx & 0xFF;
+
+        unsigned run;
+        if (x0 < 0 || x0 >= int32_t(width) - 1) {
+            // Edge texel, the second tap is clamped.
+            unsigned const a = ClampIndex(x0, width);
+            unsigned const b = ClampIndex(x0 + 1, width);
+            *dst = Bilerp<Traits>(row0[a], row0[b], row1[a], row1[b], wx, wy);
+            run = 1;
+        } else {
+            run = std::min<unsigned>(count, width - 1 - x0);
+            LerpRun<Traits>(dst, row0 + x0, row1 + x0, wx, wy, run, simd);
+        }
+
+        dst += run;
+        count -= run;
+        sx += int32_t(run) * 256;
+        if (sx >= wrap - 128)
+            sx -= wrap;
+    }
+}
+
+template<typename Traits>
+void ShuffleSpan(typename Traits::Pixel* pixels, unsigned count)
+{
+    for (unsigned i = 0; i < count; ++i)
+        pixels[i] = Traits::Shuffle(pixels[i]);
+}
+
+/// Replaces the color of <paramref name="dst"/> with <paramref name="trash"/>
+/// while keeping the alpha of the source.
+template<typename Traits>
+void MergeTrashSpan(typename Traits::Pixel* dst, typename Traits::Pixel const* trash,
+                    unsigned count)
+{
+    for (unsigned i = 0; i < count; ++i)
+        dst[i] = (trash[i] & ~Traits::AlphaMask) | (dst[i] & Traits::AlphaMask);
+}
+
+template<typename Traits>
+Color SampleScalar(cimage_view<typename Traits::Pixel> image, float sx, float sy,
+                   GlitchSampling sampling)
+{
+    unsigned const width = unsigned(image.width());
+    unsigned const height = unsigned(image.height());
+
+    if (sampling == GlitchSampling::Nearest) {
+        return Traits::ToColor(image(ClampIndex(int32_t(std::floor(sx + 0.5f)), width),
+                                     ClampIndex(int32_t(std::floor(sy + 0.5f)), height)));
+    }
+
+    float const fx0 = std::floor(sx);
+    float const fy0 = std::floor(sy);
+    float const fx = sx - fx0;
+    float const fy = sy - fy0;
+    unsigned const x0 = ClampIndex(int32_t(fx0), width);
+    unsigned const x1 = ClampIndex(int32_t(fx0) + 1, width);
+    auto const row0 = image.row(ClampIndex(int32_t(fy0), height));
+    auto const row1 = image.row(ClampIndex(int32_t(fy0) + 1, height));
+
+    Color const c00 = Traits::ToColor(row0[x0]);
+    Color const c01 = Traits::ToColor(row0[x1]);
+    Color const c10 = Traits::ToColor(row1[x0]);
+    Color const c11 = Traits::ToColor(row1[x1]);
+
+    auto channel = [&](float Color::*c) {
+        return Lerp(Lerp(c00.*c, c01.*c, fx), Lerp(c10.*c, c11.*c, fx), fy);
+    };
+    return {channel(&Color::b), channel(&Color::g), channel(&Color::r),
+            channel(&Color::a)};
+}
+
+template<typename Traits>
+void RenderRowsScalar(GlitchPlan const& plan, cimage_view<typename Traits::Pixel> source,
+                      cimage_view<typename Traits::Pixel> trash,
+                      image_view<typename Traits::Pixel> dest, unsigned rowBegin,
+                      unsigned rowEnd)
+{
+    float const width = static_cast<float>(plan.width);
+    float const height = static_cast<float>(plan.height);
+    float const scale = Traits::ColorScale;
+
+    unsigned cy = 0;
+    for (unsigned y = rowBegin; y < rowEnd; ++y) {
+        while (y >= plan.cellY[cy + 1])
+            ++cy;
+
+        auto const out = dest.row(y);
+        for (unsigned cx = 0; cx < NoiseGrid::Width; ++cx) {
+            GlitchCell const& cell = plan.Cell(cx, cy);
+            float const sy = std::fmod(y + 0.5f + cell.offsetY / 256.0f, height) - 0.5f;
+
+            for (unsigned x = plan.cellX[cx]; x < plan.cellX[cx + 1]; ++x) {
+                float const sx = std::fmod(x + 0.5f + cell.offsetX / 256.0f, width) - 0.5f;
+
+                Color color = SampleScalar<Traits>(source, sx, sy, plan.sampling);
+                if (cell.flags & GlitchCell::Trash) {
+                    Color const t = SampleScalar<Traits>(trash, sx, sy, plan.sampling);
+                    color = {t.b, t.g, t.r, color.a};
+                }
+
+                if (cell.flags & GlitchCell::Shuffle) {
+                    float const k = (scale - (color.r + color.g + color.b)) * 0.5f;
+                    color = {std::clamp(color.b + k, 0.0f, scale),
+                             std::clamp(color.r + k, 0.0f, scale),
+                             std::clamp(color.g + k, 0.0f, scale), color.a};
+                }
+
+                out[x] = Traits::FromColor(color);
+            }
+        }
+    }
+}
+
+template<typename Traits>
+void RenderRowsFixed(GlitchPlan const& plan, cimage_view<typename Traits::Pixel> source,
+                     cimage_view<typename Traits::Pixel> trash,
+                     image_view<typename Traits::Pixel> dest, unsigned rowBegin,
+                     unsigned rowEnd, bool simd)
+{
+    using Pixel = typename Traits::Pixel;
+
+    unsigned const width = plan.width;
+    unsigned const height = plan.height;
+    int32_t const wrapX = int32_t(width) * 256;
+    int32_t const wrapY = int32_t(height) * 256;
+
+    Pixel scratch[ScratchPixels];
+
+    unsigned cy = 0;
+    for (unsigned y = rowBegin; y < rowEnd; ++y) {
+        while (y >= plan.cellY[cy + 1])
+            ++cy;
+
+        Pixel* out = dest.row(y).data();
+        unsigned cx = 0;
+        while (cx < NoiseGrid::Width) {
+            GlitchCell const& cell = plan.Cell(cx, cy);
+            unsigned const x0 = plan.cellX[cx];
+
+            if (cell.flags == 0) {
+                // Copy the whole run of clean cells at once.
+                unsigned end = cx + 1;
+                while (end < NoiseGrid::Width && plan.Cell(end, cy).flags == 0)
+                    ++end;
+                std::memcpy(out + x0, &source(x0, y),
+                            (plan.cellX[end] - x0) * sizeof(Pixel));
+                cx = end;
+                continue;
+            }
+
+            unsigned const x1 = plan.cellX[cx + 1];
+            int32_t const sy = WrapCoord(y, cell.offsetY, wrapY);
+            unsigned const wy = sy & 0xFF;
+            unsigned const r0 = ClampIndex(sy >> 8, height);
+            unsigned const r1 = ClampIndex((sy >> 8) + 1, height);
+
+            SampleSpan<Traits>(out + x0, source.row(r0).data(), source.row(r1).data(), wy,
+                               WrapCoord(x0, cell.offsetX, wrapX), x1 - x0, width, simd);
+
+            if (cell.flags & GlitchCell::Trash) {
+                for (unsigned x = x0; x < x1; x += ScratchPixels) {
+                    unsigned const count = std::min(ScratchPixels, x1 - x);
+                    SampleSpan<Traits>(scratch, trash.row(r0).data(),
+                                       trash.row(r1).data(), wy,
+                                       WrapCoord(x, cell.offsetX, wrapX), count, width,
+                                       simd);
+                    MergeTrashSpan<Traits>(out + x, scratch, count);
+                }
+            }
+
+            if (cell.flags & GlitchCell::Shuffle)
+                ShuffleSpan<Traits>(out + x0, x1 - x0);
+
+            ++cx;
+        }
+    }
+}
+
+template<typename Traits>
+void RenderRowsBlit(GlitchPlan const& plan, cimage_view<typename Traits::Pixel> source,
+                    cimage_view<typename Traits::Pixel> trash,
+                    image_view<typename Traits::Pixel> dest, unsigned rowBegin,
+                    unsigned rowEnd)
+{
+    using Pixel = typename Traits::Pixel;
+
+    assert(plan.sampling == GlitchSampling::Nearest);
+
+    for (GlitchBlit const& blit : plan.blits) {
+        unsigned const y0 = std::max(blit.dstY, rowBegin);
+        unsigned const y1 = std::min(blit.dstY + blit.height, rowEnd);
+
+        for (unsigned y = y0; y < y1; ++y) {
+            unsigned const srcY = blit.srcY + (y - blit.dstY);
+            Pixel* out = &dest(blit.dstX, y);
+            Pixel const* src = &source(blit.srcX, srcY);
+
+            std::memcpy(out, src, blit.width * sizeof(Pixel));
+            if (blit.flags & GlitchBlit::FromTrash)
+                MergeTrashSpan<Traits>(out, &trash(blit.srcX, srcY), blit.width);
+            if (blit.flags & GlitchBlit::Shuffle)
+                ShuffleSpan<Traits>(out, blit.width);
+        }
+    }
+}
+
+struct PlaneSources
+{
+    cimage_view<uint8_t> source;
+    cimage_view<uint8_t> trash;
+};
+
+/// <summary>
+///   Renders rows [<paramref name="rowBegin"/>, <paramref name="rowEnd"/>) of
+///   one plane of the size the plan was compiled for. Cells with the shuffle
+///   flag read from <paramref name="shuffled"/> instead of
+///   <paramref name="normal"/>.
+/// </summary>
+void RenderPlaneRows(GlitchPlan const& plan, PlaneSources const& normal,
+                     PlaneSources const& shuffled, image_view<uint8_t> dest,
+                     unsigned rowBegin, unsigned rowEnd, bool simd)
+{
+    unsigned const width = plan.width;
+    unsigned const height = plan.height;
+    int32_t const wrapX = int32_t(width) * 256;
+    int32_t const wrapY = int32_t(height) * 256;
+
+    unsigned cy = 0;
+    for (unsigned y = rowBegin; y < rowEnd; ++y) {
+        while (y >= plan.cellY[cy + 1])
+            ++cy;
+
+        uint8_t* out = dest.row(y).data();
+        unsigned cx = 0;
+        while (cx < NoiseGrid::Width) {
+            GlitchCell const& cell = plan.Cell(cx, cy);
+            unsigned const x0 = plan.cellX[cx];
+
+            if (cell.flags == 0) {
+                unsigned end = cx + 1;
+                while (end < NoiseGrid::Width && plan.Cell(end, cy).flags == 0)
+                    ++end;
+                std::memcpy(out + x0, &normal.source(x0, y), plan.cellX[end] - x0);
+                cx = end;
+                continue;
+            }
+
+            // Trash replaces the sample entirely; there is no alpha to keep.
+            PlaneSources const& planes = (cell.flags & GlitchCell::Shuffle) ? shuffled
+                                                                             : normal;
+            cimage_view<uint8_t> const& src =
+                (cell.flags & GlitchCell::Trash) ? planes.trash : planes.source;
+
+            int32_t const sy = WrapCoord(y, cell.offsetY, wrapY);
+            unsigned const r0 = ClampIndex(sy >> 8, height);
+            unsigned const r1 = ClampIndex((sy >> 8) + 1, height);
+            SampleSpan<PlaneTraits>(out + x0, src.row(r0).data(), src.row(r1).data(),
+                                    sy & 0xFF, WrapCoord(x0, cell.offsetX, wrapX),
+                                    plan.cellX[cx + 1] - x0, width, simd);
+            ++cx;
+        }
+    }
+}
+
+template<typename Traits>
+typename Traits::Pixel CombineChannels(typename Traits::Pixel red,
+                                       typename Traits::Pixel center,
+                                       typename Traits::Pixel blue)
+{
+    return (red & Traits::RedMask) | (center & ~(Traits::RedMask | Traits::BlueMask)) |
+           (blue & Traits::BlueMask);
+}
+
+#if GT_HAVE_SSE2
+inline __m128i SplatPixel(uint32_t p)
+{
+    return _mm_set1_epi32(static_cast<int>(p));
+}
+
+inline __m128i SplatPixel(uint64_t p)
+{
+    return _mm_set1_epi64x(static_cast<long long>(p));
+}
+#endif
+
+} // namespace
+
+void CellDecisions::Evaluate(NoiseGrid const& noise, float intensity)
+{
+    // Same weights as DigitalGlitchPS.
+    float const thresh = 1.001f - intensity * 1.001f;
+
+    for (size_t i = 0; i < flags.size(); ++i) {
+        uint32_t const texel = noise.texels[i];
+        float const gz = (texel & 0xFF) / 255.0f;
+        float const gw = (texel >> 24) / 255.0f;
+
+        uint8_t cellFlags = 0;
+        if (std::pow(gz, 2.5f) >= thresh)
+            cellFlags |= GlitchCell::Displace;
+        if (std::pow(gw, 2.5f) >= thresh)
+            cellFlags |= GlitchCell::Trash;
+        if (std::pow(gz, 3.5f) >= thresh)
+            cellFlags |= GlitchCell::Shuffle;
+        flags[i] = cellFlags;
+    }
+}
+
+void GlitchPlan::Compile(NoiseGrid const& noise, float intensity, unsigned newWidth,
+                         unsigned newHeight, Arena* blitArena)
+{
+    CellDecisions decisions;
+    decisions.Evaluate(noise, intensity);
+    Compile(noise, decisions, newWidth, newHeight, blitArena);
+}
+
+void GlitchPlan::Compile(NoiseGrid const& noise, CellDecisions const& decisions,
+                         unsigned newWidth, unsigned newHeight, Arena* blitArena)
+{
+    width = newWidth;
+    height = newHeight;
+    ComputeCellBounds(cellX, width);
+    ComputeCellBounds(cellY, height);
+
+    // Cells whose effect is a no-op are normalized to no flags so that
+    // kernels can copy them directly.
+    uint8_t const allowed = colorShuffle ? 0xFF : uint8_t(~GlitchCell::Shuffle);
+
+    uint64_t cleanCells = 0;
+    for (size_t i = 0; i < cells.size(); ++i) {
+        GlitchCell cell;
+        cell.flags = decisions.flags[i] & allowed;
+        if (cell.flags & GlitchCell::Displace) {
+            uint32_t const texel = noise.texels[i];
+            float const gx = ((texel >> 16) & 0xFF) / 255.0f;
+            float const gy = ((texel >> 8) & 0xFF) / 255.0f;
+            cell.offsetX = FixedOffset(gx, width, sampling);
+            cell.offsetY = FixedOffset(gy, height, sampling);
+            if (cell.offsetX == 0 && cell.offsetY == 0)
+                cell.flags &= ~GlitchCell::Displace;
+        }
+
+        cells[i] = cell;
+        cleanCells += cell.flags == 0;
+    }
+    AddToCounter(MetricCounter::CleanCells, cleanCells);
+    AddToCounter(MetricCounter::GlitchedCells, cells.size() - cleanCells);
+
+    blits = {};
+    if (blitArena)
+        CompileBlits(*blitArena);
+}
+
+void GlitchPlan::CompileBlits(Arena& arena)
+{
+    assert(sampling == GlitchSampling::Nearest);
+
+    // A cell splits into at most four blits. The unused part of the worst
+    // case goes back to the arena afterwards.
+    span<GlitchBlit> const storage = arena.AllocateArray<GlitchBlit>(cells.size() * 4);
+    size_t count = 0;
+    auto emit = [&](GlitchBlit const& blit) { storage[count++] = blit; };
+
+    auto sameBlit = [](GlitchCell const& a, GlitchCell const& b) {
+        return a.flags == b.flags && a.offsetX == b.offsetX && a.offsetY == b.offsetY;
+    };
+
+    for (unsigned cy = 0; cy < NoiseGrid::Height; ++cy) {
+        uint32_t const y0 = cellY[cy];
+        uint32_t const y1 = cellY[cy + 1];
+        if (y0 == y1)
+            continue;
+
+        unsigned cx = 0;
+        while (cx < NoiseGrid::Width) {
+            GlitchCell const& cell = Cell(cx, cy);
+            unsigned end = cx + 1;
+            while (end < NoiseGrid::Width && sameBlit(Cell(end, cy), cell))
+                ++end;
+
+            uint32_t const x0 = cellX[cx];
+            uint32_t const x1 = cellX[end];
+            cx = end;
+            if (x0 == x1)
+                continue;
+
+            uint8_t flags = 0;
+            if (cell.flags & GlitchCell::Trash)
+                flags |= GlitchBlit::FromTrash;
+            if (cell.flags & GlitchCell::Shuffle)
+                flags |= GlitchBlit::Shuffle;
+
+            // Split the source rectangle where it wraps around the image.
+            uint32_t const srcX = (x0 + cell.offsetX / 256) % width;
+            uint32_t const srcY = (y0 + cell.offsetY / 256) % height;
+            uint32_t const w0 = std::min(x1 - x0, width - srcX);
+            uint32_t const h0 = std::min(y1 - y0, height - srcY);
+
+            emit({x0, y0, w0, h0, srcX, srcY, flags});
+            if (w0 < x1 - x0)
+                emit({x0 + w0, y0, x1 - x0 - w0, h0, 0, srcY, flags});
+            if (h0 < y1 - y0) {
+                emit({x0, y0 + h0, w0, y1 - y0 - h0, srcX, 0, flags});
+                if (w0 < x1 - x0)
+                    emit({x0 + w0, y0 + h0, x1 - x0 - w0, y1 - y0 - h0, 0, 0, flags});
+            }
+        }
+    }
+
+    arena.Shrink(storage.data(), storage.size_bytes(), count * sizeof(GlitchBlit));
+    blits = storage.first(count);
+}
+
+template<PixelFormat Format>
+void RenderDigitalGlitch(GlitchKernel kernel, GlitchPlan const& plan,
+                         cimage_view<PixelType<Format>> source,
+                         cimage_view<PixelType<Format>> trash,
+                         image_view<PixelType<Format>> dest, unsigned rowBegin,
+                         unsigned rowEnd)
+{
+    using Traits = PixelTraits<Format>;
+
+    assert(source.width() == plan.width && source.height() == plan.height);
+    assert(trash.width() == plan.width && trash.height() == plan.height);
+    assert(dest.width() == plan.width && dest.height() == plan.height);
+
+    rowEnd = std::min(rowEnd, plan.height);
+    if (rowBegin >= rowEnd)
+        return;
+
+    switch (kernel) {
+    case GlitchKernel::Scalar:
+        RenderRowsScalar<Traits>(plan, source, trash, dest, rowBegin, rowEnd);
+        break;
+    case GlitchKernel::Integer:
+        RenderRowsFixed<Traits>(plan, source, trash, dest, rowBegin, rowEnd, false);
+        break;
+    case GlitchKernel::Simd:
+        RenderRowsFixed<Traits>(plan, source, trash, dest, rowBegin, rowEnd, true);
+        break;
+    case GlitchKernel::Blit:
+        RenderRowsBlit<Traits>(plan, source, trash, dest, rowBegin, rowEnd);
+        break;
+    }
+}
+
+template<PixelFormat Format>
+void ApplyBlitFlags(uint8_t flags, span<PixelType<Format>> pixels)
+{
+    using Traits = PixelTraits<Format>;
+
+    // Merging a blank trash frame only keeps the alpha of the source.
+    if (flags & GlitchBlit::FromTrash) {
+        for (PixelType<Format>& pixel : pixels)
+            pixel &= Traits::AlphaMask;
+    }
+    if (flags & GlitchBlit::Shuffle)
+        ShuffleSpan<Traits>(pixels.data(), static_cast<unsigned>(pixels.size()));
+}
+
+void RenderDigitalGlitch(GlitchKernel kernel, GlitchPlan const& lumaPlan,
+                         GlitchPlan const& chromaPlan, YuvImage const& source,
+                         YuvImage const& trash, YuvImage& dest, unsigned rowBegin,
+                         unsigned rowEnd)
+{
+    assert(source.Width() == lumaPlan.width && source.Height() == lumaPlan.height);
+    assert(source.ChromaWidth() == chromaPlan.width &&
+           source.ChromaHeight() == chromaPlan.height);
+    assert(trash.Width() == source.Width() && trash.Height() == source.Height());
+    assert(dest.Width() == source.Width() && dest.Height() == source.Height());
+
+    rowEnd = std::min(rowEnd, chromaPlan.height);
+    if (rowBegin >= rowEnd)
+        return;
+
+    bool const simd = kernel == GlitchKernel::Simd || kernel == GlitchKernel::Blit;
+
+    auto planeSources = [&](YuvPlane plane) {
+        return PlaneSources{source.PlaneView(plane), trash.PlaneView(plane)};
+    };
+
+    PlaneSources const luma = planeSources(YuvPlane::Y);
+    RenderPlaneRows(lumaPlan, luma, luma, dest.PlaneView(YuvPlane::Y), 2 * rowBegin,
+                    std::min(2 * rowEnd, lumaPlan.height), simd);
+
+    PlaneSources const u = planeSources(YuvPlane::U);
+    PlaneSources const v = planeSources(YuvPlane::V);
+    RenderPlaneRows(chromaPlan, u, v, dest.PlaneView(YuvPlane::U), rowBegin, rowEnd,
+                    simd);
+    RenderPlaneRows(chromaPlan, v, u, dest.PlaneView(YuvPlane::V), rowBegin, rowEnd,
+                    simd);
+}
+
+template<PixelFormat Format>
+void RenderChromaticSplit(cimage_view<PixelType<Format>> source,
+                          image_view<PixelType<Format>> dest, int shiftX, int shiftY,
+                          unsigned rowBegin, unsigned rowEnd)
+{
+    using Traits = PixelTraits<Format>;
+    using Pixel = PixelType<Format>;
+
+    assert(source.width() == dest.width() && source.height() == dest.height());
+
+    unsigned const width = unsigned(source.width());
+    unsigned const height = unsigned(source.height());
+    rowEnd = std::min(rowEnd, height);
+
+    // Columns for which both shifted taps are inside the row.
+    unsigned const margin = std::min<unsigned>(std::abs(shiftX), width);
+    unsigned const interiorBegin = margin;
+    unsigned const interiorEnd = std::max(width - margin, interiorBegin);
+
+    for (unsigned y = rowBegin; y < rowEnd; ++y) {
+        Pixel const* red = source.row(ClampIndex(int32_t(y) + shiftY, height)).data();
+        Pixel const* center = source.row(y).data();
+        Pixel const* blue = source.row(ClampIndex(int32_t(y) - shiftY, height)).data();
+        Pixel* out = dest.row(y).data();
+
+        auto edge = [&](unsigned x) {
+            unsigned const redX = ClampIndex(int32_t(x) + shiftX, width);
+            unsigned const blueX = ClampIndex(int32_t(x) - shiftX, width);
+            out[x] = CombineChannels<Traits>(red[redX], center[x], blue[blueX]);
+        };
+
+        for (unsigned x = 0; x < interiorBegin; ++x)
+            edge(x);
+
+        unsigned x = interiorBegin;
+#if GT_HAVE_SSE2
+        constexpr unsigned PixelsPerVector = sizeof(__m128i) / sizeof(Pixel);
+        __m128i const redMask = SplatPixel(Traits::RedMask);
+        __m128i const centerMask =
+            SplatPixel(Pixel(~(Traits::RedMask | Traits::BlueMask)));
+        __m128i const blueMask = SplatPixel(Traits::BlueMask);
+
+        for (; x + PixelsPerVector <= interiorEnd; x += PixelsPerVector) {
+            __m128i const r =
+                _mm_loadu_si128(reinterpret_cast<__m128i const*>(red + x + shiftX));
+            __m128i const c = _mm_loadu_si128(reinterpret_cast<__m128i const*>(center + x));
+            __m128i const b =
+                _mm_loadu_si128(reinterpret_cast<__m128i const*>(blue + x - shiftX));
+
+            __m128i const result =
+                _mm_or_si128(_mm_or_si128(_mm_and_si128(r, redMask),
+                                          _mm_and_si128(c, centerMask)),
+                             _mm_and_si128(b, blueMask));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), result);
+        }
+#endif
+        for (; x < interiorEnd; ++x)
+            out[x] =
+                CombineChannels<Traits>(red[x + shiftX], center[x], blue[x - shiftX]);
+
+        for (x = interiorEnd; x < width; ++x)
+            edge(x);
+    }
+}
+
+#define GT_INSTANTIATE_KERNELS(Format)                                                   \
+    template void RenderDigitalGlitch<Format>(                                           \
+        GlitchKernel, GlitchPlan const&, cimage_view<PixelType<Format>>,                 \
+        cimage_view<PixelType<Format>>, image_view<PixelType<Format>>, unsigned,         \
+        unsigned);                                                                       \
+    template void ApplyBlitFlags<Format>(uint8_t, span<PixelType<Format>>);              \
+    template void RenderChromaticSplit<Format>(cimage_view<PixelType<Format>>,           \
+                                               image_view<PixelType<Format>>, int, int,  \
+                                               unsigned, unsigned);
+
+GT_INSTANTIATE_KERNELS(PixelFormat::Bgra8)
+GT_INSTANTIATE_KERNELS(PixelFormat::Rgb10A2)
+GT_INSTANTIATE_KERNELS(PixelFormat::Rgba16)
+GT_INSTANTIATE_KERNELS(PixelFormat::Rgba16F)
+
+#undef GT_INSTANTIATE_KERNELS
+
+template<PixelFormat Format>
+void BasicCpuDigitalGlitch<Format>::Resize(unsigned renderWidth, unsigned renderHeight)
+{
+    trashFrame1.Resize(renderWidth, renderHeight);
+    trashFrame2.Resize(renderWidth, renderHeight);
+}
+
+template<PixelFormat Format>
+void BasicCpuDigitalGlitch<Format>::Update(Arena& frameArena)
+{
+    if (RandomFloat() > Lerp(0.9f, 0.5f, intensity))
+        noise.Generate();
+
+    useTrashFrame2 = !(RandomFloat() > 0.5f);
+
+    bool const blit = kernel == GlitchKernel::Blit;
+    plan.sampling = blit ? GlitchSampling::Nearest : sampling;
+    plan.colorShuffle = colorShuffle;
+    plan.Compile(noise, intensity, trashFrame1.Width(), trashFrame1.Height(),
+                 blit ? &frameArena : nullptr);
+}
+
+template<PixelFormat Format>
+void BasicCpuDigitalGlitch<Format>::Update(Arena& frameArena,
+                                           NoiseGrid const& frameNoise,
+                                           CellDecisions const& decisions,
+                                           bool trashFrame2)
+{
+    useTrashFrame2 = trashFrame2;
+
+    bool const blit = kernel == GlitchKernel::Blit;
+    plan.sampling = blit ? GlitchSampling::Nearest : sampling;
+    plan.colorShuffle = colorShuffle;
+    plan.Compile(frameNoise, decisions, trashFrame1.Width(), trashFrame1.Height(),
+                 blit ? &frameArena : nullptr);
+}
+
+template<PixelFormat Format>
+void BasicCpuDigitalGlitch<Format>::OnRenderImage(
+    BasicImageBuffer<Format> const& source, BasicImageBuffer<Format>& destination,
+    unsigned rowBegin, unsigned rowEnd) const
+{
+    OnRenderImage(source.View(), destination.View(), rowBegin, rowEnd);
+}
+
+template<PixelFormat Format>
+void BasicCpuDigitalGlitch<Format>::OnRenderImage(cimage_view<Pixel> source,
+                                                  image_view<Pixel> destination,
+                                                  unsigned rowBegin,
+                                                  unsigned rowEnd) const
+{
+    BasicImageBuffer<Format> const& trash = useTrashFrame2 ? trashFrame2 : trashFrame1;
+    RenderDigitalGlitch<Format>(kernel, plan, source, trash.View(), destination,
+                                rowBegin, rowEnd);
+}
+
+void CpuYuvGlitch::Resize(unsigned renderWidth, unsigned renderHeight)
+{
+    trashFrame1.Resize(renderWidth, renderHeight);
+    trashFrame2.Resize(renderWidth, renderHeight);
+}
+
+void CpuYuvGlitch::Update()
+{
+    if (RandomFloat() > Lerp(0.9f, 0.5f, intensity))
+        noise.Generate();
+
+    useTrashFrame2 = !(RandomFloat() > 0.5f);
+
+    GlitchSampling const planSampling =
+        kernel == GlitchKernel::Blit ? GlitchSampling::Nearest : sampling;
+    for (GlitchPlan* plan : {&lumaPlan, &chromaPlan}) {
+        plan->sampling = planSampling;
+        plan->colorShuffle = colorShuffle;
+    }
+
+    lumaPlan.Compile(noise, intensity, trashFrame1.Width(), trashFrame1.Height());
+    chromaPlan.Compile(noise, intensity, trashFrame1.ChromaWidth(),
+                       trashFrame1.ChromaHeight());
+}
+
+void CpuYuvGlitch::OnRenderImage(YuvImage const& source, YuvImage& destination,
+                                 unsigned rowBegin, unsigned rowEnd) const
+{
+    RenderDigitalGlitch(kernel, lumaPlan, chromaPlan, source,
+                        useTrashFrame2 ? trashFrame2 : trashFrame1, destination, rowBegin,
+                        rowEnd);
+}
+
+template<PixelFormat Format>
+void BasicCpuChromaticSplit<Format>::Update()
+{
+    shiftX = static_cast<int>(std::lround(intensity * MaxShiftX));
+    shiftY = static_cast<int>(std::lround(intensity * MaxShiftY));
+}
+
+template<PixelFormat Format>
+void BasicCpuChromaticSplit<Format>::OnRenderImage(
+    BasicImageBuffer<Format> const& source, BasicImageBuffer<Format>& destination,
+    unsigned rowBegin, unsigned rowEnd) const
+{
+    OnRenderImage(source.View(), destination.View(), rowBegin, rowEnd);
+}
+
+template<PixelFormat Format>
+void BasicCpuChromaticSplit<Format>::OnRenderImage(cimage_view<Pixel> source,
+                                                   image_view<Pixel> destination,
+                                                   unsigned rowBegin,
+                                                   unsigned rowEnd) const
+{
+    RenderChromaticSplit<Format>(source, destination, shiftX, shiftY, rowBegin, rowEnd);
+}
+
+template class BasicCpuDigitalGlitch<PixelFormat::Bgra8>;
+template class BasicCpuDigitalGlitch<PixelFormat::Rgb10A2>;
+template class BasicCpuDigitalGlitch<PixelFormat::Rgba16>;
+template class BasicCpuDigitalGlitch<PixelFormat::Rgba16F>;
+template class BasicCpuChromaticSplit<PixelFormat::Bgra8>;
+template class BasicCpuChromaticSplit<PixelFormat::Rgb10A2>;
+template class BasicCpuChromaticSplit<PixelFormat::Rgba16>;
+template class BasicCpuChromaticSplit<PixelFormat::Rgba16F>;
+
+} // namespace gt
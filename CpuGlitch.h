@@ -0,0 +1,301 @@
+#pragma once
+#include "Arena.h"
+#include "ImageBuffer.h"
+#include "NoiseGrid.h"
+#include "PixelFormat.h"
+#include "Span.h"
+#include "YuvImage.h"
+
+#include <array>
+#include <cstdint>
+
+namespace gt
+{
+
+/// <summary>Implementation used to execute the CPU digital glitch.</summary>
+enum class GlitchKernel
+{
+    /// Per-pixel floating point emulation of DigitalGlitchPS. Reference only.
+    Scalar,
+    /// 8-bit fixed point sampling, one pixel at a time.
+    Integer,
+    /// Same arithmetic as <see cref="Integer"/>, four pixels at a time.
+    Simd,
+    /// Nearest sampling compiled to rectangle copies per run of cells.
+    Blit,
+};
+
+enum class GlitchSampling
+{
+    Bilinear,
+    Nearest,
+};
+
+struct GlitchCell
+{
+    enum : uint8_t
+    {
+        Displace = 1,
+        Trash = 2,
+        Shuffle = 4,
+    };
+
+    uint8_t flags = 0;
+
+    /// Displacement in 1/256 source pixels, wrapped to the image size. Always
+    /// whole pixels for nearest sampling.
+    int32_t offsetX = 0;
+    int32_t offsetY = 0;
+};
+
+/// <summary>
+///   What every noise cell does at one intensity, before it is placed in an
+///   image of some size: the part of <see cref="GlitchPlan::Compile"/> that
+///   only depends on the noise, so that bursts can evaluate it ahead of time.
+/// </summary>
+struct CellDecisions
+{
+    /// <see cref="GlitchCell"/> flags. Displaced cells may still end up clean
+    /// if their offset rounds to zero, and shuffled cells only shuffle in
+    /// plans with the color shuffle.
+    std::array<uint8_t, NoiseGrid::Width * NoiseGrid::Height> flags{};
+
+    void Evaluate(NoiseGrid const& noise, float intensity);
+};
+
+/// <summary>
+///   Rectangle copy produced by the blit kernel. Source rectangles never wrap
+///   around the image edges; wrapping cells are split into several blits.
+/// </summary>
+struct GlitchBlit
+{
+    enum : uint8_t
+    {
+        FromTrash = 1,
+        Shuffle = 2,
+    };
+
+    uint32_t dstX;
+    uint32_t dstY;
+    uint32_t width;
+    uint32_t height;
+    uint32_t srcX;
+    uint32_t srcY;
+    uint8_t flags;
+};
+
+/// <summary>
+///   Per-frame decisions of the digital glitch: what every noise cell does at
+///   the current intensity, where the cells land in an image of the given
+///   size, and (for the blit kernel) the copies they compile to.
+/// </summary>
+struct GlitchPlan
+{
+    unsigned width = 0;
+    unsigned height = 0;
+    GlitchSampling sampling = GlitchSampling::Bilinear;
+    bool colorShuffle = false;
+
+    /// First pixel column/row of every cell, plus one past the last pixel.
+    std::array<uint32_t, NoiseGrid::Width + 1> cellX{};
+    std::array<uint32_t, NoiseGrid::Height + 1> cellY{};
+    std::array<GlitchCell, NoiseGrid::Width * NoiseGrid::Height> cells{};
+
+    /// Blits of the frame, allocated from the arena given to Compile. Only
+    /// valid until that arena is rewound.
+    span<GlitchBlit> blits;
+
+    /// <summary>
+    ///   Evaluates the noise at <paramref name="intensity"/> with the current
+    ///   <see cref="sampling"/> and <see cref="colorShuffle"/> settings. Blits
+    ///   are compiled into <paramref name="blitArena"/> if one is given, which
+    ///   requires nearest sampling.
+    /// </summary>
+    void Compile(NoiseGrid const& noise, float intensity, unsigned newWidth,
+                 unsigned newHeight, Arena* blitArena = nullptr);
+
+    /// Same with the cells already evaluated for the intensity of the frame.
+    void Compile(NoiseGrid const& noise, CellDecisions const& decisions,
+                 unsigned newWidth, unsigned newHeight, Arena* blitArena = nullptr);
+
+    GlitchCell const& Cell(unsigned cx, unsigned cy) const
+    {
+        return cells[cy * NoiseGrid::Width + cx];
+    }
+
+private:
+    void CompileBlits(Arena& arena);
+};
+
+/// <summary>
+///   Renders rows [<paramref name="rowBegin"/>, <paramref name="rowEnd"/>) of
+///   the digital glitch on images of the given format. <paramref name="source"/>,
+///   <paramref name="trash"/> and <paramref name="dest"/> must all have the
+///   size the plan was compiled for, but may have any row pitch. The blit
+///   kernel requires a plan compiled with blits.
+/// </summary>
+/// <remarks>
+///   Instantiated for every <see cref="PixelFormat"/>, so frames are glitched
+///   in the format they were captured in. Only formats with 8-bit channels
+///   have a vectorized bilinear path; the others run the integer arithmetic
+///   (or F16C conversions for half floats) one pixel at a time.
+/// </remarks>
+template<PixelFormat Format>
+void RenderDigitalGlitch(GlitchKernel kernel, GlitchPlan const& plan,
+                         cimage_view<PixelType<Format>> source,
+                         cimage_view<PixelType<Format>> trash,
+                         image_view<PixelType<Format>> dest, unsigned rowBegin,
+                         unsigned rowEnd);
+
+/// <summary>
+///   Applies the trash and shuffle <paramref name="flags"/> of a
+///   <see cref="GlitchBlit"/> to pixels already copied from its source, as the
+///   blit kernel does with blank trash frames. For callers that move the
+///   pixels themselves, such as <see cref="BandedGlitch"/>.
+/// </summary>
+template<PixelFormat Format>
+void ApplyBlitFlags(uint8_t flags, span<PixelType<Format>> pixels);
+
+/// <summary>
+///   Renders the digital glitch on a 4:2:0 image, one plane at a time.
+///   <paramref name="lumaPlan"/> and <paramref name="chromaPlan"/> are
+///   compiled from the same noise for the luma and chroma resolutions, so the
+///   cells cover the same part of the picture in all planes.
+///   <paramref name="rowBegin"/> and <paramref name="rowEnd"/> count chroma
+///   rows; each also covers the two luma rows above it.
+/// </summary>
+/// <remarks>
+///   Trash cells replace all three planes. The red/green swap of the color
+///   shuffle has no cheap planar equivalent; shuffled cells swap Cb and Cr
+///   instead, which changes the hue just as drastically at no extra cost.
+///   Unlike the RGB swap it leaves luma alone, so shuffled cells are not
+///   expected to match the BGRA output. The scalar kernel runs the integer
+///   kernel, and the blit kernel runs the SIMD kernel, which copies whole
+///   rows of cells when the plans use nearest sampling.
+/// </remarks>
+void RenderDigitalGlitch(GlitchKernel kernel, GlitchPlan const& lumaPlan,
+                         GlitchPlan const& chromaPlan, YuvImage const& source,
+                         YuvImage const& trash, YuvImage& dest, unsigned rowBegin,
+                         unsigned rowEnd);
+
+/// <summary>
+///   Renders rows [<paramref name="rowBegin"/>, <paramref name="rowEnd"/>) of
+///   the RGB split. Red is read from (x + shiftX, y + shiftY) and blue from
+///   (x - shiftX, y - shiftY), clamped to the image. Each output row reads the
+///   three source rows once and recombines them with channel masks.
+/// </summary>
+template<PixelFormat Format>
+void RenderChromaticSplit(cimage_view<PixelType<Format>> source,
+                          image_view<PixelType<Format>> dest, int shiftX, int shiftY,
+                          unsigned rowBegin, unsigned rowEnd);
+
+/// <summary>
+///   CPU counterpart of the D3D11 <c>DigitalGlitch</c> behavior, on frames
+///   and trash frames of <typeparamref name="Format"/>.
+/// </summary>
+template<PixelFormat Format>
+class BasicCpuDigitalGlitch
+{
+public:
+    using Pixel = PixelType<Format>;
+
+    float intensity = 0.5f;
+    GlitchKernel kernel = GlitchKernel::Simd;
+    GlitchSampling sampling = GlitchSampling::Bilinear;
+    bool colorShuffle = false;
+
+    NoiseGrid noise;
+    GlitchPlan plan;
+    BasicImageBuffer<Format> trashFrame1;
+    BasicImageBuffer<Format> trashFrame2;
+
+    void Resize(unsigned renderWidth, unsigned renderHeight);
+
+    /// Regenerates the noise, picks the trash frame and compiles the plan for
+    /// the next frame. The blit kernel keeps its blits in
+    /// <paramref name="frameArena"/>, which must outlive the rendering.
+    void Update(Arena& frameArena);
+
+    /// <summary>
+    ///   Compiles the plan for a frame whose noise, cell decisions and trash
+    ///   frame were decided ahead of time, leaving <see cref="noise"/> alone.
+    ///   <paramref name="frameNoise"/> must outlive the rendering.
+    /// </summary>
+    void Update(Arena& frameArena, NoiseGrid const& frameNoise,
+                CellDecisions const& decisions, bool trashFrame2);
+
+    void OnRenderImage(BasicImageBuffer<Format> const& source,
+                       BasicImageBuffer<Format>& destination, unsigned rowBegin,
+                       unsigned rowEnd) const;
+
+    /// Same on views of the size the plan was compiled for, such as one
+    /// rectangle of a larger frame.
+    void OnRenderImage(cimage_view<Pixel> source, image_view<Pixel> destination,
+                       unsigned rowBegin, unsigned rowEnd) const;
+
+private:
+    bool useTrashFrame2 = false;
+};
+
+using CpuDigitalGlitch = BasicCpuDigitalGlitch<PixelFormat::Bgra8>;
+
+/// <summary>
+///   <see cref="CpuDigitalGlitch"/> for planar 4:2:0 frames, avoiding the
+///   conversion to BGRA and back for video streams.
+/// </summary>
+class CpuYuvGlitch
+{
+public:
+    float intensity = 0.5f;
+    GlitchKernel kernel = GlitchKernel::Simd;
+    GlitchSampling sampling = GlitchSampling::Bilinear;
+    bool colorShuffle = false;
+
+    NoiseGrid noise;
+    GlitchPlan lumaPlan;
+    GlitchPlan chromaPlan;
+    YuvImage trashFrame1;
+    YuvImage trashFrame2;
+
+    void Resize(unsigned renderWidth, unsigned renderHeight);
+    void Update();
+
+    /// Renders chroma rows [rowBegin, rowEnd) and the luma rows they cover.
+    void OnRenderImage(YuvImage const& source, YuvImage& destination, unsigned rowBegin,
+                       unsigned rowEnd) const;
+
+private:
+    bool useTrashFrame2 = false;
+};
+
+/// <summary>
+///   CPU counterpart of the D3D11 <c>ChromaticSplit</c> behavior, on frames of
+///   <typeparamref name="Format"/>.
+/// </summary>
+template<PixelFormat Format>
+class BasicCpuChromaticSplit
+{
+public:
+    using Pixel = PixelType<Format>;
+
+    /// Channel separation in pixels at intensity 1.
+    static constexpr float MaxShiftX = 24.0f;
+    static constexpr float MaxShiftY = 4.0f;
+
+    float intensity = 0.0f;
+
+    void Update();
+    void OnRenderImage(BasicImageBuffer<Format> const& source,
+                       BasicImageBuffer<Format>& destination, unsigned rowBegin,
+                       unsigned rowEnd) const;
+    void OnRenderImage(cimage_view<Pixel> source, image_view<Pixel> destination,
+                       unsigned rowBegin, unsigned rowEnd) const;
+
+private:
+    int shiftX = 0;
+    int shiftY = 0;
+};
+
+using CpuChromaticSplit = BasicCpuChromaticSplit<PixelFormat::Bgra8>;
+
+} // namespace gt
@@ -0,0 +1,1077 @@
+#include "D3D11Backend.h"
+
+#include "BurstPlan.h"
+#include "ErrorHandling.h"
+#include "MathUtils.h"
+#include "Metrics.h"
+#include "NoiseGrid.h"
+#include "PixelFormat.h"
+#include "Random.h"
+#include "ResourceUtils.h"
+
+#include <dwmapi.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#pragma comment(lib, "dwmapi.lib")
+#pragma comment(lib, "dxguid.lib")
+
+using namespace DirectX;
+
+namespace gt
+{
+
+namespace
+{
+
+/// Formats requested from output duplication, in order of preference. HDR
+/// desktops are duplicated as half floats, SDR desktops as BGRA8.
+DXGI_FORMAT const DuplicationFormats[] = {
+    DXGI_FORMAT_R16G16B16A16_FLOAT,
+    DXGI_FORMAT_R10G10B10A2_UNORM,
+    DXGI_FORMAT_B8G8R8A8_UNORM,
+};
+
+bool GetPixelFormat(DXGI_FORMAT dxgiFormat, PixelFormat& format)
+{
+    switch (dxgiFormat) {
+    case DXGI_FORMAT_B8G8R8A8_UNORM:
+        format = PixelFormat::Bgra8;
+        return true;
+    case DXGI_FORMAT_R10G10B10A2_UNORM:
+        format = PixelFormat::Rgb10A2;
+        return true;
+    case DXGI_FORMAT_R16G16B16A16_UNORM:
+        format = PixelFormat::Rgba16;
+        return true;
+    case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        format = PixelFormat::Rgba16F;
+        return true;
+    default:
+        return false;
+    }
+}
+
+DXGI_FORMAT GetDxgiFormat(PixelFormat format)
+{
+    switch (format) {
+    case PixelFormat::Bgra8:
+        return DXGI_FORMAT_B8G8R8A8_UNORM;
+    case PixelFormat::Rgb10A2:
+        return DXGI_FORMAT_R10G10B10A2_UNORM;
+    case PixelFormat::Rgba16:
+        return DXGI_FORMAT_R16G16B16A16_UNORM;
+    case PixelFormat::Rgba16F:
+        return DXGI_FORMAT_R16G16B16A16_FLOAT;
+    }
+    return DXGI_FORMAT_B8G8R8A8_UNORM;
+}
+
+size_t GetTextureBytes(unsigned width, unsigned height, DXGI_FORMAT dxgiFormat)
+{
+    PixelFormat format = PixelFormat::Bgra8;
+    GetPixelFormat(dxgiFormat, format);
+    return size_t(width) * height * BytesPerPixel(format);
+}
+
+HRESULT SetD3DDebugObjectName(_In_ ID3D11DeviceChild* object, _In_z_ char const* name)
+{
+#ifdef _DEBUG
+    return object->SetPrivateData(WKPDID_D3DDebugObjectName,
+                                  static_cast<UINT>(strnlen_s(name, 255)), name);
+#else
+    return S_OK;
+#endif
+}
+
+HRESULT SetD3DDebugObjectName(_In_ IDXGIObject* object, _In_z_ char const* name)
+{
+#ifdef _DEBUG
+    return object->SetPrivateData(WKPDID_D3DDebugObjectName,
+                                  static_cast<UINT>(strnlen_s(name, 255)), name);
+#else
+    return S_OK;
+#endif
+}
+
+struct HideWindowScope
+{
+    explicit HideWindowScope(HWND hwnd)
+    {
+        bool const isVisible = GetWindowLongPtr(hwnd, GWL_STYLE) & WS_VISIBLE;
+        if (!isVisible)
+            return;
+
+        if (GetLayeredWindowAttributes(hwnd, &keyColor, &alpha, &flags) &&
+            SetLayeredWindowAttributes(hwnd, 0, 0, LWA_ALPHA)) {
+            DwmFlush();
+            this->hwnd = hwnd;
+        }
+    }
+
+    ~HideWindowScope()
+    {
+        if (hwnd)
+            SetLayeredWindowAttributes(hwnd, keyColor, alpha, flags);
+    }
+
+private:
+    HWND hwnd = nullptr;
+    COLORREF keyColor = 0;
+    BYTE alpha = 0;
+    DWORD flags = 0;
+};
+
+ComPtr<ID3D11DeviceContext> GetImmediateContext(ID3D11DeviceChild* deviceChild)
+{
+    ComPtr<ID3D11Device> device;
+    ComPtr<ID3D11DeviceContext> context;
+    deviceChild->GetDevice(&device);
+    device->GetImmediateContext(&context);
+    return context;
+}
+
+template<typename T>
+class ConstantBufferImpl : public T
+{
+public:
+    HRESULT Create(ID3D11Device* device)
+    {
+        CD3D11_BUFFER_DESC const bufferDesc(sizeof(T), D3D11_BIND_CONSTANT_BUFFER,
+                                            D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+        D3D11_SUBRESOURCE_DATA const data = {
+            .pSysMem = static_cast<T const*>(this),
+        };
+
+        HR(device->CreateBuffer(&bufferDesc, &data, &buffer));
+        return S_OK;
+    }
+
+    HRESULT Update()
+    {
+        ComPtr<ID3D11DeviceContext> context = GetImmediateContext(buffer);
+
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        HR(context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+        std::memcpy(mapped.pData, static_cast<T const*>(this), sizeof(T));
+        context->Unmap(buffer, 0);
+        return S_OK;
+    }
+
+    operator ID3D11Buffer*() const { return buffer; }
+
+private:
+    ComPtr<ID3D11Buffer> buffer;
+};
+
+class IBehavior
+{
+public:
+    virtual ~IBehavior() {};
+    virtual void Update() = 0;
+    virtual void OnRenderImage(D3D11Backend& rc, ID3D11DeviceContext* context,
+                               unsigned frameCount, ID3D11ShaderResourceView* source,
+                               ID3D11RenderTargetView* destination) = 0;
+};
+
+} // namespace
+
+class DigitalGlitch : public IBehavior
+{
+public:
+    struct alignas(16) Constants
+    {
+        float intensity = 0.5f;
+    };
+
+    ConstantBufferImpl<Constants> constants;
+
+    ComPtr<ID3D11PixelShader> pixelShader;
+
+    ComPtr<ID3D11SamplerState> mainSamplerState;
+    ComPtr<ID3D11SamplerState> pointSamplerState;
+
+    /// Samples the displaced capture without filtering, for the cheaper
+    /// quality levels.
+    bool nearestSampling = false;
+
+    /// Trash frame mixed into the next rendered frame.
+    bool useTrashFrame2 = false;
+
+    NoiseGrid noise;
+    ComPtr<ID3D11Texture2D> noiseTexture;
+    ComPtr<ID3D11ShaderResourceView> noiseTextureView;
+    ComPtr<ID3D11SamplerState> noiseSamplerState;
+
+    ComPtr<ID3D11Texture2D> trashFrame1Tex;
+    ComPtr<ID3D11ShaderResourceView> trashFrame1View;
+    ComPtr<ID3D11RenderTargetView> trashFrame1;
+    ComPtr<ID3D11Texture2D> trashFrame2Tex;
+    ComPtr<ID3D11ShaderResourceView> trashFrame2View;
+    ComPtr<ID3D11RenderTargetView> trashFrame2;
+    ComPtr<ID3D11SamplerState> trashSamplerState;
+
+    HRESULT SetupResources(ID3D11Device* device, D3D11TexturePool& texturePool,
+                           unsigned renderWidth, unsigned renderHeight,
+                           DXGI_FORMAT frameFormat)
+    {
+        HR(constants.Create(device));
+
+        CD3D11_TEXTURE2D_DESC noiseTextureDesc(DXGI_FORMAT_B8G8R8A8_UNORM, NoiseGrid::Width,
+                                               NoiseGrid::Height);
+        noiseTextureDesc.MipLevels = 1;
+        noiseTextureDesc.Usage = D3D11_USAGE_DYNAMIC;
+        noiseTextureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        HR(device->CreateTexture2D(&noiseTextureDesc, nullptr, &noiseTexture));
+        HR(device->CreateShaderResourceView(noiseTexture, nullptr, &noiseTextureView));
+
+        CD3D11_SAMPLER_DESC noiseSamplerDesc(D3D11_DEFAULT);
+        noiseSamplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
+        noiseSamplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+        noiseSamplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+        noiseSamplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+        HR(device->CreateSamplerState(&noiseSamplerDesc, &noiseSamplerState));
+
+        HR(CreateTrashFrames(device, texturePool, renderWidth, renderHeight,
+                             frameFormat));
+
+        CD3D11_SAMPLER_DESC trashSamplerDesc(D3D11_DEFAULT);
+        HR(device->CreateSamplerState(&trashSamplerDesc, &trashSamplerState));
+
+        CD3D11_SAMPLER_DESC mainSamplerDesc(D3D11_DEFAULT);
+        HR(device->CreateSamplerState(&trashSamplerDesc, &mainSamplerState));
+
+        CD3D11_SAMPLER_DESC pointSamplerDesc(D3D11_DEFAULT);
+        pointSamplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
+        HR(device->CreateSamplerState(&pointSamplerDesc, &pointSamplerState));
+
+        UpdateNoiseTexture();
+
+        auto const psBytecode =
+            GetModuleResource(nullptr, L"SHADER", MAKEINTRESOURCEW(200));
+        HR(device->CreatePixelShader(psBytecode.data(), psBytecode.size(), nullptr,
+                                     &pixelShader));
+
+        return S_OK;
+    }
+
+    /// (Re)creates the trash frames in the size of the render target and the
+    /// format of the captured frames, so that mixing them in does not lose
+    /// precision on HDR desktops. The old frames go back to the pool. Pooled
+    /// textures keep the pixels of their last user, so the frames are cleared
+    /// to black like the trash frames of the CPU backend.
+    HRESULT CreateTrashFrames(ID3D11Device* device, D3D11TexturePool& texturePool,
+                              unsigned renderWidth, unsigned renderHeight,
+                              DXGI_FORMAT frameFormat)
+    {
+        trashFrame1.Reset();
+        trashFrame1View.Reset();
+        texturePool.Release(trashFrame1Tex);
+        trashFrame2.Reset();
+        trashFrame2View.Reset();
+        texturePool.Release(trashFrame2Tex);
+
+        HR(texturePool.Acquire(renderWidth, renderHeight, frameFormat, trashFrame1Tex));
+        HR(device->CreateRenderTargetView(trashFrame1Tex, nullptr, &trashFrame1));
+        HR(device->CreateShaderResourceView(trashFrame1Tex, nullptr, &trashFrame1View));
+
+        HR(texturePool.Acquire(renderWidth, renderHeight, frameFormat, trashFrame2Tex));
+        HR(device->CreateRenderTargetView(trashFrame2Tex, nullptr, &trashFrame2));
+        HR(device->CreateShaderResourceView(trashFrame2Tex, nullptr, &trashFrame2View));
+
+        ComPtr<ID3D11DeviceContext> context = GetImmediateContext(trashFrame1Tex);
+        float const black[4] = {};
+        context->ClearRenderTargetView(trashFrame1, black);
+        context->ClearRenderTargetView(trashFrame2, black);
+
+        return S_OK;
+    }
+
+    void UpdateNoiseTexture()
+    {
+        noise.Generate();
+        UploadNoise(noise);
+    }
+
+    void UploadNoise(NoiseGrid const& frameNoise)
+    {
+        ComPtr<ID3D11DeviceContext> context = GetImmediateContext(noiseTexture);
+
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        HRT(context->Map(noiseTexture, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+
+        image_view<uint32_t> const texels(static_cast<uint32_t*>(mapped.pData),
+                                          NoiseGrid::Width, NoiseGrid::Height,
+                                          mapped.RowPitch);
+        copy_pixels(frameNoise.View(), texels);
+
+        context->Unmap(noiseTexture, 0);
+    }
+
+    void Update() override
+    {
+        if (RandomFloat() > Lerp(0.9f, 0.5f, constants.intensity)) {
+            UpdateNoiseTexture();
+        }
+        useTrashFrame2 = !(RandomFloat() > 0.5f);
+
+        constants.Update();
+    }
+
+    /// Same for a frame planned ahead. The shader evaluates the cells itself,
+    /// so only the noise and the trash frame are taken from the plan.
+    void Update(BurstFrame const& planned)
+    {
+        if (planned.noiseChanged) {
+            UploadNoise(*planned.noise);
+        }
+        useTrashFrame2 = planned.useTrashFrame2;
+
+        constants.Update();
+    }
+
+    void OnRenderImage(D3D11Backend& rc, ID3D11DeviceContext* context,
+                       unsigned frameCount, ID3D11ShaderResourceView* source,
+                       ID3D11RenderTargetView* destination) override
+    {
+        // Update trash frames on a constant interval.
+        // if (frameCount % 13 == 0)
+        //    rc.Blit(source, _trashFrame1);
+        // if (frameCount % 73 == 0)
+        //    rc.Blit(source, _trashFrame2);
+
+        ID3D11ShaderResourceView* trashFrame =
+            useTrashFrame2 ? trashFrame2View : trashFrame1View;
+
+        ID3D11Buffer* const constantBuffers[] = {
+            constants,
+        };
+        ID3D11ShaderResourceView* const resources[] = {
+            source,
+            noiseTextureView,
+            trashFrame,
+        };
+        ID3D11SamplerState* const samplers[] = {
+            nearestSampling ? pointSamplerState : mainSamplerState,
+            noiseSamplerState,
+            trashSamplerState,
+        };
+        context->PSSetConstantBuffers(0, std::size(constantBuffers), constantBuffers);
+        context->PSSetShaderResources(0, std::size(resources), resources);
+        context->PSSetShader(pixelShader, nullptr, 0);
+        context->PSSetSamplers(0, std::size(samplers), samplers);
+        context->OMSetRenderTargets(1, &destination, nullptr);
+
+        context->Draw(3, 0);
+    }
+};
+
+/// <summary>
+///   RGB split (chromatic aberration). Red and blue are gathered from
+///   positions shifted in opposite directions while green stays in place, so
+///   the whole effect is a single pass over the source.
+/// </summary>
+class ChromaticSplit : public IBehavior
+{
+public:
+    struct alignas(16) Constants
+    {
+        XMFLOAT2 redOffset{};
+        XMFLOAT2 blueOffset{};
+    };
+
+    /// Channel separation in pixels at intensity 1.
+    static constexpr float MaxShiftX = 24.0f;
+    static constexpr float MaxShiftY = 4.0f;
+
+    float intensity = 0.0f;
+
+    ConstantBufferImpl<Constants> constants;
+
+    ComPtr<ID3D11PixelShader> pixelShader;
+    ComPtr<ID3D11SamplerState> samplerState;
+
+    HRESULT SetupResources(ID3D11Device* device, unsigned renderWidth,
+                           unsigned renderHeight)
+    {
+        HR(constants.Create(device));
+
+        CD3D11_SAMPLER_DESC samplerDesc(D3D11_DEFAULT);
+        HR(device->CreateSamplerState(&samplerDesc, &samplerState));
+
+        auto const psBytecode =
+            GetModuleResource(nullptr, L"SHADER", MAKEINTRESOURCEW(201));
+        HR(device->CreatePixelShader(psBytecode.data(), psBytecode.size(), nullptr,
+                                     &pixelShader));
+
+        Resize(renderWidth, renderHeight);
+        return S_OK;
+    }
+
+    void Resize(unsigned renderWidth, unsigned renderHeight)
+    {
+        width = static_cast<float>(std::max(renderWidth, 1u));
+        height = static_cast<float>(std::max(renderHeight, 1u));
+    }
+
+    void Update() override
+    {
+        float const dx = intensity * MaxShiftX / width;
+        float const dy = intensity * MaxShiftY / height;
+        constants.redOffset = XMFLOAT2(dx, dy);
+        constants.blueOffset = XMFLOAT2(-dx, -dy);
+        constants.Update();
+    }
+
+    void OnRenderImage(D3D11Backend& rc, ID3D11DeviceContext* context,
+                       unsigned frameCount, ID3D11ShaderResourceView* source,
+                       ID3D11RenderTargetView* destination) override
+    {
+        ID3D11Buffer* const constantBuffers[] = {
+            constants,
+        };
+
+        // Bind the destination first so that a source which was the previous
+        // render target is unbound from the output merger before being read.
+        context->OMSetRenderTargets(1, &destination, nullptr);
+        context->PSSetConstantBuffers(0, std::size(constantBuffers), constantBuffers);
+        context->PSSetShaderResources(0, 1, &source);
+        context->PSSetShader(pixelShader, nullptr, 0);
+        context->PSSetSamplers(0, 1, &samplerState);
+
+        context->Draw(3, 0);
+    }
+
+private:
+    float width = 1.0f;
+    float height = 1.0f;
+};
+
+D3D11TexturePool::D3D11TexturePool(ID3D11Device* device, size_t idleCap)
+    : device(device)
+    , idleCap(idleCap)
+{
+    // Room for the effect target and trash frames of a few sizes, so that a
+    // format change in the middle of a burst does not allocate.
+    idle.reserve(8);
+}
+
+HRESULT D3D11TexturePool::Acquire(unsigned width, unsigned height, DXGI_FORMAT format,
+                                  ComPtr<ID3D11Texture2D>& texture)
+{
+    size_t const bytes = GetTextureBytes(width, height, format);
+
+    auto const match = std::find_if(idle.rbegin(), idle.rend(), [&](Entry const& e) {
+        return e.width == width && e.height == height && e.format == format;
+    });
+
+    if (match != idle.rend()) {
+        texture = std::move(match->texture);
+        idle.erase(std::next(match).base());
+        ++stats.hits;
+        --stats.blocksIdle;
+        stats.bytesIdle -= bytes;
+    } else {
+        CD3D11_TEXTURE2D_DESC desc(format, width, height);
+        desc.MipLevels = 1;
+        desc.BindFlags |= D3D11_BIND_RENDER_TARGET;
+        HR(device->CreateTexture2D(&desc, nullptr, &texture));
+        ++stats.misses;
+    }
+
+    ++stats.blocksInUse;
+    stats.bytesInUse += bytes;
+    return S_OK;
+}
+
+void D3D11TexturePool::Release(ComPtr<ID3D11Texture2D>& texture)
+{
+    if (!texture)
+        return;
+
+    D3D11_TEXTURE2D_DESC desc;
+    texture->GetDesc(&desc);
+    size_t const bytes = GetTextureBytes(desc.Width, desc.Height, desc.Format);
+
+    idle.push_back({std::move(texture), desc.Width, desc.Height, desc.Format, bytes});
+    --stats.blocksInUse;
+    stats.bytesInUse -= bytes;
+    ++stats.blocksIdle;
+    stats.bytesIdle += bytes;
+
+    Trim(idleCap);
+}
+
+void D3D11TexturePool::Trim(size_t maxIdleBytes)
+{
+    auto it = idle.begin();
+    while (stats.bytesIdle > maxIdleBytes && it != idle.end()) {
+        --stats.blocksIdle;
+        stats.bytesIdle -= it->bytes;
+        ++stats.trimmed;
+        ++it;
+    }
+    idle.erase(idle.begin(), it);
+}
+
+D3D11Backend::D3D11Backend() = default;
+
+D3D11Backend::~D3D11Backend() = default;
+
+HRESULT D3D11Backend::CaptureItem::Initialize(_In_ ID3D11Device* device,
+                                               _In_opt_ IDXGIOutput* newOutput)
+{
+    if (newOutput) {
+        HR(output.QueryFrom(newOutput));
+    }
+
+    HR(SetupDuplication(device));
+
+    return S_OK;
+}
+
+HRESULT D3D11Backend::CaptureItem::SetupDuplication()
+{
+    if (!snapshot)
+        return E_UNEXPECTED;
+
+    ComPtr<ID3D11Device> device;
+    snapshot->GetDevice(&device);
+
+    HR(SetupDuplication(device));
+    return S_OK;
+}
+
+HRESULT D3D11Backend::CaptureItem::SetupDuplication(_In_ ID3D11Device* device)
+{
+    outputDuplication.Reset();
+    snapshot.Reset();
+    snapshotView.Reset();
+
+    // DuplicateOutput always converts to BGRA8. DuplicateOutput1 (Windows 10
+    // 1703) delivers HDR desktops in a format that keeps their range, but
+    // fails unless the process is per-monitor DPI aware.
+    HRESULT hr = E_NOINTERFACE;
+    ComPtr<IDXGIOutput5> output5;
+    if (SUCCEEDED(output.As(&output5))) {
+        hr = output5->DuplicateOutput1(device, 0, std::size(DuplicationFormats),
+                                       DuplicationFormats, &outputDuplication);
+    }
+    if (FAILED(hr))
+        HR(output->DuplicateOutput(device, &outputDuplication));
+
+    DXGI_OUTDUPL_DESC outduplDesc;
+    outputDuplication->GetDesc(&outduplDesc);
+    format = outduplDesc.ModeDesc.Format;
+
+    CD3D11_TEXTURE2D_DESC const snapshotTextureDesc(
+        format, outduplDesc.ModeDesc.Width,
+        outduplDesc.ModeDesc.Height, 1, 1, D3D11_BIND_SHADER_RESOURCE,
+        D3D11_USAGE_DEFAULT);
+
+    HR(device->CreateTexture2D(&snapshotTextureDesc, nullptr, &snapshot));
+    HR(device->CreateShaderResourceView(snapshot, nullptr, &snapshotView));
+
+    return S_OK;
+}
+
+HRESULT D3D11Backend::CaptureItem::Refresh()
+{
+    DXGI_OUTDUPL_FRAME_INFO frameInfo;
+    ComPtr<IDXGIResource> desktopResource;
+    while (true) {
+        HRESULT const hr =
+            outputDuplication->AcquireNextFrame(1000, &frameInfo, &desktopResource);
+        if (hr == DXGI_ERROR_ACCESS_LOST) {
+            HR(SetupDuplication());
+            continue;
+        }
+        if (hr == DXGI_ERROR_WAIT_TIMEOUT)
+            AddToCounter(MetricCounter::CaptureStalls);
+        HR(hr);
+
+        if (frameInfo.LastPresentTime.QuadPart != 0)
+            break;
+
+        // Only the pointer moved; wait for the desktop itself to change.
+        AddToCounter(MetricCounter::CaptureStalls);
+        outputDuplication->ReleaseFrame();
+    }
+
+    ComPtr<ID3D11Texture2D> desktopTexture;
+    HR(desktopResource.As(&desktopTexture));
+
+    ComPtr<ID3D11DeviceContext> context = GetImmediateContext(snapshot);
+    context->CopyResource(snapshot, desktopTexture);
+
+    HR(outputDuplication->ReleaseFrame());
+
+    return S_OK;
+}
+
+HRESULT D3D11Backend::Initialize(HWND hWnd)
+{
+    if (initialized)
+        return S_OK;
+
+    window = hWnd;
+
+    RECT clientArea;
+    GetClientRect(window, &clientArea);
+    renderWidth = clientArea.right - clientArea.left;
+    renderHeight = clientArea.bottom - clientArea.top;
+
+    UINT flags = D3D11_CREATE_DEVICE_DEBUG /*| D3D11_CREATE_DEVICE_DEBUGGABLE*/;
+
+    D3D_FEATURE_LEVEL featureLevels[] = {
+        D3D_FEATURE_LEVEL_11_1,
+        D3D_FEATURE_LEVEL_11_0,
+    };
+
+    HR(D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, flags, featureLevels,
+                         std::size(featureLevels), D3D11_SDK_VERSION, &device,
+                         &featureLevel, &context));
+
+    ComPtr<IDXGIDevice2> dxgiDevice;
+    ComPtr<IDXGIAdapter> dxgiAdapter;
+    ComPtr<IDXGIFactory2> dxgiFactory;
+    HR(device.As(&dxgiDevice));
+    HR(dxgiDevice->GetParent(COMPTR_PPV_ARGS(&dxgiAdapter)));
+    HR(dxgiAdapter->GetParent(COMPTR_PPV_ARGS(&dxgiFactory)));
+
+    HR(SetupCapture(dxgiFactory));
+    HR(RefreshCapture());
+    GetPixelFormat(captureItems[0].format, frameFormat);
+
+    DXGI_SWAP_CHAIN_DESC1 const swapChainDesc = {
+        .Width = renderWidth,
+        .Height = renderHeight,
+        .Format = DXGI_FORMAT_B8G8R8A8_UNORM,
+        .Stereo = FALSE,
+        .SampleDesc =
+            {
+                .Count = 1,
+                .Quality = 0, // No multisampling
+            },
+        .BufferUsage = DXGI_USAGE_BACK_BUFFER | DXGI_USAGE_RENDER_TARGET_OUTPUT,
+        .BufferCount = 2,
+        .Scaling = DXGI_SCALING_STRETCH,
+        .SwapEffect = DXGI_SWAP_EFFECT_DISCARD,
+        .AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED,
+        .Flags = 0,
+    };
+
+    DXGI_SWAP_CHAIN_FULLSCREEN_DESC const swapChainFullscreenDesc = {
+        .RefreshRate =
+            {
+                .Numerator = 0,
+                .Denominator = 1,
+            },
+        .ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED,
+        .Scaling = DXGI_MODE_SCALING_UNSPECIFIED,
+        .Windowed = TRUE,
+    };
+
+    HR(dxgiFactory->CreateSwapChainForHwnd(
+        device, window, &swapChainDesc, &swapChainFullscreenDesc, nullptr, &swapChain));
+
+    texturePool = std::make_unique<D3D11TexturePool>(device);
+
+    HR(InitPipeline());
+
+    HR(CreateVertices());
+    HR(CreateRasterizerState());
+    HR(CreateRenderTargetView());
+    // HR(CreateDepthBuffer(renderWidth, renderHeight));
+
+    UpdateViewport(renderWidth, renderHeight);
+
+    auto digitalGlitch = std::make_unique<DigitalGlitch>();
+    HR(digitalGlitch->SetupResources(device, *texturePool, renderWidth, renderHeight,
+                                     GetDxgiFormat(frameFormat)));
+    this->digitalGlitch = std::move(digitalGlitch);
+
+    auto chromaticSplit = std::make_unique<ChromaticSplit>();
+    HR(chromaticSplit->SetupResources(device, renderWidth, renderHeight));
+    this->chromaticSplit = std::move(chromaticSplit);
+
+    initialized = true;
+    return S_OK;
+}
+
+HRESULT D3D11Backend::CreateRenderTargetView()
+{
+    ComPtr<ID3D11Texture2D> backBuffer;
+    HR(swapChain->GetBuffer(0, COMPTR_PPV_ARGS(&backBuffer)));
+    HR(device->CreateRenderTargetView(backBuffer, nullptr, &backBufferView));
+    HR(SetD3DDebugObjectName(backBuffer, "Backbuffer"));
+    HR(SetD3DDebugObjectName(backBufferView, "Backbuffer RTV"));
+    return S_OK;
+}
+
+HRESULT D3D11Backend::CreateEffectTarget(unsigned width, unsigned height)
+{
+    ReleaseEffectTarget();
+
+    HR(texturePool->Acquire(width, height, GetDxgiFormat(frameFormat), effectTarget));
+    HR(device->CreateRenderTargetView(effectTarget, nullptr, &effectTargetRTV));
+    HR(device->CreateShaderResourceView(effectTarget, nullptr, &effectTargetView));
+    HR(SetD3DDebugObjectName(effectTarget, "Effect target"));
+    return S_OK;
+}
+
+void D3D11Backend::ReleaseEffectTarget()
+{
+    effectTargetRTV.Reset();
+    effectTargetView.Reset();
+    texturePool->Release(effectTarget);
+}
+
+HRESULT D3D11Backend::Resize(unsigned newWidth, unsigned newHeight)
+{
+    if (!swapChain)
+        return S_OK;
+
+    newWidth = std::max(newWidth, 1u);
+    newHeight = std::max(newHeight, 1u);
+
+    backBufferView.Reset();
+    // depthStencilBuffer.Reset();
+    // depthStencilState.Reset();
+    // depthStencilView.Reset();
+
+    HR(swapChain->ResizeBuffers(0, newWidth, newHeight, DXGI_FORMAT_UNKNOWN,
+                                DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH));
+    HR(CreateRenderTargetView());
+    ReleaseEffectTarget();
+    // HR(CreateDepthBuffer(newWidth, newHeight));
+
+    if (digitalGlitch) {
+        HR(digitalGlitch->CreateTrashFrames(device, *texturePool, newWidth, newHeight,
+                                            GetDxgiFormat(frameFormat)));
+    }
+
+    UpdateViewport(static_cast<float>(newWidth), static_cast<float>(newHeight));
+
+    if (chromaticSplit)
+        chromaticSplit->Resize(newWidth, newHeight);
+
+    renderWidth = newWidth;
+    renderHeight = newHeight;
+
+    CreateVertices();
+
+    return S_OK;
+}
+
+void D3D11Backend::UpdateViewport(float width, float height)
+{
+    CD3D11_VIEWPORT viewport(0.0f, 0.0f, width, height);
+    context->RSSetViewports(1, &viewport);
+
+    orthoProjection =
+        XMMatrixOrthographicOffCenterLH(0.0f, width, height, 0.0f, -1.0f, 1.0f);
+}
+
+HRESULT D3D11Backend::SetupCapture(IDXGIFactory2* dxgiFactory)
+{
+    ComPtr<IDXGIAdapter> dxgiAdapter;
+    HR(dxgiFactory->EnumAdapters(0, &dxgiAdapter));
+
+    ComPtr<IDXGIOutput> dxgiOutput;
+    HR(dxgiAdapter->EnumOutputs(0, &dxgiOutput));
+
+    CaptureItem& capture = captureItems.emplace_back();
+    capture.Initialize(device, dxgiOutput);
+
+    return S_OK;
+}
+
+HRESULT D3D11Backend::RefreshCapture()
+{
+    HideWindowScope hws(window);
+
+    HRESULT hr = S_OK;
+    for (auto& item : captureItems) {
+        HRESULT hrItem = item.Refresh();
+        if (hr == S_OK && FAILED(hrItem))
+            hr = hrItem;
+    }
+
+    if (initialized && SUCCEEDED(hr))
+        hr = UpdateFrameFormat();
+
+    return hr;
+}
+
+HRESULT D3D11Backend::UpdateFrameFormat()
+{
+    // The duplication is recreated when HDR is toggled, possibly with a new
+    // format. Intermediates follow the capture format.
+    PixelFormat newFormat = PixelFormat::Bgra8;
+    GetPixelFormat(captureItems[0].format, newFormat);
+    if (newFormat == frameFormat)
+        return S_OK;
+
+    frameFormat = newFormat;
+    ReleaseEffectTarget();
+    HR(digitalGlitch->CreateTrashFrames(device, *texturePool, renderWidth, renderHeight,
+                                        GetDxgiFormat(frameFormat)));
+    return S_OK;
+}
+
+HRESULT D3D11Backend::Render(FrameParams const& params)
+{
+    float clearColor[4] = {};
+    context->ClearRenderTargetView(backBufferView, clearColor);
+
+    UpdateConstants();
+
+    // The RGB split follows the same intensity curve. It is skipped entirely
+    // for the clean frame so that a burst always ends on the unmodified image,
+    // and at the cheapest quality level. The GPU has no blit or reduced
+    // resolution mode. The effect target it reads is acquired by the first
+    // frame that splits and kept across bursts, whose clean frames skip it;
+    // it only goes back to the pool once the governor drops the split.
+    bool const split =
+        params.intensity > 0.0f && params.quality < QualityLevel::SingleEffect;
+    if (params.quality >= QualityLevel::SingleEffect)
+        ReleaseEffectTarget();
+    else if (split && !effectTarget)
+        HR(CreateEffectTarget(renderWidth, renderHeight));
+
+    {
+        GT_STAGE_SCOPE(MetricStage::GlitchUpdate);
+        digitalGlitch->nearestSampling = params.quality >= QualityLevel::NearestSampling;
+        digitalGlitch->constants.intensity = params.intensity;
+        if (params.planned)
+            digitalGlitch->Update(*params.planned);
+        else
+            digitalGlitch->Update();
+    }
+
+    {
+        GT_STAGE_SCOPE(MetricStage::DigitalGlitch);
+        digitalGlitch->OnRenderImage(*this, context, params.frameCount,
+                                     captureItems[0].snapshotView,
+                                     split ? effectTargetRTV : backBufferView);
+    }
+
+    if (split) {
+        GT_STAGE_SCOPE(MetricStage::ChromaticSplit);
+        chromaticSplit->intensity = params.intensity;
+        chromaticSplit->Update();
+        chromaticSplit->OnRenderImage(*this, context, params.frameCount, effectTargetView,
+                                      backBufferView);
+    }
+    // context->Draw(4, 0);
+
+    return S_OK;
+}
+
+HRESULT D3D11Backend::Present()
+{
+    GT_STAGE_SCOPE(MetricStage::Present);
+    HR(swapChain->Present(1, 0));
+    return S_OK;
+}
+
+HRESULT D3D11Backend::CreateDepthBuffer(unsigned width, unsigned height)
+{
+    /*
+    D3D11_TEXTURE2D_DESC depthBufferDesc = {};
+    depthBufferDesc.Width = width;
+    depthBufferDesc.Height = height;
+    depthBufferDesc.MipLevels = 1;
+    depthBufferDesc.ArraySize = 1;
+    depthBufferDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+    depthBufferDesc.SampleDesc.Count = 1;
+    depthBufferDesc.SampleDesc.Quality = 0;
+    depthBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+    depthBufferDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+    depthBufferDesc.CPUAccessFlags = 0;
+    depthBufferDesc.MiscFlags = 0;
+
+    HR(device->CreateTexture2D(&depthBufferDesc, nullptr, &depthStencilBuffer));
+    HR(SetD3DDebugObjectName(depthStencilBuffer, "Depth buffer"));
+
+    D3D11_DEPTH_STENCIL_DESC depthStencilDesc = {};
+    depthStencilDesc.DepthEnable = TRUE;
+    depthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+    depthStencilDesc.DepthFunc = D3D11_COMPARISON_LESS;
+    depthStencilDesc.StencilEnable = FALSE;
+    depthStencilDesc.StencilReadMask = 0xFF;
+    depthStencilDesc.StencilWriteMask = 0xFF;
+    depthStencilDesc.FrontFace.StencilFailOp = D3D11_STENCIL_OP_KEEP;
+    depthStencilDesc.FrontFace.StencilDepthFailOp = D3D11_STENCIL_OP_INCR;
+    depthStencilDesc.FrontFace.StencilPassOp = D3D11_STENCIL_OP_KEEP;
+    depthStencilDesc.FrontFace.StencilFunc = D3D11_COMPARISON_ALWAYS;
+    depthStencilDesc.BackFace.StencilFailOp = D3D11_STENCIL_OP_KEEP;
+    depthStencilDesc.BackFace.StencilDepthFailOp = D3D11_STENCIL_OP_DECR;
+    depthStencilDesc.BackFace.StencilPassOp = D3D11_STENCIL_OP_KEEP;
+    depthStencilDesc.BackFace.StencilFunc = D3D11_COMPARISON_ALWAYS;
+
+    HR(device->CreateDepthStencilState(&depthStencilDesc, &depthStencilState));
+    HR(SetD3DDebugObjectName(depthStencilState, "Default DepthStencilState"));
+
+    D3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc = {};
+    depthStencilViewDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+    depthStencilViewDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+    depthStencilViewDesc.Texture2D.MipSlice = 0;
+
+    HR(device->CreateDepthStencilView(depthStencilBuffer, &depthStencilViewDesc,
+                                      &depthStencilView));
+    HR(SetD3DDebugObjectName(depthStencilView, "Default DepthStencilView"));
+
+    CD3D11_BLEND_DESC blendStateDesc(D3D11_DEFAULT);
+    blendStateDesc.AlphaToCoverageEnable = FALSE;
+    blendStateDesc.IndependentBlendEnable = FALSE;
+    blendStateDesc.RenderTarget[0].BlendEnable = TRUE;
+    blendStateDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
+    blendStateDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+    blendStateDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+    blendStateDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+    blendStateDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+    blendStateDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+    blendStateDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+    for (UINT i = 1; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+        blendStateDesc.RenderTarget[i] = blendStateDesc.RenderTarget[0];
+
+    HR(device->CreateBlendState(&blendStateDesc, &blendState));
+    HR(SetD3DDebugObjectName(blendState, "Premultiplied alpha"));
+
+    context->OMSetDepthStencilState(depthStencilState, 1);
+    context->OMSetBlendState(blendState, nullptr, 0xFFFFFFFF);
+    context->OMSetRenderTargets(1, &backBufferView, nullptr);
+
+    return S_OK;
+    */
+    return E_NOTIMPL;
+}
+
+HRESULT D3D11Backend::CreateRasterizerState()
+{
+    D3D11_RASTERIZER_DESC const rasterizerDesc = {
+        .FillMode = D3D11_FILL_SOLID,
+        .CullMode = D3D11_CULL_BACK,
+        .FrontCounterClockwise = FALSE,
+        .DepthBias = 0,
+        .DepthBiasClamp = 0.0f,
+        .SlopeScaledDepthBias = 0.0f,
+        .DepthClipEnable = TRUE,
+        .ScissorEnable = FALSE,
+        .MultisampleEnable = FALSE,
+        .AntialiasedLineEnable = FALSE,
+    };
+
+    HR(device->CreateRasterizerState(&rasterizerDesc, &rasterizerState));
+    HR(SetD3DDebugObjectName(rasterizerState, "Solid/backculling Rasterizer"));
+
+    context->RSSetState(rasterizerState);
+
+    return S_OK;
+}
+
+HRESULT D3D11Backend::UpdateConstants()
+{
+    GT_TRACE_SCOPE("UpdateConstants");
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    HR(context->Map(constantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+
+    VSConstants* ptr = static_cast<VSConstants*>(mapped.pData);
+    ptr->Projection = orthoProjection;
+
+    context->Unmap(constantBuffer, 0);
+    return S_OK;
+}
+
+//   <-----w----->
+// ^ 2-----------0
+// | | \         |
+// | |   \       |
+// h |     \     |
+// | |       \   |
+// | |         \ |
+// v 3-----------1
+void CreateFullscreenQuad(D3D11Backend::Vertex (&vertices)[4], float w, float h)
+{
+    vertices[0] = {XMFLOAT2(w, 0), XMFLOAT2(1, 0)};
+    vertices[1] = {XMFLOAT2(w, h), XMFLOAT2(1, 1)};
+    vertices[2] = {XMFLOAT2(0, 0), XMFLOAT2(0, 0)};
+    vertices[3] = {XMFLOAT2(0, h), XMFLOAT2(0, 1)};
+}
+
+//   <--w-->
+// ^ 0-----+-----1
+// h |     |   /
+// | |     | /
+// v +-----/
+//   |   /
+//   | /
+//   2
+void CreateFullscreenTriangle(D3D11Backend::Vertex (&vertices)[3], float w, float h)
+{
+    vertices[0] = {XMFLOAT2(0, 0), XMFLOAT2(0, 0)};
+    vertices[1] = {XMFLOAT2(w * 2, 0), XMFLOAT2(2, 0)};
+    vertices[2] = {XMFLOAT2(0, h * 2), XMFLOAT2(0, 2)};
+}
+
+HRESULT D3D11Backend::CreateVertices()
+{
+    Vertex vertices[3];
+    // CreateFullscreenQuad(vertices, renderWidth, renderHeight);
+    CreateFullscreenTriangle(vertices, renderWidth, renderHeight);
+
+    D3D11_BUFFER_DESC const vertexBufferDesc = {
+        .ByteWidth = sizeof(Vertex) * std::size(vertices),
+        .Usage = D3D11_USAGE_DYNAMIC,
+        .BindFlags = D3D11_BIND_VERTEX_BUFFER,
+        .CPUAccessFlags = D3D11_CPU_ACCESS_WRITE,
+    };
+
+    D3D11_SUBRESOURCE_DATA const vertexData = {
+        .pSysMem = vertices,
+    };
+
+    HR(device->CreateBuffer(&vertexBufferDesc, &vertexData, &vertexBuffer));
+
+    UINT const stride = sizeof(Vertex);
+    UINT const offset = 0;
+    context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+    context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+
+    return S_OK;
+}
+
+HRESULT D3D11Backend::InitPipeline()
+{
+    auto const vsBytecode = GetModuleResource(nullptr, L"SHADER", MAKEINTRESOURCEW(100));
+
+    D3D11_INPUT_ELEMENT_DESC const inputElementDesc[] = {
+        {"POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0},
+    };
+
+    HR(device->CreateInputLayout(inputElementDesc, 2, vsBytecode.data(),
+                                 vsBytecode.size(), &inputLayout));
+    HR(device->CreateVertexShader(vsBytecode.data(), vsBytecode.size(), nullptr,
+                                  &vertexShader));
+
+    context->IASetInputLayout(inputLayout);
+    context->VSSetShader(vertexShader, nullptr, 0);
+
+    {
+        CD3D11_BUFFER_DESC const bufferDesc(sizeof(VSConstants),
+                                            D3D11_BIND_CONSTANT_BUFFER,
+                                            D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+        HR(device->CreateBuffer(&bufferDesc, nullptr, &constantBuffer));
+        HR(SetD3DDebugObjectName(constantBuffer, "VSConstants"));
+        context->VSSetConstantBuffers(0, 1, &constantBuffer);
+    }
+
+    return S_OK;
+}
+
+} // namespace gt
@@ -0,0 +1,158 @@
+#pragma once
+#include "ComPtr.h"
+#include "FramePool.h"
+#include "PixelFormat.h"
+#include "RenderBackend.h"
+
+#include <windows.h>
+
+#include <DirectXMath.h>
+#include <d3d11.h>
+#include <dxgi1_5.h>
+
+#include <memory>
+#include <vector>
+
+namespace gt
+{
+
+class DigitalGlitch;
+class ChromaticSplit;
+
+/// <summary>
+///   Recycles the render target textures of the effects across resizes and
+///   capture format changes, keyed by (width, height, format). Textures are
+///   single-level render targets that can also be sampled.
+/// </summary>
+/// <remarks>
+///   Idle textures are kept most recently released last. When they exceed the
+///   idle cap, the least recently released ones are released to the driver.
+/// </remarks>
+class D3D11TexturePool
+{
+public:
+    static constexpr size_t DefaultIdleCap = size_t(256) << 20;
+
+    explicit D3D11TexturePool(ID3D11Device* device, size_t idleCap = DefaultIdleCap);
+
+    HRESULT Acquire(unsigned width, unsigned height, DXGI_FORMAT format,
+                    ComPtr<ID3D11Texture2D>& texture);
+
+    /// Returns <paramref name="texture"/> to the pool and resets it. Views of
+    /// the texture should be reset before.
+    void Release(ComPtr<ID3D11Texture2D>& texture);
+
+    void Trim(size_t maxIdleBytes = 0);
+
+    FramePoolStats GetStats() const { return stats; }
+
+private:
+    struct Entry
+    {
+        ComPtr<ID3D11Texture2D> texture;
+        unsigned width;
+        unsigned height;
+        DXGI_FORMAT format;
+        size_t bytes;
+    };
+
+    ComPtr<ID3D11Device> device;
+    std::vector<Entry> idle;
+    size_t idleCap;
+    FramePoolStats stats;
+};
+
+/// <summary>
+///   Backend rendering with D3D11 into the swap chain of a window. The desktop
+///   is captured with DXGI output duplication.
+/// </summary>
+struct D3D11Backend : IRenderBackend
+{
+    D3D11Backend();
+    ~D3D11Backend() override;
+
+    HRESULT Initialize(HWND hWnd);
+    HRESULT CreateVertices();
+    HRESULT InitPipeline();
+    HRESULT Resize(unsigned newWidth, unsigned newHeight) override;
+
+    HRESULT CreateRasterizerState();
+    HRESULT CreateRenderTargetView();
+    HRESULT CreateEffectTarget(unsigned width, unsigned height);
+    /// Hands the effect target back to the pool until the next frame that
+    /// splits, after a resize, a format change or a drop to a single effect.
+    void ReleaseEffectTarget();
+    HRESULT CreateDepthBuffer(unsigned width, unsigned height);
+
+    HRESULT SetupCapture(IDXGIFactory2* dxgiFactory);
+    HRESULT RefreshCapture() override;
+    HRESULT UpdateFrameFormat();
+    HRESULT Render(FrameParams const& params) override;
+    HRESULT Present() override;
+    HRESULT UpdateConstants();
+    void UpdateViewport(float width, float height);
+
+    struct Vertex
+    {
+        DirectX::XMFLOAT2 Position;
+        DirectX::XMFLOAT2 TexCoords;
+    };
+
+    struct VSConstants
+    {
+        DirectX::XMMATRIX Projection;
+    };
+
+    bool initialized = false;
+
+    HWND window = nullptr;
+    ComPtr<IDXGISwapChain1> swapChain;
+    ComPtr<ID3D11Device> device;
+    ComPtr<ID3D11DeviceContext> context;
+    ComPtr<ID3D11RenderTargetView> backBufferView;
+    ComPtr<ID3D11Texture2D> effectTarget;
+    ComPtr<ID3D11ShaderResourceView> effectTargetView;
+    ComPtr<ID3D11RenderTargetView> effectTargetRTV;
+    ComPtr<ID3D11InputLayout> inputLayout;
+    ComPtr<ID3D11VertexShader> vertexShader;
+    ComPtr<ID3D11Buffer> vertexBuffer;
+    ComPtr<ID3D11Buffer> constantBuffer;
+
+    // ComPtr<ID3D11Texture2D> depthStencilBuffer;
+    // ComPtr<ID3D11DepthStencilState> depthStencilState;
+    // ComPtr<ID3D11DepthStencilView> depthStencilView;
+    // ComPtr<ID3D11BlendState> blendState;
+    //
+    ComPtr<ID3D11RasterizerState> rasterizerState;
+
+    D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL(0);
+    unsigned renderWidth = 0;
+    unsigned renderHeight = 0;
+
+    /// Format of the captured frames, also used for all intermediate
+    /// textures. Falls back to BGRA8 for capture formats without traits.
+    PixelFormat frameFormat = PixelFormat::Bgra8;
+
+    DirectX::XMMATRIX orthoProjection{};
+
+    struct CaptureItem
+    {
+        ComPtr<IDXGIOutput1> output;
+        ComPtr<IDXGIOutputDuplication> outputDuplication;
+        ComPtr<ID3D11Texture2D> snapshot;
+        ComPtr<ID3D11ShaderResourceView> snapshotView;
+        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+
+        HRESULT Initialize(_In_ ID3D11Device* device, _In_opt_ IDXGIOutput* output);
+        HRESULT SetupDuplication();
+        HRESULT SetupDuplication(_In_ ID3D11Device* device);
+        HRESULT Refresh();
+    };
+
+    std::vector<CaptureItem> captureItems;
+    std::unique_ptr<D3D11TexturePool> texturePool;
+    std::unique_ptr<DigitalGlitch> digitalGlitch;
+    std::unique_ptr<ChromaticSplit> chromaticSplit;
+};
+
+} // namespace gt
@@ -6,6 +6,7 @@
 namespace gt
 {
 
+#ifdef _WIN32
 void TraceHResult(HRESULT hresult, wchar_t const* file, int line, wchar_t const* function)
 {
     wchar_t buffer[512];
@@ -14,5 +15,12 @@ void TraceHResult(HRESULT hresult, wchar_t const* file, int line, wchar_t const*
     fwprintf(stderr, buffer);
     OutputDebugStringW(buffer);
 }
+#else
+void TraceHResult(HRESULT hresult, char const* file, int line, char const* function)
+{
+    fprintf(stderr, "%s(%d): hr=0x%08X (%s)\n", file, line,
+            static_cast<unsigned>(hresult), function);
+}
+#endif
 
 } // namespace gt
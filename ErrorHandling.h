@@ -1,12 +1,23 @@
 #pragma once
-#include <Windows.h>
+#include "Platform.h"
+
+#ifdef _WIN32
 #include <comdef.h>
 
+#define GT_TRACE_HRESULT(hr) ::gt::TraceHResult(hr, __FILEW__, __LINE__, __FUNCTIONW__)
+#define GT_THROW_HRESULT(hr) throw _com_error(hr, nullptr, false)
+#else
+#include <system_error>
+
+#define GT_TRACE_HRESULT(hr) ::gt::TraceHResult(hr, __FILE__, __LINE__, __func__)
+#define GT_THROW_HRESULT(hr) throw std::system_error(hr, std::generic_category())
+#endif
+
 #define HR(expr)                                                                         \
     do {                                                                                 \
         HRESULT const hr_ = (expr);                                                      \
         if (FAILED(hr_)) {                                                               \
-            ::gt::TraceHResult(hr_, __FILEW__, __LINE__, __FUNCTIONW__);                 \
+            GT_TRACE_HRESULT(hr_);                                                       \
             return hr_;                                                                  \
         }                                                                                \
     } while (false)
@@ -15,15 +26,19 @@
     do {                                                                                 \
         HRESULT const hr_ = (expr);                                                      \
         if (FAILED(hr_)) {                                                               \
-            ::gt::TraceHResult(hr_, __FILEW__, __LINE__, __FUNCTIONW__);                 \
-            throw _com_error(hr_, nullptr, false);                                       \
+            GT_TRACE_HRESULT(hr_);                                                       \
+            GT_THROW_HRESULT(hr_);                                                       \
         }                                                                                \
     } while (false)
 
 namespace gt
 {
 
+#ifdef _WIN32
 void TraceHResult(HRESULT hresult, wchar_t const* file, int line,
                   wchar_t const* function);
+#else
+void TraceHResult(HRESULT hresult, char const* file, int line, char const* function);
+#endif
 
 } // namespace gt
@@ -0,0 +1,44 @@
+#pragma once
+#include <chrono>
+
+namespace gt
+{
+
+/// <summary>
+///   Time source of <see cref="RenderContext"/> for frame timing. Hosts that
+///   need reproducible timing, such as tests, install a
+///   <see cref="ManualFrameClock"/> and advance it themselves.
+/// </summary>
+class IFrameClock
+{
+public:
+    virtual ~IFrameClock() {}
+
+    virtual std::chrono::steady_clock::time_point Now() = 0;
+};
+
+class SteadyFrameClock : public IFrameClock
+{
+public:
+    std::chrono::steady_clock::time_point Now() override
+    {
+        return std::chrono::steady_clock::now();
+    }
+};
+
+/// <summary>
+///   Clock that only moves when told to, e.g. by a fake backend that
+///   pretends every frame took a fixed time.
+/// </summary>
+class ManualFrameClock : public IFrameClock
+{
+public:
+    std::chrono::steady_clock::time_point Now() override { return time; }
+
+    void Advance(std::chrono::steady_clock::duration delta) { time += delta; }
+
+private:
+    std::chrono::steady_clock::time_point time;
+};
+
+} // namespace gt
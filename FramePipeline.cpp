@@ -0,0 +1,157 @@
+#include "FramePipeline.h"
+
+#include "Metrics.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace gt
+{
+
+namespace
+{
+
+template<typename Frame>
+struct FrameSlot
+{
+    unsigned index = 0;
+    Frame input;
+    Frame output;
+};
+
+template<typename Slot>
+bool PopCounting(SpscQueue<Slot*>& queue, Slot*& slot, unsigned& waits)
+{
+    if (queue.TryPop(slot))
+        return true;
+
+    ++waits;
+    return queue.Pop(slot);
+}
+
+} // namespace
+
+template<typename Frame>
+HRESULT BasicFramePipeline<Frame>::Run(IBasicFrameReader<Frame>& reader,
+                                       IBasicFrameProcessor<Frame>& processor,
+                                       IBasicFrameSink<Frame>& sink)
+{
+    using Slot = FrameSlot<Frame>;
+    using SlotQueue = SpscQueue<Slot*>;
+
+    frames = 0;
+    readWaits = 0;
+    processWaits = 0;
+    writeWaits = 0;
+    droppedFrames = 0;
+
+    // Every queue has one thread on either end: free slots go from the
+    // writer to the reader, the others follow the frames.
+    std::vector<std::unique_ptr<Slot>> slots;
+    SlotQueue freeSlots(depth);
+    SlotQueue readSlots(depth, MetricStage::InputQueue, MetricGauge::InputQueueOccupancy);
+    SlotQueue processedSlots(depth, MetricStage::OutputQueue,
+                             MetricGauge::OutputQueueOccupancy);
+
+    for (unsigned i = 0; i < depth; ++i) {
+        slots.push_back(std::make_unique<Slot>());
+        freeSlots.Push(slots.back().get());
+    }
+
+    // The first failure wins and shuts down all queues, so that every stage
+    // blocked on a queue returns.
+    std::atomic<HRESULT> result{S_OK};
+    auto fail = [&](HRESULT hr) {
+        HRESULT expected = S_OK;
+        result.compare_exchange_strong(expected, hr);
+        freeSlots.Close();
+        readSlots.Close();
+        processedSlots.Close();
+    };
+
+    // Without a free slot, a dropping reader takes back the oldest frame
+    // that still waits for processing. If the processor holds the last one,
+    // even a dropping reader has to wait.
+    auto const acquireSlot = [&](Slot*& slot) {
+        if (freeSlots.TryPop(slot))
+            return true;
+        if (overflow == OverflowPolicy::DropOldest && readSlots.DropOldest(slot)) {
+            ++droppedFrames;
+            AddToCounter(MetricCounter::DroppedFrames);
+            return true;
+        }
+        return PopCounting(freeSlots, slot, readWaits);
+    };
+
+    std::thread readThread([&] {
+        SetTraceThreadName("Frame reader");
+        Slot* slot;
+        for (unsigned index = 0; acquireSlot(slot); ++index) {
+            GT_STAGE_SCOPE(MetricStage::ReadFrame);
+            HRESULT const hr = reader.ReadFrame(slot->input);
+            if (hr == S_FALSE)
+                break;
+            if (FAILED(hr)) {
+                fail(hr);
+                break;
+            }
+
+            slot->index = index;
+            if (!readSlots.Push(slot))
+                break;
+        }
+        readSlots.Close();
+    });
+
+    std::thread writeThread([&] {
+        SetTraceThreadName("Frame writer");
+        Slot* slot;
+        while (PopCounting(processedSlots, slot, writeWaits)) {
+            GT_STAGE_SCOPE(MetricStage::WriteFrame);
+            HRESULT const hr = sink.WriteFrame(slot->output);
+            if (FAILED(hr)) {
+                fail(hr);
+                break;
+            }
+
+            ++frames;
+            AddToCounter(MetricCounter::Frames);
+            freeSlots.Push(slot);
+        }
+    });
+
+    // Waits for the reader are the filter's capture stalls in the metrics.
+    auto const popRead = [&](Slot*& slot) {
+        unsigned const waits = processWaits;
+        bool const popped = PopCounting(readSlots, slot, processWaits);
+        AddToCounter(MetricCounter::CaptureStalls, processWaits - waits);
+        return popped;
+    };
+
+    Slot* slot;
+    while (popRead(slot)) {
+        GT_STAGE_SCOPE(MetricStage::ProcessFrame);
+        HRESULT const hr = processor.ProcessFrame(slot->index, slot->input, slot->output);
+        if (FAILED(hr)) {
+            fail(hr);
+            break;
+        }
+
+        if (!processedSlots.Push(slot))
+            break;
+    }
+    processedSlots.Close();
+
+    readThread.join();
+    writeThread.join();
+    inputQueueStats = readSlots.GetStats();
+    outputQueueStats = processedSlots.GetStats();
+    return result.load();
+}
+
+template class BasicFramePipeline<ImageBuffer>;
+template class BasicFramePipeline<YuvImage>;
+
+} // namespace gt
@@ -0,0 +1,93 @@
+#pragma once
+#include "FrameSink.h"
+#include "ImageBuffer.h"
+#include "ImageIO.h"
+#include "Platform.h"
+#include "SpscQueue.h"
+#include "YuvImage.h"
+
+namespace gt
+{
+
+/// <summary>Transforms one frame of a stream.</summary>
+template<typename Frame>
+class IBasicFrameProcessor
+{
+public:
+    virtual ~IBasicFrameProcessor() {}
+
+    /// <summary>
+    ///   Processes frame number <paramref name="index"/>. Frames arrive in
+    ///   order, one at a time. <paramref name="output"/> is a reused buffer
+    ///   that has to be resized to the output size if necessary.
+    /// </summary>
+    virtual HRESULT ProcessFrame(unsigned index, Frame const& input, Frame& output) = 0;
+};
+
+using IFrameProcessor = IBasicFrameProcessor<ImageBuffer>;
+using IYuvFrameProcessor = IBasicFrameProcessor<YuvImage>;
+
+/// <summary>
+///   Runs a read, process and write stage on three threads, connected by
+///   lock-free queues of reused frame slots. With all stages busy,
+///   throughput is limited by the slowest stage instead of the sum of all
+///   three.
+/// </summary>
+template<typename Frame>
+class BasicFramePipeline
+{
+public:
+    /// <summary>
+    ///   <paramref name="depth"/> is the number of frames in flight. Two per
+    ///   stage boundary keeps every stage busy while its neighbors jitter.
+    ///   With <c>OverflowPolicy::DropOldest</c>, the reader reuses the oldest
+    ///   frame not processed yet rather than waiting for a free slot, as live
+    ///   sources cannot wait.
+    /// </summary>
+    explicit BasicFramePipeline(unsigned depth = 4,
+                                OverflowPolicy overflow = OverflowPolicy::Block)
+        : depth(depth < 3 ? 3 : depth)
+        , overflow(overflow)
+    {}
+
+    /// <summary>
+    ///   Processes frames until <paramref name="reader"/> reaches the end of
+    ///   the stream or any stage fails. Returns the first failure.
+    /// </summary>
+    HRESULT Run(IBasicFrameReader<Frame>& reader, IBasicFrameProcessor<Frame>& processor,
+                IBasicFrameSink<Frame>& sink);
+
+    unsigned GetFrames() const { return frames; }
+
+    /// How often each stage had to wait for input from its predecessor (the
+    /// reader waits for free slots). The stage waiting least is the bottleneck.
+    unsigned GetReadWaits() const { return readWaits; }
+    unsigned GetProcessWaits() const { return processWaits; }
+    unsigned GetWriteWaits() const { return writeWaits; }
+
+    /// Frames the reader dropped because processing fell behind.
+    unsigned GetDroppedFrames() const { return droppedFrames; }
+
+    /// Queues from the reader to the processor and on to the writer.
+    QueueStats const& GetInputQueueStats() const { return inputQueueStats; }
+    QueueStats const& GetOutputQueueStats() const { return outputQueueStats; }
+
+private:
+    unsigned depth;
+    OverflowPolicy overflow;
+    unsigned frames = 0;
+    unsigned readWaits = 0;
+    unsigned processWaits = 0;
+    unsigned writeWaits = 0;
+    unsigned droppedFrames = 0;
+    QueueStats inputQueueStats;
+    QueueStats outputQueueStats;
+};
+
+extern template class BasicFramePipeline<ImageBuffer>;
+extern template class BasicFramePipeline<YuvImage>;
+
+using FramePipeline = BasicFramePipeline<ImageBuffer>;
+using YuvFramePipeline = BasicFramePipeline<YuvImage>;
+
+} // namespace gt
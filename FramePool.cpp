@@ -0,0 +1,233 @@
+#include "FramePool.h"
+
+#include "PageAllocator.h"
+
+#include <cassert>
+#include <new>
+#include <utility>
+
+namespace gt
+{
+
+struct FrameBlock::Header
+{
+    Header* prev;
+    Header* next;
+    /// Bytes of the block, this header included.
+    size_t capacity;
+    /// Mapping holding the block, empty for blocks from the heap.
+    PageAllocation pages;
+};
+
+static_assert(sizeof(FrameBlock::Header) <= FramePool::Alignment,
+              "Block header must fit in front of the aligned data");
+
+namespace
+{
+
+using Header = FrameBlock::Header;
+
+std::byte* GetBlockData(Header* header)
+{
+    return reinterpret_cast<std::byte*>(header) + FramePool::Alignment;
+}
+
+/// Allocates <paramref name="capacity"/> bytes, the header included.
+Header* AllocateBlock(size_t capacity)
+{
+    // Frames are mapped directly, so that they can sit on huge pages.
+    if (capacity >= FramePool::MinMappedSize) {
+        PageAllocation const pages = AllocatePages(capacity);
+        if (pages.base)
+            return new (pages.base) Header{nullptr, nullptr, capacity, pages};
+    }
+
+    void* memory = ::operator new(capacity, std::align_val_t(FramePool::Alignment));
+    return new (memory) Header{nullptr, nullptr, capacity, {}};
+}
+
+void FreeBlock(Header* header)
+{
+    if (header->pages.base) {
+        // The header lives in the mapping, copy it out first.
+        PageAllocation const pages = header->pages;
+        FreePages(pages);
+        return;
+    }
+    ::operator delete(header, std::align_val_t(FramePool::Alignment));
+}
+
+} // namespace
+
+FrameBlock::FrameBlock(FrameBlock&& other) noexcept
+    : pool(std::exchange(other.pool, nullptr))
+    , header(std::exchange(other.header, nullptr))
+    , size(std::exchange(other.size, 0))
+{}
+
+FrameBlock& FrameBlock::operator=(FrameBlock&& other) noexcept
+{
+    if (this != &other) {
+        Reset();
+        pool = std::exchange(other.pool, nullptr);
+        header = std::exchange(other.header, nullptr);
+        size = std::exchange(other.size, 0);
+    }
+    return *this;
+}
+
+void FrameBlock::Reset()
+{
+    if (header)
+        pool->Release(header);
+
+    pool = nullptr;
+    header = nullptr;
+    size = 0;
+}
+
+std::byte* FrameBlock::Data() const
+{
+    return header ? GetBlockData(header) : nullptr;
+}
+
+FramePool::FramePool(size_t idleCap)
+    : idleCap(idleCap)
+{}
+
+FramePool::~FramePool()
+{
+    assert(stats.blocksInUse == 0 && "Frame pool destroyed with blocks in use");
+    Trim();
+}
+
+FrameBlock FramePool::Acquire(unsigned width, unsigned height, PixelFormat format)
+{
+    return Acquire(size_t(width) * height * BytesPerPixel(format));
+}
+
+FrameBlock FramePool::Acquire(size_t bytes)
+{
+    if (bytes == 0)
+        return {};
+
+    // The header shares the size class with the data, so that frames of
+    // exactly a size class fill whole pages.
+    size_t const capacity = GetSizeClass(Alignment + bytes);
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    Header* header = idleHead;
+    while (header && header->capacity != capacity)
+        header = header->next;
+
+    if (header) {
+        Unlink(header);
+        ++stats.hits;
+        --stats.blocksIdle;
+        stats.bytesIdle -= capacity;
+    } else {
+        ++stats.misses;
+        lock.unlock();
+        header = AllocateBlock(capacity);
+        lock.lock();
+    }
+
+    ++stats.blocksInUse;
+    stats.bytesInUse += capacity;
+    return {this, header, bytes};
+}
+
+void FramePool::Release(Header* header)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    --stats.blocksInUse;
+    stats.bytesInUse -= header->capacity;
+    ++stats.blocksIdle;
+    stats.bytesIdle += header->capacity;
+
+    header->prev = nullptr;
+    header->next = idleHead;
+    if (idleHead)
+        idleHead->prev = header;
+    else
+        idleTail = header;
+    idleHead = header;
+
+    TrimLocked(idleCap);
+}
+
+void FramePool::Trim(size_t maxIdleBytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    TrimLocked(maxIdleBytes);
+}
+
+void FramePool::TrimLocked(size_t maxIdleBytes)
+{
+    while (stats.bytesIdle > maxIdleBytes) {
+        Header* const header = idleTail;
+        Unlink(header);
+        --stats.blocksIdle;
+        stats.bytesIdle -= header->capacity;
+        ++stats.trimmed;
+        FreeBlock(header);
+    }
+}
+
+void FramePool::Unlink(Header* header)
+{
+    if (header->prev)
+        header->prev->next = header->next;
+    else
+        idleHead = header->next;
+
+    if (header->next)
+        header->next->prev = header->prev;
+    else
+        idleTail = header->prev;
+}
+
+void FramePool::SetIdleCap(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    idleCap = bytes;
+    TrimLocked(idleCap);
+}
+
+size_t FramePool::GetIdleCap() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return idleCap;
+}
+
+FramePoolStats FramePool::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+FramePool& FramePool::Shared()
+{
+    static FramePool* const pool = new FramePool();
+    return *pool;
+}
+
+size_t FramePool::GetSizeClass(size_t bytes)
+{
+    constexpr size_t SmallStep = 4096;
+    constexpr size_t SmallLimit = 64 * 1024;
+
+    if (bytes <= SmallLimit)
+        return (bytes + SmallStep - 1) & ~(SmallStep - 1);
+
+    size_t highBit = SmallLimit;
+    while (highBit <= bytes / 2)
+        highBit *= 2;
+
+    size_t const step = highBit / 8;
+    return (bytes + step - 1) / step * step;
+}
+
+} // namespace gt
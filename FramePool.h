@@ -0,0 +1,140 @@
+#pragma once
+#include "PixelFormat.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace gt
+{
+
+class FramePool;
+
+/// <summary>
+///   Block of frame memory handed out by a <see cref="FramePool"/>. The data
+///   is aligned to <see cref="FramePool::Alignment"/> bytes, and the block
+///   goes back to its pool when it is reset or destroyed.
+/// </summary>
+class FrameBlock
+{
+public:
+    FrameBlock() = default;
+    ~FrameBlock() { Reset(); }
+
+    FrameBlock(FrameBlock&& other) noexcept;
+    FrameBlock& operator=(FrameBlock&& other) noexcept;
+    FrameBlock(FrameBlock const&) = delete;
+    FrameBlock& operator=(FrameBlock const&) = delete;
+
+    void Reset();
+
+    std::byte* Data() const;
+
+    /// Number of bytes requested. The block may be larger.
+    size_t Size() const { return size; }
+
+    explicit operator bool() const { return header != nullptr; }
+
+    /// Bookkeeping stored in front of the data, opaque outside the pool.
+    struct Header;
+
+private:
+    friend class FramePool;
+
+    FrameBlock(FramePool* pool, Header* header, size_t size)
+        : pool(pool)
+        , header(header)
+        , size(size)
+    {}
+
+    FramePool* pool = nullptr;
+    Header* header = nullptr;
+    size_t size = 0;
+};
+
+struct FramePoolStats
+{
+    /// Acquisitions served from an idle block and from a new allocation.
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    /// Idle blocks freed to stay under the idle cap.
+    uint64_t trimmed = 0;
+
+    size_t blocksInUse = 0;
+    size_t blocksIdle = 0;
+    size_t bytesInUse = 0;
+    size_t bytesIdle = 0;
+};
+
+/// <summary>
+///   Recycles frame buffers and intermediates across frames, resizes, effects
+///   and sessions. Requests are rounded up to a size class derived from the
+///   frame size and format, so a released buffer is reused by the next
+///   request of the same class, and a window resized by a few pixels usually
+///   gets its old buffers back.
+/// </summary>
+/// <remarks>
+///   Idle blocks are kept in an intrusive list, most recently released first,
+///   so acquiring and releasing never allocate. When the idle blocks exceed
+///   the idle cap, the least recently released ones are freed. All methods
+///   are thread-safe; they are meant to run on resize, not per pixel row.
+/// </remarks>
+class FramePool
+{
+public:
+    /// Alignment of the block data, one cache line. Also enough for any
+    /// SIMD load the kernels use.
+    static constexpr size_t Alignment = 64;
+
+    static constexpr size_t DefaultIdleCap = size_t(256) << 20;
+
+    /// Blocks of at least this size are mapped with <see cref="AllocatePages"/>
+    /// and may be backed by huge pages; smaller ones come from the heap.
+    static constexpr size_t MinMappedSize = size_t(2) << 20;
+
+    explicit FramePool(size_t idleCap = DefaultIdleCap);
+    ~FramePool();
+
+    FramePool(FramePool const&) = delete;
+    FramePool& operator=(FramePool const&) = delete;
+
+    /// Block for a tightly packed frame of the given size and format.
+    FrameBlock Acquire(unsigned width, unsigned height, PixelFormat format);
+
+    /// Block of at least <paramref name="bytes"/> bytes. Empty for zero.
+    FrameBlock Acquire(size_t bytes);
+
+    /// Frees idle blocks until at most <paramref name="maxIdleBytes"/> remain.
+    void Trim(size_t maxIdleBytes = 0);
+
+    void SetIdleCap(size_t bytes);
+    size_t GetIdleCap() const;
+
+    FramePoolStats GetStats() const;
+
+    /// Pool used by images that were not given one, shared by everything in
+    /// the process. It is never destroyed, so images in static storage can
+    /// still release their blocks during shutdown.
+    static FramePool& Shared();
+
+    /// Size of the block reserved for <paramref name="bytes"/> bytes, which
+    /// include the block header. Classes are 4 KiB apart up to 64 KiB and
+    /// eight per power of two above, wasting at most 12.5%.
+    static size_t GetSizeClass(size_t bytes);
+
+private:
+    friend class FrameBlock;
+    using Header = FrameBlock::Header;
+
+    void Release(Header* header);
+    void TrimLocked(size_t maxIdleBytes);
+    void Unlink(Header* header);
+
+    mutable std::mutex mutex;
+    Header* idleHead = nullptr;
+    Header* idleTail = nullptr;
+    size_t idleCap;
+    FramePoolStats stats;
+};
+
+} // namespace gt
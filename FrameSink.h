@@ -0,0 +1,25 @@
+#pragma once
+#include "ImageBuffer.h"
+#include "Platform.h"
+#include "YuvImage.h"
+
+namespace gt
+{
+
+/// <summary>
+///   Receives frames, e.g. the frames presented by a CPU backend or the
+///   output of a frame pipeline.
+/// </summary>
+template<typename Frame>
+class IBasicFrameSink
+{
+public:
+    virtual ~IBasicFrameSink() {}
+
+    virtual HRESULT WriteFrame(Frame const& frame) = 0;
+};
+
+using IFrameSink = IBasicFrameSink<ImageBuffer>;
+using IYuvFrameSink = IBasicFrameSink<YuvImage>;
+
+} // namespace gt
@@ -0,0 +1,110 @@
+#pragma once
+#include "ImageBuffer.h"
+#include "Platform.h"
+
+#include <utility>
+
+namespace gt
+{
+
+/// <summary>
+///   Provides the frames a CPU backend glitches, standing in for desktop
+///   duplication on hosts without a display. Frames are delivered in
+///   <typeparamref name="Format"/>.
+/// </summary>
+template<PixelFormat Format>
+class IBasicFrameSource
+{
+public:
+    using Pixel = PixelType<Format>;
+
+    virtual ~IBasicFrameSource() {}
+
+    /// Native size of the frames produced by this source.
+    virtual void GetSize(unsigned& width, unsigned& height) const = 0;
+
+    /// <summary>
+    ///   Captures the current frame into <paramref name="dest"/>, resampling
+    ///   it to the size of <paramref name="dest"/> if necessary.
+    /// </summary>
+    virtual HRESULT Capture(image_view<Pixel> dest) = 0;
+
+    /// <summary>
+    ///   Captures only the pixels of <paramref name="dest"/> inside
+    ///   <paramref name="rects"/>, leaving the others as they were. Sources
+    ///   that cannot capture part of a frame, or would have to resample it,
+    ///   capture all of it.
+    /// </summary>
+    virtual HRESULT CaptureRects(image_view<Pixel> dest, cspan<ImageRect> rects)
+    {
+        (void)rects;
+        return Capture(dest);
+    }
+
+    /// <summary>
+    ///   Lends the newest frame in place instead of copying it, for sources
+    ///   whose frames already are in memory the backend can read, such as a
+    ///   <see cref="SharedFrameSource"/>. The view stays valid until the next
+    ///   call of any capture method. Sources that cannot lend a frame of
+    ///   <paramref name="width"/> x <paramref name="height"/> return
+    ///   <c>E_NOTIMPL</c>, and the frame is captured into a copy instead.
+    /// </summary>
+    virtual HRESULT MapFrame(unsigned width, unsigned height, cimage_view<Pixel>& frame)
+    {
+        (void)width;
+        (void)height;
+        (void)frame;
+        return E_NOTIMPL;
+    }
+};
+
+using IFrameSource = IBasicFrameSource<PixelFormat::Bgra8>;
+
+/// <summary>Frame source that always returns the same image.</summary>
+template<PixelFormat Format>
+class BasicImageFrameSource : public IBasicFrameSource<Format>
+{
+public:
+    using Pixel = PixelType<Format>;
+
+    explicit BasicImageFrameSource(BasicImageBuffer<Format> image)
+        : image(std::move(image))
+    {}
+
+    void GetSize(unsigned& width, unsigned& height) const override
+    {
+        width = image.Width();
+        height = image.Height();
+    }
+
+    HRESULT Capture(image_view<Pixel> dest) override
+    {
+        CopyImage(image.View(), dest);
+        return S_OK;
+    }
+
+    HRESULT CaptureRects(image_view<Pixel> dest, cspan<ImageRect> rects) override
+    {
+        if (dest.width() != image.Width() || dest.height() != image.Height())
+            return Capture(dest);
+
+        CopyImageRects(image.View(), dest, rects);
+        return S_OK;
+    }
+
+    HRESULT MapFrame(unsigned width, unsigned height, cimage_view<Pixel>& frame) override
+    {
+        if (width != image.Width() || height != image.Height())
+            return E_NOTIMPL;
+
+        frame = image.View();
+        return S_OK;
+    }
+
+private:
+    BasicImageBuffer<Format> image;
+};
+
+using ImageFrameSource = BasicImageFrameSource<PixelFormat::Bgra8>;
+
+} // namespace gt
@@ -0,0 +1,65 @@
+#include "GlitchFilter.h"
+
+#include <utility>
+
+namespace gt
+{
+
+GlitchFilter::GlitchFilter(IntensitySchedule schedule, ThreadPool* pool)
+    : schedule(std::move(schedule))
+    , pool(pool)
+{
+    digitalGlitch.noise.Generate();
+}
+
+HRESULT GlitchFilter::ProcessFrame(unsigned index, ImageBuffer const& input,
+                                   ImageBuffer& output)
+{
+    if (input.Width() != width || input.Height() != height) {
+        width = input.Width();
+        height = input.Height();
+        digitalGlitch.Resize(width, height);
+    }
+    if (output.Width() != width || output.Height() != height)
+        output.Resize(width, height);
+
+    ArenaScope const frameScope(arena);
+    digitalGlitch.intensity = schedule.Evaluate(index);
+    digitalGlitch.Update(arena);
+    ForEachRowBand(pool, height, [&](unsigned rowBegin, unsigned rowEnd) {
+        digitalGlitch.OnRenderImage(input, output, rowBegin, rowEnd);
+    });
+
+    return S_OK;
+}
+
+YuvGlitchFilter::YuvGlitchFilter(IntensitySchedule schedule, ThreadPool* pool)
+    : schedule(std::move(schedule))
+    , pool(pool)
+{
+    digitalGlitch.noise.Generate();
+}
+
+HRESULT YuvGlitchFilter::ProcessFrame(unsigned index, YuvImage const& input,
+                                      YuvImage& output)
+{
+    if (input.Width() != width || input.Height() != height) {
+        width = input.Width();
+        height = input.Height();
+        digitalGlitch.Resize(width, height);
+    }
+    if (output.Width() != width || output.Height() != height)
+        output.Resize(width, height);
+
+    // Bands are counted in chroma rows so that no band splits a pair of luma
+    // rows sharing their chroma.
+    digitalGlitch.intensity = schedule.Evaluate(index);
+    digitalGlitch.Update();
+    ForEachRowBand(pool, input.ChromaHeight(), [&](unsigned rowBegin, unsigned rowEnd) {
+        digitalGlitch.OnRenderImage(input, output, rowBegin, rowEnd);
+    });
+
+    return S_OK;
+}
+
+} // namespace gt
@@ -0,0 +1,53 @@
+#pragma once
+#include "CpuGlitch.h"
+#include "FramePipeline.h"
+#include "IntensitySchedule.h"
+#include "ThreadPool.h"
+
+namespace gt
+{
+
+/// <summary>
+///   Applies the digital glitch to a stream of frames, with the intensity of
+///   every frame taken from a schedule instead of the burst timer.
+/// </summary>
+class GlitchFilter : public IFrameProcessor
+{
+public:
+    GlitchFilter(IntensitySchedule schedule, ThreadPool* pool);
+
+    HRESULT ProcessFrame(unsigned index, ImageBuffer const& input,
+                         ImageBuffer& output) override;
+
+    CpuDigitalGlitch digitalGlitch;
+
+private:
+    IntensitySchedule schedule;
+    ThreadPool* pool;
+    /// Scratch data of the frame being processed.
+    Arena arena;
+    unsigned width = 0;
+    unsigned height = 0;
+};
+
+/// <summary>
+///   <see cref="GlitchFilter"/> for 4:2:0 streams, glitching the planes
+///   directly.
+/// </summary>
+class YuvGlitchFilter : public IYuvFrameProcessor
+{
+public:
+    YuvGlitchFilter(IntensitySchedule schedule, ThreadPool* pool);
+
+    HRESULT ProcessFrame(unsigned index, YuvImage const& input, YuvImage& output) override;
+
+    CpuYuvGlitch digitalGlitch;
+
+private:
+    IntensitySchedule schedule;
+    ThreadPool* pool;
+    unsigned width = 0;
+    unsigned height = 0;
+};
+
+} // namespace gt
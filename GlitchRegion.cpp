@@ -0,0 +1,114 @@
+#include "GlitchRegion.h"
+
+#include <algorithm>
+#include <cassert>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define GT_HAVE_SSE2 1
+#else
+#define GT_HAVE_SSE2 0
+#endif
+
+namespace gt
+{
+
+namespace
+{
+
+/// Color channels of a BGRA8 pixel; the alpha of mask images is ignored.
+constexpr uint32_t ColorMask = 0x00FFFFFF;
+
+} // namespace
+
+ImageRect GetMaskBounds(cimage_view<uint32_t> mask)
+{
+    unsigned const width = unsigned(mask.width());
+    unsigned const height = unsigned(mask.height());
+
+    unsigned x0 = width;
+    unsigned x1 = 0;
+    unsigned y0 = height;
+    unsigned y1 = 0;
+    for (unsigned y = 0; y < height; ++y) {
+        uint32_t const* const row = mask.row(y).data();
+        unsigned first = 0;
+        while (first < width && (row[first] & ColorMask) == 0)
+            ++first;
+        if (first == width)
+            continue;
+
+        unsigned last = width;
+        while ((row[last - 1] & ColorMask) == 0)
+            --last;
+
+        x0 = std::min(x0, first);
+        x1 = std::max(x1, last);
+        y0 = std::min(y0, y);
+        y1 = y + 1;
+    }
+
+    if (x0 >= x1)
+        return {};
+    return {x0, y0, x1 - x0, y1 - y0};
+}
+
+void ApplyRegionMask(cimage_view<uint32_t> mask, cimage_view<uint32_t> source,
+                     image_view<uint32_t> dest, unsigned rowBegin, unsigned rowEnd)
+{
+    assert(mask.width() == dest.width() && mask.height() == dest.height() &&
+           source.width() == dest.width() && source.height() == dest.height() &&
+           "Image sizes differ");
+
+    unsigned const width = unsigned(dest.width());
+    rowEnd = std::min(rowEnd, unsigned(dest.height()));
+    for (unsigned y = rowBegin; y < rowEnd; ++y) {
+        uint32_t const* const maskRow = mask.row(y).data();
+        uint32_t const* const sourceRow = source.row(y).data();
+        uint32_t* const destRow = dest.row(y).data();
+
+        unsigned x = 0;
+#if GT_HAVE_SSE2
+        __m128i const zero = _mm_setzero_si128();
+        __m128i const colorMask = _mm_set1_epi32(static_cast<int>(ColorMask));
+        auto const load = [](uint32_t const* p) {
+            return _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+        };
+        for (; x + 4 <= width; x += 4) {
+            __m128i const m = load(maskRow + x);
+            __m128i const clean = _mm_cmpeq_epi32(_mm_and_si128(m, colorMask), zero);
+            __m128i const kept = _mm_and_si128(clean, load(sourceRow + x));
+            __m128i const glitched = _mm_andnot_si128(clean, load(destRow + x));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destRow + x),
+                             _mm_or_si128(kept, glitched));
+        }
+#endif
+
+        for (; x < width; ++x) {
+            if ((maskRow[x] & ColorMask) == 0)
+                destRow[x] = sourceRow[x];
+        }
+    }
+}
+
+void ApplyRegionMask(cimage_view<uint32_t> mask, cimage_view<uint64_t> source,
+                     image_view<uint64_t> dest, unsigned rowBegin, unsigned rowEnd)
+{
+    assert(mask.width() == dest.width() && mask.height() == dest.height() &&
+           source.width() == dest.width() && source.height() == dest.height() &&
+           "Image sizes differ");
+
+    unsigned const width = unsigned(dest.width());
+    rowEnd = std::min(rowEnd, unsigned(dest.height()));
+    for (unsigned y = rowBegin; y < rowEnd; ++y) {
+        uint32_t const* const maskRow = mask.row(y).data();
+        uint64_t const* const sourceRow = source.row(y).data();
+        uint64_t* const destRow = dest.row(y).data();
+        for (unsigned x = 0; x < width; ++x) {
+            if ((maskRow[x] & ColorMask) == 0)
+                destRow[x] = sourceRow[x];
+        }
+    }
+}
+
+} // namespace gt
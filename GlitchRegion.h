@@ -0,0 +1,49 @@
+#pragma once
+#include "ImageBuffer.h"
+#include "Span.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace gt
+{
+
+/// <summary>
+///   Part of a frame the effects are limited to, such as the bounds of a
+///   window: a set of rectangles, optionally narrowed down to the pixels of
+///   a mask. An empty region stands for the whole frame.
+/// </summary>
+struct GlitchRegion
+{
+    /// Rectangles in frame pixels, clipped to the frame. They should not
+    /// overlap; where they do, the later one is rendered last.
+    std::vector<ImageRect> rects;
+
+    /// <summary>
+    ///   Optional mask, resampled to the frame size. Only pixels where its
+    ///   color is not black are glitched. Without rectangles, the bounding
+    ///   box of the mask is the only one.
+    /// </summary>
+    cimage_view<uint32_t> mask;
+
+    bool Empty() const { return rects.empty() && mask.empty(); }
+};
+
+/// Smallest rectangle holding all pixels of <paramref name="mask"/> whose
+/// color is not black; empty if there are none.
+ImageRect GetMaskBounds(cimage_view<uint32_t> mask);
+
+/// <summary>
+///   Copies the pixels of rows [<paramref name="rowBegin"/>,
+///   <paramref name="rowEnd"/>) of <paramref name="source"/> into
+///   <paramref name="dest"/> wherever <paramref name="mask"/> is black, so
+///   that only the masked pixels keep the effect. All three views have the
+///   same size. The mask is always BGRA8; the frames may have any format of
+///   the size of their pixels.
+/// </summary>
+void ApplyRegionMask(cimage_view<uint32_t> mask, cimage_view<uint32_t> source,
+                     image_view<uint32_t> dest, unsigned rowBegin, unsigned rowEnd);
+void ApplyRegionMask(cimage_view<uint32_t> mask, cimage_view<uint64_t> source,
+                     image_view<uint64_t> dest, unsigned rowBegin, unsigned rowEnd);
+
+} // namespace gt
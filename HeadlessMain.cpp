@@ -0,0 +1,1425 @@
+#include "AsyncFrameSink.h"
+#include "BandedGlitch.h"
+#include "ChildProcess.h"
+#include "CommandLine.h"
+#include "CpuBackend.h"
+#include "ErrorHandling.h"
+#include "FramePipeline.h"
+#include "FramePool.h"
+#include "FrameSource.h"
+#include "GlitchFilter.h"
+#include "GlitchRegion.h"
+#include "ImageIO.h"
+#include "IntensitySchedule.h"
+#include "MetricsServer.h"
+#include "PageAllocator.h"
+#include "RenderContext.h"
+#include "RenderJob.h"
+#include "SessionServer.h"
+#include "SharedFrameRing.h"
+#include "SyntheticDesktop.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace gt
+{
+
+namespace
+{
+
+void PrintUsage()
+{
+    fprintf(stderr,
+            "Usage:\n"
+            "  GlitchCli render --input <image> --output <file|-> [options]\n"
+            "  GlitchCli render --ring <name> --output <file|-> [options]\n"
+            "\n"
+            "Renders glitch bursts of a BMP or PPM image, or of the frames shared\n"
+            "by a GlitchCli share process, as fast as possible.\n"
+            "\n"
+            "Options:\n"
+            "  --format y4m|raw    Output format (default: from the extension,\n"
+            "                      raw BGRA unless the output ends in .y4m)\n"
+            "  --size WxH          Render size (default: size of the image)\n"
+            "  --bursts N          Number of bursts to render (default: 1)\n"
+            "  --threads N         Render threads, 0 for all cores (default: 0)\n"
+            "  --frame-rate N      Frame rate stored in Y4M output (default: 60)\n"
+            "  --frame-budget MS   Lower the quality of frames that take longer\n"
+            "                      (default: 0, always full quality)\n"
+            "  --scale 1|2|4       Run the glitch at 1/N resolution and upscale\n"
+            "                      the glitched cells (default: 1)\n"
+            "  --region WxH+X+Y    Only glitch this rectangle; may be repeated\n"
+            "  --mask <image>      Only glitch pixels where this image is not black\n"
+            "  --overflow POLICY   block or drop-oldest frames when the output\n"
+            "                      falls behind (default: block)\n"
+            "  --huge-pages MODE   off, transparent or explicit huge pages for\n"
+            "                      frame buffers (default: transparent)\n"
+            "  --trace <file>      Write a Chrome trace of the run\n"
+            "  --metrics <path>    Serve live metrics on a Unix socket or named pipe\n"
+            "\n"
+            "  GlitchCli share --ring <name> --input <image> [options]\n"
+            "  GlitchCli share --ring <name> --synthetic DIRTY [options]\n"
+            "\n"
+            "Publishes frames in shared memory for a render --ring process, standing\n"
+            "in for a capture process: an image, or a synthetic desktop redrawing\n"
+            "the fraction DIRTY (0 to 1) of the screen every frame.\n"
+            "\n"
+            "Options:\n"
+            "  --size WxH          Frame size (default: size of the image, or\n"
+            "                      1920x1080 for the synthetic desktop)\n"
+            "  --frames N          Frames to publish, 0 until stopped (default: 0)\n"
+            "  --frame-rate N      Frames published per second (default: 60)\n"
+            "\n"
+            "  GlitchCli serve [options] --session <name> [session options] ...\n"
+            "\n"
+            "Glitches several independent streams at once on one shared pool of\n"
+            "threads, starting the frames with the earliest deadline first while\n"
+            "giving every session a fair share of the threads.\n"
+            "\n"
+            "Options:\n"
+            "  --threads N         Worker threads, 0 for all cores (default: 0)\n"
+            "  --huge-pages MODE   off, transparent or explicit (default:\n"
+            "                      transparent)\n"
+            "  --trace <file>      Write a Chrome trace of the run\n"
+            "\n"
+            "Session options, applying to the last --session:\n"
+            "  --input <image>     Glitch this image over and over\n"
+            "  --synthetic DIRTY   Glitch a synthetic desktop redrawing the fraction\n"
+            "                      DIRTY (0 to 1) of the screen every frame\n"
+            "  --ring <name>       Glitch the frames of a GlitchCli share process\n"
+            "  --output <file|->   Write the frames, Y4M if the file ends in .y4m\n"
+            "                      and raw BGRA otherwise (default: discard them)\n"
+            "  --size WxH          Processing size (default: size of the source)\n"
+            "  --seed N            Seed of the glitch (default: 1)\n"
+            "  --intensity SPEC    Intensity schedule, as for filter (default:\n"
+            "                      burst:40)\n"
+            "  --effects CHAIN     glitch or glitch+split (default: glitch+split)\n"
+            "  --frame-rate N      Frames due per second, 0 as fast as the fair\n"
+            "                      share allows (default: 0)\n"
+            "  --frames N          Frames to glitch, 0 until the source ends\n"
+            "                      (default: 600)\n"
+            "\n"
+            "  GlitchCli job --input <image> --output <file|-> --frames N [options]\n"
+            "\n"
+            "Renders an offline job of N frames of back-to-back bursts, each frame\n"
+            "depending on the seed only, so that the job can be split into frame\n"
+            "ranges rendered by separate processes or hosts and merged afterwards.\n"
+            "\n"
+            "Options:\n"
+            "  --format y4m|raw    Output format (default: from the extension)\n"
+            "  --size WxH          Render size (default: size of the image)\n"
+            "  --seed N            Seed of the job (default: 1)\n"
+            "  --threads N         Render threads per process, 0 to divide all cores\n"
+            "                      among the workers (default: 0)\n"
+            "  --frame-rate N      Frame rate stored in Y4M output (default: 60)\n"
+            "  --scale 1|2|4       Run the glitch at 1/N resolution (default: 1)\n"
+            "  --region WxH+X+Y    Only glitch this rectangle; may be repeated\n"
+            "  --shard I/N         Only render the I-th of N frame ranges, from 0\n"
+            "  --workers N         Render N shards in processes of their own and\n"
+            "                      merge them into the output file (default: 1)\n"
+            "\n"
+            "  GlitchCli merge --output <file|-> --part <file> [--part <file> ...]\n"
+            "\n"
+            "Concatenates the outputs of the shards of a job, in the order given.\n"
+            "\n"
+            "Options:\n"
+            "  --format y4m|raw    Format of the parts (default: from the extension\n"
+            "                      of the output)\n"
+            "\n"
+            "  GlitchCli bands --input <image> --output <image|-> [options]\n"
+            "\n"
+            "Glitches a PPM or raw BGRA image too large for memory one band of rows\n"
+            "at a time, reading only the parts of the input each band needs. The\n"
+            "output is PPM if it ends in .ppm and raw BGRA otherwise.\n"
+            "\n"
+            "Options:\n"
+            "  --input-size WxH    Size of a raw BGRA input (default: PPM input)\n"
+            "  --memory MB         Budget for the band buffers (default: 256)\n"
+            "  --seed N            Seed of the noise (default: 1)\n"
+            "  --intensity X       Glitch intensity from 0 to 1 (default: 0.5)\n"
+            "  --effects CHAIN     glitch or glitch+split (default: glitch+split)\n"
+            "  --threads N         Glitch threads, 0 for all cores (default: 0)\n"
+            "\n"
+            "  GlitchCli filter [options] < input > output\n"
+            "\n"
+            "Applies the digital glitch to a stream of frames, e.g. between two\n"
+            "ffmpeg processes.\n"
+            "\n"
+            "Options:\n"
+            "  --input <file|->         Input stream (default: stdin)\n"
+            "  --output <file|->        Output stream (default: stdout)\n"
+            "  --input-format y4m|raw   Input format (default: y4m)\n"
+            "  --output-format y4m|raw  Output format (default: input format)\n"
+            "  --size WxH               Frame size, required for raw input\n"
+            "  --frame-rate N           Frame rate of raw input (default: 60)\n"
+            "  --intensity SPEC         Intensity schedule (default: burst:40):\n"
+            "                           0.5             constant\n"
+            "                           burst:N[:PEAK]  ramps of N frames\n"
+            "                           F:I,F:I,...     keyframes\n"
+            "  --process yuv|bgra       Glitch Y4M-to-Y4M streams on the 4:2:0 planes\n"
+            "                           or in BGRA (default: yuv)\n"
+            "  --threads N              Glitch threads, 0 for all cores (default: 0)\n"
+            "  --queue-depth N          Frames in flight (default: 4)\n"
+            "  --overflow POLICY        block or drop-oldest frames when glitching\n"
+            "                           falls behind (default: block)\n"
+            "  --huge-pages MODE        off, transparent or explicit (default:\n"
+            "                           transparent)\n"
+            "  --trace <file>           Write a Chrome trace of the run\n"
+            "  --metrics <path>         Serve live metrics on a Unix socket or named\n"
+            "                           pipe\n");
+}
+
+bool ParseFormat(char const* text, StreamFormat& format)
+{
+    std::string_view const name = text;
+    if (name == "y4m") {
+        format = StreamFormat::Y4m;
+    } else if (name == "raw" || name == "bgra") {
+        format = StreamFormat::RawBgra;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool ParseHugePageMode(char const* text, HugePageMode& mode)
+{
+    for (HugePageMode const candidate :
+         {HugePageMode::Off, HugePageMode::Transparent, HugePageMode::Explicit}) {
+        if (std::string_view(text) == GetHugePageModeName(candidate)) {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ParseFraction(char const* text, float& value)
+{
+    char* end;
+    double const parsed = std::strtod(text, &end);
+    if (end == text || *end != '\0' || !(parsed >= 0.0 && parsed <= 1.0))
+        return false;
+    value = static_cast<float>(parsed);
+    return true;
+}
+
+bool ParseOverflowPolicy(char const* text, OverflowPolicy& policy)
+{
+    std::string_view const name = text;
+    if (name == "block") {
+        policy = OverflowPolicy::Block;
+    } else if (name == "drop-oldest") {
+        policy = OverflowPolicy::DropOldest;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/// Parses a shard written as "I/N", with I below N.
+bool ParseShard(char const* text, unsigned& shard, unsigned& shardCount)
+{
+    std::string_view const value = text;
+    size_t const slash = value.find('/');
+    if (slash == std::string_view::npos)
+        return false;
+    std::string const index(value.substr(0, slash));
+    return ParseUnsigned(index.c_str(), shard) &&
+           ParseUnsigned(text + slash + 1, shardCount) && shard < shardCount;
+}
+
+void PrintQueueStats(char const* name, QueueStats const& stats)
+{
+    fprintf(stderr, "%s queue: %.2f frames on average, %llu at most, %llu dropped\n",
+            name, stats.averageOccupancy,
+            static_cast<unsigned long long>(stats.maxOccupancy),
+            static_cast<unsigned long long>(stats.drops));
+}
+
+StreamFormat FormatFromPath(char const* path)
+{
+    std::string_view const name = path;
+    if (name.size() >= 4 && name.substr(name.size() - 4) == ".y4m")
+        return StreamFormat::Y4m;
+    return StreamFormat::RawBgra;
+}
+
+struct RenderOptions
+{
+    char const* input = nullptr;
+    char const* ring = nullptr;
+    char const* output = nullptr;
+    bool hasFormat = false;
+    StreamFormat format = StreamFormat::RawBgra;
+    unsigned width = 0;
+    unsigned height = 0;
+    unsigned bursts = 1;
+    unsigned threads = 0;
+    unsigned frameRate = 60;
+    unsigned frameBudget = 0;
+    unsigned scale = 1;
+    std::vector<ImageRect> region;
+    char const* mask = nullptr;
+    OverflowPolicy overflow = OverflowPolicy::Block;
+    HugePageMode hugePages = HugePageMode::Transparent;
+    char const* trace = nullptr;
+    char const* metrics = nullptr;
+};
+
+bool ParseRenderOptions(int argc, char** argv, RenderOptions& options)
+{
+    auto const handler = [&](std::string_view arg, char const* value) {
+        if (arg == "--input") {
+            options.input = value;
+        } else if (arg == "--ring") {
+            options.ring = value;
+        } else if (arg == "--output") {
+            options.output = value;
+        } else if (arg == "--format") {
+            options.hasFormat = true;
+            return Check(ParseFormat(value, options.format));
+        } else if (arg == "--size") {
+            return Check(ParseSize(value, options.width, options.height));
+        } else if (arg == "--bursts") {
+            return Check(ParseUnsigned(value, options.bursts));
+        } else if (arg == "--threads") {
+            return Check(ParseUnsigned(value, options.threads));
+        } else if (arg == "--frame-rate") {
+            return Check(ParseUnsigned(value, options.frameRate) &&
+                         options.frameRate > 0);
+        } else if (arg == "--frame-budget") {
+            return Check(ParseUnsigned(value, options.frameBudget));
+        } else if (arg == "--scale") {
+            return Check(ParseUnsigned(value, options.scale) &&
+                         (options.scale == 1 || options.scale == 2 ||
+                          options.scale == 4));
+        } else if (arg == "--region") {
+            ImageRect rect;
+            if (!ParseRect(value, rect.x, rect.y, rect.width, rect.height))
+                return OptionResult::Invalid;
+            options.region.push_back(rect);
+        } else if (arg == "--mask") {
+            options.mask = value;
+        } else if (arg == "--overflow") {
+            return Check(ParseOverflowPolicy(value, options.overflow));
+        } else if (arg == "--huge-pages") {
+            return Check(ParseHugePageMode(value, options.hugePages));
+        } else if (arg == "--trace") {
+            options.trace = value;
+        } else if (arg == "--metrics") {
+            options.metrics = value;
+        } else {
+            return OptionResult::Unknown;
+        }
+        return OptionResult::Valid;
+    };
+    if (!ParseOptions(argc, argv, handler))
+        return false;
+
+    if (!(options.input || options.ring) || !options.output) {
+        fprintf(stderr, "--input or --ring, and --output are required\n");
+        return false;
+    }
+
+    if (!options.hasFormat)
+        options.format = FormatFromPath(options.output);
+    return true;
+}
+
+void PrintPoolStats()
+{
+    FramePoolStats const stats = FramePool::Shared().GetStats();
+    fprintf(stderr,
+            "Frame pool: %llu hits, %llu misses, %.1f MiB in use, %.1f MiB idle\n",
+            static_cast<unsigned long long>(stats.hits),
+            static_cast<unsigned long long>(stats.misses),
+            stats.bytesInUse / 1048576.0, stats.bytesIdle / 1048576.0);
+
+    PageAllocatorStats const pages = GetPageAllocatorStats();
+    if (pages.allocations == 0)
+        return;
+
+    size_t const hugeBytes = pages.hugePages * pages.hugePageSize;
+    fprintf(stderr,
+            "Huge pages (%s): %zu of %zu pages of %zu KiB, %.0f%% of %.1f MiB mapped, "
+            "%llu fallbacks\n",
+            GetHugePageModeName(GetHugePageMode()), pages.hugePages,
+            pages.hugePageSize ? pages.bytesMapped / pages.hugePageSize : 0,
+            pages.hugePageSize / 1024, 100.0 * hugeBytes / pages.bytesMapped,
+            pages.bytesMapped / 1048576.0,
+            static_cast<unsigned long long>(pages.fallbacks));
+}
+
+/// Writes the events recorded since tracing was enabled, if a trace was asked for.
+void SaveTrace(char const* path)
+{
+    if (!path)
+        return;
+
+    FILE* const file = OpenStream(path, "wb");
+    if (!file || FAILED(WriteChromeTrace(file)))
+        fprintf(stderr, "Cannot write trace to %s\n", path);
+    CloseStream(file);
+}
+
+/// Serves metrics for the rest of the run, if an endpoint was asked for.
+bool StartMetrics(MetricsServer& server, char const* path)
+{
+    if (!path)
+        return true;
+
+    if (FAILED(server.Start(path))) {
+        fprintf(stderr, "Cannot serve metrics on %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+int RunRender(int argc, char** argv)
+{
+    RenderOptions options;
+    if (!ParseRenderOptions(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+    SetHugePageMode(options.hugePages);
+    EnableTracing(options.trace != nullptr);
+
+    MetricsServer metricsServer;
+    if (!StartMetrics(metricsServer, options.metrics))
+        return 1;
+
+    std::unique_ptr<IFrameSource> source;
+    SharedFrameSource* ring = nullptr;
+    if (options.ring) {
+        auto shared = std::make_unique<SharedFrameSource>();
+        if (FAILED(shared->Open(options.ring))) {
+            fprintf(stderr, "Cannot open frame ring %s\n", options.ring);
+            return 1;
+        }
+        ring = shared.get();
+        source = std::move(shared);
+    } else {
+        ImageBuffer image;
+        if (FAILED(LoadImageFile(options.input, image))) {
+            fprintf(stderr, "Cannot load image %s\n", options.input);
+            return 1;
+        }
+        source = std::make_unique<ImageFrameSource>(std::move(image));
+    }
+
+    GlitchRegion region;
+    region.rects = options.region;
+    ImageBuffer mask;
+    if (options.mask) {
+        if (FAILED(LoadImageFile(options.mask, mask))) {
+            fprintf(stderr, "Cannot load mask %s\n", options.mask);
+            return 1;
+        }
+        region.mask = mask.View();
+    }
+
+    FILE* const output = OpenStream(options.output, "wb");
+    if (!output) {
+        fprintf(stderr, "Cannot open %s for writing\n", options.output);
+        return 1;
+    }
+
+    ThreadPool pool(options.threads);
+    auto writer = CreateFrameWriter(options.format, output, {options.frameRate, 1});
+    AsyncFrameSink sink(*writer, 4, options.overflow);
+
+    auto backend = std::make_unique<CpuBackend>(std::move(source));
+    CpuBackend& cpu = *backend;
+    cpu.SetSink(&sink);
+    cpu.SetThreadPool(&pool);
+
+    RenderContext rc;
+    HRESULT hr = cpu.SetProcessingScale(options.scale);
+    if (SUCCEEDED(hr))
+        hr = cpu.SetRegion(region);
+    if (SUCCEEDED(hr))
+        hr = cpu.Initialize(options.width, options.height);
+    if (SUCCEEDED(hr))
+        hr = rc.Initialize(std::move(backend));
+
+    QualityGovernorOptions governorOptions;
+    governorOptions.frameBudget = std::chrono::milliseconds(options.frameBudget);
+    rc.governor.SetOptions(governorOptions);
+
+    auto const start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < options.bursts && SUCCEEDED(hr); ++i)
+        hr = rc.RenderFrame();
+
+    HRESULT const writeResult = sink.Finish();
+    auto const elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start);
+    CloseStream(output);
+    SaveTrace(options.trace);
+
+    if (FAILED(hr) || FAILED(writeResult)) {
+        fprintf(stderr, "Rendering failed: 0x%08X\n",
+                static_cast<unsigned>(FAILED(hr) ? hr : writeResult));
+        return 1;
+    }
+
+    unsigned const frames = cpu.GetPresentedFrames();
+    fprintf(stderr,
+            "%u frames (%ux%u, %u threads) in %.3f s: %.1f fps, %u writer stalls\n",
+            frames, cpu.GetOutput().Width(), cpu.GetOutput().Height(),
+            pool.ThreadCount(), elapsed.count(), frames / elapsed.count(),
+            sink.GetStalls());
+    if (options.frameBudget > 0) {
+        fprintf(stderr, "Quality: %s after %llu steps down and %llu up\n",
+                GetQualityLevelName(rc.governor.GetLevel()),
+                static_cast<unsigned long long>(rc.governor.GetStepsDown()),
+                static_cast<unsigned long long>(rc.governor.GetStepsUp()));
+    }
+    if (ring) {
+        fprintf(stderr, "Shared frames: up to #%llu, %llu skipped\n",
+                static_cast<unsigned long long>(ring->GetFrame()),
+                static_cast<unsigned long long>(ring->GetSkippedFrames()));
+    }
+    PrintQueueStats("Output", sink.GetQueueStats());
+    PrintPoolStats();
+    return 0;
+}
+
+struct ShareOptions
+{
+    char const* ring = nullptr;
+    char const* input = nullptr;
+    bool synthetic = false;
+    float dirtyFraction = 0.0f;
+    unsigned width = 0;
+    unsigned height = 0;
+    unsigned frames = 0;
+    unsigned frameRate = 60;
+};
+
+bool ParseShareOptions(int argc, char** argv, ShareOptions& options)
+{
+    auto const handler = [&](std::string_view arg, char const* value) {
+        if (arg == "--ring") {
+            options.ring = value;
+        } else if (arg == "--input") {
+            options.input = value;
+        } else if (arg == "--synthetic") {
+            options.synthetic = true;
+            return Check(ParseFraction(value, options.dirtyFraction));
+        } else if (arg == "--size") {
+            return Check(ParseSize(value, options.width, options.height));
+        } else if (arg == "--frames") {
+            return Check(ParseUnsigned(value, options.frames));
+        } else if (arg == "--frame-rate") {
+            return Check(ParseUnsigned(value, options.frameRate) &&
+                         options.frameRate > 0);
+        } else {
+            return OptionResult::Unknown;
+        }
+        return OptionResult::Valid;
+    };
+    if (!ParseOptions(argc, argv, handler))
+        return false;
+
+    if (!options.ring || !options.input == !options.synthetic) {
+        fprintf(stderr, "--ring and either --input or --synthetic are required\n");
+        return false;
+    }
+    return true;
+}
+
+int RunShare(int argc, char** argv)
+{
+    ShareOptions options;
+    if (!ParseShareOptions(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+
+    std::unique_ptr<IFrameSource> source;
+    if (options.synthetic) {
+        SyntheticDesktopOptions desktopOptions;
+        desktopOptions.dirtyFraction = options.dirtyFraction;
+        if (options.width > 0) {
+            desktopOptions.width = options.width;
+            desktopOptions.height = options.height;
+        }
+        source = std::make_unique<SyntheticDesktopSource>(desktopOptions);
+    } else {
+        ImageBuffer image;
+        if (FAILED(LoadImageFile(options.input, image))) {
+            fprintf(stderr, "Cannot load image %s\n", options.input);
+            return 1;
+        }
+        source = std::make_unique<ImageFrameSource>(std::move(image));
+    }
+
+    unsigned width = options.width;
+    unsigned height = options.height;
+    if (width == 0 || height == 0)
+        source->GetSize(width, height);
+
+    SharedFrameWriter writer;
+    if (FAILED(writer.Create(options.ring, width, height))) {
+        fprintf(stderr, "Cannot create frame ring %s\n", options.ring);
+        return 1;
+    }
+
+    auto const interval = std::chrono::nanoseconds(1000000000 / options.frameRate);
+    auto const start = std::chrono::steady_clock::now();
+    auto next = start;
+    HRESULT hr = S_OK;
+    for (unsigned i = 0; (options.frames == 0 || i < options.frames) && SUCCEEDED(hr);
+         ++i) {
+        // Captured straight into the slot the consumer reads.
+        hr = source->Capture(writer.BeginFrame());
+        if (SUCCEEDED(hr))
+            writer.PublishFrame();
+        next += interval;
+        std::this_thread::sleep_until(next);
+    }
+    writer.Close();
+
+    if (FAILED(hr)) {
+        fprintf(stderr, "Capture failed: 0x%08X\n", static_cast<unsigned>(hr));
+        return 1;
+    }
+
+    auto const elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start);
+    fprintf(stderr, "%llu frames (%ux%u) published in %.3f s\n",
+            static_cast<unsigned long long>(writer.GetPublishedFrames()), width, height,
+            elapsed.count());
+    return 0;
+}
+
+struct FilterOptions
+{
+    char const* input = "-";
+    char const* output = "-";
+    StreamFormat inputFormat = StreamFormat::Y4m;
+    bool hasOutputFormat = false;
+    StreamFormat outputFormat = StreamFormat::Y4m;
+    unsigned width = 0;
+    unsigned height = 0;
+    unsigned frameRate = 60;
+    IntensitySchedule schedule;
+    bool processYuv = true;
+    unsigned threads = 0;
+    unsigned queueDepth = 4;
+    OverflowPolicy overflow = OverflowPolicy::Block;
+    HugePageMode hugePages = HugePageMode::Transparent;
+    char const* trace = nullptr;
+    char const* metrics = nullptr;
+};
+
+bool ParseFilterOptions(int argc, char** argv, FilterOptions& options)
+{
+    IntensitySchedule::Parse("burst:40", options.schedule);
+
+    auto const handler = [&](std::string_view arg, char const* value) {
+        if (arg == "--input") {
+            options.input = value;
+        } else if (arg == "--output") {
+            options.output = value;
+        } else if (arg == "--input-format") {
+            return Check(ParseFormat(value, options.inputFormat));
+        } else if (arg == "--output-format") {
+            options.hasOutputFormat = true;
+            return Check(ParseFormat(value, options.outputFormat));
+        } else if (arg == "--size") {
+            return Check(ParseSize(value, options.width, options.height));
+        } else if (arg == "--frame-rate") {
+            return Check(ParseUnsigned(value, options.frameRate) &&
+                         options.frameRate > 0);
+        } else if (arg == "--intensity") {
+            return Check(IntensitySchedule::Parse(value, options.schedule));
+        } else if (arg == "--process") {
+            std::string_view const process = value;
+            options.processYuv = process == "yuv";
+            return Check(process == "yuv" || process == "bgra");
+        } else if (arg == "--threads") {
+            return Check(ParseUnsigned(value, options.threads));
+        } else if (arg == "--queue-depth") {
+            return Check(ParseUnsigned(value, options.queueDepth));
+        } else if (arg == "--overflow") {
+            return Check(ParseOverflowPolicy(value, options.overflow));
+        } else if (arg == "--huge-pages") {
+            return Check(ParseHugePageMode(value, options.hugePages));
+        } else if (arg == "--trace") {
+            options.trace = value;
+        } else if (arg == "--metrics") {
+            options.metrics = value;
+        } else {
+            return OptionResult::Unknown;
+        }
+        return OptionResult::Valid;
+    };
+    if (!ParseOptions(argc, argv, handler))
+        return false;
+
+    if (options.inputFormat == StreamFormat::RawBgra && options.width == 0) {
+        fprintf(stderr, "--size is required for raw input\n");
+        return false;
+    }
+
+    if (!options.hasOutputFormat)
+        options.outputFormat = options.inputFormat;
+
+    // Raw streams are BGRA on at least one end.
+    if (options.inputFormat != StreamFormat::Y4m ||
+        options.outputFormat != StreamFormat::Y4m)
+        options.processYuv = false;
+    return true;
+}
+
+template<typename Frame, typename Filter>
+HRESULT RunPipeline(FilterOptions& options, IBasicFrameReader<Frame>& reader,
+                    IBasicFrameSink<Frame>& writer, ThreadPool& pool, unsigned& frames)
+{
+    Filter filter(std::move(options.schedule), &pool);
+    BasicFramePipeline<Frame> pipeline(options.queueDepth, options.overflow);
+
+    auto const start = std::chrono::steady_clock::now();
+    HRESULT const hr = pipeline.Run(reader, filter, writer);
+    auto const elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start);
+
+    frames = pipeline.GetFrames();
+    if (SUCCEEDED(hr)) {
+        fprintf(stderr,
+                "%u frames in %.3f s: %.1f fps (waits: read %u, glitch %u, write %u)\n",
+                frames, elapsed.count(), frames / elapsed.count(),
+                pipeline.GetReadWaits(), pipeline.GetProcessWaits(),
+                pipeline.GetWriteWaits());
+        PrintQueueStats("Input", pipeline.GetInputQueueStats());
+        PrintQueueStats("Output", pipeline.GetOutputQueueStats());
+        PrintPoolStats();
+    }
+    return hr;
+}
+
+int RunFilter(int argc, char** argv)
+{
+    FilterOptions options;
+    if (!ParseFilterOptions(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+    SetHugePageMode(options.hugePages);
+    EnableTracing(options.trace != nullptr);
+
+    MetricsServer metricsServer;
+    if (!StartMetrics(metricsServer, options.metrics))
+        return 1;
+
+    FILE* const input = OpenStream(options.input, "rb");
+    if (!input) {
+        fprintf(stderr, "Cannot open %s for reading\n", options.input);
+        return 1;
+    }
+
+    std::unique_ptr<Y4mFrameReader> y4mReader;
+    std::unique_ptr<IFrameReader> rawReader;
+    if (options.inputFormat == StreamFormat::Y4m) {
+        y4mReader = std::make_unique<Y4mFrameReader>(input);
+        if (FAILED(y4mReader->ReadHeader())) {
+            fprintf(stderr, "Unsupported Y4M stream; only 8-bit 4:2:0 is supported\n");
+            CloseStream(input);
+            return 1;
+        }
+    } else {
+        rawReader = std::make_unique<RawFrameReader>(input, options.width, options.height,
+                                                     FrameRate{options.frameRate, 1});
+    }
+
+    FILE* const output = OpenStream(options.output, "wb");
+    if (!output) {
+        fprintf(stderr, "Cannot open %s for writing\n", options.output);
+        CloseStream(input);
+        return 1;
+    }
+
+    ThreadPool pool(options.threads);
+    unsigned frames = 0;
+    HRESULT hr;
+    if (options.processYuv) {
+        Y4mFrameWriter writer(output, y4mReader->GetFrameRate());
+        hr = RunPipeline<YuvImage, YuvGlitchFilter>(options, *y4mReader, writer, pool,
+                                                    frames);
+    } else {
+        IFrameReader& reader = y4mReader ? *y4mReader : *rawReader;
+        auto writer = CreateFrameWriter(options.outputFormat, output,
+                                        reader.GetFrameRate());
+        hr = RunPipeline<ImageBuffer, GlitchFilter>(options, reader, *writer, pool,
+                                                    frames);
+    }
+
+    CloseStream(output);
+    CloseStream(input);
+    SaveTrace(options.trace);
+
+    if (FAILED(hr)) {
+        fprintf(stderr, "Filtering failed after %u frames: 0x%08X\n", frames,
+                static_cast<unsigned>(hr));
+        return 1;
+    }
+    return 0;
+}
+
+struct ServeSessionOptions
+{
+    std::string name;
+    char const* input = nullptr;
+    char const* ring = nullptr;
+    bool synthetic = false;
+    float dirtyFraction = 0.0f;
+    char const* output = nullptr;
+    unsigned width = 0;
+    unsigned height = 0;
+    unsigned seed = 1;
+    IntensitySchedule schedule;
+    bool chromaticSplit = true;
+    unsigned frameRate = 0;
+    unsigned frames = 600;
+};
+
+struct ServeOptions
+{
+    unsigned threads = 0;
+    HugePageMode hugePages = HugePageMode::Transparent;
+    char const* trace = nullptr;
+    std::vector<ServeSessionOptions> sessions;
+};
+
+bool ParseServeOptions(int argc, char** argv, ServeOptions& options)
+{
+    auto const handler = [&](std::string_view arg, char const* value) {
+        if (arg == "--session") {
+            options.sessions.emplace_back();
+            options.sessions.back().name = value;
+            IntensitySchedule::Parse("burst:40", options.sessions.back().schedule);
+            return OptionResult::Valid;
+        }
+
+        if (options.sessions.empty()) {
+            if (arg == "--threads") {
+                return Check(ParseUnsigned(value, options.threads));
+            } else if (arg == "--huge-pages") {
+                return Check(ParseHugePageMode(value, options.hugePages));
+            } else if (arg == "--trace") {
+                options.trace = value;
+                return OptionResult::Valid;
+            }
+            return OptionResult::Unknown;
+        }
+
+        ServeSessionOptions& session = options.sessions.back();
+        if (arg == "--input") {
+            session.input = value;
+        } else if (arg == "--synthetic") {
+            session.synthetic = true;
+            return Check(ParseFraction(value, session.dirtyFraction));
+        } else if (arg == "--ring") {
+            session.ring = value;
+        } else if (arg == "--output") {
+            session.output = value;
+        } else if (arg == "--size") {
+            return Check(ParseSize(value, session.width, session.height));
+        } else if (arg == "--seed") {
+            return Check(ParseUnsigned(value, session.seed));
+        } else if (arg == "--intensity") {
+            return Check(IntensitySchedule::Parse(value, session.schedule));
+        } else if (arg == "--effects") {
+            std::string_view const chain = value;
+            session.chromaticSplit = chain == "glitch+split";
+            return Check(chain == "glitch" || chain == "glitch+split");
+        } else if (arg == "--frame-rate") {
+            return Check(ParseUnsigned(value, session.frameRate));
+        } else if (arg == "--frames") {
+            return Check(ParseUnsigned(value, session.frames));
+        } else {
+            return OptionResult::Unknown;
+        }
+        return OptionResult::Valid;
+    };
+    if (!ParseOptions(argc, argv, handler))
+        return false;
+
+    if (options.sessions.empty()) {
+        fprintf(stderr, "At least one --session is required\n");
+        return false;
+    }
+    for (ServeSessionOptions const& session : options.sessions) {
+        if ((session.input != nullptr) + (session.ring != nullptr) + session.synthetic !=
+            1) {
+            fprintf(stderr, "Session %s needs one of --input, --synthetic or --ring\n",
+                    session.name.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Frame source of a session, or null after reporting why there is none.
+std::unique_ptr<IFrameSource> OpenSessionSource(ServeSessionOptions const& session)
+{
+    if (session.ring) {
+        auto shared = std::make_unique<SharedFrameSource>();
+        if (FAILED(shared->Open(session.ring))) {
+            fprintf(stderr, "Cannot open frame ring %s\n", session.ring);
+            return nullptr;
+        }
+        return shared;
+    }
+
+    if (session.synthetic) {
+        SyntheticDesktopOptions desktopOptions;
+        desktopOptions.dirtyFraction = session.dirtyFraction;
+        desktopOptions.seed = session.seed;
+        if (session.width > 0) {
+            desktopOptions.width = session.width;
+            desktopOptions.height = session.height;
+        }
+        return std::make_unique<SyntheticDesktopSource>(desktopOptions);
+    }
+
+    ImageBuffer image;
+    if (FAILED(LoadImageFile(session.input, image))) {
+        fprintf(stderr, "Cannot load image %s\n", session.input);
+        return nullptr;
+    }
+    return std::make_unique<ImageFrameSource>(std::move(image));
+}
+
+int RunServe(int argc, char** argv)
+{
+    ServeOptions options;
+    if (!ParseServeOptions(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+    SetHugePageMode(options.hugePages);
+    EnableTracing(options.trace != nullptr);
+
+    SessionServer server(options.threads);
+    std::vector<FILE*> outputs;
+    std::vector<std::unique_ptr<IFrameSink>> writers;
+    auto const closeOutputs = [&] {
+        writers.clear();
+        for (FILE* output : outputs)
+            CloseStream(output);
+    };
+
+    for (ServeSessionOptions& session : options.sessions) {
+        SessionOptions sessionOptions;
+        sessionOptions.name = session.name;
+        sessionOptions.source = OpenSessionSource(session);
+        if (!sessionOptions.source) {
+            closeOutputs();
+            return 1;
+        }
+
+        if (session.output) {
+            FILE* const output = OpenStream(session.output, "wb");
+            if (!output) {
+                fprintf(stderr, "Cannot open %s for writing\n", session.output);
+                closeOutputs();
+                return 1;
+            }
+            outputs.push_back(output);
+            unsigned const frameRate = session.frameRate ? session.frameRate : 60;
+            StreamFormat const format = FormatFromPath(session.output);
+            writers.push_back(CreateFrameWriter(format, output, {frameRate, 1}));
+            sessionOptions.sink = writers.back().get();
+        }
+
+        sessionOptions.width = session.width;
+        sessionOptions.height = session.height;
+        sessionOptions.seed = session.seed;
+        sessionOptions.schedule = std::move(session.schedule);
+        sessionOptions.chromaticSplit = session.chromaticSplit;
+        sessionOptions.frameRate = session.frameRate;
+        sessionOptions.frames = session.frames;
+
+        unsigned index;
+        if (FAILED(server.AddSession(std::move(sessionOptions), index))) {
+            fprintf(stderr, "Cannot start session %s\n", session.name.c_str());
+            closeOutputs();
+            return 1;
+        }
+    }
+
+    HRESULT const hr = server.Run();
+    closeOutputs();
+    SaveTrace(options.trace);
+
+    fprintf(stderr, "%zu sessions on %u threads\n", server.GetSessionCount(),
+            server.ThreadCount());
+    for (unsigned i = 0; i < server.GetSessionCount(); ++i) {
+        SessionStats const stats = server.GetSessionStats(i);
+        fprintf(stderr,
+                "%s: %u frames in %.3f s: %.1f fps, %.2f threads busy, queue delay "
+                "%.2f ms (max %.2f ms), latency %.2f ms, %u deadlines missed\n",
+                server.GetSessionName(i).c_str(), stats.frames, stats.elapsed,
+                stats.elapsed > 0.0 ? stats.frames / stats.elapsed : 0.0,
+                stats.elapsed > 0.0 ? stats.busy / stats.elapsed : 0.0,
+                stats.averageQueueDelay * 1000.0, stats.maxQueueDelay * 1000.0,
+                stats.averageLatency * 1000.0, stats.deadlineMisses);
+        if (FAILED(stats.result)) {
+            fprintf(stderr, "%s failed: 0x%08X\n", server.GetSessionName(i).c_str(),
+                    static_cast<unsigned>(stats.result));
+        }
+    }
+    PrintPoolStats();
+    return FAILED(hr) ? 1 : 0;
+}
+
+struct JobOptions
+{
+    char const* input = nullptr;
+    char const* output = nullptr;
+    bool hasFormat = false;
+    StreamFormat format = StreamFormat::RawBgra;
+    unsigned width = 0;
+    unsigned height = 0;
+    unsigned frames = 0;
+    unsigned seed = 1;
+    unsigned threads = 0;
+    unsigned frameRate = 60;
+    unsigned scale = 1;
+    std::vector<ImageRect> region;
+    unsigned shard = 0;
+    unsigned shardCount = 1;
+    unsigned workers = 1;
+};
+
+bool ParseJobOptions(int argc, char** argv, JobOptions& options)
+{
+    auto const handler = [&](std::string_view arg, char const* value) {
+        if (arg == "--input") {
+            options.input = value;
+        } else if (arg == "--output") {
+            options.output = value;
+        } else if (arg == "--format") {
+            options.hasFormat = true;
+            return Check(ParseFormat(value, options.format));
+        } else if (arg == "--size") {
+            return Check(ParseSize(value, options.width, options.height));
+        } else if (arg == "--frames") {
+            return Check(ParseUnsigned(value, options.frames));
+        } else if (arg == "--seed") {
+            return Check(ParseUnsigned(value, options.seed));
+        } else if (arg == "--threads") {
+            return Check(ParseUnsigned(value, options.threads));
+        } else if (arg == "--frame-rate") {
+            return Check(ParseUnsigned(value, options.frameRate) &&
+                         options.frameRate > 0);
+        } else if (arg == "--scale") {
+            return Check(ParseUnsigned(value, options.scale) &&
+                         (options.scale == 1 || options.scale == 2 ||
+                          options.scale == 4));
+        } else if (arg == "--region") {
+            ImageRect rect;
+            if (!ParseRect(value, rect.x, rect.y, rect.width, rect.height))
+                return OptionResult::Invalid;
+            options.region.push_back(rect);
+        } else if (arg == "--shard") {
+            return Check(ParseShard(value, options.shard, options.shardCount));
+        } else if (arg == "--workers") {
+            return Check(ParseUnsigned(value, options.workers) && options.workers > 0);
+        } else {
+            return OptionResult::Unknown;
+        }
+        return OptionResult::Valid;
+    };
+    if (!ParseOptions(argc, argv, handler))
+        return false;
+
+    if (!options.input || !options.output || options.frames == 0) {
+        fprintf(stderr, "--input, --output and --frames are required\n");
+        return false;
+    }
+    if (options.workers > 1 &&
+        (options.shardCount > 1 || std::string_view(options.output) == "-")) {
+        fprintf(stderr, "--workers needs an output file and no --shard\n");
+        return false;
+    }
+
+    if (!options.hasFormat)
+        options.format = FormatFromPath(options.output);
+    return true;
+}
+
+/// Renders one shard of a job, or all of it, in this process.
+int RenderJobShard(JobOptions const& options)
+{
+    ImageBuffer image;
+    if (FAILED(LoadImageFile(options.input, image))) {
+        fprintf(stderr, "Cannot load image %s\n", options.input);
+        return 1;
+    }
+
+    GlitchRegion region;
+    region.rects = options.region;
+
+    FILE* const output = OpenStream(options.output, "wb");
+    if (!output) {
+        fprintf(stderr, "Cannot open %s for writing\n", options.output);
+        return 1;
+    }
+
+    ThreadPool pool(options.threads);
+    auto writer = CreateFrameWriter(options.format, output, {options.frameRate, 1});
+    AsyncFrameSink sink(*writer, 4, OverflowPolicy::Block);
+
+    auto backend = std::make_unique<CpuBackend>(
+        std::make_unique<ImageFrameSource>(std::move(image)));
+    CpuBackend& cpu = *backend;
+    cpu.SetSink(&sink);
+    cpu.SetThreadPool(&pool);
+
+    // No frame budget: the governor keeps every frame at full quality, so
+    // that frames do not depend on how fast the host rendered the others.
+    RenderContext rc;
+    HRESULT hr = cpu.SetProcessingScale(options.scale);
+    if (SUCCEEDED(hr))
+        hr = cpu.SetRegion(region);
+    if (SUCCEEDED(hr))
+        hr = cpu.Initialize(options.width, options.height);
+    if (SUCCEEDED(hr))
+        hr = rc.Initialize(std::move(backend));
+
+    FrameRange const range =
+        GetShardRange(options.frames, options.shard, options.shardCount);
+    JobPlanner planner(options.seed);
+    auto const start = std::chrono::steady_clock::now();
+    if (SUCCEEDED(hr))
+        hr = rc.RenderJobFrames(planner, range.begin, range.end);
+
+    HRESULT const writeResult = sink.Finish();
+    auto const elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start);
+    CloseStream(output);
+
+    if (FAILED(hr) || FAILED(writeResult)) {
+        fprintf(stderr, "Rendering failed: 0x%08X\n",
+                static_cast<unsigned>(FAILED(hr) ? hr : writeResult));
+        return 1;
+    }
+
+    fprintf(stderr,
+            "Frames %llu to %llu of %u (%ux%u, %u threads) in %.3f s: %.1f fps\n",
+            static_cast<unsigned long long>(range.begin),
+            static_cast<unsigned long long>(range.end), options.frames,
+            cpu.GetOutput().Width(), cpu.GetOutput().Height(), pool.ThreadCount(),
+            elapsed.count(), (range.end - range.begin) / elapsed.count());
+    return 0;
+}
+
+/// <summary>
+///   Renders a job as one shard per worker process, each with its share of
+///   the cores, and merges their outputs. The workers are this program again,
+///   with the options of the job.
+/// </summary>
+int RunJobWorkers(char const* argv0, int argc, char** argv, JobOptions const& options)
+{
+    unsigned threads = options.threads;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency() / options.workers);
+
+    std::vector<std::string> common = {"job"};
+    for (int i = 0; i + 1 < argc; i += 2) {
+        std::string_view const arg = argv[i];
+        if (arg != "--output" && arg != "--format" && arg != "--workers" &&
+            arg != "--threads") {
+            common.push_back(argv[i]);
+            common.push_back(argv[i + 1]);
+        }
+    }
+    // The parts are named after the output, but do not end like it.
+    common.push_back("--format");
+    common.push_back(options.format == StreamFormat::Y4m ? "y4m" : "raw");
+    common.push_back("--threads");
+    common.push_back(std::to_string(threads));
+
+    std::string const program = GetProgramPath(argv0);
+    std::vector<std::string> parts;
+    std::vector<ChildProcess> workers(options.workers);
+    auto const start = std::chrono::steady_clock::now();
+    bool succeeded = true;
+    for (unsigned i = 0; i < options.workers; ++i) {
+        parts.push_back(std::string(options.output) + ".shard" + std::to_string(i));
+        std::vector<std::string> args = common;
+        args.push_back("--shard");
+        args.push_back(std::to_string(i) + "/" + std::to_string(options.workers));
+        args.push_back("--output");
+        args.push_back(parts.back());
+        if (FAILED(workers[i].Start(program, args))) {
+            fprintf(stderr, "Cannot start worker %u\n", i);
+            succeeded = false;
+            break;
+        }
+    }
+
+    // Started workers are waited for even if others failed to start.
+    for (unsigned i = 0; i < options.workers; ++i) {
+        int exitCode = 0;
+        HRESULT const hr = workers[i].Wait(exitCode);
+        if (hr != E_UNEXPECTED && (FAILED(hr) || exitCode != 0)) {
+            fprintf(stderr, "Worker %u failed\n", i);
+            succeeded = false;
+        }
+    }
+    auto const rendered = std::chrono::steady_clock::now();
+
+    FILE* const output = succeeded ? OpenStream(options.output, "wb") : nullptr;
+    HRESULT const hr = output ? MergeShards(options.format, parts, output) : E_FAIL;
+    CloseStream(output);
+    for (std::string const& part : parts)
+        std::remove(part.c_str());
+    if (!succeeded)
+        return 1;
+    if (FAILED(hr)) {
+        fprintf(stderr, "Cannot merge the shards into %s: 0x%08X\n", options.output,
+                static_cast<unsigned>(hr));
+        return 1;
+    }
+
+    auto const end = std::chrono::steady_clock::now();
+    double const elapsed = std::chrono::duration<double>(end - start).count();
+    fprintf(stderr,
+            "%u frames on %u workers of %u threads in %.3f s: %.1f fps, %.3f s "
+            "merging\n",
+            options.frames, options.workers, threads, elapsed, options.frames / elapsed,
+            std::chrono::duration<double>(end - rendered).count());
+    return 0;
+}
+
+int RunJob(char const* argv0, int argc, char** argv)
+{
+    JobOptions options;
+    if (!ParseJobOptions(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+
+    if (options.workers > 1)
+        return RunJobWorkers(argv0, argc, argv, options);
+    return RenderJobShard(options);
+}
+
+int RunMerge(int argc, char** argv)
+{
+    char const* outputPath = nullptr;
+    bool hasFormat = false;
+    StreamFormat format = StreamFormat::RawBgra;
+    std::vector<std::string> parts;
+    auto const handler = [&](std::string_view arg, char const* value) {
+        if (arg == "--output") {
+            outputPath = value;
+        } else if (arg == "--part") {
+            parts.push_back(value);
+        } else if (arg == "--format") {
+            hasFormat = true;
+            return Check(ParseFormat(value, format));
+        } else {
+            return OptionResult::Unknown;
+        }
+        return OptionResult::Valid;
+    };
+    if (!ParseOptions(argc, argv, handler) || !outputPath || parts.empty()) {
+        PrintUsage();
+        return 1;
+    }
+    if (!hasFormat)
+        format = FormatFromPath(outputPath);
+
+    FILE* const output = OpenStream(outputPath, "wb");
+    if (!output) {
+        fprintf(stderr, "Cannot open %s for writing\n", outputPath);
+        return 1;
+    }
+    HRESULT const hr = MergeShards(format, parts, output);
+    CloseStream(output);
+    if (FAILED(hr)) {
+        fprintf(stderr, "Cannot merge the parts: 0x%08X\n", static_cast<unsigned>(hr));
+        return 1;
+    }
+    return 0;
+}
+
+struct BandsOptions
+{
+    char const* input = nullptr;
+    char const* output = nullptr;
+    unsigned inputWidth = 0;
+    unsigned inputHeight = 0;
+    unsigned memory = 256;
+    unsigned seed = 1;
+    float intensity = 0.5f;
+    bool chromaticSplit = true;
+    unsigned threads = 0;
+};
+
+bool ParseBandsOptions(int argc, char** argv, BandsOptions& options)
+{
+    auto const handler = [&](std::string_view arg, char const* value) {
+        if (arg == "--input") {
+            options.input = value;
+        } else if (arg == "--output") {
+            options.output = value;
+        } else if (arg == "--input-size") {
+            return Check(ParseSize(value, options.inputWidth, options.inputHeight));
+        } else if (arg == "--memory") {
+            return Check(ParseUnsigned(value, options.memory) && options.memory > 0);
+        } else if (arg == "--seed") {
+            return Check(ParseUnsigned(value, options.seed));
+        } else if (arg == "--intensity") {
+            return Check(ParseFraction(value, options.intensity));
+        } else if (arg == "--effects") {
+            std::string_view const chain = value;
+            options.chromaticSplit = chain == "glitch+split";
+            return Check(chain == "glitch" || chain == "glitch+split");
+        } else if (arg == "--threads") {
+            return Check(ParseUnsigned(value, options.threads));
+        } else {
+            return OptionResult::Unknown;
+        }
+        return OptionResult::Valid;
+    };
+    if (!ParseOptions(argc, argv, handler))
+        return false;
+
+    if (!options.input || !options.output) {
+        fprintf(stderr, "--input and --output are required\n");
+        return false;
+    }
+    return true;
+}
+
+int RunBands(int argc, char** argv)
+{
+    BandsOptions options;
+    if (!ParseBandsOptions(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+
+    ImageFileReader reader;
+    ImageFileFormat const inputFormat =
+        options.inputWidth ? ImageFileFormat::RawBgra : ImageFileFormat::Ppm;
+    if (FAILED(reader.Open(options.input, inputFormat, options.inputWidth,
+                           options.inputHeight))) {
+        fprintf(stderr, "Cannot open image %s\n", options.input);
+        return 1;
+    }
+
+    std::string_view const outputName = options.output;
+    bool const ppm =
+        outputName.size() >= 4 && outputName.substr(outputName.size() - 4) == ".ppm";
+
+    // Seeded like a session, so that the same seed glitches the same way.
+    xorshift128_engine rng(options.seed, ~uint64_t(options.seed));
+    NoiseGrid noise;
+    noise.Generate(rng);
+    CellDecisions decisions;
+    decisions.Evaluate(noise, options.intensity);
+
+    BandedGlitchOptions glitchOptions;
+    glitchOptions.memoryBudget = size_t(options.memory) << 20;
+    glitchOptions.intensity = options.intensity;
+    glitchOptions.chromaticSplit = options.chromaticSplit;
+
+    ThreadPool pool(options.threads);
+    BandedGlitch glitch;
+    glitch.SetThreadPool(&pool);
+    auto const start = std::chrono::steady_clock::now();
+    HRESULT hr = glitch.Plan(noise, decisions, reader.Width(), reader.Height(),
+                             glitchOptions);
+    if (hr == E_OUTOFMEMORY) {
+        fprintf(stderr, "%u MiB cannot hold a band of %u pixels wide rows\n",
+                options.memory, reader.Width());
+        return 1;
+    }
+
+    ImageFileWriter writer;
+    if (SUCCEEDED(hr)) {
+        hr = writer.Create(options.output,
+                           ppm ? ImageFileFormat::Ppm : ImageFileFormat::RawBgra,
+                           reader.Width(), reader.Height());
+    }
+    if (SUCCEEDED(hr))
+        hr = glitch.Run(reader, writer);
+    HRESULT const closeResult = writer.Close();
+    auto const elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start);
+
+    if (FAILED(hr) || FAILED(closeResult)) {
+        fprintf(stderr, "Glitching failed: 0x%08X\n",
+                static_cast<unsigned>(FAILED(hr) ? hr : closeResult));
+        return 1;
+    }
+
+    BandedGlitchStats const stats = glitch.GetStats();
+    double const pixels = double(reader.Width()) * reader.Height();
+    fprintf(stderr,
+            "%ux%u in %u bands of %u rows (%u threads) in %.3f s: %.1f Mpixels/s, "
+            "%.1f MiB of band buffers\n",
+            reader.Width(), reader.Height(), stats.bands, stats.rowsPerBand,
+            pool.ThreadCount(), elapsed.count(), pixels / 1e6 / elapsed.count(),
+            stats.bufferBytes / 1048576.0);
+    fprintf(stderr,
+            "Reads: %.2f source bands per band on average, %u at most; %.3f times "
+            "the image in %llu spans\n",
+            stats.averageSourceBands, stats.maxSourceBands, stats.pixelsRead / pixels,
+            static_cast<unsigned long long>(stats.spansRead));
+    return 0;
+}
+
+} // namespace
+} // namespace gt
+
+int main(int argc, char** argv)
+{
+    using namespace gt;
+
+    if (argc < 2) {
+        PrintUsage();
+        return 1;
+    }
+
+    SetTraceThreadName("Main");
+    std::string_view const command = argv[1];
+    if (command == "render")
+        return RunRender(argc - 2, argv + 2);
+    if (command == "filter")
+        return RunFilter(argc - 2, argv + 2);
+    if (command == "share")
+        return RunShare(argc - 2, argv + 2);
+    if (command == "serve")
+        return RunServe(argc - 2, argv + 2);
+    if (command == "job")
+        return RunJob(argv[0], argc - 2, argv + 2);
+    if (command == "merge")
+        return RunMerge(argc - 2, argv + 2);
+    if (command == "bands")
+        return RunBands(argc - 2, argv + 2);
+
+    fprintf(stderr, "Unknown command %s\n", argv[1]);
+    PrintUsage();
+    return 1;
+}
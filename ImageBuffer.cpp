@@ -0,0 +1,79 @@
+#include "ImageBuffer.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace gt
+{
+
+namespace
+{
+
+template<typename Pixel>
+void CopyResampled(cimage_view<Pixel> source, image_view<Pixel> dest)
+{
+    if (source.empty() || dest.empty())
+        return;
+
+    if (source.width() == dest.width() && source.height() == dest.height()) {
+        copy_pixels(source, dest);
+        return;
+    }
+
+    unsigned const srcWidth = unsigned(source.width());
+    unsigned const srcHeight = unsigned(source.height());
+
+    // 16.16 fixed point step through the source.
+    uint64_t const stepX = (uint64_t(srcWidth) << 16) / dest.width();
+    uint64_t const stepY = (uint64_t(srcHeight) << 16) / dest.height();
+
+    for (unsigned y = 0; y < dest.height(); ++y) {
+        unsigned const sy = std::min(static_cast<unsigned>((y * stepY + stepY / 2) >> 16),
+                                     srcHeight - 1);
+        Pixel const* src = source.row(sy).data();
+        Pixel* dst = dest.row(y).data();
+
+        for (unsigned x = 0; x < dest.width(); ++x) {
+            unsigned const sx = std::min(
+                static_cast<unsigned>((x * stepX + stepX / 2) >> 16), srcWidth - 1);
+            dst[x] = src[sx];
+        }
+    }
+}
+
+template<typename Pixel>
+void CopyRects(cimage_view<Pixel> source, image_view<Pixel> dest,
+               cspan<ImageRect> rects)
+{
+    assert(source.width() == dest.width() && source.height() == dest.height() &&
+           "Image sizes differ");
+
+    for (ImageRect const& rect : rects)
+        copy_pixels(SubView(source, rect), SubView(dest, rect));
+}
+
+} // namespace
+
+void CopyImage(cimage_view<uint32_t> source, image_view<uint32_t> dest)
+{
+    CopyResampled(source, dest);
+}
+
+void CopyImage(cimage_view<uint64_t> source, image_view<uint64_t> dest)
+{
+    CopyResampled(source, dest);
+}
+
+void CopyImageRects(cimage_view<uint32_t> source, image_view<uint32_t> dest,
+                    cspan<ImageRect> rects)
+{
+    CopyRects(source, dest, rects);
+}
+
+void CopyImageRects(cimage_view<uint64_t> source, image_view<uint64_t> dest,
+                    cspan<ImageRect> rects)
+{
+    CopyRects(source, dest, rects);
+}
+
+} // namespace gt
@@ -0,0 +1,139 @@
+#pragma once
+#include "FramePool.h"
+#include "PixelFormat.h"
+#include "Span.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace gt
+{
+
+/// Rectangle of an image, in pixels.
+struct ImageRect
+{
+    unsigned x = 0;
+    unsigned y = 0;
+    unsigned width = 0;
+    unsigned height = 0;
+
+    bool Empty() const { return width == 0 || height == 0; }
+};
+
+/// Part of <paramref name="rect"/> inside an image of the given size.
+inline ImageRect ClipRect(ImageRect const& rect, unsigned width, unsigned height)
+{
+    unsigned const x = std::min(rect.x, width);
+    unsigned const y = std::min(rect.y, height);
+    return {x, y, std::min(rect.width, width - x), std::min(rect.height, height - y)};
+}
+
+/// Pixels of <paramref name="view"/> inside <paramref name="rect"/>, which
+/// must lie within the view.
+template<typename PixelType>
+image_view<PixelType> SubView(image_view<PixelType> view, ImageRect const& rect)
+{
+    return view.subview(rect.x, rect.y, rect.width, rect.height);
+}
+
+/// <summary>
+///   Image in system memory, in <typeparamref name="Format"/>. Rows are
+///   tightly packed, so the row pitch is always <c>width</c> times the size
+///   of a pixel. The pixels live in a block of a <see cref="FramePool"/> (the
+///   shared pool unless given another one), which gets it back when the image
+///   is resized or destroyed.
+/// </summary>
+template<PixelFormat Format>
+class BasicImageBuffer
+{
+public:
+    using Pixel = PixelType<Format>;
+
+    BasicImageBuffer() = default;
+    explicit BasicImageBuffer(FramePool& pool)
+        : pool(&pool)
+    {}
+    BasicImageBuffer(unsigned width, unsigned height) { Resize(width, height); }
+
+    /// Resizes the image and clears it to zero. The old block is released
+    /// before the new one is acquired, so it can be recycled right away.
+    void Resize(unsigned newWidth, unsigned newHeight)
+    {
+        if (newWidth != width || newHeight != height) {
+            width = newWidth;
+            height = newHeight;
+            pixels.Reset();
+            pixels = GetPool().Acquire(width, height, Format);
+        }
+        if (pixels)
+            std::memset(pixels.Data(), 0, pixels.Size());
+    }
+
+    /// Moves future allocations to <paramref name="newPool"/>.
+    void SetPool(FramePool& newPool) { pool = &newPool; }
+    FramePool& GetPool() const { return pool ? *pool : FramePool::Shared(); }
+
+    unsigned Width() const { return width; }
+    unsigned Height() const { return height; }
+    size_t RowPitch() const { return width * sizeof(Pixel); }
+    size_t SizeBytes() const { return pixels.Size(); }
+    bool Empty() const { return pixels.Size() == 0; }
+
+    Pixel* Data() { return reinterpret_cast<Pixel*>(pixels.Data()); }
+    Pixel const* Data() const { return reinterpret_cast<Pixel const*>(pixels.Data()); }
+
+    Pixel* Row(unsigned y) { return Data() + static_cast<size_t>(y) * width; }
+    Pixel const* Row(unsigned y) const { return Data() + static_cast<size_t>(y) * width; }
+
+    image_view<Pixel> View() { return {Data(), width, height}; }
+    image_view<Pixel const> View() const { return {Data(), width, height}; }
+
+private:
+    FramePool* pool = nullptr;
+    unsigned width = 0;
+    unsigned height = 0;
+    FrameBlock pixels;
+};
+
+/// BGRA8 image, the format of SDR desktops, files and streams.
+using ImageBuffer = BasicImageBuffer<PixelFormat::Bgra8>;
+
+/// <summary>
+///   Converts BGRA8 pixels to <typeparamref name="Format"/>, mapping full
+///   scale to full scale. Alpha is scaled like the colors, so it saturates
+///   in formats with fewer alpha bits.
+/// </summary>
+template<PixelFormat Format>
+void ConvertFromBgra(cimage_view<uint32_t> source, image_view<PixelType<Format>> dest)
+{
+    using Traits = PixelTraits<Format>;
+    float const scale = Traits::ColorScale / 255.0f;
+    for (size_t y = 0; y < dest.height(); ++y) {
+        uint32_t const* const in = source.row(y).data();
+        PixelType<Format>* const out = dest.row(y).data();
+        for (size_t x = 0; x < dest.width(); ++x) {
+            Color const c = PixelTraits<PixelFormat::Bgra8>::ToColor(in[x]);
+            out[x] = Traits::FromColor({c.b * scale, c.g * scale, c.r * scale,
+                                        c.a * scale});
+        }
+    }
+}
+
+/// <summary>
+///   Copies <paramref name="source"/> into <paramref name="dest"/>, resampling
+///   with nearest-neighbor filtering if the sizes differ. Pixels are copied
+///   as they are, so both overloads serve every format of their size.
+/// </summary>
+void CopyImage(cimage_view<uint32_t> source, image_view<uint32_t> dest);
+void CopyImage(cimage_view<uint64_t> source, image_view<uint64_t> dest);
+
+/// Copies the pixels inside <paramref name="rects"/> between two images of
+/// the same size, leaving the rest of <paramref name="dest"/> alone.
+void CopyImageRects(cimage_view<uint32_t> source, image_view<uint32_t> dest,
+                    cspan<ImageRect> rects);
+void CopyImageRects(cimage_view<uint64_t> source, image_view<uint64_t> dest,
+                    cspan<ImageRect> rects);
+
+} // namespace gt
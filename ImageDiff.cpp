@@ -0,0 +1,246 @@
+#include "ImageDiff.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define GT_HAVE_SSE2 1
+#else
+#define GT_HAVE_SSE2 0
+#endif
+
+namespace gt
+{
+
+namespace
+{
+
+/// Brightness of a mismatching channel in the mismatch map, so that even a
+/// difference of one stands out against the black background.
+uint8_t MapValue(unsigned error)
+{
+    return static_cast<uint8_t>(std::min(255u, 64 + 4 * error));
+}
+
+/// <summary>
+///   Compares <paramref name="bytes"/> bytes of two rows made of pixels of
+///   <c>BytesPerPixel</c> 8-bit channels and adds the result to
+///   <paramref name="diff"/>. <paramref name="map"/> may be null.
+/// </summary>
+template<unsigned BytesPerPixel>
+void DiffRow(uint8_t const* a, uint8_t const* b, uint8_t* map, size_t bytes,
+             unsigned tolerance, ImageDiff& diff)
+{
+    static_assert(BytesPerPixel == 1 || BytesPerPixel == 4);
+    size_t i = 0;
+
+#if GT_HAVE_SSE2
+    // Squares of up to 255 summed four at a time per 32-bit lane overflow
+    // after 16512 vectors; flush well before that.
+    constexpr size_t FlushInterval = 4096 * sizeof(__m128i);
+
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const allOnes = _mm_cmpeq_epi8(zero, zero);
+    __m128i const toleranceVector =
+        _mm_set1_epi8(static_cast<char>(std::min(tolerance, 255u)));
+    __m128i const mapBase = _mm_set1_epi8(64);
+    __m128i maxError = zero;
+
+    size_t const vectorBytes = bytes & ~(sizeof(__m128i) - 1);
+    while (i < vectorBytes) {
+        size_t const batchEnd = std::min(vectorBytes, i + FlushInterval);
+        __m128i squares = zero;
+        for (; i < batchEnd; i += sizeof(__m128i)) {
+            __m128i const va = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a + i));
+            __m128i const vb = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b + i));
+            __m128i const error =
+                _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+            maxError = _mm_max_epu8(maxError, error);
+
+            __m128i const lo = _mm_unpacklo_epi8(error, zero);
+            __m128i const hi = _mm_unpackhi_epi8(error, zero);
+            squares = _mm_add_epi32(
+                squares, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+
+            // A pixel mismatches if any of its channels exceeds the tolerance.
+            __m128i const within =
+                _mm_cmpeq_epi8(_mm_subs_epu8(error, toleranceVector), zero);
+            __m128i const pixelWithin =
+                BytesPerPixel == 4 ? _mm_cmpeq_epi32(within, allOnes) : within;
+            __m128i const mismatch = _mm_xor_si128(pixelWithin, allOnes);
+            int const mask = _mm_movemask_epi8(mismatch);
+            diff.mismatches += std::popcount(static_cast<unsigned>(mask)) / BytesPerPixel;
+
+            if (map) {
+                // 64 + 4 * error, saturated, where the pixel mismatches.
+                __m128i const twice = _mm_adds_epu8(error, error);
+                __m128i const value =
+                    _mm_adds_epu8(mapBase, _mm_adds_epu8(twice, twice));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(map + i),
+                                 _mm_and_si128(value, mismatch));
+            }
+        }
+
+        alignas(16) uint32_t lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), squares);
+        diff.sumSquaredError += uint64_t(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    }
+
+    alignas(16) uint8_t maxLanes[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(maxLanes), maxError);
+    for (uint8_t const lane : maxLanes)
+        diff.maxError = std::max<unsigned>(diff.maxError, lane);
+#endif
+
+    for (; i < bytes; i += BytesPerPixel) {
+        unsigned errors[BytesPerPixel];
+        bool mismatch = false;
+        for (unsigned c = 0; c < BytesPerPixel; ++c) {
+            errors[c] = static_cast<unsigned>(std::abs(int(a[i + c]) - int(b[i + c])));
+            diff.maxError = std::max(diff.maxError, errors[c]);
+            diff.sumSquaredError += errors[c] * errors[c];
+            mismatch |= errors[c] > tolerance;
+        }
+        diff.mismatches += mismatch;
+
+        if (map) {
+            for (unsigned c = 0; c < BytesPerPixel; ++c)
+                map[i + c] = mismatch ? MapValue(errors[c]) : 0;
+        }
+    }
+
+    diff.pixels += bytes / BytesPerPixel;
+    diff.samples += bytes;
+}
+
+template<unsigned BytesPerPixel, typename Pixel>
+ImageDiff DiffViews(cimage_view<Pixel> a, cimage_view<Pixel> b, unsigned tolerance,
+                    image_view<Pixel> mismatchMap)
+{
+    assert(a.width() == b.width() && a.height() == b.height() && "Image sizes differ");
+    assert((mismatchMap.empty() ||
+            (mismatchMap.width() == a.width() && mismatchMap.height() == a.height())) &&
+           "Mismatch map size differs");
+
+    ImageDiff diff;
+    for (size_t y = 0; y < a.height(); ++y) {
+        uint8_t* const map =
+            mismatchMap.empty() ? nullptr
+                                : reinterpret_cast<uint8_t*>(mismatchMap.row(y).data());
+        DiffRow<BytesPerPixel>(reinterpret_cast<uint8_t const*>(a.row(y).data()),
+                               reinterpret_cast<uint8_t const*>(b.row(y).data()), map,
+                               a.row_size_bytes(), tolerance, diff);
+    }
+    return diff;
+}
+
+/// Errors of a channel of <typeparamref name="Format"/> in units of its last
+/// bit; the traits give packed channels in those units already.
+template<PixelFormat Format>
+constexpr float ErrorUnits = PixelTraits<Format>::ColorScale == 1.0f ? 2048.0f : 1.0f;
+
+} // namespace
+
+double ImageDiff::GetMeanSquaredError() const
+{
+    return samples ? static_cast<double>(sumSquaredError) / samples : 0.0;
+}
+
+double ImageDiff::GetPsnr() const
+{
+    double const mse = GetMeanSquaredError();
+    if (mse == 0.0)
+        return std::numeric_limits<double>::infinity();
+    return 10.0 * std::log10(peak * peak / mse);
+}
+
+void ImageDiff::Merge(ImageDiff const& other)
+{
+    pixels += other.pixels;
+    samples += other.samples;
+    mismatches += other.mismatches;
+    maxError = std::max(maxError, other.maxError);
+    sumSquaredError += other.sumSquaredError;
+}
+
+ImageDiff DiffImages(cimage_view<uint32_t> a, cimage_view<uint32_t> b, unsigned tolerance,
+                     image_view<uint32_t> mismatchMap)
+{
+    return DiffViews<4>(a, b, tolerance, mismatchMap);
+}
+
+ImageDiff DiffImages(cimage_view<uint8_t> a, cimage_view<uint8_t> b, unsigned tolerance,
+                     image_view<uint8_t> mismatchMap)
+{
+    return DiffViews<1>(a, b, tolerance, mismatchMap);
+}
+
+template<PixelFormat Format>
+ImageDiff DiffImages(cimage_view<PixelType<Format>> a, cimage_view<PixelType<Format>> b,
+                     unsigned tolerance, image_view<uint32_t> mismatchMap)
+{
+    using Traits = PixelTraits<Format>;
+    assert(a.width() == b.width() && a.height() == b.height() && "Image sizes differ");
+    assert((mismatchMap.empty() ||
+            (mismatchMap.width() == a.width() && mismatchMap.height() == a.height())) &&
+           "Mismatch map size differs");
+
+    ImageDiff diff;
+    diff.peak = Traits::ColorScale * ErrorUnits<Format>;
+    for (size_t y = 0; y < a.height(); ++y) {
+        auto const rowA = a.row(y);
+        auto const rowB = b.row(y);
+        uint32_t* const map = mismatchMap.empty() ? nullptr : mismatchMap.row(y).data();
+        for (size_t x = 0; x < a.width(); ++x) {
+            // Most pixels of a passing comparison are identical; decoding
+            // them would only add zeros.
+            if (rowA[x] == rowB[x]) {
+                if (map)
+                    map[x] = 0;
+                continue;
+            }
+
+            Color const ca = Traits::ToColor(rowA[x]);
+            Color const cb = Traits::ToColor(rowB[x]);
+            float const channelsA[] = {ca.b, ca.g, ca.r, ca.a};
+            float const channelsB[] = {cb.b, cb.g, cb.r, cb.a};
+
+            unsigned errors[4];
+            bool mismatch = false;
+            for (unsigned c = 0; c < 4; ++c) {
+                float const error = std::abs(channelsA[c] - channelsB[c]);
+                errors[c] = static_cast<unsigned>(std::ceil(error * ErrorUnits<Format>));
+                diff.maxError = std::max(diff.maxError, errors[c]);
+                diff.sumSquaredError += uint64_t(errors[c]) * errors[c];
+                mismatch |= errors[c] > tolerance;
+            }
+            diff.mismatches += mismatch;
+
+            if (map) {
+                map[x] = 0;
+                for (unsigned c = 0; mismatch && c < 4; ++c)
+                    map[x] |= uint32_t(MapValue(errors[c])) << (c * 8);
+            }
+        }
+        diff.pixels += a.width();
+        diff.samples += a.width() * 4;
+    }
+    return diff;
+}
+
+#define GT_INSTANTIATE_DIFF(Format)                                                      \
+    template ImageDiff DiffImages<Format>(cimage_view<PixelType<Format>>,               \
+                                          cimage_view<PixelType<Format>>, unsigned,     \
+                                          image_view<uint32_t>);
+
+GT_INSTANTIATE_DIFF(PixelFormat::Rgb10A2)
+GT_INSTANTIATE_DIFF(PixelFormat::Rgba16)
+GT_INSTANTIATE_DIFF(PixelFormat::Rgba16F)
+
+#undef GT_INSTANTIATE_DIFF
+
+} // namespace gt
@@ -0,0 +1,60 @@
+#pragma once
+#include "PixelFormat.h"
+#include "Span.h"
+
+#include <cstdint>
+
+namespace gt
+{
+
+/// <summary>
+///   Differences between two images of the same size, measured per 8-bit
+///   channel. Results of several comparisons can be merged, e.g. all frames
+///   of a burst or the three planes of a 4:2:0 image.
+/// </summary>
+struct ImageDiff
+{
+    uint64_t pixels = 0;
+    uint64_t samples = 0;
+    /// Pixels with at least one channel differing by more than the tolerance.
+    uint64_t mismatches = 0;
+    /// Largest difference of any channel.
+    unsigned maxError = 0;
+    uint64_t sumSquaredError = 0;
+    /// Full scale of a channel in the units of the errors, for the PSNR.
+    double peak = 255.0;
+
+    double GetMeanSquaredError() const;
+
+    /// Peak signal-to-noise ratio in dB, infinite for identical images.
+    double GetPsnr() const;
+
+    void Merge(ImageDiff const& other);
+};
+
+/// <summary>
+///   Compares two BGRA8 images. If <paramref name="mismatchMap"/> is not
+///   empty, it receives a black image with the mismatching pixels lit up in
+///   proportion to their per-channel difference. All views must have the same
+///   size, but may have any row pitch.
+/// </summary>
+ImageDiff DiffImages(cimage_view<uint32_t> a, cimage_view<uint32_t> b, unsigned tolerance,
+                     image_view<uint32_t> mismatchMap = {});
+
+/// Same as above for single-channel images such as the planes of a
+/// <see cref="YuvImage"/>.
+ImageDiff DiffImages(cimage_view<uint8_t> a, cimage_view<uint8_t> b, unsigned tolerance,
+                     image_view<uint8_t> mismatchMap = {});
+
+/// <summary>
+///   Compares two frames of a deeper <see cref="PixelFormat"/> channel by
+///   channel, with errors in units of the last bit of its channels: 1/1023 for
+///   RGB10A2 colors, 1/65535 for RGBA16 and 1/2048 for half floats, their
+///   spacing just below 1. The mismatch map, if given, is BGRA8 like the
+///   one of the overload above.
+/// </summary>
+template<PixelFormat Format>
+ImageDiff DiffImages(cimage_view<PixelType<Format>> a, cimage_view<PixelType<Format>> b,
+                     unsigned tolerance, image_view<uint32_t> mismatchMap = {});
+
+} // namespace gt
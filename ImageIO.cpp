@@ -0,0 +1,598 @@
+#include "ImageIO.h"
+
+#include "ErrorHandling.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace gt
+{
+
+namespace
+{
+
+HRESULT ReadWholeFile(char const* path, std::vector<uint8_t>& contents)
+{
+    FILE* file = OpenStream(path, "rb");
+    if (!file)
+        return E_ACCESSDENIED;
+
+    contents.clear();
+    uint8_t chunk[64 * 1024];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        contents.insert(contents.end(), chunk, chunk + read);
+
+    bool const failed = ferror(file) != 0;
+    CloseStream(file);
+    return failed ? E_FAIL : S_OK;
+}
+
+uint32_t ReadLE(uint8_t const* data, size_t size)
+{
+    uint32_t value = 0;
+    for (size_t i = 0; i < size; ++i)
+        value |= static_cast<uint32_t>(data[i]) << (8 * i);
+    return value;
+}
+
+HRESULT DecodeBmp(std::vector<uint8_t> const& file, ImageBuffer& image)
+{
+    constexpr size_t FileHeaderSize = 14;
+    constexpr size_t InfoHeaderSize = 40;
+    constexpr uint32_t CompressionRgb = 0;
+    constexpr uint32_t CompressionBitFields = 3;
+
+    if (file.size() < FileHeaderSize + InfoHeaderSize)
+        return E_INVALIDARG;
+
+    uint8_t const* info = file.data() + FileHeaderSize;
+    uint32_t const pixelOffset = ReadLE(file.data() + 10, 4);
+    int32_t const width = static_cast<int32_t>(ReadLE(info + 4, 4));
+    int32_t const height = static_cast<int32_t>(ReadLE(info + 8, 4));
+    uint32_t const bitCount = ReadLE(info + 14, 2);
+    uint32_t const compression = ReadLE(info + 16, 4);
+
+    if (width <= 0 || height == 0 || (bitCount != 24 && bitCount != 32))
+        return E_INVALIDARG;
+    if (compression != CompressionRgb &&
+        !(compression == CompressionBitFields && bitCount == 32))
+        return E_INVALIDARG;
+
+    // Rows are stored bottom-up unless the height is negative.
+    bool const topDown = height < 0;
+    unsigned const w = static_cast<unsigned>(width);
+    unsigned const h = static_cast<unsigned>(topDown ? -height : height);
+    unsigned const bytesPerPixel = bitCount / 8;
+    size_t const stride = (static_cast<size_t>(w) * bytesPerPixel + 3) & ~size_t(3);
+
+    if (pixelOffset > file.size() || (file.size() - pixelOffset) / stride < h)
+        return E_INVALIDARG;
+
+    image.Resize(w, h);
+    for (unsigned y = 0; y < h; ++y) {
+        size_t const row = topDown ? y : h - 1 - y;
+        uint8_t const* src = file.data() + pixelOffset + stride * row;
+        uint32_t* dst = image.Row(y);
+        for (unsigned x = 0; x < w; ++x, src += bytesPerPixel)
+            dst[x] = src[0] | (src[1] << 8) | (src[2] << 16) | 0xFF000000u;
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+///   Parses a binary PPM header: "P6" width height maxval, separated by
+///   whitespace and comments, followed by a single whitespace byte. Returns
+///   the offset of the pixels in <paramref name="dataOffset"/>.
+/// </summary>
+HRESULT ParsePpmHeader(uint8_t const* data, size_t size, unsigned& width,
+                       unsigned& height, size_t& dataOffset)
+{
+    if (size < 2 || data[0] != 'P' || data[1] != '6')
+        return E_INVALIDARG;
+
+    size_t pos = 2;
+    unsigned fields[3] = {};
+    for (unsigned& field : fields) {
+        for (;;) {
+            while (pos < size && std::isspace(data[pos]))
+                ++pos;
+            if (pos < size && data[pos] == '#') {
+                while (pos < size && data[pos] != '\n')
+                    ++pos;
+                continue;
+            }
+            break;
+        }
+
+        if (pos >= size || !std::isdigit(data[pos]))
+            return E_INVALIDARG;
+        while (pos < size && std::isdigit(data[pos]))
+            field = field * 10 + (data[pos++] - '0');
+    }
+    ++pos;
+
+    width = fields[0];
+    height = fields[1];
+    dataOffset = pos;
+    if (width == 0 || height == 0 || fields[2] != 255 || pos > size)
+        return E_INVALIDARG;
+    return S_OK;
+}
+
+/// Converts PPM pixels to opaque BGRA.
+void ConvertRgbToBgra(uint8_t const* src, uint32_t* dst, size_t count)
+{
+    for (size_t x = 0; x < count; ++x, src += 3)
+        dst[x] = src[2] | (src[1] << 8) | (src[0] << 16) | 0xFF000000u;
+}
+
+HRESULT DecodePpm(std::vector<uint8_t> const& file, ImageBuffer& image)
+{
+    unsigned w;
+    unsigned h;
+    size_t pos;
+    HR(ParsePpmHeader(file.data(), file.size(), w, h, pos));
+    if ((file.size() - pos) / 3 / w < h)
+        return E_INVALIDARG;
+
+    image.Resize(w, h);
+    uint8_t const* src = file.data() + pos;
+    for (unsigned y = 0; y < h; ++y, src += size_t(w) * 3)
+        ConvertRgbToBgra(src, image.Row(y), w);
+
+    return S_OK;
+}
+
+/// Moves to a byte offset of a file that may be larger than 2 GiB.
+HRESULT SeekStream(FILE* file, uint64_t offset)
+{
+#ifdef _WIN32
+    int const result = _fseeki64(file, static_cast<__int64>(offset), SEEK_SET);
+#else
+    int const result = fseeko(file, static_cast<off_t>(offset), SEEK_SET);
+#endif
+    return result == 0 ? S_OK : E_FAIL;
+}
+
+HRESULT WriteBytes(FILE* file, void const* data, size_t size)
+{
+    if (fwrite(data, 1, size, file) != size)
+        return E_FAIL;
+    return S_OK;
+}
+
+/// Returns S_FALSE if the stream ends before the first byte, and E_FAIL if it
+/// ends within the data.
+HRESULT ReadBytes(FILE* file, void* data, size_t size)
+{
+    size_t const read = fread(data, 1, size, file);
+    if (read == size)
+        return S_OK;
+    return read == 0 && feof(file) ? S_FALSE : E_FAIL;
+}
+
+/// Reads up to and including the next newline. Y4M headers are short.
+HRESULT ReadLine(FILE* file, std::string& line)
+{
+    constexpr size_t MaxLineLength = 1024;
+
+    line.clear();
+    for (int c; (c = fgetc(file)) != '\n';) {
+        if (c == EOF)
+            return line.empty() && feof(file) ? S_FALSE : E_FAIL;
+        if (line.size() == MaxLineLength)
+            return E_INVALIDARG;
+        line.push_back(static_cast<char>(c));
+    }
+    return S_OK;
+}
+
+uint8_t ClampByte(int value)
+{
+    return static_cast<uint8_t>(std::clamp(value, 0, 255));
+}
+
+} // namespace
+
+FILE* OpenStream(char const* path, char const* mode)
+{
+    if (std::strcmp(path, "-") == 0) {
+        FILE* const file = std::strchr(mode, 'r') ? stdin : stdout;
+#ifdef _WIN32
+        _setmode(_fileno(file), _O_BINARY);
+#endif
+        return file;
+    }
+
+#ifdef _WIN32
+    FILE* file = nullptr;
+    if (fopen_s(&file, path, mode) != 0)
+        return nullptr;
+    return file;
+#else
+    return fopen(path, mode);
+#endif
+}
+
+void CloseStream(FILE* file)
+{
+    if (file && file != stdin && file != stdout)
+        fclose(file);
+    else if (file)
+        fflush(file);
+}
+
+HRESULT LoadImageFile(char const* path, ImageBuffer& image)
+{
+    std::vector<uint8_t> file;
+    HR(ReadWholeFile(path, file));
+
+    if (file.size() >= 2 && file[0] == 'B' && file[1] == 'M')
+        return DecodeBmp(file, image);
+    if (file.size() >= 2 && file[0] == 'P' && file[1] == '6')
+        return DecodePpm(file, image);
+
+    return E_INVALIDARG;
+}
+
+HRESULT SavePpmFile(char const* path, cimage_view<uint32_t> image)
+{
+    ImageFileWriter writer;
+    HR(writer.Create(path, ImageFileFormat::Ppm, static_cast<unsigned>(image.width()),
+                     static_cast<unsigned>(image.height())));
+    HR(writer.WriteRows(image));
+    return writer.Close();
+}
+
+ImageFileReader::~ImageFileReader()
+{
+    CloseStream(file);
+}
+
+HRESULT ImageFileReader::Open(char const* path, ImageFileFormat newFormat,
+                              unsigned newWidth, unsigned newHeight)
+{
+    if (file)
+        return E_UNEXPECTED;
+
+    // Parts are read at any offset, so the input cannot be a pipe.
+    if (std::strcmp(path, "-") == 0)
+        return E_INVALIDARG;
+    file = OpenStream(path, "rb");
+    if (!file)
+        return E_ACCESSDENIED;
+    setvbuf(file, nullptr, _IOFBF, 1 << 20);
+
+    format = newFormat;
+    if (format == ImageFileFormat::Ppm) {
+        uint8_t header[4096];
+        size_t const size = fread(header, 1, sizeof(header), file);
+        size_t offset;
+        HR(ParsePpmHeader(header, size, width, height, offset));
+        dataOffset = offset;
+    } else {
+        if (newWidth == 0 || newHeight == 0)
+            return E_INVALIDARG;
+        width = newWidth;
+        height = newHeight;
+        dataOffset = 0;
+    }
+
+    position = UINT64_MAX;
+    return S_OK;
+}
+
+HRESULT ImageFileReader::ReadSpan(unsigned x, unsigned y, unsigned count, uint32_t* dest)
+{
+    if (!file || x > width || count > width - x || y >= height)
+        return E_INVALIDARG;
+
+    size_t const bytesPerPixel = format == ImageFileFormat::Ppm ? 3 : 4;
+    uint64_t const offset = dataOffset + (uint64_t(y) * width + x) * bytesPerPixel;
+    if (offset != position)
+        HR(SeekStream(file, offset));
+    position = UINT64_MAX;
+
+    size_t const bytes = count * bytesPerPixel;
+    if (format == ImageFileFormat::RawBgra) {
+        if (ReadBytes(file, dest, bytes) != S_OK)
+            return E_FAIL;
+    } else {
+        scratch.resize(bytes);
+        if (ReadBytes(file, scratch.data(), bytes) != S_OK)
+            return E_FAIL;
+        ConvertRgbToBgra(scratch.data(), dest, count);
+    }
+
+    position = offset + bytes;
+    return S_OK;
+}
+
+ImageFileWriter::~ImageFileWriter()
+{
+    Close();
+}
+
+HRESULT ImageFileWriter::Create(char const* path, ImageFileFormat newFormat,
+                                unsigned newWidth, unsigned newHeight)
+{
+    if (file)
+        return E_UNEXPECTED;
+
+    file = OpenStream(path, "wb");
+    if (!file)
+        return E_ACCESSDENIED;
+
+    format = newFormat;
+    width = newWidth;
+    height = newHeight;
+    rowsWritten = 0;
+    result = S_OK;
+    if (format == ImageFileFormat::Ppm &&
+        fprintf(file, "P6\n%u %u\n255\n", width, height) < 0) {
+        result = E_FAIL;
+    }
+    return result;
+}
+
+HRESULT ImageFileWriter::WriteRows(cimage_view<uint32_t> rows)
+{
+    if (!file || rows.width() != width || rows.height() > height - rowsWritten)
+        return E_INVALIDARG;
+
+    for (size_t y = 0; y < rows.height() && SUCCEEDED(result); ++y) {
+        if (format == ImageFileFormat::RawBgra) {
+            result = WriteBytes(file, rows.row(y).data(), rows.row(y).size_bytes());
+            continue;
+        }
+
+        scratch.resize(size_t(width) * 3);
+        uint8_t* dst = scratch.data();
+        for (uint32_t const pixel : rows.row(y)) {
+            *dst++ = static_cast<uint8_t>(pixel >> 16);
+            *dst++ = static_cast<uint8_t>(pixel >> 8);
+            *dst++ = static_cast<uint8_t>(pixel);
+        }
+        result = WriteBytes(file, scratch.data(), scratch.size());
+    }
+    rowsWritten += static_cast<unsigned>(rows.height());
+    return result;
+}
+
+HRESULT ImageFileWriter::Close()
+{
+    if (!file)
+        return result;
+
+    if (SUCCEEDED(result) && rowsWritten != height)
+        result = E_UNEXPECTED;
+    if (fflush(file) != 0)
+        result = E_FAIL;
+    CloseStream(file);
+    file = nullptr;
+    return result;
+}
+
+void ConvertBgraToI420(ImageBuffer const& source, YuvImage& dest)
+{
+    unsigned const width = source.Width();
+    unsigned const height = source.Height();
+    if (dest.Width() != width || dest.Height() != height)
+        dest.Resize(width, height);
+
+    unsigned const chromaWidth = dest.ChromaWidth();
+    uint8_t* const yPlane = dest.Plane(YuvPlane::Y);
+    uint8_t* const uPlane = dest.Plane(YuvPlane::U);
+    uint8_t* const vPlane = dest.Plane(YuvPlane::V);
+
+    for (unsigned y = 0; y < height; ++y) {
+        uint32_t const* src = source.Row(y);
+        uint8_t* dst = yPlane + static_cast<size_t>(y) * width;
+        for (unsigned x = 0; x < width; ++x) {
+            int const b = src[x] & 0xFF;
+            int const g = (src[x] >> 8) & 0xFF;
+            int const r = (src[x] >> 16) & 0xFF;
+            dst[x] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        }
+    }
+
+    for (unsigned cy = 0; cy < dest.ChromaHeight(); ++cy) {
+        uint32_t const* row0 = source.Row(2 * cy);
+        uint32_t const* row1 = source.Row(std::min(2 * cy + 1, height - 1));
+        uint8_t* u = uPlane + static_cast<size_t>(cy) * chromaWidth;
+        uint8_t* v = vPlane + static_cast<size_t>(cy) * chromaWidth;
+
+        for (unsigned cx = 0; cx < chromaWidth; ++cx) {
+            unsigned const x0 = 2 * cx;
+            unsigned const x1 = std::min(x0 + 1, width - 1);
+            uint32_t const quad[4] = {row0[x0], row0[x1], row1[x0], row1[x1]};
+
+            int b = 0, g = 0, r = 0;
+            for (uint32_t const pixel : quad) {
+                b += pixel & 0xFF;
+                g += (pixel >> 8) & 0xFF;
+                r += (pixel >> 16) & 0xFF;
+            }
+            b = (b + 2) >> 2;
+            g = (g + 2) >> 2;
+            r = (r + 2) >> 2;
+
+            u[cx] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            v[cx] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+}
+
+void ConvertI420ToBgra(YuvImage const& source, ImageBuffer& dest)
+{
+    unsigned const width = source.Width();
+    unsigned const height = source.Height();
+    if (dest.Width() != width || dest.Height() != height)
+        dest.Resize(width, height);
+
+    unsigned const chromaWidth = source.ChromaWidth();
+    uint8_t const* const yPlane = source.Plane(YuvPlane::Y);
+    uint8_t const* const uPlane = source.Plane(YuvPlane::U);
+    uint8_t const* const vPlane = source.Plane(YuvPlane::V);
+
+    for (unsigned y = 0; y < height; ++y) {
+        uint8_t const* luma = yPlane + static_cast<size_t>(y) * width;
+        uint8_t const* u = uPlane + static_cast<size_t>(y / 2) * chromaWidth;
+        uint8_t const* v = vPlane + static_cast<size_t>(y / 2) * chromaWidth;
+        uint32_t* dst = dest.Row(y);
+
+        for (unsigned x = 0; x < width; ++x) {
+            int const c = 298 * (luma[x] - 16) + 128;
+            int const d = u[x / 2] - 128;
+            int const e = v[x / 2] - 128;
+
+            uint32_t const r = ClampByte((c + 409 * e) >> 8);
+            uint32_t const g = ClampByte((c - 100 * d - 208 * e) >> 8);
+            uint32_t const b = ClampByte((c + 516 * d) >> 8);
+            dst[x] = b | (g << 8) | (r << 16) | 0xFF000000u;
+        }
+    }
+}
+
+HRESULT RawFrameReader::ReadFrame(ImageBuffer& frame)
+{
+    if (frame.Width() != width || frame.Height() != height)
+        frame.Resize(width, height);
+
+    return ReadBytes(file, frame.Data(), frame.SizeBytes());
+}
+
+HRESULT Y4mFrameReader::ReadHeader()
+{
+    std::string line;
+    if (ReadLine(file, line) != S_OK || line.rfind("YUV4MPEG2", 0) != 0)
+        return E_INVALIDARG;
+
+    // Parameters are single-letter tags followed by a value. Interlacing,
+    // aspect ratio and extensions do not matter for a per-frame effect.
+    size_t pos = 9;
+    while (pos < line.size()) {
+        size_t const end = std::min(line.find(' ', pos + 1), line.size());
+        std::string const token = line.substr(pos + 1, end - pos - 1);
+        pos = end;
+        if (token.empty())
+            continue;
+
+        std::string const value = token.substr(1);
+        switch (token[0]) {
+        case 'W':
+            width = static_cast<unsigned>(strtoul(value.c_str(), nullptr, 10));
+            break;
+        case 'H':
+            height = static_cast<unsigned>(strtoul(value.c_str(), nullptr, 10));
+            break;
+        case 'F': {
+            char* end = nullptr;
+            frameRate.numerator = static_cast<unsigned>(strtoul(value.c_str(), &end, 10));
+            if (*end != ':')
+                return E_INVALIDARG;
+            frameRate.denominator = static_cast<unsigned>(strtoul(end + 1, nullptr, 10));
+            if (frameRate.numerator == 0 || frameRate.denominator == 0)
+                return E_INVALIDARG;
+            break;
+        }
+        case 'C':
+            // Only 8-bit 4:2:0; the variants differ in chroma siting only.
+            if (value != "420" && value != "420jpeg" && value != "420paldv" &&
+                value != "420mpeg2")
+                return E_NOTIMPL;
+            break;
+        }
+    }
+
+    if (width == 0 || height == 0)
+        return E_INVALIDARG;
+
+    return S_OK;
+}
+
+HRESULT Y4mFrameReader::ReadFrame(ImageBuffer& frame)
+{
+    HRESULT const hr = ReadFrame(planes);
+    if (hr != S_OK)
+        return hr;
+
+    ConvertI420ToBgra(planes, frame);
+    return S_OK;
+}
+
+HRESULT Y4mFrameReader::ReadFrame(YuvImage& frame)
+{
+    if (width == 0)
+        return E_UNEXPECTED;
+
+    std::string line;
+    HRESULT const hr = ReadLine(file, line);
+    if (hr != S_OK)
+        return hr;
+    if (line.rfind("FRAME", 0) != 0)
+        return E_INVALIDARG;
+
+    // The frame layout of Y4M is exactly the I420 layout of YuvImage.
+    if (frame.Width() != width || frame.Height() != height)
+        frame.Resize(width, height);
+    HR(ReadBytes(file, frame.Data(), frame.SizeBytes()) == S_OK ? S_OK : E_FAIL);
+    return S_OK;
+}
+
+HRESULT RawFrameWriter::WriteFrame(ImageBuffer const& frame)
+{
+    return WriteBytes(file, frame.Data(), frame.SizeBytes());
+}
+
+HRESULT Y4mFrameWriter::WriteFrame(ImageBuffer const& frame)
+{
+    ConvertBgraToI420(frame, planes);
+    return WriteFrame(planes);
+}
+
+HRESULT Y4mFrameWriter::WriteFrame(YuvImage const& frame)
+{
+    if (width == 0) {
+        width = frame.Width();
+        height = frame.Height();
+
+        std::string const header =
+            "YUV4MPEG2 W" + std::to_string(width) + " H" + std::to_string(height) +
+            " F" + std::to_string(frameRate.numerator) + ":" +
+            std::to_string(frameRate.denominator) + " Ip A1:1 C420jpeg\n";
+        HR(WriteBytes(file, header.data(), header.size()));
+    }
+
+    if (frame.Width() != width || frame.Height() != height)
+        return E_INVALIDARG;
+
+    static char const frameHeader[] = "FRAME\n";
+    HR(WriteBytes(file, frameHeader, sizeof(frameHeader) - 1));
+    HR(WriteBytes(file, frame.Data(), frame.SizeBytes()));
+    return S_OK;
+}
+
+std::unique_ptr<IFrameSink> CreateFrameWriter(StreamFormat format, FILE* file,
+                                              FrameRate frameRate)
+{
+    switch (format) {
+    case StreamFormat::RawBgra:
+        return std::make_unique<RawFrameWriter>(file);
+    case StreamFormat::Y4m:
+        return std::make_unique<Y4mFrameWriter>(file, frameRate);
+    }
+    return nullptr;
+}
+
+} // namespace gt
@@ -0,0 +1,260 @@
+#pragma once
+#include "FrameSink.h"
+#include "ImageBuffer.h"
+#include "Platform.h"
+#include "YuvImage.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace gt
+{
+
+/// <summary>
+///   Opens a file with <c>fopen</c> semantics. The path "-" stands for
+///   stdin or stdout (depending on <paramref name="mode"/>), switched to
+///   binary mode.
+/// </summary>
+FILE* OpenStream(char const* path, char const* mode);
+
+/// Closes a stream from <see cref="OpenStream"/>. Standard streams are only
+/// flushed.
+void CloseStream(FILE* file);
+
+/// <summary>
+///   Loads an uncompressed 24/32-bit BMP or a binary PPM (P6) file. Alpha is
+///   always opaque, like captured desktop frames.
+/// </summary>
+HRESULT LoadImageFile(char const* path, ImageBuffer& image);
+
+/// Saves BGRA8 pixels as a binary PPM (P6) file, dropping alpha.
+HRESULT SavePpmFile(char const* path, cimage_view<uint32_t> image);
+
+/// File formats of images read or written a few rows at a time.
+enum class ImageFileFormat
+{
+    /// Binary PPM (P6). Alpha is opaque when read and dropped when written.
+    Ppm,
+    /// Tightly packed BGRA8 pixels without any header.
+    RawBgra,
+};
+
+/// <summary>
+///   Reads parts of a binary PPM or raw BGRA8 file without loading the rest
+///   of it, for images too large for memory. Reads in file order only move
+///   forward through the file; any other read seeks.
+/// </summary>
+class ImageFileReader
+{
+public:
+    ImageFileReader() = default;
+    ~ImageFileReader();
+
+    ImageFileReader(ImageFileReader const&) = delete;
+    ImageFileReader& operator=(ImageFileReader const&) = delete;
+
+    /// Opens a PPM file, or a raw file of <paramref name="width"/> x
+    /// <paramref name="height"/>, which PPM files ignore.
+    HRESULT Open(char const* path, ImageFileFormat format, unsigned width = 0,
+                 unsigned height = 0);
+
+    unsigned Width() const { return width; }
+    unsigned Height() const { return height; }
+
+    /// Reads pixels [x, x + count) of row y into <paramref name="dest"/>.
+    HRESULT ReadSpan(unsigned x, unsigned y, unsigned count, uint32_t* dest);
+
+private:
+    FILE* file = nullptr;
+    ImageFileFormat format = ImageFileFormat::Ppm;
+    unsigned width = 0;
+    unsigned height = 0;
+    uint64_t dataOffset = 0;
+    /// Offset the next read starts at without seeking.
+    uint64_t position = 0;
+    std::vector<uint8_t> scratch;
+};
+
+/// <summary>
+///   Writes a binary PPM or raw BGRA8 file a few rows at a time, from the top,
+///   so that no more than those rows need to be in memory.
+/// </summary>
+class ImageFileWriter
+{
+public:
+    ImageFileWriter() = default;
+    ~ImageFileWriter();
+
+    ImageFileWriter(ImageFileWriter const&) = delete;
+    ImageFileWriter& operator=(ImageFileWriter const&) = delete;
+
+    HRESULT Create(char const* path, ImageFileFormat format, unsigned width,
+                   unsigned height);
+
+    /// Appends the next rows, which must have the width of the image.
+    HRESULT WriteRows(cimage_view<uint32_t> rows);
+
+    /// Flushes and closes the file. Fails if it did not get every row or a
+    /// write failed.
+    HRESULT Close();
+
+private:
+    FILE* file = nullptr;
+    ImageFileFormat format = ImageFileFormat::Ppm;
+    unsigned width = 0;
+    unsigned height = 0;
+    unsigned rowsWritten = 0;
+    HRESULT result = S_OK;
+    std::vector<uint8_t> scratch;
+};
+
+/// <summary>
+///   Converts BGRA to 8-bit 4:2:0 Y'CbCr (BT.601, limited range), resizing
+///   <paramref name="dest"/> if necessary. Chroma is the average of each 2x2
+///   block, sited at the block center.
+/// </summary>
+void ConvertBgraToI420(ImageBuffer const& source, YuvImage& dest);
+
+/// <summary>
+///   Inverse of <see cref="ConvertBgraToI420"/>. Each chroma sample is
+///   replicated to its 2x2 block; alpha is opaque.
+/// </summary>
+void ConvertI420ToBgra(YuvImage const& source, ImageBuffer& dest);
+
+enum class StreamFormat
+{
+    /// Tightly packed BGRA8 frames without any header.
+    RawBgra,
+    /// YUV4MPEG2 stream with 4:2:0 frames.
+    Y4m,
+};
+
+struct FrameRate
+{
+    unsigned numerator = 60;
+    unsigned denominator = 1;
+};
+
+/// <summary>Reads a sequence of frames from a file or pipe.</summary>
+template<typename Frame>
+class IBasicFrameReader
+{
+public:
+    virtual ~IBasicFrameReader() {}
+
+    /// Size of all frames in the stream.
+    virtual void GetSize(unsigned& width, unsigned& height) const = 0;
+    virtual FrameRate GetFrameRate() const = 0;
+
+    /// <summary>
+    ///   Reads the next frame into <paramref name="frame"/>, resizing it if
+    ///   necessary. Returns S_FALSE at the end of the stream.
+    /// </summary>
+    virtual HRESULT ReadFrame(Frame& frame) = 0;
+};
+
+using IFrameReader = IBasicFrameReader<ImageBuffer>;
+using IYuvFrameReader = IBasicFrameReader<YuvImage>;
+
+/// <summary>Reads raw BGRA8 frames of a size given up front.</summary>
+class RawFrameReader : public IFrameReader
+{
+public:
+    RawFrameReader(FILE* file, unsigned width, unsigned height, FrameRate frameRate = {})
+        : file(file)
+        , width(width)
+        , height(height)
+        , frameRate(frameRate)
+    {}
+
+    void GetSize(unsigned& outWidth, unsigned& outHeight) const override
+    {
+        outWidth = width;
+        outHeight = height;
+    }
+
+    FrameRate GetFrameRate() const override { return frameRate; }
+    HRESULT ReadFrame(ImageBuffer& frame) override;
+
+private:
+    FILE* file;
+    unsigned width;
+    unsigned height;
+    FrameRate frameRate;
+};
+
+/// <summary>
+///   Reads a YUV4MPEG2 stream with 4:2:0 frames, either as they are or
+///   converted to BGRA8. <see cref="ReadHeader"/> must succeed before frames
+///   can be read.
+/// </summary>
+class Y4mFrameReader : public IFrameReader, public IYuvFrameReader
+{
+public:
+    explicit Y4mFrameReader(FILE* file)
+        : file(file)
+    {}
+
+    HRESULT ReadHeader();
+
+    void GetSize(unsigned& outWidth, unsigned& outHeight) const override
+    {
+        outWidth = width;
+        outHeight = height;
+    }
+
+    FrameRate GetFrameRate() const override { return frameRate; }
+    HRESULT ReadFrame(ImageBuffer& frame) override;
+    HRESULT ReadFrame(YuvImage& frame) override;
+
+private:
+    FILE* file;
+    unsigned width = 0;
+    unsigned height = 0;
+    FrameRate frameRate;
+    YuvImage planes;
+};
+
+/// <summary>Writes frames as raw BGRA8 to a file or pipe.</summary>
+class RawFrameWriter : public IFrameSink
+{
+public:
+    explicit RawFrameWriter(FILE* file)
+        : file(file)
+    {}
+
+    HRESULT WriteFrame(ImageBuffer const& frame) override;
+
+private:
+    FILE* file;
+};
+
+/// <summary>
+///   Writes BGRA8 or 4:2:0 frames as a YUV4MPEG2 stream. The header is
+///   written with the first frame, and all frames must have its size.
+/// </summary>
+class Y4mFrameWriter : public IFrameSink, public IYuvFrameSink
+{
+public:
+    Y4mFrameWriter(FILE* file, FrameRate frameRate)
+        : file(file)
+        , frameRate(frameRate)
+    {}
+
+    HRESULT WriteFrame(ImageBuffer const& frame) override;
+    HRESULT WriteFrame(YuvImage const& frame) override;
+
+private:
+    FILE* file;
+    FrameRate frameRate;
+    unsigned width = 0;
+    unsigned height = 0;
+    YuvImage planes;
+};
+
+std::unique_ptr<IFrameSink> CreateFrameWriter(StreamFormat format, FILE* file,
+                                              FrameRate frameRate);
+
+} // namespace gt
@@ -0,0 +1,102 @@
+#include "IntensitySchedule.h"
+
+#include "MathUtils.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace gt
+{
+
+namespace
+{
+
+bool ParseFloat(char const* text, char const** end, float& result)
+{
+    char* parseEnd = nullptr;
+    result = strtof(text, &parseEnd);
+    *end = parseEnd;
+    return parseEnd != text && result >= 0.0f && result <= 1.0f;
+}
+
+bool ParseFrame(char const* text, char const** end, unsigned& result)
+{
+    char* parseEnd = nullptr;
+    result = static_cast<unsigned>(strtoul(text, &parseEnd, 10));
+    *end = parseEnd;
+    return parseEnd != text;
+}
+
+} // namespace
+
+bool IntensitySchedule::Parse(char const* spec, IntensitySchedule& schedule)
+{
+    IntensitySchedule result;
+    char const* pos = spec;
+
+    if (std::strncmp(spec, "burst:", 6) == 0) {
+        result.kind = Kind::Burst;
+        result.value = 0.75f;
+        if (!ParseFrame(spec + 6, &pos, result.period) || result.period < 2)
+            return false;
+        if (*pos == ':' && !ParseFloat(pos + 1, &pos, result.value))
+            return false;
+    } else if (std::strchr(spec, ':')) {
+        result.kind = Kind::Keyframes;
+        for (;;) {
+            unsigned frame;
+            float intensity;
+            if (!ParseFrame(pos, &pos, frame) || *pos != ':' ||
+                !ParseFloat(pos + 1, &pos, intensity))
+                return false;
+            if (!result.keyframes.empty() && frame <= result.keyframes.back().first)
+                return false;
+
+            result.keyframes.emplace_back(frame, intensity);
+            if (*pos != ',')
+                break;
+            ++pos;
+        }
+    } else {
+        if (!ParseFloat(spec, &pos, result.value))
+            return false;
+    }
+
+    if (*pos != '\0')
+        return false;
+
+    schedule = std::move(result);
+    return true;
+}
+
+float IntensitySchedule::Evaluate(unsigned frame) const
+{
+    switch (kind) {
+    case Kind::Constant:
+        break;
+
+    case Kind::Burst:
+        return TriangleSeries(static_cast<int>(frame % period), static_cast<int>(period),
+                              0.0f, value);
+
+    case Kind::Keyframes: {
+        auto const next = std::upper_bound(keyframes.begin(), keyframes.end(), frame,
+                                           [](unsigned f, auto const& key) {
+                                               return f < key.first;
+                                           });
+        if (next == keyframes.begin())
+            return next->second;
+        if (next == keyframes.end())
+            return keyframes.back().second;
+
+        auto const prev = next - 1;
+        float const t = float(frame - prev->first) / float(next->first - prev->first);
+        return Lerp(prev->second, next->second, t);
+    }
+    }
+
+    return value;
+}
+
+} // namespace gt
@@ -0,0 +1,44 @@
+#pragma once
+#include <utility>
+#include <vector>
+
+namespace gt
+{
+
+/// <summary>
+///   Glitch intensity as a function of the frame index, for streams that are
+///   not driven by the burst timer.
+/// </summary>
+class IntensitySchedule
+{
+public:
+    /// <summary>
+    ///   Parses a schedule specification:
+    ///   <list type="bullet">
+    ///     <item><c>0.5</c>: constant intensity.</item>
+    ///     <item><c>burst:PERIOD[:PEAK]</c>: repeating triangle ramps of
+    ///       PERIOD frames up to PEAK (default 0.75), like a burst of
+    ///       <c>RenderContext::RenderFrame</c>.</item>
+    ///     <item><c>FRAME:VALUE,FRAME:VALUE,...</c>: keyframes with linear
+    ///       interpolation, holding the first and last value.</item>
+    ///   </list>
+    /// </summary>
+    static bool Parse(char const* spec, IntensitySchedule& schedule);
+
+    float Evaluate(unsigned frame) const;
+
+private:
+    enum class Kind
+    {
+        Constant,
+        Burst,
+        Keyframes,
+    };
+
+    Kind kind = Kind::Constant;
+    float value = 0.5f;
+    unsigned period = 0;
+    std::vector<std::pair<unsigned, float>> keyframes;
+};
+
+} // namespace gt
@@ -0,0 +1,17 @@
+#pragma once
+#include <cmath>
+
+namespace gt
+{
+
+inline float Lerp(float a, float b, float t)
+{
+    return a + (b - a) * t;
+}
+
+inline float TriangleSeries(int index, int steps, float min, float max)
+{
+    return max - std::abs((max - min) * (2.0f * index / steps - 1.0f));
+}
+
+} // namespace gt
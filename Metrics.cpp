@@ -0,0 +1,352 @@
+#include "Metrics.h"
+
+#include "FramePool.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+namespace gt
+{
+
+namespace
+{
+
+constexpr unsigned StageCount = static_cast<unsigned>(MetricStage::Count);
+constexpr unsigned CounterCount = static_cast<unsigned>(MetricCounter::Count);
+
+constexpr char const* stageNames[StageCount] = {
+    "burst",           "frame",   "refresh_capture", "glitch_update", "digital_glitch",
+    "chromatic_split", "present", "read_frame",      "process_frame", "write_frame",
+    "plan_burst",      "input_queue", "output_queue",
+};
+
+/// <summary>
+///   Log-linear buckets as in HdrHistogram: values below 16 ns get a bucket
+///   each, every power of two above is split into 16 buckets, which keeps
+///   quantiles within 1/16 of the true value from nanoseconds to minutes.
+/// </summary>
+struct LatencyBuckets
+{
+    static constexpr unsigned SubBucketBits = 4;
+    static constexpr unsigned SubBuckets = 1u << SubBucketBits;
+    /// Longer latencies, about 18 minutes, land in the last bucket.
+    static constexpr unsigned MaxBits = 40;
+    static constexpr unsigned Count = (MaxBits - SubBucketBits + 1) * SubBuckets;
+
+    static unsigned Index(uint64_t value)
+    {
+        value = std::min(value, (uint64_t(1) << MaxBits) - 1);
+        if (value < SubBuckets)
+            return static_cast<unsigned>(value);
+
+        unsigned const shift = std::bit_width(value) - 1 - SubBucketBits;
+        return (shift + 1) * SubBuckets + static_cast<unsigned>(value >> shift) -
+               SubBuckets;
+    }
+
+    /// Largest value that falls into the bucket.
+    static uint64_t UpperBound(unsigned index)
+    {
+        if (index < SubBuckets)
+            return index;
+
+        unsigned const shift = index / SubBuckets - 1;
+        uint64_t const subBucket = index % SubBuckets + SubBuckets;
+        return ((subBucket + 1) << shift) - 1;
+    }
+};
+
+/// Relaxed increment for values only the calling thread writes. Avoiding the
+/// read-modify-write keeps the hot path free of locked instructions.
+void Bump(std::atomic<uint64_t>& value, uint64_t amount)
+{
+    value.store(value.load(std::memory_order_relaxed) + amount,
+                std::memory_order_relaxed);
+}
+
+struct StageHistogram
+{
+    std::array<std::atomic<uint64_t>, LatencyBuckets::Count> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+};
+
+/// <summary>
+///   Counters and histograms of one thread. Only the owning thread writes;
+///   scrapes read it from any thread and may see a sample in the count before
+///   its bucket, which only skews a quantile by one sample.
+/// </summary>
+struct ThreadMetrics
+{
+    std::array<std::atomic<uint64_t>, CounterCount> counters{};
+    std::array<StageHistogram, StageCount> stages;
+};
+
+std::array<std::atomic<int64_t>, static_cast<size_t>(MetricGauge::Count)> gauges{};
+
+/// Threads that ever recorded a sample. Blocks come from malloc for the same
+/// reason as the trace buffers: a thread recording its first sample in the
+/// middle of a burst must not trip the allocation check.
+constexpr unsigned MaxMetricThreads = 256;
+std::array<std::atomic<ThreadMetrics*>, MaxMetricThreads> threadBlocks{};
+std::atomic<unsigned> threadBlockCount{0};
+
+#if GT_ENABLE_METRICS
+
+thread_local ThreadMetrics* threadMetrics = nullptr;
+
+ThreadMetrics* GetThreadMetrics()
+{
+    if (threadMetrics)
+        return threadMetrics;
+
+    unsigned const index = threadBlockCount.fetch_add(1, std::memory_order_relaxed);
+    if (index >= MaxMetricThreads)
+        return nullptr;
+
+    void* const memory = std::malloc(sizeof(ThreadMetrics));
+    if (!memory)
+        return nullptr;
+
+    threadMetrics = new (memory) ThreadMetrics();
+    threadBlocks[index].store(threadMetrics, std::memory_order_release);
+    return threadMetrics;
+}
+
+#endif
+
+/// Plain copy of the histograms of all threads.
+struct HistogramSnapshot
+{
+    std::array<uint64_t, LatencyBuckets::Count> buckets{};
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+    void Add(StageHistogram const& histogram)
+    {
+        for (unsigned i = 0; i < LatencyBuckets::Count; ++i)
+            buckets[i] += histogram.buckets[i].load(std::memory_order_relaxed);
+        count += histogram.count.load(std::memory_order_relaxed);
+        sum += histogram.sum.load(std::memory_order_relaxed);
+        max = std::max(max, histogram.max.load(std::memory_order_relaxed));
+    }
+
+    uint64_t GetQuantile(double quantile) const
+    {
+        uint64_t total = 0;
+        for (uint64_t const bucket : buckets)
+            total += bucket;
+
+        uint64_t const rank = std::max<uint64_t>(
+            static_cast<uint64_t>(quantile * static_cast<double>(total) + 0.5), 1);
+        uint64_t seen = 0;
+        for (unsigned i = 0; i < LatencyBuckets::Count; ++i) {
+            seen += buckets[i];
+            if (seen >= rank)
+                return std::min(LatencyBuckets::UpperBound(i), max);
+        }
+        return max;
+    }
+};
+
+/// Frame count and time of the previous scrape, for the frame rate.
+std::mutex scrapeMutex;
+uint64_t lastFrames = 0;
+auto lastScrape = std::chrono::steady_clock::now();
+
+void AppendFormat(std::string& text, char const* format, ...)
+{
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    int const length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length > 0)
+        text.append(line, std::min(static_cast<size_t>(length), sizeof(line) - 1));
+}
+
+void AppendCounter(std::string& text, char const* name, char const* help,
+                   uint64_t value)
+{
+    AppendFormat(text, "# HELP glitch_%s %s\n# TYPE glitch_%s counter\nglitch_%s %llu\n",
+                 name, help, name, name, static_cast<unsigned long long>(value));
+}
+
+void AppendGauge(std::string& text, char const* name, char const* help, double value)
+{
+    AppendFormat(text, "# HELP glitch_%s %s\n# TYPE glitch_%s gauge\nglitch_%s %.6g\n",
+                 name, help, name, name, value);
+}
+
+double GetRatio(uint64_t part, uint64_t whole)
+{
+    return whole ? static_cast<double>(part) / static_cast<double>(whole) : 0.0;
+}
+
+} // namespace
+
+#if GT_ENABLE_METRICS
+
+void RecordStageLatency(MetricStage stage, std::chrono::nanoseconds latency)
+{
+    ThreadMetrics* const metrics = GetThreadMetrics();
+    if (!metrics)
+        return;
+
+    uint64_t const value = static_cast<uint64_t>(std::max<int64_t>(latency.count(), 0));
+    StageHistogram& histogram = metrics->stages[static_cast<unsigned>(stage)];
+    Bump(histogram.buckets[LatencyBuckets::Index(value)], 1);
+    Bump(histogram.count, 1);
+    Bump(histogram.sum, value);
+    if (value > histogram.max.load(std::memory_order_relaxed))
+        histogram.max.store(value, std::memory_order_relaxed);
+}
+
+void AddToCounter(MetricCounter counter, uint64_t value)
+{
+    if (ThreadMetrics* const metrics = GetThreadMetrics())
+        Bump(metrics->counters[static_cast<unsigned>(counter)], value);
+}
+
+void SetGauge(MetricGauge gauge, int64_t value)
+{
+    gauges[static_cast<unsigned>(gauge)].store(value, std::memory_order_relaxed);
+}
+
+#else
+
+void RecordStageLatency(MetricStage /*stage*/, std::chrono::nanoseconds /*latency*/)
+{}
+
+void AddToCounter(MetricCounter /*counter*/, uint64_t /*value*/)
+{}
+
+void SetGauge(MetricGauge /*gauge*/, int64_t /*value*/)
+{}
+
+#endif
+
+void FormatMetrics(std::string& text)
+{
+    std::array<uint64_t, CounterCount> counters{};
+    std::array<HistogramSnapshot, StageCount> stages;
+
+    unsigned const blockCount =
+        std::min(threadBlockCount.load(std::memory_order_relaxed), MaxMetricThreads);
+    for (unsigned i = 0; i < blockCount; ++i) {
+        ThreadMetrics const* const block =
+            threadBlocks[i].load(std::memory_order_acquire);
+        if (!block)
+            continue;
+
+        for (unsigned c = 0; c < CounterCount; ++c)
+            counters[c] += block->counters[c].load(std::memory_order_relaxed);
+        for (unsigned s = 0; s < StageCount; ++s)
+            stages[s].Add(block->stages[s]);
+    }
+
+    auto const counter = [&](MetricCounter which) {
+        return counters[static_cast<unsigned>(which)];
+    };
+
+    double framesPerSecond;
+    {
+        std::lock_guard<std::mutex> lock(scrapeMutex);
+        auto const now = std::chrono::steady_clock::now();
+        double const seconds = std::chrono::duration<double>(now - lastScrape).count();
+        uint64_t const frames = counter(MetricCounter::Frames);
+        framesPerSecond = seconds > 0.0 ? (frames - lastFrames) / seconds : 0.0;
+        lastFrames = frames;
+        lastScrape = now;
+    }
+
+    text.clear();
+    AppendCounter(text, "frames_total", "Frames presented or written.",
+                  counter(MetricCounter::Frames));
+    AppendGauge(text, "frames_per_second", "Frame rate since the previous scrape.",
+                framesPerSecond);
+
+    uint64_t const clean = counter(MetricCounter::CleanCells);
+    uint64_t const glitched = counter(MetricCounter::GlitchedCells);
+    AppendCounter(text, "clean_cells_total", "Glitch cells copied straight through.",
+                  clean);
+    AppendCounter(text, "glitched_cells_total", "Glitch cells that ran the effect.",
+                  glitched);
+    AppendGauge(text, "fast_path_ratio", "Share of glitch cells copied straight through.",
+                GetRatio(clean, clean + glitched));
+    AppendCounter(text, "capture_stalls_total",
+                  "Desktop captures that waited for a new frame.",
+                  counter(MetricCounter::CaptureStalls));
+    AppendCounter(text, "writer_stalls_total",
+                  "Frames that waited for the writer thread.",
+                  counter(MetricCounter::WriterStalls));
+    AppendCounter(text, "dropped_frames_total",
+                  "Queued frames replaced by newer ones.",
+                  counter(MetricCounter::DroppedFrames));
+
+    auto const gauge = [&](MetricGauge which) {
+        return gauges[static_cast<unsigned>(which)].load(std::memory_order_relaxed);
+    };
+
+    AppendGauge(text, "quality_level", "Quality level, 0 for full quality.",
+                static_cast<double>(gauge(MetricGauge::QualityLevel)));
+    AppendGauge(text, "input_queue_occupancy", "Frames waiting for the next stage.",
+                static_cast<double>(gauge(MetricGauge::InputQueueOccupancy)));
+    AppendGauge(text, "output_queue_occupancy", "Frames waiting for the writer.",
+                static_cast<double>(gauge(MetricGauge::OutputQueueOccupancy)));
+    AppendFormat(text,
+                 "# HELP glitch_quality_steps_total Quality governor decisions.\n"
+                 "# TYPE glitch_quality_steps_total counter\n"
+                 "glitch_quality_steps_total{direction=\"down\"} %llu\n"
+                 "glitch_quality_steps_total{direction=\"up\"} %llu\n",
+                 static_cast<unsigned long long>(
+                     counter(MetricCounter::QualityStepsDown)),
+                 static_cast<unsigned long long>(counter(MetricCounter::QualityStepsUp)));
+
+    FramePoolStats const pool = FramePool::Shared().GetStats();
+    AppendCounter(text, "frame_pool_hits_total", "Frame buffers served from the pool.",
+                  pool.hits);
+    AppendCounter(text, "frame_pool_misses_total", "Frame buffers newly allocated.",
+                  pool.misses);
+    AppendCounter(text, "frame_pool_trimmed_total", "Idle frame buffers freed.",
+                  pool.trimmed);
+    AppendGauge(text, "frame_pool_hit_ratio",
+                "Share of frame buffers served from the pool.",
+                GetRatio(pool.hits, pool.hits + pool.misses));
+    AppendFormat(text,
+                 "# HELP glitch_frame_pool_bytes Bytes of frame buffers.\n"
+                 "# TYPE glitch_frame_pool_bytes gauge\n"
+                 "glitch_frame_pool_bytes{state=\"in_use\"} %zu\n"
+                 "glitch_frame_pool_bytes{state=\"idle\"} %zu\n",
+                 pool.bytesInUse, pool.bytesIdle);
+
+    text.append("# HELP glitch_stage_latency_seconds Latency of the frame loop stages.\n"
+                "# TYPE glitch_stage_latency_seconds summary\n");
+    for (unsigned s = 0; s < StageCount; ++s) {
+        HistogramSnapshot const& histogram = stages[s];
+        if (histogram.count == 0)
+            continue;
+
+        for (double const quantile : {0.5, 0.9, 0.99, 0.999, 1.0}) {
+            AppendFormat(text,
+                         "glitch_stage_latency_seconds{stage=\"%s\",quantile=\"%g\"} "
+                         "%.9f\n",
+                         stageNames[s], quantile, histogram.GetQuantile(quantile) * 1e-9);
+        }
+        AppendFormat(text, "glitch_stage_latency_seconds_sum{stage=\"%s\"} %.9f\n",
+                     stageNames[s], histogram.sum * 1e-9);
+        AppendFormat(text, "glitch_stage_latency_seconds_count{stage=\"%s\"} %llu\n",
+                     stageNames[s], static_cast<unsigned long long>(histogram.count));
+    }
+}
+
+} // namespace gt
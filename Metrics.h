@@ -0,0 +1,147 @@
+#pragma once
+#include "Platform.h"
+#include "Trace.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <string>
+
+/// Compiles the stage timers and counters in. Without it they vanish
+/// entirely and scrapes only report the frame pool.
+#ifndef GT_ENABLE_METRICS
+#define GT_ENABLE_METRICS 1
+#endif
+
+namespace gt
+{
+
+/// Parts of the frame loop whose latency is kept in a histogram.
+enum class MetricStage : unsigned
+{
+    Burst,
+    Frame,
+    RefreshCapture,
+    GlitchUpdate,
+    DigitalGlitch,
+    ChromaticSplit,
+    Present,
+    ReadFrame,
+    ProcessFrame,
+    WriteFrame,
+    PlanBurst,
+    /// Time frames spent queued between the reader or renderer and the
+    /// next stage, and between that stage and the writer.
+    InputQueue,
+    OutputQueue,
+    Count,
+};
+
+enum class MetricCounter : unsigned
+{
+    /// Frames presented by a backend or written by the filter pipeline.
+    Frames,
+    /// Glitch cells left clean, which kernels copy straight through, and
+    /// cells that run the full effect.
+    CleanCells,
+    GlitchedCells,
+    /// Desktop captures that had to wait for a new frame, and filter frames
+    /// that waited for their input.
+    CaptureStalls,
+    /// Frames that waited for the writer thread to free a buffer.
+    WriterStalls,
+    /// Queued frames replaced by newer ones because the next stage fell
+    /// behind.
+    DroppedFrames,
+    /// Decisions of the quality governor to render cheaper or better.
+    QualityStepsDown,
+    QualityStepsUp,
+    Count,
+};
+
+/// Values that are set rather than summed across threads.
+enum class MetricGauge : unsigned
+{
+    /// Current <see cref="QualityLevel"/>, 0 for full quality.
+    QualityLevel,
+    /// Frames queued behind the stages of <see cref="MetricStage::InputQueue"/>
+    /// and <see cref="MetricStage::OutputQueue"/> after their last push.
+    InputQueueOccupancy,
+    OutputQueueOccupancy,
+    Count,
+};
+
+/// <summary>
+///   Name of the stage in traces, matching the scopes recorded before the
+///   stages had metrics.
+/// </summary>
+constexpr char const* GetStageTraceName(MetricStage stage)
+{
+    constexpr char const* names[] = {
+        "Burst",         "Frame",          "RefreshCapture", "DigitalGlitch.Update",
+        "DigitalGlitch", "ChromaticSplit", "Present",        "ReadFrame",
+        "ProcessFrame",  "WriteFrame",     "PlanBurst",      "InputQueue",
+        "OutputQueue",
+    };
+    static_assert(std::size(names) == static_cast<size_t>(MetricStage::Count));
+    return names[static_cast<unsigned>(stage)];
+}
+
+/// <summary>
+///   Adds one sample to the latency histogram of <paramref name="stage"/>.
+///   Samples go to a block owned by the calling thread, so recording never
+///   contends with other threads or with scrapes.
+/// </summary>
+void RecordStageLatency(MetricStage stage, std::chrono::nanoseconds latency);
+
+/// <summary>
+///   Adds <paramref name="value"/> to a counter of the calling thread.
+/// </summary>
+void AddToCounter(MetricCounter counter, uint64_t value = 1);
+
+void SetGauge(MetricGauge gauge, int64_t value);
+
+/// <summary>
+///   Sums the blocks of all threads into a text snapshot in the Prometheus
+///   exposition format: counters, frame pool usage, the frame rate since the
+///   previous snapshot and latency quantiles of every stage that ran. Only
+///   allocates if <paramref name="text"/> lacks the capacity.
+/// </summary>
+void FormatMetrics(std::string& text);
+
+#if GT_ENABLE_METRICS
+
+/// <summary>
+///   Records the time from construction to destruction in the histogram of
+///   <paramref name="stage"/>. Use <see cref="GT_STAGE_SCOPE"/> rather than
+///   this class directly, which also traces the stage.
+/// </summary>
+class StageTimer
+{
+public:
+    explicit StageTimer(MetricStage stage)
+        : stage(stage)
+        , start(std::chrono::steady_clock::now())
+    {}
+
+    ~StageTimer() { RecordStageLatency(stage, std::chrono::steady_clock::now() - start); }
+
+    StageTimer(StageTimer const&) = delete;
+    StageTimer& operator=(StageTimer const&) = delete;
+
+private:
+    MetricStage stage;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define GT_STAGE_SCOPE(stage)                                                            \
+    GT_TRACE_SCOPE(::gt::GetStageTraceName(stage));                                      \
+    ::gt::StageTimer const GT_TRACE_CONCAT(stageTimer_, __LINE__)(stage)
+
+#else
+
+#define GT_STAGE_SCOPE(stage) GT_TRACE_SCOPE(::gt::GetStageTraceName(stage))
+
+#endif
+
+} // namespace gt
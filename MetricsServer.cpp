@@ -0,0 +1,156 @@
+#include "MetricsServer.h"
+
+#include "Metrics.h"
+#include "Trace.h"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+
+namespace gt
+{
+
+MetricsServer::~MetricsServer()
+{
+    Stop();
+}
+
+#ifdef _WIN32
+
+HRESULT MetricsServer::Start(char const* newPath)
+{
+    if (server.joinable())
+        return E_UNEXPECTED;
+
+    constexpr char prefix[] = "\\\\.\\pipe\\";
+    path = std::strncmp(newPath, prefix, sizeof(prefix) - 1) == 0
+               ? newPath
+               : std::string(prefix) + newPath;
+
+    // Snapshots are a few KiB; reserving up front keeps scrapes from
+    // allocating while a burst asserts that nothing does.
+    text.reserve(64 * 1024);
+    stopping = false;
+    server = std::thread([this] { ServerMain(); });
+    return S_OK;
+}
+
+void MetricsServer::Stop()
+{
+    if (!server.joinable())
+        return;
+
+    // Connect once to release the server from ConnectNamedPipe.
+    stopping = true;
+    HANDLE const client = CreateFileA(path.c_str(), GENERIC_READ, 0, nullptr,
+                                      OPEN_EXISTING, 0, nullptr);
+    if (client != INVALID_HANDLE_VALUE)
+        CloseHandle(client);
+    server.join();
+}
+
+void MetricsServer::ServerMain()
+{
+    SetTraceThreadName("Metrics server");
+    while (!stopping) {
+        HANDLE const pipe = CreateNamedPipeA(
+            path.c_str(), PIPE_ACCESS_OUTBOUND,
+            PIPE_TYPE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+            PIPE_UNLIMITED_INSTANCES, 64 * 1024, 0, 0, nullptr);
+        if (pipe == INVALID_HANDLE_VALUE)
+            return;
+
+        bool const connected =
+            ConnectNamedPipe(pipe, nullptr) || GetLastError() == ERROR_PIPE_CONNECTED;
+        if (connected && !stopping) {
+            FormatMetrics(text);
+            DWORD written;
+            WriteFile(pipe, text.data(), static_cast<DWORD>(text.size()), &written,
+                      nullptr);
+            FlushFileBuffers(pipe);
+        }
+        DisconnectNamedPipe(pipe);
+        CloseHandle(pipe);
+    }
+}
+
+#else
+
+HRESULT MetricsServer::Start(char const* newPath)
+{
+    if (server.joinable())
+        return E_UNEXPECTED;
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (std::strlen(newPath) >= sizeof(address.sun_path))
+        return E_INVALIDARG;
+    std::strcpy(address.sun_path, newPath);
+
+    listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSocket < 0)
+        return E_FAIL;
+
+    unlink(newPath);
+    if (bind(listenSocket, reinterpret_cast<sockaddr const*>(&address),
+             sizeof(address)) != 0 ||
+        listen(listenSocket, 4) != 0) {
+        close(listenSocket);
+        listenSocket = -1;
+        return E_ACCESSDENIED;
+    }
+
+    path = newPath;
+    // Snapshots are a few KiB; reserving up front keeps scrapes from
+    // allocating while a burst asserts that nothing does.
+    text.reserve(64 * 1024);
+    stopping = false;
+    server = std::thread([this] { ServerMain(); });
+    return S_OK;
+}
+
+void MetricsServer::Stop()
+{
+    if (!server.joinable())
+        return;
+
+    // Shutting the socket down releases the server from accept.
+    stopping = true;
+    shutdown(listenSocket, SHUT_RDWR);
+    server.join();
+    close(listenSocket);
+    listenSocket = -1;
+    unlink(path.c_str());
+}
+
+void MetricsServer::ServerMain()
+{
+    SetTraceThreadName("Metrics server");
+    while (!stopping) {
+        int const client = accept(listenSocket, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            return;
+        }
+
+        FormatMetrics(text);
+        for (size_t sent = 0; sent < text.size();) {
+            ssize_t const result =
+                send(client, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+            if (result <= 0)
+                break;
+            sent += static_cast<size_t>(result);
+        }
+        close(client);
+    }
+}
+
+#endif
+
+} // namespace gt
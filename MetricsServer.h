@@ -0,0 +1,48 @@
+#pragma once
+#include "Platform.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+namespace gt
+{
+
+/// <summary>
+///   Serves <see cref="FormatMetrics"/> snapshots on a local endpoint: a Unix
+///   domain socket, or a named pipe on Windows. Every connection receives one
+///   snapshot and is closed, so <c>socat - UNIX-CONNECT:path</c> or
+///   <c>type \\.\pipe\name</c> is all a scraper needs.
+/// </summary>
+class MetricsServer
+{
+public:
+    MetricsServer() = default;
+    ~MetricsServer();
+
+    MetricsServer(MetricsServer const&) = delete;
+    MetricsServer& operator=(MetricsServer const&) = delete;
+
+    /// <summary>
+    ///   Starts listening on <paramref name="path"/>, a socket path, or on
+    ///   Windows a pipe name with or without the <c>\\.\pipe\</c> prefix. A
+    ///   stale socket left behind by a previous run is replaced.
+    /// </summary>
+    HRESULT Start(char const* path);
+
+    /// Stops serving and removes the endpoint.
+    void Stop();
+
+private:
+    void ServerMain();
+
+    std::string path;
+    std::string text;
+#ifndef _WIN32
+    int listenSocket = -1;
+#endif
+    std::atomic<bool> stopping{false};
+    std::thread server;
+};
+
+} // namespace gt
@@ -0,0 +1,54 @@
+#pragma once
+#include "Random.h"
+#include "Span.h"
+
+#include <array>
+#include <cstdint>
+
+namespace gt
+{
+
+/// <summary>
+///   Grid of BGRA noise texels driving the digital glitch. Each texel holds
+///   the displacement (R, G) and the glitch weights (B, A) of one cell.
+/// </summary>
+struct NoiseGrid
+{
+    static constexpr unsigned Width = 64;
+    static constexpr unsigned Height = 32;
+
+    std::array<uint32_t, Width * Height> texels{};
+
+    void Generate() { Generate(SharedRandomEngine()); }
+
+    /// Same noise from a caller-owned generator, so that seeded runs
+    /// reproduce it.
+    void Generate(xorshift128_engine& rng)
+    {
+        uint32_t color = RandomColorBGRA(rng);
+        for (uint32_t& texel : texels) {
+            if (RandomFloat(rng) > 0.89f)
+                color = RandomColorBGRA(rng);
+            texel = color;
+        }
+    }
+
+    /// <summary>
+    ///   Noise of another image glitched in the same frame as
+    ///   <paramref name="noise"/>, told apart by <paramref name="stream"/>.
+    ///   Each texel seeds the color it is given, so runs stay runs but their
+    ///   colors are unrelated to the original ones.
+    /// </summary>
+    void Derive(NoiseGrid const& noise, uint32_t stream)
+    {
+        for (size_t i = 0; i < texels.size(); ++i) {
+            uint64_t const key = noise.texels[i] | (static_cast<uint64_t>(stream) << 32);
+            xorshift128_engine rng(MixBits(key), MixBits(~key));
+            texels[i] = RandomColorBGRA(rng);
+        }
+    }
+
+    image_view<uint32_t const> View() const { return {texels.data(), Width, Height}; }
+};
+
+} // namespace gt
@@ -0,0 +1,303 @@
+#include "PageAllocator.h"
+
+#include "Platform.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+
+namespace gt
+{
+
+namespace
+{
+
+std::atomic<HugePageMode> hugePageMode{HugePageMode::Transparent};
+
+std::atomic<size_t> allocationCount{0};
+std::atomic<size_t> bytesMapped{0};
+std::atomic<size_t> hugePageCount{0};
+std::atomic<uint64_t> fallbackCount{0};
+
+size_t RoundUp(size_t value, size_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+#ifdef _WIN32
+
+size_t GetPageSize()
+{
+    static size_t const pageSize = [] {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return static_cast<size_t>(info.dwPageSize);
+    }();
+    return pageSize;
+}
+
+size_t GetHugePageSize()
+{
+    static size_t const hugePageSize = GetLargePageMinimum();
+    return hugePageSize;
+}
+
+/// Large pages need SeLockMemoryPrivilege, which has to be granted to the
+/// user and then enabled in the process token.
+bool EnableLockMemoryPrivilege()
+{
+    static bool const enabled = [] {
+        HANDLE token;
+        if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY,
+                              &token))
+            return false;
+
+        TOKEN_PRIVILEGES privileges = {};
+        privileges.PrivilegeCount = 1;
+        privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+        // AdjustTokenPrivileges succeeds without assigning anything when the
+        // user does not hold the privilege; only the last error tells.
+        bool const adjusted =
+            LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME,
+                                  &privileges.Privileges[0].Luid) &&
+            AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) &&
+            GetLastError() == ERROR_SUCCESS;
+
+        CloseHandle(token);
+        return adjusted;
+    }();
+    return enabled;
+}
+
+PageAllocation MapExplicit(size_t bytes)
+{
+    size_t const hugePageSize = GetHugePageSize();
+    if (hugePageSize == 0 || !EnableLockMemoryPrivilege())
+        return {};
+
+    size_t const size = RoundUp(bytes, hugePageSize);
+    void* const base = VirtualAlloc(nullptr, size,
+                                    MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                                    PAGE_READWRITE);
+    if (!base)
+        return {};
+    return {base, size, size / hugePageSize};
+}
+
+PageAllocation MapRegular(size_t bytes, HugePageMode /*mode*/)
+{
+    size_t const size = RoundUp(bytes, GetPageSize());
+    void* const base =
+        VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (!base)
+        return {};
+    return {base, size, 0};
+}
+
+void Unmap(PageAllocation const& allocation)
+{
+    VirtualFree(allocation.base, 0, MEM_RELEASE);
+}
+
+#else
+
+size_t GetPageSize()
+{
+    static size_t const pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return pageSize;
+}
+
+/// Default huge page size from /proc/meminfo, used for both transparent and
+/// explicit huge pages. 0 if the kernel has no huge page support.
+size_t GetHugePageSize()
+{
+    static size_t const hugePageSize = [] {
+        FILE* const file = fopen("/proc/meminfo", "r");
+        if (!file)
+            return size_t(0);
+
+        char line[256];
+        unsigned long long kilobytes = 0;
+        while (fgets(line, sizeof(line), file)) {
+            if (sscanf(line, "Hugepagesize: %llu kB", &kilobytes) == 1)
+                break;
+        }
+        fclose(file);
+        return static_cast<size_t>(kilobytes) * 1024;
+    }();
+    return hugePageSize;
+}
+
+/// Sum of the AnonHugePages of all mappings overlapping [begin, end). Adjacent
+/// mappings with the same flags are merged by the kernel, so this may include
+/// memory of neighboring allocations.
+size_t CountAnonHugeBytes(uintptr_t begin, uintptr_t end)
+{
+    FILE* const file = fopen("/proc/self/smaps", "r");
+    if (!file)
+        return 0;
+
+    char line[4096];
+    bool overlaps = false;
+    size_t bytes = 0;
+    while (fgets(line, sizeof(line), file)) {
+        unsigned long long low, high, kilobytes;
+        if (sscanf(line, "%llx-%llx ", &low, &high) == 2)
+            overlaps = low < end && high > begin;
+        else if (overlaps && sscanf(line, "AnonHugePages: %llu kB", &kilobytes) == 1)
+            bytes += static_cast<size_t>(kilobytes) * 1024;
+    }
+    fclose(file);
+    return bytes;
+}
+
+PageAllocation MapExplicit(size_t bytes)
+{
+    size_t const hugePageSize = GetHugePageSize();
+    if (hugePageSize == 0)
+        return {};
+
+    // Without MAP_NORESERVE the huge pages are reserved up front, so the
+    // mapping fails now instead of faulting later when the pool runs dry.
+    size_t const size = RoundUp(bytes, hugePageSize);
+    void* const base = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (base == MAP_FAILED)
+        return {};
+    return {base, size, size / hugePageSize};
+}
+
+PageAllocation MapRegular(size_t bytes, HugePageMode mode)
+{
+    size_t const hugePageSize = GetHugePageSize();
+    if (mode == HugePageMode::Off || hugePageSize == 0) {
+        size_t const size = RoundUp(bytes, GetPageSize());
+        void* const base = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED)
+            return {};
+        return {base, size, 0};
+    }
+
+    // Only aligned huge page sized ranges can be backed by huge pages. Map one
+    // huge page more than needed and cut off the unaligned ends.
+    size_t const size = RoundUp(bytes, hugePageSize);
+    void* const raw = mmap(nullptr, size + hugePageSize, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+        return {};
+
+    uintptr_t const rawBegin = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t const begin = RoundUp(rawBegin, hugePageSize);
+    uintptr_t const end = begin + size;
+    if (begin > rawBegin)
+        munmap(raw, begin - rawBegin);
+    if (rawBegin + size + hugePageSize > end)
+        munmap(reinterpret_cast<void*>(end), rawBegin + size + hugePageSize - end);
+
+    char* const base = reinterpret_cast<char*>(begin);
+    madvise(base, size, MADV_HUGEPAGE);
+
+    // Fault the memory in now, one write per huge page, so that the huge
+    // pages the kernel managed to provide can be counted. The frame is
+    // cleared right after anyway. Serialized so that the difference in
+    // AnonHugePages is ours alone.
+    static std::mutex countMutex;
+    std::lock_guard<std::mutex> lock(countMutex);
+
+    size_t const hugeBefore = CountAnonHugeBytes(begin, end);
+    for (size_t offset = 0; offset < size; offset += hugePageSize)
+        static_cast<char volatile*>(base)[offset] = 0;
+    size_t const hugeAfter = CountAnonHugeBytes(begin, end);
+
+    size_t const hugeBytes = hugeAfter > hugeBefore ? hugeAfter - hugeBefore : 0;
+    return {base, size, std::min(hugeBytes, size) / hugePageSize};
+}
+
+void Unmap(PageAllocation const& allocation)
+{
+    munmap(allocation.base, allocation.size);
+}
+
+#endif
+
+} // namespace
+
+PageAllocation AllocatePages(size_t bytes)
+{
+    if (bytes == 0)
+        return {};
+
+    HugePageMode const mode = hugePageMode.load(std::memory_order_relaxed);
+
+    PageAllocation allocation;
+    if (mode == HugePageMode::Explicit) {
+        allocation = MapExplicit(bytes);
+        if (!allocation.base)
+            ++fallbackCount;
+    }
+
+    if (!allocation.base)
+        allocation = MapRegular(bytes, mode);
+    if (!allocation.base)
+        return {};
+
+    ++allocationCount;
+    bytesMapped += allocation.size;
+    hugePageCount += allocation.hugePages;
+    return allocation;
+}
+
+void FreePages(PageAllocation const& allocation)
+{
+    if (!allocation.base)
+        return;
+
+    --allocationCount;
+    bytesMapped -= allocation.size;
+    hugePageCount -= allocation.hugePages;
+    Unmap(allocation);
+}
+
+void SetHugePageMode(HugePageMode mode)
+{
+    hugePageMode.store(mode, std::memory_order_relaxed);
+}
+
+HugePageMode GetHugePageMode()
+{
+    return hugePageMode.load(std::memory_order_relaxed);
+}
+
+char const* GetHugePageModeName(HugePageMode mode)
+{
+    switch (mode) {
+    case HugePageMode::Off:
+        return "off";
+    case HugePageMode::Transparent:
+        return "transparent";
+    case HugePageMode::Explicit:
+        return "explicit";
+    }
+    return "unknown";
+}
+
+PageAllocatorStats GetPageAllocatorStats()
+{
+    PageAllocatorStats stats;
+    stats.hugePageSize = GetHugePageSize();
+    stats.allocations = allocationCount.load();
+    stats.bytesMapped = bytesMapped.load();
+    stats.hugePages = hugePageCount.load();
+    stats.fallbacks = fallbackCount.load();
+    return stats;
+}
+
+} // namespace gt
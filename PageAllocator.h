@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace gt
+{
+
+/// <summary>How hard <see cref="AllocatePages"/> tries to use huge pages.</summary>
+enum class HugePageMode
+{
+    /// Regular pages only.
+    Off,
+    /// Mappings aligned to the huge page size and marked for transparent huge
+    /// pages, which the kernel uses when it can (Linux). Windows has no
+    /// transparent huge pages and uses regular pages.
+    Transparent,
+    /// Explicit huge pages (MAP_HUGETLB on Linux, large pages on Windows),
+    /// falling back to <see cref="Transparent"/> when none are available, e.g.
+    /// without reserved hugetlbfs pages or the "Lock pages in memory" right.
+    Explicit,
+};
+
+/// <summary>
+///   Memory mapped directly from the OS by <see cref="AllocatePages"/>.
+///   <c>base</c> is aligned to at least the regular page size.
+/// </summary>
+struct PageAllocation
+{
+    void* base = nullptr;
+    /// Bytes mapped, the request rounded up to whole pages.
+    size_t size = 0;
+    /// Huge pages actually backing the mapping when it was made.
+    size_t hugePages = 0;
+};
+
+struct PageAllocatorStats
+{
+    /// Huge page size of the system, 0 if unknown.
+    size_t hugePageSize = 0;
+
+    size_t allocations = 0;
+    size_t bytesMapped = 0;
+    /// Huge pages among the live allocations.
+    size_t hugePages = 0;
+
+    /// Explicit huge page requests that fell back to regular pages.
+    uint64_t fallbacks = 0;
+};
+
+/// <summary>
+///   Maps at least <paramref name="bytes"/> bytes of zeroed memory, backed by
+///   huge pages according to the current <see cref="HugePageMode"/>. Huge
+///   pages cut the TLB misses of gathers that jump across the rows of large
+///   frames. Returns an empty allocation if the memory cannot be mapped.
+/// </summary>
+/// <remarks>
+///   Mapping is a system call, so this is meant for full-resolution frame
+///   buffers allocated on a pool miss; see <see cref="FramePool"/>.
+/// </remarks>
+PageAllocation AllocatePages(size_t bytes);
+
+void FreePages(PageAllocation const& allocation);
+
+void SetHugePageMode(HugePageMode mode);
+HugePageMode GetHugePageMode();
+
+char const* GetHugePageModeName(HugePageMode mode);
+
+PageAllocatorStats GetPageAllocatorStats();
+
+} // namespace gt
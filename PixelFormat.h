@@ -0,0 +1,309 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__F16C__) || defined(__AVX2__)
+#include <immintrin.h>
+#define GT_HAVE_F16C 1
+#else
+#define GT_HAVE_F16C 0
+#endif
+
+namespace gt
+{
+
+/// <summary>Memory layout of the pixels of a frame.</summary>
+enum class PixelFormat
+{
+    /// 8-bit unsigned normalized BGRA, the SDR desktop format.
+    Bgra8,
+    /// 10-bit unsigned normalized RGB with 2-bit alpha, red in the low bits.
+    Rgb10A2,
+    /// 16-bit unsigned normalized RGBA.
+    Rgba16,
+    /// 16-bit floating point RGBA, as delivered by HDR desktops (scRGB).
+    Rgba16F,
+};
+
+inline unsigned BytesPerPixel(PixelFormat format)
+{
+    switch (format) {
+    case PixelFormat::Bgra8:
+    case PixelFormat::Rgb10A2:
+        return 4;
+    case PixelFormat::Rgba16:
+    case PixelFormat::Rgba16F:
+        return 8;
+    }
+    return 0;
+}
+
+inline char const* GetPixelFormatName(PixelFormat format)
+{
+    switch (format) {
+    case PixelFormat::Bgra8:
+        return "bgra8";
+    case PixelFormat::Rgb10A2:
+        return "rgb10a2";
+    case PixelFormat::Rgba16:
+        return "rgba16";
+    case PixelFormat::Rgba16F:
+        return "rgba16f";
+    }
+    return "unknown";
+}
+
+/// <summary>
+///   Pixel with floating point channels in the units of its format, e.g.
+///   0-255 for BGRA8 and 0-1 for half floats. Used by the scalar reference
+///   kernel.
+/// </summary>
+struct Color
+{
+    float b, g, r, a;
+};
+
+/// Converts an IEEE half to float. Exact for all inputs.
+inline float HalfToFloat(uint16_t half)
+{
+    uint32_t const sign = uint32_t(half & 0x8000) << 16;
+    uint32_t const exponent = (half >> 10) & 0x1F;
+    uint32_t const mantissa = half & 0x3FF;
+
+    uint32_t bits;
+    if (exponent == 0x1F) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else {
+        // Zero or subnormal, mantissa * 2^-24.
+        float const value = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+        return sign ? -value : value;
+    }
+
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/// Converts a float to an IEEE half, rounding to nearest even like F16C.
+inline uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint16_t const sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    bits &= 0x7FFFFFFF;
+
+    if (bits >= 0x7F800000) // Infinity and NaN
+        return sign | 0x7C00 | (bits > 0x7F800000 ? 0x200 : 0);
+    if (bits >= 0x477FF000) // Rounds to 65520 or more
+        return sign | 0x7C00;
+
+    if (bits < 0x38800000) {
+        // Below the smallest normal half, 2^-14: round to a multiple of 2^-24.
+        float magnitude;
+        std::memcpy(&magnitude, &bits, sizeof(magnitude));
+        return sign | static_cast<uint16_t>(std::nearbyint(magnitude * 16777216.0f));
+    }
+
+    uint32_t const rounded = bits + 0xFFF + ((bits >> 13) & 1);
+    return sign | static_cast<uint16_t>((rounded - 0x38000000) >> 13);
+}
+
+namespace details
+{
+
+/// <c>(a * (256 - w) + b * w + 128) >> 8</c> for one channel of up to 16 bits.
+inline uint32_t LerpChannel(uint32_t a, uint32_t b, unsigned w)
+{
+    return (a * (256 - w) + b * w + 128) >> 8;
+}
+
+/// <summary>
+///   Pixel packing all four channels as unsigned normalized integers into
+///   one word. Channels are addressed by their shift; the color channels all
+///   have <typeparamref name="ColorBits"/> bits.
+/// </summary>
+template<typename PixelType, unsigned RedShift, unsigned GreenShift, unsigned BlueShift,
+         unsigned AlphaShift, unsigned ColorBits, unsigned AlphaBits>
+struct PackedUnormTraits
+{
+    using Pixel = PixelType;
+
+    static constexpr Pixel ColorMax = (Pixel(1) << ColorBits) - 1;
+    static constexpr Pixel AlphaMax = (Pixel(1) << AlphaBits) - 1;
+    static constexpr Pixel RedMask = ColorMax << RedShift;
+    static constexpr Pixel GreenMask = ColorMax << GreenShift;
+    static constexpr Pixel BlueMask = ColorMax << BlueShift;
+    static constexpr Pixel AlphaMask = AlphaMax << AlphaShift;
+
+    /// Whether all channels are single bytes, so that a pixel can be
+    /// interpolated byte by byte regardless of the channel order.
+    static constexpr bool ByteChannels = ColorBits == 8 && AlphaBits == 8;
+
+    static constexpr float ColorScale = static_cast<float>(ColorMax);
+
+    static Pixel Lerp(Pixel a, Pixel b, unsigned w)
+    {
+        auto channel = [&](unsigned shift, Pixel max) {
+            uint32_t const ca = uint32_t((a >> shift) & max);
+            uint32_t const cb = uint32_t((b >> shift) & max);
+            return Pixel(LerpChannel(ca, cb, w)) << shift;
+        };
+        return channel(RedShift, ColorMax) | channel(GreenShift, ColorMax) |
+               channel(BlueShift, ColorMax) | channel(AlphaShift, AlphaMax);
+    }
+
+    /// Color shuffle of DigitalGlitchPS (<c>color.grb</c>): swaps R and G and
+    /// pushes the sum of the channels towards full scale, saturating.
+    static Pixel Shuffle(Pixel p)
+    {
+        int const max = int(ColorMax);
+        int const r = int((p >> RedShift) & ColorMax);
+        int const g = int((p >> GreenShift) & ColorMax);
+        int const b = int((p >> BlueShift) & ColorMax);
+        int const k = (max - (r + g + b)) >> 1;
+
+        Pixel const nr = Pixel(std::clamp(g + k, 0, max));
+        Pixel const ng = Pixel(std::clamp(r + k, 0, max));
+        Pixel const nb = Pixel(std::clamp(b + k, 0, max));
+        return (p & AlphaMask) | (nr << RedShift) | (ng << GreenShift) |
+               (nb << BlueShift);
+    }
+
+    static Color ToColor(Pixel p)
+    {
+        auto channel = [&](unsigned shift, Pixel max) {
+            return static_cast<float>((p >> shift) & max);
+        };
+        return {channel(BlueShift, ColorMax), channel(GreenShift, ColorMax),
+                channel(RedShift, ColorMax), channel(AlphaShift, AlphaMax)};
+    }
+
+    static Pixel FromColor(Color const& c)
+    {
+        auto unorm = [](float v, Pixel max, unsigned shift) {
+            float const clamped = std::clamp(v, 0.0f, static_cast<float>(max));
+            return Pixel(clamped + 0.5f) << shift;
+        };
+        return unorm(c.b, ColorMax, BlueShift) | unorm(c.g, ColorMax, GreenShift) |
+               unorm(c.r, ColorMax, RedShift) | unorm(c.a, AlphaMax, AlphaShift);
+    }
+};
+
+} // namespace details
+
+/// <summary>
+///   Per-format pixel operations used by the CPU kernels: the storage type,
+///   channel masks, fixed point interpolation with 1/256 weights, the color
+///   shuffle and conversions for the scalar reference.
+/// </summary>
+template<PixelFormat Format>
+struct PixelTraits;
+
+template<>
+struct PixelTraits<PixelFormat::Bgra8>
+    : details::PackedUnormTraits<uint32_t, 16, 8, 0, 24, 8, 8>
+{
+    /// Same result as the generic version, with channel pairs interpolated in
+    /// parallel; no lane can overflow into its neighbor.
+    static Pixel Lerp(Pixel a, Pixel b, unsigned w)
+    {
+        uint32_t const iw = 256 - w;
+        uint32_t const rb =
+            (((a & 0x00FF00FF) * iw + (b & 0x00FF00FF) * w + 0x00800080) >> 8) &
+            0x00FF00FF;
+        uint32_t const ag =
+            (((a >> 8) & 0x00FF00FF) * iw + ((b >> 8) & 0x00FF00FF) * w + 0x00800080) &
+            0xFF00FF00;
+        return rb | ag;
+    }
+};
+
+template<>
+struct PixelTraits<PixelFormat::Rgb10A2>
+    : details::PackedUnormTraits<uint32_t, 0, 10, 20, 30, 10, 2>
+{};
+
+template<>
+struct PixelTraits<PixelFormat::Rgba16>
+    : details::PackedUnormTraits<uint64_t, 0, 16, 32, 48, 16, 16>
+{
+    /// Channel pairs in 32-bit lanes, like the BGRA8 version.
+    static Pixel Lerp(Pixel a, Pixel b, unsigned w)
+    {
+        constexpr uint64_t Lanes = 0x0000FFFF0000FFFF;
+        constexpr uint64_t Round = 0x0000008000000080;
+        uint64_t const iw = 256 - w;
+        uint64_t const rb = (((a & Lanes) * iw + (b & Lanes) * w + Round) >> 8) & Lanes;
+        uint64_t const ga =
+            ((((a >> 16) & Lanes) * iw + ((b >> 16) & Lanes) * w + Round) >> 8) & Lanes;
+        return rb | (ga << 16);
+    }
+};
+
+template<>
+struct PixelTraits<PixelFormat::Rgba16F>
+{
+    using Pixel = uint64_t;
+
+    static constexpr Pixel RedMask = 0x000000000000FFFF;
+    static constexpr Pixel GreenMask = 0x00000000FFFF0000;
+    static constexpr Pixel BlueMask = 0x0000FFFF00000000;
+    static constexpr Pixel AlphaMask = 0xFFFF000000000000;
+    static constexpr bool ByteChannels = false;
+    static constexpr float ColorScale = 1.0f;
+
+    static Pixel Lerp(Pixel a, Pixel b, unsigned w)
+    {
+        float const t = static_cast<float>(w) * (1.0f / 256.0f);
+#if GT_HAVE_F16C
+        auto load = [](Pixel const& p) {
+            return _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(&p)));
+        };
+        __m128 const fa = load(a);
+        __m128 const fb = load(b);
+        __m128 const result =
+            _mm_add_ps(fa, _mm_mul_ps(_mm_sub_ps(fb, fa), _mm_set1_ps(t)));
+
+        Pixel p;
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(&p),
+                         _mm_cvtps_ph(result, _MM_FROUND_TO_NEAREST_INT));
+        return p;
+#else
+        Color const ca = ToColor(a);
+        Color const cb = ToColor(b);
+        return FromColor({ca.b + (cb.b - ca.b) * t, ca.g + (cb.g - ca.g) * t,
+                          ca.r + (cb.r - ca.r) * t, ca.a + (cb.a - ca.a) * t});
+#endif
+    }
+
+    /// Floating point version of the shuffle, saturating like the shader.
+    static Pixel Shuffle(Pixel p)
+    {
+        Color const c = ToColor(p);
+        float const k = (1.0f - (c.r + c.g + c.b)) * 0.5f;
+        auto saturate = [](float v) { return std::clamp(v, 0.0f, 1.0f); };
+        return FromColor({saturate(c.b + k), saturate(c.r + k), saturate(c.g + k), c.a});
+    }
+
+    static Color ToColor(Pixel p)
+    {
+        return {HalfToFloat(uint16_t(p >> 32)), HalfToFloat(uint16_t(p >> 16)),
+                HalfToFloat(uint16_t(p)), HalfToFloat(uint16_t(p >> 48))};
+    }
+
+    /// Stores the channels without clamping; HDR values above 1 survive.
+    static Pixel FromColor(Color const& c)
+    {
+        return Pixel(FloatToHalf(c.r)) | (Pixel(FloatToHalf(c.g)) << 16) |
+               (Pixel(FloatToHalf(c.b)) << 32) | (Pixel(FloatToHalf(c.a)) << 48);
+    }
+};
+
+template<PixelFormat Format>
+using PixelType = typename PixelTraits<Format>::Pixel;
+
+} // namespace gt
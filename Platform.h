@@ -0,0 +1,26 @@
+#pragma once
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cstdint>
+
+// Minimal HRESULT vocabulary so that the backend-independent parts of the
+// renderer can keep using the same error handling on non-Windows hosts.
+
+using HRESULT = int32_t;
+
+#define S_OK static_cast<HRESULT>(0x00000000L)
+#define S_FALSE static_cast<HRESULT>(0x00000001L)
+#define E_NOTIMPL static_cast<HRESULT>(0x80004001L)
+#define E_ABORT static_cast<HRESULT>(0x80004004L)
+#define E_FAIL static_cast<HRESULT>(0x80004005L)
+#define E_UNEXPECTED static_cast<HRESULT>(0x8000FFFFL)
+#define E_BOUNDS static_cast<HRESULT>(0x8000000BL)
+#define E_ACCESSDENIED static_cast<HRESULT>(0x80070005L)
+#define E_OUTOFMEMORY static_cast<HRESULT>(0x8007000EL)
+#define E_INVALIDARG static_cast<HRESULT>(0x80070057L)
+
+#define SUCCEEDED(hr) (static_cast<HRESULT>(hr) >= 0)
+#define FAILED(hr) (static_cast<HRESULT>(hr) < 0)
+#endif
@@ -0,0 +1,96 @@
+#include "QualityGovernor.h"
+
+#include "Metrics.h"
+
+#include <algorithm>
+
+namespace gt
+{
+
+char const* GetQualityLevelName(QualityLevel level)
+{
+    switch (level) {
+    case QualityLevel::Full:
+        return "full";
+    case QualityLevel::NearestSampling:
+        return "nearest";
+    case QualityLevel::Blit:
+        return "blit";
+    case QualityLevel::HalfResolution:
+        return "half-resolution";
+    case QualityLevel::SingleEffect:
+        return "single-effect";
+    case QualityLevel::Count:
+        break;
+    }
+    return "unknown";
+}
+
+void QualityGovernor::SetOptions(QualityGovernorOptions const& newOptions)
+{
+    options = newOptions;
+    Reset();
+}
+
+void QualityGovernor::OnFrame(std::chrono::nanoseconds frameTime)
+{
+    if (options.frameBudget.count() <= 0)
+        return;
+
+    double const time = static_cast<double>(frameTime.count());
+    ++framesAtLevel;
+    averageFrameTime =
+        framesAtLevel == 1 ? time : averageFrameTime + (time - averageFrameTime) / 4;
+    if (framesAtLevel < options.settleFrames)
+        return;
+
+    unsigned const index = static_cast<unsigned>(level);
+    double const budget = static_cast<double>(options.frameBudget.count());
+    if (averageFrameTime > budget) {
+        if (index + 1 == static_cast<unsigned>(QualityLevel::Count))
+            return;
+
+        // Overrunning right after stepping up means the level above still
+        // does not fit; wait longer before trying it again.
+        if (steppedUp)
+            holdFrames = std::min(holdFrames * 2, options.maxHoldFrames);
+        steppedUp = false;
+        SetLevel(static_cast<QualityLevel>(index + 1));
+        ++stepsDown;
+        AddToCounter(MetricCounter::QualityStepsDown);
+        return;
+    }
+
+    if (framesAtLevel < holdFrames)
+        return;
+
+    // The last step up held for a whole hold period.
+    if (steppedUp) {
+        steppedUp = false;
+        holdFrames = options.holdFrames;
+    }
+
+    if (averageFrameTime <= budget * options.headroom && level != QualityLevel::Full) {
+        steppedUp = true;
+        SetLevel(static_cast<QualityLevel>(index - 1));
+        ++stepsUp;
+        AddToCounter(MetricCounter::QualityStepsUp);
+    }
+}
+
+void QualityGovernor::Reset()
+{
+    SetLevel(QualityLevel::Full);
+    holdFrames = options.holdFrames;
+    steppedUp = false;
+}
+
+void QualityGovernor::SetLevel(QualityLevel newLevel)
+{
+    level = newLevel;
+    averageFrameTime = 0.0;
+    framesAtLevel = 0;
+    SetGauge(MetricGauge::QualityLevel, static_cast<int64_t>(level));
+}
+
+} // namespace gt
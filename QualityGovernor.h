@@ -0,0 +1,76 @@
+#pragma once
+#include "RenderBackend.h"
+
+#include <chrono>
+#include <cstdint>
+
+namespace gt
+{
+
+char const* GetQualityLevelName(QualityLevel level);
+
+struct QualityGovernorOptions
+{
+    /// Time a frame may take, zero to always render at full quality.
+    std::chrono::nanoseconds frameBudget{0};
+    /// Frames faster than this share of the budget leave room for a more
+    /// expensive level. Paced backends whose frames never finish early use
+    /// a budget above the refresh interval and a headroom of 1.
+    float headroom = 0.75f;
+    /// Frames rendered at a new level before its frame time is trusted.
+    unsigned settleFrames = 4;
+    /// Frames with headroom before stepping back up. Doubles, up to
+    /// maxHoldFrames, whenever stepping up overran the budget right away.
+    unsigned holdFrames = 30;
+    unsigned maxHoldFrames = 960;
+};
+
+/// <summary>
+///   Holds frames within a time budget by stepping down through the
+///   <see cref="QualityLevel"/> modes while frames overrun it, and back up
+///   while they leave headroom. Levels persist across bursts, so a slow
+///   machine starts the next burst where the last one settled.
+/// </summary>
+class QualityGovernor
+{
+public:
+    QualityGovernor() = default;
+    explicit QualityGovernor(QualityGovernorOptions const& options)
+        : options(options)
+    {}
+
+    void SetOptions(QualityGovernorOptions const& newOptions);
+    QualityGovernorOptions const& GetOptions() const { return options; }
+
+    /// Level the next frame renders at.
+    QualityLevel GetLevel() const { return level; }
+
+    /// <summary>
+    ///   Accounts for a frame rendered at <see cref="GetLevel"/> that took
+    ///   <paramref name="frameTime"/>, possibly changing the level.
+    /// </summary>
+    void OnFrame(std::chrono::nanoseconds frameTime);
+
+    /// Returns to full quality and forgets the frame times seen so far.
+    void Reset();
+
+    uint64_t GetStepsDown() const { return stepsDown; }
+    uint64_t GetStepsUp() const { return stepsUp; }
+
+private:
+    void SetLevel(QualityLevel newLevel);
+
+    QualityGovernorOptions options;
+    QualityLevel level = QualityLevel::Full;
+
+    /// Exponential moving average of the frame times at the current level.
+    double averageFrameTime = 0.0;
+    unsigned framesAtLevel = 0;
+    unsigned holdFrames = options.holdFrames;
+    bool steppedUp = false;
+
+    uint64_t stepsDown = 0;
+    uint64_t stepsUp = 0;
+};
+
+} // namespace gt
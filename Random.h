@@ -1,5 +1,9 @@
 #pragma once
 #include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <random>
 
 namespace gt
@@ -47,19 +51,43 @@ private:
     std::array<uint64_t, 2> state_;
 };
 
+/// SplitMix64 finalizer, spreading consecutive indices over all the bits.
+inline uint64_t MixBits(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
 #define RtlGenRandom SystemFunction036
 
-inline float RandomFloat()
+/// Generator behind the overloads without one, seeded by the system.
+inline xorshift128_engine& SharedRandomEngine()
 {
     static xorshift128_engine rng;
-    static std::uniform_real_distribution<float> dist(0.0f,
-                                                      std::nextafter(1.0f, FLT_MAX));
+    return rng;
+}
+
+inline float RandomFloat(xorshift128_engine& rng)
+{
+    std::uniform_real_distribution<float> dist(0.0f, std::nextafter(1.0f, FLT_MAX));
     return dist(rng);
 }
 
+inline float RandomFloat()
+{
+    return RandomFloat(SharedRandomEngine());
+}
+
+inline uint8_t RandomByte(xorshift128_engine& rng)
+{
+    return RandomFloat(rng) * 255;
+}
+
 inline uint8_t RandomByte()
 {
-    return RandomFloat() * 255;
+    return RandomByte(SharedRandomEngine());
 }
 
 inline int RandomInt(int const min, int const max)
@@ -67,13 +95,18 @@ inline int RandomInt(int const min, int const max)
     return static_cast<int>(min + RandomFloat() * (max - min));
 }
 
+inline uint32_t RandomColorBGRA(xorshift128_engine& rng)
+{
+    uint32_t b = RandomByte(rng);
+    uint32_t g = RandomByte(rng);
+    uint32_t r = RandomByte(rng);
+    uint32_t a = RandomByte(rng);
+    return b | (g << 8) | (r << 16) | (a << 24);
+}
+
 inline uint32_t RandomColorBGRA()
 {
-    uint32_t b = RandomByte();
-    uint32_t g = RandomByte();
-    uint32_t r = RandomByte();
-    uint32_t a = RandomByte();
-    return b | (g << 8) | (r << 8) | (a << 8);
+    return RandomColorBGRA(SharedRandomEngine());
 }
 
 } // namespace gt
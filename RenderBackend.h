@@ -0,0 +1,66 @@
+#pragma once
+#include "Platform.h"
+
+namespace gt
+{
+
+class Arena;
+struct BurstFrame;
+
+/// <summary>
+///   Rendering modes of decreasing cost, picked per frame by the
+///   <see cref="QualityGovernor"/>. Every level includes the savings of the
+///   levels before it.
+/// </summary>
+enum class QualityLevel : unsigned
+{
+    Full,
+    /// Nearest instead of bilinear sampling of displaced cells.
+    NearestSampling,
+    /// Cells are copied as rectangles, where a backend has such a mode.
+    Blit,
+    /// The digital glitch runs at half resolution or less, where a backend
+    /// has such a mode.
+    HalfResolution,
+    /// The RGB split is skipped, leaving only the digital glitch.
+    SingleEffect,
+    Count,
+};
+
+/// <summary>Per-frame input handed from the burst schedule to a backend.</summary>
+struct FrameParams
+{
+    unsigned frameCount = 0;
+    float intensity = 0.0f;
+    QualityLevel quality = QualityLevel::Full;
+
+    /// Scratch memory for the frame, rewound once it is presented. Always set
+    /// by <see cref="RenderContext"/>.
+    Arena* arena = nullptr;
+
+    /// Random choices of the frame, decided before the burst. Backends make
+    /// their own when it is not set.
+    BurstFrame const* planned = nullptr;
+};
+
+/// <summary>
+///   Device-specific half of the renderer. A backend owns the capture, the
+///   effect resources and the presentation target, while the burst schedule
+///   itself lives in <see cref="RenderContext"/>.
+/// </summary>
+class IRenderBackend
+{
+public:
+    virtual ~IRenderBackend() {}
+
+    virtual HRESULT RefreshCapture() = 0;
+    virtual HRESULT Resize(unsigned width, unsigned height) = 0;
+
+    /// Renders the glitched capture for one frame of a burst.
+    virtual HRESULT Render(FrameParams const& params) = 0;
+
+    /// Hands the rendered frame to the output. May block for pacing.
+    virtual HRESULT Present() = 0;
+};
+
+} // namespace gt
@@ -0,0 +1,141 @@
+#include "RenderContext.h"
+
+#include "AllocationCounter.h"
+#include "ErrorHandling.h"
+#include "Metrics.h"
+
+#include <cassert>
+#include <chrono>
+
+namespace gt
+{
+
+HRESULT RenderContext::Initialize(std::unique_ptr<IRenderBackend> newBackend)
+{
+    if (initialized)
+        return S_OK;
+    if (!newBackend)
+        return E_INVALIDARG;
+
+    backend = std::move(newBackend);
+    initialized = true;
+    return S_OK;
+}
+
+HRESULT RenderContext::Resize(unsigned newWidth, unsigned newHeight)
+{
+    if (!backend)
+        return S_OK;
+
+    HR(backend->Resize(newWidth, newHeight));
+    warmedUp = false;
+    ++sizeGeneration;
+    return S_OK;
+}
+
+HRESULT RenderContext::RefreshCapture()
+{
+    if (!backend)
+        return S_OK;
+
+    GT_STAGE_SCOPE(MetricStage::RefreshCapture);
+    return backend->RefreshCapture();
+}
+
+Burst RenderContext::StartBurst()
+{
+    if (!initialized)
+        co_return S_OK;
+
+    GT_STAGE_SCOPE(MetricStage::Burst);
+    BurstPlan const& plan = planner.TakePlan();
+    planner.PlanAhead();
+
+    unsigned const generation = sizeGeneration;
+
+#if GT_COUNT_ALLOCATIONS
+    // Only allocations made by the frames themselves count; the host runs
+    // in between.
+    bool const warm = warmedUp;
+    uint64_t allocations = 0;
+    size_t const chunkAllocations = arena.GetChunkAllocations();
+#endif
+
+    for (unsigned i = 0; i < plan.frameCount; ++i) {
+#if GT_COUNT_ALLOCATIONS
+        uint64_t const frameStart = GetAllocationCount();
+#endif
+        BurstFrame const& frame = plan.frames[i];
+        if (frame.refreshCapture) {
+            RefreshCapture();
+        }
+
+        HRESULT const hr = RenderSingleFrame(frame.intensity, &frame);
+        if (FAILED(hr))
+            co_return hr;
+#if GT_COUNT_ALLOCATIONS
+        allocations += GetAllocationCount() - frameStart;
+#endif
+
+        co_yield i;
+    }
+
+    bool const sameSize = generation == sizeGeneration;
+#if GT_COUNT_ALLOCATIONS
+    // Once warmed up, only a burst that needs more scratch memory than any
+    // before it may allocate.
+    assert((!warm || !sameSize || arena.GetChunkAllocations() != chunkAllocations ||
+            allocations == 0) &&
+           "Heap allocation in a warmed up burst");
+#endif
+    warmedUp = sameSize;
+
+    co_return S_OK;
+}
+
+HRESULT RenderContext::RenderFrame()
+{
+    Burst burst = StartBurst();
+    while (burst.Step()) {
+    }
+    return burst.Result();
+}
+
+HRESULT RenderContext::RenderSingleFrame(float intensity, BurstFrame const* planned)
+{
+    GT_STAGE_SCOPE(MetricStage::Frame);
+    ArenaScope const frameScope(arena);
+
+    FrameParams const params = {
+        .frameCount = frameCount,
+        .intensity = intensity,
+        .quality = governor.GetLevel(),
+        .arena = &arena,
+        .planned = planned,
+    };
+
+    auto const start = clock->Now();
+    HR(backend->Render(params));
+    HR(backend->Present());
+    governor.OnFrame(clock->Now() - start);
+    AddToCounter(MetricCounter::Frames);
+    ++frameCount;
+
+    return S_OK;
+}
+
+HRESULT RenderContext::RenderJobFrames(JobPlanner& planner, uint64_t begin, uint64_t end)
+{
+    if (!initialized)
+        return E_UNEXPECTED;
+
+    for (uint64_t i = begin; i < end; ++i) {
+        BurstFrame const& frame = planner.PlanFrame(i);
+        if (frame.refreshCapture)
+            HR(RefreshCapture());
+        HR(RenderSingleFrame(frame.intensity, &frame));
+    }
+    return S_OK;
+}
+
+} // namespace gt
@@ -0,0 +1,80 @@
+#pragma once
+#include "Arena.h"
+#include "Burst.h"
+#include "BurstPlan.h"
+#include "FrameClock.h"
+#include "QualityGovernor.h"
+#include "RenderBackend.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace gt
+{
+
+/// <summary>
+///   Backend-independent burst orchestration: frame counting, capture
+///   refresh cadence, the intensity curve of a glitch burst and the quality
+///   needed to keep its frames within budget.
+/// </summary>
+struct RenderContext
+{
+    HRESULT Initialize(std::unique_ptr<IRenderBackend> newBackend);
+    HRESULT Resize(unsigned newWidth, unsigned newHeight);
+
+    HRESULT RefreshCapture();
+
+    /// <summary>
+    ///   Starts a glitch burst that renders one frame per
+    ///   <see cref="Burst::Step"/>. The previous burst must be destroyed or
+    ///   reset first, even if it is done, and none may outlive the context.
+    /// </summary>
+    Burst StartBurst();
+
+    /// Renders a whole burst at once.
+    HRESULT RenderFrame();
+
+    HRESULT RenderSingleFrame(float intensity = 0.5f,
+                              BurstFrame const* planned = nullptr);
+
+    /// <summary>
+    ///   Renders frames [<paramref name="begin"/>, <paramref name="end"/>) of
+    ///   an offline job, which only depend on <paramref name="planner"/> and
+    ///   the source, not on any frame rendered before.
+    /// </summary>
+    HRESULT RenderJobFrames(JobPlanner& planner, uint64_t begin, uint64_t end);
+
+    /// Starts planning the next burst in the background, such as when its
+    /// timer is armed. Every burst plans the one after itself.
+    void PlanNextBurst() { planner.PlanAhead(); }
+
+    bool initialized = false;
+    unsigned frameCount = 0;
+
+    /// Transient data of the current frame, rewound once it is presented.
+    Arena arena;
+
+    /// Whether a burst ran at the current size, so that the arena, the frame
+    /// pools and the plans have reached their steady state.
+    bool warmedUp = false;
+
+    /// Incremented by every resize, so that bursts can tell whether their
+    /// frames all had the same size.
+    unsigned sizeGeneration = 0;
+
+    /// Picks the quality of every frame from the time the previous ones
+    /// took. Renders everything at full quality until given a budget.
+    QualityGovernor governor;
+
+    /// Intensities, noise and cell decisions of the upcoming bursts.
+    BurstPlanner planner;
+    BurstStorage burstStorage;
+
+    /// Times frames for the governor. Defaults to the steady clock.
+    IFrameClock* clock = &steadyClock;
+    SteadyFrameClock steadyClock;
+
+    std::unique_ptr<IRenderBackend> backend;
+};
+
+} // namespace gt
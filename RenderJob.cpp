@@ -0,0 +1,79 @@
+#include "RenderJob.h"
+
+#include <cstdio>
+
+namespace gt
+{
+
+namespace
+{
+
+/// Reads the stream header of a Y4M shard, including its newline.
+HRESULT ReadHeader(FILE* file, std::string& header)
+{
+    header.clear();
+    for (;;) {
+        int const c = fgetc(file);
+        if (c == EOF)
+            return E_FAIL;
+        header += static_cast<char>(c);
+        if (c == '\n')
+            return S_OK;
+    }
+}
+
+HRESULT AppendShard(StreamFormat format, FILE* part, FILE* output,
+                    std::string& firstHeader, std::vector<char>& buffer)
+{
+    int const first = fgetc(part);
+    if (first == EOF)
+        return S_OK;
+    ungetc(first, part);
+
+    if (format == StreamFormat::Y4m) {
+        std::string header;
+        if (FAILED(ReadHeader(part, header)) || header.rfind("YUV4MPEG2", 0) != 0)
+            return E_FAIL;
+        if (firstHeader.empty()) {
+            firstHeader = header;
+            if (fwrite(header.data(), 1, header.size(), output) != header.size())
+                return E_FAIL;
+        } else if (header != firstHeader) {
+            return E_INVALIDARG;
+        }
+    }
+
+    for (;;) {
+        size_t const read = fread(buffer.data(), 1, buffer.size(), part);
+        if (read > 0 && fwrite(buffer.data(), 1, read, output) != read)
+            return E_FAIL;
+        if (read < buffer.size())
+            return ferror(part) ? E_FAIL : S_OK;
+    }
+}
+
+} // namespace
+
+FrameRange GetShardRange(uint64_t frames, unsigned shard, unsigned shardCount)
+{
+    return {frames * shard / shardCount, frames * (shard + 1) / shardCount};
+}
+
+HRESULT MergeShards(StreamFormat format, std::vector<std::string> const& parts,
+                    FILE* output)
+{
+    std::vector<char> buffer(1 << 20);
+    std::string firstHeader;
+    for (std::string const& path : parts) {
+        FILE* const part = OpenStream(path.c_str(), "rb");
+        if (!part)
+            return E_INVALIDARG;
+        HRESULT const hr = AppendShard(format, part, output, firstHeader, buffer);
+        CloseStream(part);
+        if (FAILED(hr))
+            return hr;
+    }
+    return fflush(output) == 0 ? S_OK : E_FAIL;
+}
+
+} // namespace gt
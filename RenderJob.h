@@ -0,0 +1,35 @@
+#pragma once
+#include "ImageIO.h"
+#include "Platform.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gt
+{
+
+/// Frames [begin, end) of an offline job.
+struct FrameRange
+{
+    uint64_t begin = 0;
+    uint64_t end = 0;
+};
+
+/// <summary>
+///   Frames of shard <paramref name="shard"/> when a job of
+///   <paramref name="frames"/> frames is split into
+///   <paramref name="shardCount"/> contiguous ranges of nearly equal length.
+/// </summary>
+FrameRange GetShardRange(uint64_t frames, unsigned shard, unsigned shardCount);
+
+/// <summary>
+///   Concatenates the outputs of the shards of a job into
+///   <paramref name="output"/>, in the order given. Y4M shards each start with
+///   a header, which must match that of the first one and is only written
+///   once; shards without frames may be empty.
+/// </summary>
+HRESULT MergeShards(StreamFormat format, std::vector<std::string> const& parts,
+                    FILE* output);
+
+} // namespace gt
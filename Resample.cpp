@@ -0,0 +1,264 @@
+#include "Resample.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define GT_HAVE_SSE2 1
+#else
+#define GT_HAVE_SSE2 0
+#endif
+
+namespace gt
+{
+
+namespace
+{
+
+#if GT_HAVE_SSE2
+
+/// <summary>
+///   Sums the channels of the <c>Factor</c> by <c>Factor</c> block starting
+///   at column <paramref name="x"/> of <paramref name="rows"/>. The four
+///   16-bit sums end up in the low half of the result.
+/// </summary>
+template<unsigned Factor>
+__m128i SumBlock(uint32_t const* const (&rows)[Factor], unsigned x)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i sum = zero;
+    for (uint32_t const* row : rows) {
+        if constexpr (Factor == 2) {
+            __m128i const v = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(row + x));
+            sum = _mm_add_epi16(sum, _mm_unpacklo_epi8(v, zero));
+        } else {
+            __m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row + x));
+            __m128i const pairs =
+                _mm_add_epi16(_mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero));
+            sum = _mm_add_epi16(sum, pairs);
+        }
+    }
+    return _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+}
+
+#endif
+
+template<unsigned Factor>
+void DownsampleRow(uint32_t const* const (&rows)[Factor], unsigned sourceWidth,
+                   uint32_t* dest, unsigned destWidth)
+{
+    static_assert(Factor == 2 || Factor == 4);
+    constexpr unsigned Area = Factor * Factor;
+    unsigned x = 0;
+
+#if GT_HAVE_SSE2
+    // Blocks entirely inside the row, two at a time. Sums of 16 channels
+    // still fit 16-bit lanes.
+    constexpr int Shift = Factor == 2 ? 2 : 4;
+    __m128i const half = _mm_set1_epi16(Area / 2);
+    unsigned const innerBlocks = sourceWidth / Factor;
+    for (; x + 2 <= innerBlocks; x += 2) {
+        __m128i const sums = _mm_unpacklo_epi64(SumBlock<Factor>(rows, x * Factor),
+                                                SumBlock<Factor>(rows, (x + 1) * Factor));
+        __m128i const average = _mm_srli_epi16(_mm_add_epi16(sums, half), Shift);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + x),
+                         _mm_packus_epi16(average, average));
+    }
+#endif
+
+    for (; x < destWidth; ++x) {
+        unsigned sums[4] = {};
+        for (uint32_t const* row : rows) {
+            for (unsigned i = 0; i < Factor; ++i) {
+                uint32_t const pixel = row[std::min(x * Factor + i, sourceWidth - 1)];
+                for (unsigned c = 0; c < 4; ++c)
+                    sums[c] += (pixel >> (8 * c)) & 0xFF;
+            }
+        }
+
+        uint32_t average = 0;
+        for (unsigned c = 0; c < 4; ++c)
+            average |= (sums[c] + Area / 2) / Area << (8 * c);
+        dest[x] = average;
+    }
+}
+
+/// Same for formats without a fixed point path, averaging the channels of
+/// every block as colors.
+template<PixelFormat Format, unsigned Factor>
+void DownsampleColorRow(PixelType<Format> const* const (&rows)[Factor],
+                        unsigned sourceWidth, PixelType<Format>* dest, unsigned destWidth)
+{
+    using Traits = PixelTraits<Format>;
+    constexpr float Scale = 1.0f / (Factor * Factor);
+
+    for (unsigned x = 0; x < destWidth; ++x) {
+        Color sum = {};
+        for (PixelType<Format> const* row : rows) {
+            for (unsigned i = 0; i < Factor; ++i) {
+                Color const c =
+                    Traits::ToColor(row[std::min(x * Factor + i, sourceWidth - 1)]);
+                sum.b += c.b;
+                sum.g += c.g;
+                sum.r += c.r;
+                sum.a += c.a;
+            }
+        }
+        dest[x] = Traits::FromColor({sum.b * Scale, sum.g * Scale, sum.r * Scale,
+                                     sum.a * Scale});
+    }
+}
+
+template<PixelFormat Format, unsigned Factor>
+void DownsampleRows(cimage_view<PixelType<Format>> source,
+                    image_view<PixelType<Format>> dest, unsigned rowBegin,
+                    unsigned rowEnd)
+{
+    unsigned const lastRow = source.height() - 1;
+    for (unsigned y = rowBegin; y < rowEnd; ++y) {
+        PixelType<Format> const* rows[Factor];
+        for (unsigned k = 0; k < Factor; ++k)
+            rows[k] = source.row(std::min(y * Factor + k, lastRow)).data();
+
+        if constexpr (Format == PixelFormat::Bgra8) {
+            DownsampleRow<Factor>(rows, source.width(), dest.row(y).data(),
+                                  dest.width());
+        } else {
+            DownsampleColorRow<Format, Factor>(rows, source.width(), dest.row(y).data(),
+                                               dest.width());
+        }
+    }
+}
+
+/// Fills columns [x, end) of a full resolution row by repeating the pixels
+/// of a scaled row. <paramref name="x"/> is a multiple of the factor.
+template<typename Pixel>
+void UpscaleRow(Pixel const* scaled, unsigned factor, Pixel* dest, unsigned x,
+                unsigned end)
+{
+#if GT_HAVE_SSE2
+    // 64-bit pixels only take the plain loop.
+    if constexpr (sizeof(Pixel) == sizeof(uint32_t)) {
+        if (factor == 2) {
+            for (; x + 8 <= end; x += 8) {
+                __m128i const v =
+                    _mm_loadu_si128(reinterpret_cast<__m128i const*>(scaled + x / 2));
+                __m128i* const out = reinterpret_cast<__m128i*>(dest + x);
+                _mm_storeu_si128(out + 0, _mm_unpacklo_epi32(v, v));
+                _mm_storeu_si128(out + 1, _mm_unpackhi_epi32(v, v));
+            }
+        } else if (factor == 4) {
+            for (; x + 16 <= end; x += 16) {
+                __m128i const v =
+                    _mm_loadu_si128(reinterpret_cast<__m128i const*>(scaled + x / 4));
+                __m128i* const out = reinterpret_cast<__m128i*>(dest + x);
+                _mm_storeu_si128(out + 0, _mm_shuffle_epi32(v, 0x00));
+                _mm_storeu_si128(out + 1, _mm_shuffle_epi32(v, 0x55));
+                _mm_storeu_si128(out + 2, _mm_shuffle_epi32(v, 0xAA));
+                _mm_storeu_si128(out + 3, _mm_shuffle_epi32(v, 0xFF));
+            }
+        }
+    }
+#endif
+
+    for (; x < end; ++x)
+        dest[x] = scaled[x / factor];
+}
+
+template<typename Pixel>
+void ComposeScaled(GlitchPlan const& scaledPlan, unsigned factor,
+                   cimage_view<Pixel> source, cimage_view<Pixel> scaled,
+                   image_view<Pixel> dest, unsigned rowBegin, unsigned rowEnd)
+{
+    assert(scaled.width() == scaledPlan.width && scaled.height() == scaledPlan.height &&
+           "Plan was compiled for another size");
+    assert(scaled.width() == GetScaledSize(dest.width(), factor) &&
+           scaled.height() == GetScaledSize(dest.height(), factor) &&
+           "Scaled image size does not match");
+    assert(source.width() == dest.width() && source.height() == dest.height());
+
+    unsigned const width = dest.width();
+    unsigned const height = dest.height();
+    auto const fullBound = [&](uint32_t bound, unsigned size) {
+        return std::min(bound * factor, size);
+    };
+
+    unsigned cy = 0;
+    for (unsigned y = rowBegin; y < rowEnd; ++y) {
+        while (fullBound(scaledPlan.cellY[cy + 1], height) <= y)
+            ++cy;
+
+        Pixel const* const sourceRow = source.row(y).data();
+        Pixel const* const scaledRow = scaled.row(y / factor).data();
+        Pixel* const destRow = dest.row(y).data();
+
+        // Runs of clean cells are copied at once, as are runs of glitched ones.
+        auto const isClean = [&](unsigned cell) {
+            return scaledPlan.Cell(cell, cy).flags == 0;
+        };
+        unsigned cx = 0;
+        while (cx < NoiseGrid::Width) {
+            bool const clean = isClean(cx);
+            unsigned end = cx + 1;
+            while (end < NoiseGrid::Width && isClean(end) == clean)
+                ++end;
+
+            unsigned const x0 = fullBound(scaledPlan.cellX[cx], width);
+            unsigned const x1 = fullBound(scaledPlan.cellX[end], width);
+            cx = end;
+            if (clean)
+                std::memcpy(destRow + x0, sourceRow + x0, (x1 - x0) * sizeof(Pixel));
+            else
+                UpscaleRow(scaledRow, factor, destRow, x0, x1);
+        }
+    }
+}
+
+} // namespace
+
+template<PixelFormat Format>
+void DownsampleBox(cimage_view<PixelType<Format>> source,
+                   image_view<PixelType<Format>> dest, unsigned factor, unsigned rowBegin,
+                   unsigned rowEnd)
+{
+    assert(dest.width() == GetScaledSize(source.width(), factor) &&
+           dest.height() == GetScaledSize(source.height(), factor) &&
+           "Scaled image size does not match");
+
+    if (factor == 2) {
+        DownsampleRows<Format, 2>(source, dest, rowBegin, rowEnd);
+    } else {
+        assert(factor == 4 && "Unsupported downsampling factor");
+        DownsampleRows<Format, 4>(source, dest, rowBegin, rowEnd);
+    }
+}
+
+#define GT_INSTANTIATE_DOWNSAMPLE(Format)                                               \
+    template void DownsampleBox<Format>(cimage_view<PixelType<Format>>,                  \
+                                        image_view<PixelType<Format>>, unsigned,         \
+                                        unsigned, unsigned);
+
+GT_INSTANTIATE_DOWNSAMPLE(PixelFormat::Bgra8)
+GT_INSTANTIATE_DOWNSAMPLE(PixelFormat::Rgb10A2)
+GT_INSTANTIATE_DOWNSAMPLE(PixelFormat::Rgba16)
+GT_INSTANTIATE_DOWNSAMPLE(PixelFormat::Rgba16F)
+
+#undef GT_INSTANTIATE_DOWNSAMPLE
+
+void ComposeScaledGlitch(GlitchPlan const& scaledPlan, unsigned factor,
+                         cimage_view<uint32_t> source, cimage_view<uint32_t> scaled,
+                         image_view<uint32_t> dest, unsigned rowBegin, unsigned rowEnd)
+{
+    ComposeScaled(scaledPlan, factor, source, scaled, dest, rowBegin, rowEnd);
+}
+
+void ComposeScaledGlitch(GlitchPlan const& scaledPlan, unsigned factor,
+                         cimage_view<uint64_t> source, cimage_view<uint64_t> scaled,
+                         image_view<uint64_t> dest, unsigned rowBegin, unsigned rowEnd)
+{
+    ComposeScaled(scaledPlan, factor, source, scaled, dest, rowBegin, rowEnd);
+}
+
+} // namespace gt
@@ -0,0 +1,56 @@
+#pragma once
+#include "CpuGlitch.h"
+#include "Span.h"
+
+#include <cstdint>
+
+namespace gt
+{
+
+/// Width or height of an image downsampled by <paramref name="factor"/>; a
+/// partial block at the edge still yields a pixel.
+constexpr unsigned GetScaledSize(unsigned size, unsigned factor)
+{
+    return (size + factor - 1) / factor;
+}
+
+/// <summary>
+///   Renders rows [<paramref name="rowBegin"/>, <paramref name="rowEnd"/>) of
+///   <paramref name="dest"/> as the average of <paramref name="factor"/> by
+///   <paramref name="factor"/> blocks of <paramref name="source"/>. The factor
+///   must be 2 or 4, and <paramref name="dest"/> must have the size returned
+///   by <see cref="GetScaledSize"/>. Blocks that reach past the edge repeat
+///   its last row and column.
+/// </summary>
+/// <remarks>
+///   BGRA8 blocks are averaged in fixed point, four channels at a time. The
+///   other formats average the channels of their <see cref="Color"/> one
+///   pixel at a time.
+/// </remarks>
+template<PixelFormat Format>
+void DownsampleBox(cimage_view<PixelType<Format>> source,
+                   image_view<PixelType<Format>> dest, unsigned factor, unsigned rowBegin,
+                   unsigned rowEnd);
+
+/// <summary>
+///   Renders rows [<paramref name="rowBegin"/>, <paramref name="rowEnd"/>) of
+///   a full size frame from a digital glitch rendered at reduced resolution.
+///   Cells that <paramref name="scaledPlan"/> leaves clean are copied from
+///   the full resolution <paramref name="source"/>; the others are upscaled
+///   from <paramref name="scaled"/> by repeating its pixels.
+/// </summary>
+/// <remarks>
+///   The plan, compiled for the size of <paramref name="scaled"/>, decides
+///   the cells: its cell bounds times <paramref name="factor"/> are the cell
+///   bounds at full resolution, so every cell maps onto whole scaled pixels.
+///   Pixels are only copied, so both overloads serve every format of their
+///   size.
+/// </remarks>
+void ComposeScaledGlitch(GlitchPlan const& scaledPlan, unsigned factor,
+                         cimage_view<uint32_t> source, cimage_view<uint32_t> scaled,
+                         image_view<uint32_t> dest, unsigned rowBegin, unsigned rowEnd);
+void ComposeScaledGlitch(GlitchPlan const& scaledPlan, unsigned factor,
+                         cimage_view<uint64_t> source, cimage_view<uint64_t> scaled,
+                         image_view<uint64_t> dest, unsigned rowBegin, unsigned rowEnd);
+
+} // namespace gt
@@ -0,0 +1,212 @@
+#include "ScheduleCheck.h"
+
+#include "BurstPlan.h"
+#include "FrameClock.h"
+#include "QualityGovernor.h"
+#include "RenderBackend.h"
+#include "RenderContext.h"
+
+#include <array>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <memory>
+
+namespace gt
+{
+
+namespace
+{
+
+using namespace std::chrono_literals;
+
+/// Time a frame takes at every quality level. Only half resolution and the
+/// levels below it hold the budget.
+constexpr std::array<std::chrono::nanoseconds, static_cast<size_t>(QualityLevel::Count)>
+    FrameTimes = {30ms, 24ms, 20ms, 12ms, 6ms};
+constexpr std::chrono::nanoseconds FrameBudget = 16ms;
+
+/// Shortest burst of <see cref="RenderContext::StartBurst"/> plus its
+/// closing frame.
+constexpr unsigned MinFrames = 15;
+
+struct ScriptedFrame
+{
+    float intensity;
+    QualityLevel quality;
+    bool planned;
+};
+
+/// <summary>
+///   Backend that renders nothing: it records what it is asked to do and
+///   advances the clock by the time of the quality level of every frame.
+/// </summary>
+class ScriptedBackend : public IRenderBackend
+{
+public:
+    explicit ScriptedBackend(ManualFrameClock& clock)
+        : clock(clock)
+    {
+        // Warmed up bursts assert that their frames do not allocate.
+        frames.reserve(BurstPlan::MaxFrames);
+        refreshes.reserve(BurstPlan::MaxFrames);
+    }
+
+    HRESULT RefreshCapture() override
+    {
+        refreshes.push_back(static_cast<unsigned>(frames.size()));
+        return S_OK;
+    }
+
+    HRESULT Resize(unsigned, unsigned) override { return S_OK; }
+
+    HRESULT Render(FrameParams const& params) override
+    {
+        frames.push_back({params.intensity, params.quality, params.planned != nullptr});
+        clock.Advance(FrameTimes[static_cast<size_t>(params.quality)]);
+        return S_OK;
+    }
+
+    HRESULT Present() override { return S_OK; }
+
+    void Clear()
+    {
+        frames.clear();
+        refreshes.clear();
+    }
+
+    std::vector<ScriptedFrame> frames;
+    /// Index of the frame every capture refresh came before.
+    std::vector<unsigned> refreshes;
+
+private:
+    ManualFrameClock& clock;
+};
+
+/// Keeps the first failure of <paramref name="result"/>.
+void Fail(ScheduleCheckResult& result, unsigned burst, char const* format, ...)
+{
+    if (!result.Passed())
+        return;
+
+    char message[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    result.failure = "burst " + std::to_string(burst) + ": " + message;
+}
+
+} // namespace
+
+std::vector<ScheduleCheckResult> RunScheduleCheck(ScheduleCheckOptions const& options)
+{
+    std::vector<ScheduleCheckResult> results(3);
+    ScheduleCheckResult& frames = results[0];
+    ScheduleCheckResult& refresh = results[1];
+    ScheduleCheckResult& quality = results[2];
+    frames.name = "frames";
+    refresh.name = "refresh";
+    quality.name = "quality";
+
+    ManualFrameClock clock;
+    auto backend = std::make_unique<ScriptedBackend>(clock);
+    ScriptedBackend& scripted = *backend;
+
+    QualityGovernorOptions governorOptions;
+    governorOptions.frameBudget = FrameBudget;
+
+    RenderContext rc;
+    rc.clock = &clock;
+    rc.governor.SetOptions(governorOptions);
+    if (FAILED(rc.Initialize(std::move(backend)))) {
+        Fail(frames, 0, "cannot initialize the render context");
+        return results;
+    }
+
+    // Replays the scripted frame times, so that the levels the context picks
+    // can be told from those of a governor timed by hand.
+    QualityGovernor reference(governorOptions);
+
+    std::vector<unsigned> yielded;
+    std::vector<size_t> renderedAtStep;
+    yielded.reserve(BurstPlan::MaxFrames);
+    renderedAtStep.reserve(BurstPlan::MaxFrames);
+
+    for (unsigned burst = 0; burst < options.bursts; ++burst) {
+        scripted.Clear();
+        yielded.clear();
+        renderedAtStep.clear();
+        unsigned const firstFrame = rc.frameCount;
+
+        {
+            Burst steps = rc.StartBurst();
+            if (!scripted.frames.empty())
+                Fail(frames, burst, "rendered before its first step");
+
+            while (steps.Step()) {
+                yielded.push_back(steps.Frame());
+                renderedAtStep.push_back(scripted.frames.size());
+            }
+            if (FAILED(steps.Result()))
+                Fail(frames, burst, "failed with 0x%08X",
+                     static_cast<unsigned>(steps.Result()));
+            if (steps.Step())
+                Fail(frames, burst, "stepped past its end");
+        }
+
+        unsigned const count = static_cast<unsigned>(scripted.frames.size());
+        frames.bursts = refresh.bursts = quality.bursts = burst + 1;
+        frames.frames = refresh.frames = quality.frames = frames.frames + count;
+
+        if (count < MinFrames || count > BurstPlan::MaxFrames)
+            Fail(frames, burst, "rendered %u frames", count);
+        if (yielded.size() != count)
+            Fail(frames, burst, "yielded %zu times for %u frames", yielded.size(), count);
+        if (rc.frameCount - firstFrame != count)
+            Fail(frames, burst, "counted %u frames for %u rendered",
+                 rc.frameCount - firstFrame, count);
+        for (unsigned i = 0; i < yielded.size(); ++i) {
+            if (yielded[i] != i || renderedAtStep[i] != i + 1)
+                Fail(frames, burst, "step %u yielded frame %u after %zu frames", i,
+                     yielded[i], renderedAtStep[i]);
+        }
+        for (unsigned i = 0; i < count; ++i) {
+            if (!scripted.frames[i].planned)
+                Fail(frames, burst, "frame %u was not planned", i);
+        }
+        if (count > 0 && scripted.frames.back().intensity != 0.0f)
+            Fail(frames, burst, "closing frame at intensity %.3f",
+                 scripted.frames.back().intensity);
+
+        // Every tenth frame refreshes the capture first, except the closing
+        // frame.
+        unsigned expectedRefreshes = 0;
+        for (unsigned i = 9; i + 1 < count; i += 10, ++expectedRefreshes) {
+            if (expectedRefreshes >= scripted.refreshes.size() ||
+                scripted.refreshes[expectedRefreshes] != i) {
+                Fail(refresh, burst, "no capture refresh before frame %u", i);
+            }
+        }
+        if (scripted.refreshes.size() != expectedRefreshes)
+            Fail(refresh, burst, "%zu capture refreshes, expected %u",
+                 scripted.refreshes.size(), expectedRefreshes);
+
+        for (unsigned i = 0; i < count; ++i) {
+            QualityLevel const expected = reference.GetLevel();
+            if (scripted.frames[i].quality != expected)
+                Fail(quality, burst, "frame %u at %s quality, expected %s", i,
+                     GetQualityLevelName(scripted.frames[i].quality),
+                     GetQualityLevelName(expected));
+            reference.OnFrame(FrameTimes[static_cast<size_t>(expected)]);
+        }
+    }
+
+    // A governor that never left full quality would pass without the clock.
+    if (options.bursts > 0 && reference.GetStepsDown() == 0)
+        Fail(quality, 0, "the scripted frame times never lowered the quality");
+
+    return results;
+}
+
+} // namespace gt
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace gt
+{
+
+struct ScheduleCheckOptions
+{
+    unsigned bursts = 20;
+};
+
+struct ScheduleCheckResult
+{
+    /// Part of the schedule checked, e.g. "refresh".
+    std::string name;
+    unsigned bursts = 0;
+    unsigned frames = 0;
+    /// First mismatch found, empty if the check passed.
+    std::string failure;
+
+    bool Passed() const { return failure.empty(); }
+};
+
+/// <summary>
+///   Steps glitch bursts of a <see cref="RenderContext"/> one frame at a
+///   time through a scripted backend, timed by a
+///   <see cref="ManualFrameClock"/> that advances by a fixed time per
+///   quality level, and checks the schedule: the frames every
+///   <see cref="Burst"/> yields, the frames the capture is refreshed before
+///   and the quality the governor picks for each frame. The results only
+///   depend on the scripted times, not on the machine.
+/// </summary>
+std::vector<ScheduleCheckResult> RunScheduleCheck(ScheduleCheckOptions const& options);
+
+} // namespace gt
@@ -0,0 +1,464 @@
+#include "SessionServer.h"
+
+#include "Arena.h"
+#include "CpuGlitch.h"
+#include "ImageBuffer.h"
+#include "MathUtils.h"
+#include "NoiseGrid.h"
+#include "Random.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <thread>
+
+namespace gt
+{
+
+struct SessionServer::Session
+{
+    enum class Phase
+    {
+        Glitch,
+        Split,
+    };
+
+    explicit Session(SessionOptions options)
+        : options(std::move(options))
+        , rng(this->options.seed, ~this->options.seed)
+        , uniform(0.0f, std::nextafter(1.0f, FLT_MAX))
+    {}
+
+    SessionOptions options;
+    unsigned index = 0;
+    unsigned width = 0;
+    unsigned height = 0;
+    unsigned bandCount = 0;
+    Clock::duration period{0};
+
+    // Effect chain, only touched by the worker running the serial steps of
+    // the current frame.
+    xorshift128_engine rng;
+    std::uniform_real_distribution<float> uniform;
+    NoiseGrid noise;
+    CellDecisions cells;
+    CpuDigitalGlitch glitch;
+    CpuChromaticSplit split;
+    Arena arena;
+
+    ImageBuffer input;
+    cimage_view<uint32_t> capture;
+    ImageBuffer effectTarget;
+    ImageBuffer output;
+
+    // Current frame; published to the workers running its bands by pushing
+    // them.
+    Phase phase = Phase::Glitch;
+    bool splitFrame = false;
+    std::atomic<unsigned> bandsLeft{0};
+    std::atomic<int64_t> busyNs{0};
+
+    // Scheduling, guarded by the server mutex.
+    bool inFlight = false;
+    bool finished = false;
+    unsigned frame = 0;
+    Clock::time_point start;
+    Clock::time_point lastFinish;
+    Clock::time_point ready;
+    Clock::time_point nominalDeadline;
+    Clock::time_point deadline;
+    Clock::time_point previousDeadline;
+    /// Worker time of a frame, averaged over the last few.
+    double cost = 0.0;
+
+    SessionStats stats;
+    double queueDelaySum = 0.0;
+    double latencySum = 0.0;
+
+    /// Time the current or next frame may start at the frame rate.
+    Clock::time_point Release() const { return start + period * frame; }
+
+    /// Takes the session out of scheduling; called with the server mutex held.
+    void Finish(HRESULT hr, Clock::time_point now)
+    {
+        finished = true;
+        inFlight = false;
+        stats.result = hr;
+        stats.elapsed = std::chrono::duration<double>(now - start).count();
+    }
+};
+
+SessionServer::SessionServer(unsigned threadCount)
+    : threadCount(threadCount ? threadCount
+                              : std::max(std::thread::hardware_concurrency(), 1u))
+{}
+
+SessionServer::~SessionServer() = default;
+
+HRESULT SessionServer::AddSession(SessionOptions options, unsigned& index)
+{
+    if (!options.source)
+        return E_INVALIDARG;
+
+    auto session = std::make_unique<Session>(std::move(options));
+    SessionOptions const& added = session->options;
+    unsigned width = added.width;
+    unsigned height = added.height;
+    if (width == 0 || height == 0)
+        added.source->GetSize(width, height);
+    if (width == 0 || height == 0)
+        return E_INVALIDARG;
+
+    session->index = static_cast<unsigned>(sessions.size());
+    session->width = width;
+    session->height = height;
+    session->bandCount = (height + RowGrain - 1) / RowGrain;
+    if (added.frameRate > 0) {
+        session->period = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / added.frameRate));
+    }
+
+    session->noise.Generate(session->rng);
+    session->glitch.Resize(width, height);
+    session->effectTarget.Resize(width, height);
+    session->output.Resize(width, height);
+
+    index = session->index;
+    sessions.push_back(std::move(session));
+    return S_OK;
+}
+
+std::string const& SessionServer::GetSessionName(unsigned index) const
+{
+    return sessions[index]->options.name;
+}
+
+SessionStats SessionServer::GetSessionStats(unsigned index) const
+{
+    Session const& session = *sessions[index];
+    SessionStats stats = session.stats;
+    if (stats.frames > 0) {
+        stats.averageQueueDelay = session.queueDelaySum / stats.frames;
+        stats.averageLatency = session.latencySum / stats.frames;
+    }
+    return stats;
+}
+
+HRESULT SessionServer::Run()
+{
+    // Every band of every session may be queued on one worker at once.
+    size_t bands = 0;
+    for (auto const& session : sessions)
+        bands += session->bandCount;
+    queues.clear();
+    for (unsigned i = 0; i < threadCount; ++i)
+        queues.push_back(std::make_unique<WorkStealingQueue<Task>>(bands));
+
+    Clock::time_point const start = Clock::now();
+    for (auto const& session : sessions) {
+        session->start = start;
+        session->lastFinish = start;
+        session->previousDeadline = start;
+    }
+    activeSessions = static_cast<unsigned>(sessions.size());
+
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount - 1);
+    for (unsigned i = 1; i < threadCount; ++i)
+        workers.emplace_back([this, i] { WorkerMain(i); });
+    WorkerMain(0);
+    for (auto& worker : workers)
+        worker.join();
+
+    for (auto const& session : sessions) {
+        if (FAILED(session->stats.result))
+            return session->stats.result;
+    }
+    return S_OK;
+}
+
+SessionServer::Session* SessionServer::PickSession(Clock::time_point now,
+                                                   Clock::time_point& nextRelease)
+{
+    Session* best = nullptr;
+    Clock::time_point bestDeadline;
+    for (auto const& session : sessions) {
+        if (session->inFlight || session->finished)
+            continue;
+
+        Clock::time_point const release = session->Release();
+        if (release > now) {
+            nextRelease = std::min(nextRelease, release);
+            continue;
+        }
+
+        Clock::time_point const deadline = GetDeadline(*session);
+        if (!best || deadline < bestDeadline) {
+            best = session.get();
+            bestDeadline = deadline;
+        }
+    }
+    return best;
+}
+
+SessionServer::Clock::time_point SessionServer::GetDeadline(Session const& session) const
+{
+    Clock::time_point const release = session.Release();
+    Clock::time_point const nominal =
+        session.period.count() > 0 ? release + session.period
+                                   : std::max(release, session.lastFinish);
+
+    // Space the frames by what the fair share of the workers sustains.
+    double const share = double(threadCount) / std::max(activeSessions, 1u);
+    auto const spacing = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(session.cost / share));
+    return std::max(nominal, session.previousDeadline + spacing);
+}
+
+bool SessionServer::FindVictim(unsigned worker, unsigned& victim,
+                               Clock::time_point& deadline)
+{
+    bool found = false;
+    for (unsigned i = 1; i < threadCount; ++i) {
+        unsigned const candidate = (worker + i) % threadCount;
+        Task task;
+        if (!queues[candidate]->Peek(task))
+            continue;
+
+        Clock::time_point const taskDeadline = sessions[task >> 32]->deadline;
+        if (!found || taskDeadline < deadline) {
+            found = true;
+            victim = candidate;
+            deadline = taskDeadline;
+        }
+    }
+    return found;
+}
+
+void SessionServer::ReserveFrame(Session& session, Clock::time_point now)
+{
+    Clock::time_point const release = session.Release();
+    session.inFlight = true;
+    session.ready = std::max(release, session.lastFinish);
+    session.nominalDeadline = release + session.period;
+    session.deadline = GetDeadline(session);
+
+    double const delay = std::chrono::duration<double>(now - session.ready).count();
+    session.queueDelaySum += delay;
+    session.stats.maxQueueDelay = std::max(session.stats.maxQueueDelay, delay);
+}
+
+SessionServer::Session* SessionServer::PreemptFor(Clock::time_point deadline,
+                                                  Clock::time_point now)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Clock::time_point nextRelease = Clock::time_point::max();
+    Session* const session = PickSession(now, nextRelease);
+    if (!session || !(GetDeadline(*session) < deadline))
+        return nullptr;
+
+    ReserveFrame(*session, now);
+    return session;
+}
+
+void SessionServer::StartFrame(unsigned worker, Session& session)
+{
+    GT_TRACE_SCOPE("StartFrame");
+    SessionOptions const& options = session.options;
+
+    HRESULT hr = options.source->MapFrame(session.width, session.height, session.capture);
+    if (hr == E_NOTIMPL) {
+        if (session.input.Empty())
+            session.input.Resize(session.width, session.height);
+        session.capture = session.input.View();
+        hr = options.source->Capture(session.input.View());
+    }
+    if (FAILED(hr)) {
+        // A shared frame source ends the stream when its producer is gone.
+        FinishSession(session, hr == E_ABORT ? S_OK : hr);
+        return;
+    }
+
+    // Same choices as a planned burst, from the generator of the session.
+    float const intensity = options.schedule.Evaluate(session.frame);
+    if (session.uniform(session.rng) > Lerp(0.9f, 0.5f, intensity))
+        session.noise.Generate(session.rng);
+    bool const trashFrame2 = !(session.uniform(session.rng) > 0.5f);
+    session.cells.Evaluate(session.noise, intensity);
+
+    session.arena.Reset();
+    session.glitch.intensity = intensity;
+    session.glitch.Update(session.arena, session.noise, session.cells, trashFrame2);
+
+    // Like the backends, the RGB split is skipped for clean frames.
+    session.splitFrame = options.chromaticSplit && intensity > 0.0f;
+    session.split.intensity = intensity;
+    session.phase = Session::Phase::Glitch;
+    session.busyNs.store(0, std::memory_order_relaxed);
+    PushBands(worker, session);
+}
+
+void SessionServer::PushBands(unsigned worker, Session& session)
+{
+    session.bandsLeft.store(session.bandCount, std::memory_order_relaxed);
+    Task const base = Task(session.index) << 32;
+    for (unsigned band = 0; band < session.bandCount; ++band) {
+        bool const pushed = queues[worker]->Push(base | band);
+        assert(pushed && "Queues hold every band of every session");
+        (void)pushed;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++workEpoch;
+    }
+    wakeWorkers.notify_all();
+}
+
+void SessionServer::RunTask(unsigned worker, Task task)
+{
+    Session& session = *sessions[task >> 32];
+    unsigned const rowBegin = static_cast<unsigned>(task) * RowGrain;
+    unsigned const rowEnd = std::min(rowBegin + RowGrain, session.height);
+
+    Clock::time_point const begin = Clock::now();
+    if (session.phase == Session::Phase::Glitch) {
+        GT_TRACE_SCOPE("DigitalGlitch");
+        ImageBuffer& target = session.splitFrame ? session.effectTarget : session.output;
+        session.glitch.OnRenderImage(session.capture, target.View(), rowBegin, rowEnd);
+    } else {
+        GT_TRACE_SCOPE("ChromaticSplit");
+        session.split.OnRenderImage(session.effectTarget, session.output, rowBegin,
+                                    rowEnd);
+    }
+    session.busyNs.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin)
+            .count(),
+        std::memory_order_relaxed);
+
+    if (session.bandsLeft.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        AdvanceFrame(worker, session);
+}
+
+void SessionServer::AdvanceFrame(unsigned worker, Session& session)
+{
+    if (session.phase == Session::Phase::Glitch && session.splitFrame) {
+        session.phase = Session::Phase::Split;
+        session.split.Update();
+        PushBands(worker, session);
+        return;
+    }
+
+    FinishFrame(session);
+}
+
+void SessionServer::FinishFrame(Session& session)
+{
+    IFrameSink* const sink = session.options.sink;
+    HRESULT const hr = sink ? sink->WriteFrame(session.output) : S_OK;
+    Clock::time_point const now = Clock::now();
+    double const busy = session.busyNs.load(std::memory_order_relaxed) * 1e-9;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        SessionStats& stats = session.stats;
+        ++stats.frames;
+        stats.busy += busy;
+        session.latencySum += std::chrono::duration<double>(now - session.ready).count();
+        if (session.period.count() > 0 && now > session.nominalDeadline)
+            ++stats.deadlineMisses;
+
+        session.cost = session.cost == 0.0 ? busy : Lerp(session.cost, busy, 0.1);
+        session.lastFinish = now;
+        session.previousDeadline = session.deadline;
+        session.inFlight = false;
+        ++session.frame;
+
+        unsigned const frames = session.options.frames;
+        if (FAILED(hr) || (frames > 0 && session.frame >= frames)) {
+            session.Finish(hr, now);
+            --activeSessions;
+        }
+        ++workEpoch;
+    }
+    wakeWorkers.notify_all();
+}
+
+void SessionServer::FinishSession(Session& session, HRESULT hr)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        session.Finish(hr, Clock::now());
+        --activeSessions;
+        ++workEpoch;
+    }
+    wakeWorkers.notify_all();
+}
+
+void SessionServer::WorkerMain(unsigned worker)
+{
+    if (worker > 0)
+        SetTraceThreadName("Session worker");
+    WorkStealingQueue<Task>& queue = *queues[worker];
+    Clock::time_point nextCheck;
+
+    for (;;) {
+        Task task;
+        if (queue.Pop(task)) {
+            // Between bands, now and then, look for a frame due before the
+            // one the band belongs to; its bands then go first.
+            Clock::time_point const now = Clock::now();
+            if (now >= nextCheck) {
+                nextCheck = now + PreemptionInterval;
+                Session* const urgent = PreemptFor(sessions[task >> 32]->deadline, now);
+                if (urgent) {
+                    queue.Push(task);
+                    StartFrame(worker, *urgent);
+                    continue;
+                }
+            }
+            RunTask(worker, task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (activeSessions == 0)
+            return;
+
+        // Start the most urgent frame, unless a band already under way is
+        // due sooner.
+        Clock::time_point const now = Clock::now();
+        Clock::time_point nextRelease = Clock::time_point::max();
+        Session* const session = PickSession(now, nextRelease);
+        unsigned victim = 0;
+        Clock::time_point bandDeadline;
+        bool const canSteal = FindVictim(worker, victim, bandDeadline);
+
+        if (session && (!canSteal || GetDeadline(*session) < bandDeadline)) {
+            ReserveFrame(*session, now);
+            lock.unlock();
+            StartFrame(worker, *session);
+            continue;
+        }
+
+        if (canSteal) {
+            lock.unlock();
+            if (queues[victim]->Steal(task))
+                RunTask(worker, task);
+            continue;
+        }
+
+        uint64_t const epoch = workEpoch;
+        auto const changed = [&] { return workEpoch != epoch || activeSessions == 0; };
+        if (nextRelease == Clock::time_point::max())
+            wakeWorkers.wait(lock, changed);
+        else
+            wakeWorkers.wait_until(lock, nextRelease, changed);
+    }
+}
+
+} // namespace gt
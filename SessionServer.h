@@ -0,0 +1,160 @@
+#pragma once
+#include "FrameSink.h"
+#include "FrameSource.h"
+#include "IntensitySchedule.h"
+#include "Platform.h"
+#include "WorkStealingQueue.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace gt
+{
+
+/// <summary>One independent stream hosted by a <see cref="SessionServer"/>.</summary>
+struct SessionOptions
+{
+    std::string name;
+    std::unique_ptr<IFrameSource> source;
+    /// Receives the glitched frames, on whichever worker finished them; may
+    /// be null to only glitch.
+    IFrameSink* sink = nullptr;
+
+    /// Processing size; zero takes the native size of the source.
+    unsigned width = 0;
+    unsigned height = 0;
+
+    /// Seed of the noise, trash frame and cell choices, so that a session
+    /// glitches the same way whatever else the server runs.
+    uint64_t seed = 1;
+    IntensitySchedule schedule;
+    /// Effect chain: the digital glitch, followed by the RGB split if set.
+    bool chromaticSplit = true;
+
+    /// Frames per second the session is due to deliver, which sets the
+    /// deadline of every frame; zero processes frames as fast as its share
+    /// of the pool allows.
+    unsigned frameRate = 0;
+    /// Frames to process; zero runs until the source ends, like a
+    /// <see cref="SharedFrameSource"/> whose producer is gone.
+    unsigned frames = 0;
+};
+
+/// <summary>Throughput and delays of one session, in seconds.</summary>
+struct SessionStats
+{
+    unsigned frames = 0;
+    double elapsed = 0.0;
+    /// Worker time spent on the frames of the session.
+    double busy = 0.0;
+
+    /// Time from a frame being ready, i.e. released by the frame rate and
+    /// its predecessor finished, to a worker starting it.
+    double averageQueueDelay = 0.0;
+    double maxQueueDelay = 0.0;
+    /// Time from a frame being ready to it being handed to the sink.
+    double averageLatency = 0.0;
+    /// Frames finished after their deadline; only counted at a frame rate.
+    unsigned deadlineMisses = 0;
+
+    HRESULT result = S_OK;
+};
+
+/// <summary>
+///   Glitches many independent streams on one set of worker threads, so that
+///   they share the frame buffers of one process and the threads of one
+///   pool instead of each running a pool of its own. Every frame of a session
+///   runs as row band tasks on per-worker <see cref="WorkStealingQueue"/>s:
+///   a worker keeps splitting and running the frames it started, and steals
+///   bands of other frames when it runs out.
+/// </summary>
+/// <remarks>
+///   <para>
+///   Frames are started earliest deadline first, with one frame in flight
+///   per session. Idle workers start a new frame instead of stealing when it
+///   is due before the most urgent band they could steal, and busy workers
+///   check between bands whether a frame is due before the one they work on,
+///   so that a long frame cannot hold the workers while short ones are due.
+///   </para>
+///   <para>
+///   Deadlines alone would let a session whose frames cost more than the
+///   pool can afford, such as an 8K stream among 1080p ones, fall ever
+///   further behind and then win every pick. So the deadlines of a session
+///   are also spaced by what its fair share of the workers can sustain: the
+///   measured cost of its frames divided by the threads per active session.
+///   A session that needs less than its share keeps its frame rate; one that
+///   needs more gets its share and falls behind on its own.
+///   </para>
+/// </remarks>
+class SessionServer
+{
+public:
+    /// <summary>
+    ///   Creates a server of <paramref name="threadCount"/> workers including
+    ///   the thread calling <see cref="Run"/>. Zero uses one per hardware
+    ///   thread.
+    /// </summary>
+    explicit SessionServer(unsigned threadCount = 0);
+    ~SessionServer();
+
+    SessionServer(SessionServer const&) = delete;
+    SessionServer& operator=(SessionServer const&) = delete;
+
+    unsigned ThreadCount() const { return threadCount; }
+
+    /// Adds a session and allocates its frame buffers; returns its index in
+    /// <paramref name="index"/>. Must not be called while running.
+    HRESULT AddSession(SessionOptions options, unsigned& index);
+
+    /// <summary>
+    ///   Runs every session until it processed its frames, its source ended or
+    ///   it failed. Returns the first failure; the others are in the stats.
+    /// </summary>
+    HRESULT Run();
+
+    size_t GetSessionCount() const { return sessions.size(); }
+    std::string const& GetSessionName(unsigned index) const;
+    SessionStats GetSessionStats(unsigned index) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /// Session index in the high half and band in the low half.
+    using Task = uint64_t;
+
+    /// How often a worker busy with bands checks for more urgent frames.
+    static constexpr std::chrono::microseconds PreemptionInterval{500};
+
+    struct Session;
+
+    Session* PickSession(Clock::time_point now, Clock::time_point& nextRelease);
+    Clock::time_point GetDeadline(Session const& session) const;
+    bool FindVictim(unsigned worker, unsigned& victim, Clock::time_point& deadline);
+    void ReserveFrame(Session& session, Clock::time_point now);
+    Session* PreemptFor(Clock::time_point deadline, Clock::time_point now);
+    void StartFrame(unsigned worker, Session& session);
+    void PushBands(unsigned worker, Session& session);
+    void RunTask(unsigned worker, Task task);
+    void AdvanceFrame(unsigned worker, Session& session);
+    void FinishFrame(Session& session);
+    void FinishSession(Session& session, HRESULT hr);
+    void WorkerMain(unsigned worker);
+
+    unsigned threadCount;
+    std::vector<std::unique_ptr<Session>> sessions;
+    std::vector<std::unique_ptr<WorkStealingQueue<Task>>> queues;
+
+    std::mutex mutex;
+    std::condition_variable wakeWorkers;
+    /// Bumped whenever there may be new work, so that workers going to
+    /// sleep notice bands pushed since they last looked.
+    uint64_t workEpoch = 0;
+    unsigned activeSessions = 0;
+};
+
+} // namespace gt
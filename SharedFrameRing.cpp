@@ -0,0 +1,381 @@
+#include "SharedFrameRing.h"
+
+#include "ErrorHandling.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <new>
+
+namespace gt
+{
+
+namespace
+{
+
+constexpr size_t PageSize = 4096;
+
+size_t AlignToPage(size_t bytes)
+{
+    return (bytes + PageSize - 1) & ~(PageSize - 1);
+}
+
+} // namespace
+
+#ifndef _WIN32
+bool SharedFrameRing::IsAbandoned(char const* path)
+{
+    int const file = shm_open(path, O_RDONLY, 0);
+    if (file < 0)
+        return false;
+
+    void* view = MAP_FAILED;
+    struct stat status;
+    if (fstat(file, &status) == 0 &&
+        static_cast<size_t>(status.st_size) >= sizeof(Header))
+        view = mmap(nullptr, sizeof(Header), PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+    if (view == MAP_FAILED)
+        return false;
+
+    // Without the magic, the producer may still be setting the ring up.
+    auto const* const existing = static_cast<Header const*>(view);
+    bool abandoned = false;
+    if (existing->magic.load(std::memory_order_acquire) == Magic &&
+        existing->version == Version) {
+        pid_t const producer = static_cast<pid_t>(existing->producerId);
+        abandoned = kill(producer, 0) != 0 && errno == ESRCH;
+    }
+    munmap(view, sizeof(Header));
+    return abandoned;
+}
+#endif
+
+SharedFrameRing::~SharedFrameRing()
+{
+    Close();
+}
+
+uint32_t* SharedFrameRing::SlotPixels(uint32_t slot) const
+{
+    auto const base = reinterpret_cast<uint8_t*>(header);
+    return reinterpret_cast<uint32_t*>(base + header->slotOffset +
+                                       slot * header->slotBytes);
+}
+
+HRESULT SharedFrameRing::Create(char const* newName, unsigned width, unsigned height)
+{
+    if (header || width == 0 || height == 0)
+        return header ? E_UNEXPECTED : E_INVALIDARG;
+
+    size_t const slotOffset = AlignToPage(sizeof(Header));
+    size_t const slotBytes = AlignToPage(size_t(width) * height * sizeof(uint32_t));
+    size_t const bytes = slotOffset + SlotCount * slotBytes;
+
+#ifdef _WIN32
+    name = std::string("Local\\") + newName;
+    mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                 static_cast<DWORD>(uint64_t(bytes) >> 32),
+                                 static_cast<DWORD>(bytes), name.c_str());
+    if (!mapping)
+        return E_ACCESSDENIED;
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        // Another producer is still running; sharing its ring would break
+        // the single producer protocol.
+        Close();
+        return E_ACCESSDENIED;
+    }
+    event = CreateEventA(nullptr, FALSE, FALSE, (name + ".frame").c_str());
+    void* const view = event ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0)
+                             : nullptr;
+    if (!view) {
+        Close();
+        return E_OUTOFMEMORY;
+    }
+#else
+    name = newName[0] == '/' ? newName : std::string("/") + newName;
+    int file = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (file < 0 && errno == EEXIST && IsAbandoned(name.c_str())) {
+        // Unlike file mappings, shared memory objects outlive a producer that
+        // crashed. Rings of live producers are left alone, as on Windows.
+        shm_unlink(name.c_str());
+        file = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    }
+    if (file < 0)
+        return E_ACCESSDENIED;
+    void* view = MAP_FAILED;
+    if (ftruncate(file, static_cast<off_t>(bytes)) == 0)
+        view = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    close(file);
+    if (view == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return E_OUTOFMEMORY;
+    }
+#endif
+
+    owner = true;
+    mappedBytes = bytes;
+    header = new (view) Header();
+    header->version = Version;
+    header->width = width;
+    header->height = height;
+    header->slotOffset = slotOffset;
+    header->slotBytes = slotBytes;
+    // The producer starts out with slot 0 and the consumer with slot 2.
+    header->latest.store(1, std::memory_order_relaxed);
+    header->consumerSlot = 2;
+#ifdef _WIN32
+    header->producerId = GetCurrentProcessId();
+#else
+    header->producerId = static_cast<uint32_t>(getpid());
+#endif
+    header->magic.store(Magic, std::memory_order_release);
+    return S_OK;
+}
+
+HRESULT SharedFrameRing::Open(char const* newName)
+{
+    if (header)
+        return E_UNEXPECTED;
+
+    void* view = nullptr;
+    size_t bytes = 0;
+#ifdef _WIN32
+    name = std::string("Local\\") + newName;
+    mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+    if (!mapping)
+        return E_INVALIDARG;
+    event = OpenEventA(SYNCHRONIZE, FALSE, (name + ".frame").c_str());
+    view = event ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0) : nullptr;
+    MEMORY_BASIC_INFORMATION info;
+    if (!view || !VirtualQuery(view, &info, sizeof(info))) {
+        if (view)
+            UnmapViewOfFile(view);
+        Close();
+        return E_ACCESSDENIED;
+    }
+    bytes = info.RegionSize;
+#else
+    name = newName[0] == '/' ? newName : std::string("/") + newName;
+    int const file = shm_open(name.c_str(), O_RDWR, 0);
+    if (file < 0)
+        return E_INVALIDARG;
+    struct stat status;
+    if (fstat(file, &status) == 0 && status.st_size > 0) {
+        bytes = static_cast<size_t>(status.st_size);
+        view = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    }
+    close(file);
+    if (!view || view == MAP_FAILED)
+        return E_ACCESSDENIED;
+#endif
+
+    header = static_cast<Header*>(view);
+    mappedBytes = bytes;
+    // A producer still setting up its ring has not written the magic yet.
+    if (bytes < sizeof(Header) ||
+        header->magic.load(std::memory_order_acquire) != Magic ||
+        header->version != Version ||
+        bytes < header->slotOffset + SlotCount * header->slotBytes) {
+        Close();
+        return E_FAIL;
+    }
+    return S_OK;
+}
+
+void SharedFrameRing::Close()
+{
+#ifdef _WIN32
+    if (header)
+        UnmapViewOfFile(header);
+    if (event)
+        CloseHandle(event);
+    if (mapping)
+        CloseHandle(mapping);
+    event = nullptr;
+    mapping = nullptr;
+#else
+    if (header)
+        munmap(header, mappedBytes);
+    // Consumers keep their mapping; the name is free for the next producer.
+    if (owner)
+        shm_unlink(name.c_str());
+#endif
+    header = nullptr;
+    mappedBytes = 0;
+    owner = false;
+}
+
+void SharedFrameRing::Signal()
+{
+#ifdef _WIN32
+    SetEvent(event);
+#else
+    syscall(SYS_futex, &header->latest, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+void SharedFrameRing::WaitForChange(uint32_t seen, unsigned timeoutMs)
+{
+#ifdef _WIN32
+    if (header->latest.load(std::memory_order_acquire) == seen)
+        WaitForSingleObject(event, timeoutMs);
+#else
+    // Not FUTEX_PRIVATE_FLAG: the word is shared with another process.
+    timespec const timeout = {static_cast<time_t>(timeoutMs / 1000),
+                              static_cast<long>(timeoutMs % 1000) * 1000000};
+    syscall(SYS_futex, &header->latest, FUTEX_WAIT, seen, &timeout, nullptr, 0);
+#endif
+}
+
+SharedFrameWriter::~SharedFrameWriter()
+{
+    Close();
+}
+
+HRESULT SharedFrameWriter::Create(char const* newName, unsigned width, unsigned height)
+{
+    HR(SharedFrameRing::Create(newName, width, height));
+    producerSlot = 0;
+    published = 0;
+    return S_OK;
+}
+
+image_view<uint32_t> SharedFrameWriter::BeginFrame()
+{
+    return {SlotPixels(producerSlot), header->width, header->height};
+}
+
+void SharedFrameWriter::PublishFrame()
+{
+    header->slotFrame[producerSlot] = ++published;
+
+    // Swap the written slot for the one holding the previous frame, which
+    // the consumer may have taken in the meantime.
+    uint32_t latest = header->latest.load(std::memory_order_relaxed);
+    uint32_t next;
+    do {
+        uint32_t const count = latest & ~(Latest::SlotMask | Latest::FreshBit);
+        next = (count + Latest::FrameStep) | Latest::FreshBit | producerSlot;
+    } while (!header->latest.compare_exchange_weak(latest, next,
+                                                   std::memory_order_acq_rel,
+                                                   std::memory_order_relaxed));
+    producerSlot = latest & Latest::SlotMask;
+    Signal();
+}
+
+HRESULT SharedFrameWriter::WriteFrame(ImageBuffer const& frame)
+{
+    if (!header)
+        return E_UNEXPECTED;
+
+    CopyImage(frame.View(), BeginFrame());
+    PublishFrame();
+    return S_OK;
+}
+
+void SharedFrameWriter::Close()
+{
+    if (!header)
+        return;
+
+    header->latest.fetch_or(Latest::ClosedBit, std::memory_order_release);
+    Signal();
+    SharedFrameRing::Close();
+}
+
+HRESULT SharedFrameSource::Open(char const* newName, unsigned newTimeoutMs)
+{
+    HR(SharedFrameRing::Open(newName));
+    timeoutMs = newTimeoutMs;
+    acquired = false;
+    frame = 0;
+    skipped = 0;
+    return S_OK;
+}
+
+void SharedFrameSource::GetSize(unsigned& width, unsigned& height) const
+{
+    width = Width();
+    height = Height();
+}
+
+HRESULT SharedFrameSource::AcquireNewest()
+{
+    if (!header)
+        return E_UNEXPECTED;
+
+    auto const deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    uint32_t latest = header->latest.load(std::memory_order_acquire);
+    for (;;) {
+        if (latest & Latest::FreshBit) {
+            uint32_t const next = (latest & ~(Latest::SlotMask | Latest::FreshBit)) |
+                                  header->consumerSlot;
+            if (!header->latest.compare_exchange_weak(latest, next,
+                                                      std::memory_order_acq_rel,
+                                                      std::memory_order_acquire)) {
+                continue;
+            }
+            header->consumerSlot = latest & Latest::SlotMask;
+            break;
+        }
+
+        // Nothing new: keep the frame read so far, or the frame a previous
+        // consumer left in the slot.
+        if (acquired || header->slotFrame[header->consumerSlot] != 0) {
+            if ((latest & Latest::ClosedBit) &&
+                header->slotFrame[header->consumerSlot] == frame) {
+                return E_ABORT;
+            }
+            break;
+        }
+
+        auto const now = std::chrono::steady_clock::now();
+        if ((latest & Latest::ClosedBit) || now >= deadline)
+            return E_ABORT;
+        auto const remaining =
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now);
+        WaitForChange(latest, static_cast<unsigned>(remaining.count()) + 1);
+        latest = header->latest.load(std::memory_order_acquire);
+    }
+
+    uint64_t const newest = header->slotFrame[header->consumerSlot];
+    if (acquired && newest > frame + 1)
+        skipped += newest - frame - 1;
+    frame = newest;
+    acquired = true;
+    return S_OK;
+}
+
+HRESULT SharedFrameSource::Capture(image_view<uint32_t> dest)
+{
+    HR(AcquireNewest());
+    cimage_view<uint32_t> const pixels(SlotPixels(header->consumerSlot), header->width,
+                                       header->height);
+    CopyImage(pixels, dest);
+    return S_OK;
+}
+
+HRESULT SharedFrameSource::MapFrame(unsigned width, unsigned height,
+                                    cimage_view<uint32_t>& view)
+{
+    if (!header || width != header->width || height != header->height)
+        return E_NOTIMPL;
+
+    HR(AcquireNewest());
+    view = {SlotPixels(header->consumerSlot), header->width, header->height};
+    return S_OK;
+}
+
+} // namespace gt
@@ -0,0 +1,199 @@
+#pragma once
+#include "FrameSink.h"
+#include "FrameSource.h"
+#include "ImageBuffer.h"
+#include "Platform.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace gt
+{
+
+/// <summary>
+///   Shared memory between a process producing frames, e.g. a capture
+///   process, and a process glitching them: a POSIX shared memory object, or
+///   a file mapping on Windows. It holds a header and three frame slots that
+///   form a triple buffer: the producer owns one slot to write into, the
+///   consumer owns one to read from, and the third holds the newest frame
+///   until one of them swaps it for their own. Neither side ever waits for
+///   the other, frames are written once and read in place, and a consumer
+///   that falls behind skips straight to the newest frame.
+/// </summary>
+/// <remarks>
+///   One producer and one consumer at a time. The consumer waits for new
+///   frames on a futex in the header, or on a named event on Windows.
+/// </remarks>
+class SharedFrameRing
+{
+public:
+    static constexpr unsigned SlotCount = 3;
+
+    SharedFrameRing() = default;
+    ~SharedFrameRing();
+
+    SharedFrameRing(SharedFrameRing const&) = delete;
+    SharedFrameRing& operator=(SharedFrameRing const&) = delete;
+
+    unsigned Width() const { return header ? header->width : 0; }
+    unsigned Height() const { return header ? header->height : 0; }
+
+protected:
+    /// <summary>
+    ///   State of the triple buffer, in one word so that it can be swapped
+    ///   and waited on atomically: the slot holding the newest frame, whether
+    ///   the consumer has taken that frame yet, whether the producer is gone,
+    ///   and the number of frames published.
+    /// </summary>
+    struct Latest
+    {
+        static constexpr uint32_t SlotMask = 0x3;
+        static constexpr uint32_t FreshBit = 0x4;
+        static constexpr uint32_t ClosedBit = 0x8;
+        static constexpr uint32_t FrameStep = 0x10;
+    };
+
+    /// Layout at the start of the mapping; the slots follow at page aligned
+    /// offsets, with tightly packed rows like <see cref="ImageBuffer"/>.
+    struct Header
+    {
+        std::atomic<uint32_t> magic;
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint64_t slotOffset;
+        uint64_t slotBytes;
+        std::atomic<uint32_t> latest;
+        /// Slot owned by the consumer, kept here so that a consumer started
+        /// later takes over the slot of the previous one.
+        uint32_t consumerSlot;
+        /// Number of the frame in each slot, starting at 1.
+        uint64_t slotFrame[SlotCount];
+        /// Process id of the producer, so that the next one can tell a ring
+        /// still in use from one left behind by a producer that died.
+        uint32_t producerId;
+    };
+
+    static_assert(std::atomic<uint32_t>::is_always_lock_free,
+                  "Shared memory needs address-free atomics");
+
+    static constexpr uint32_t Magic = 0x52464753; // "SGFR"
+    static constexpr uint32_t Version = 2;
+
+    HRESULT Create(char const* name, unsigned width, unsigned height);
+    HRESULT Open(char const* name);
+    void Close();
+
+    uint32_t* SlotPixels(uint32_t slot) const;
+
+    /// Wakes a consumer waiting in <see cref="WaitForChange"/>.
+    void Signal();
+
+    /// <summary>
+    ///   Waits until <see cref="Header::latest"/> no longer holds
+    ///   <paramref name="seen"/>, or for at most
+    ///   <paramref name="timeoutMs"/>. May return early.
+    /// </summary>
+    void WaitForChange(uint32_t seen, unsigned timeoutMs);
+
+#ifndef _WIN32
+    /// <summary>
+    ///   Whether the ring at <paramref name="path"/> was left behind by a
+    ///   producer that is no longer running. Rings that are still being set
+    ///   up or have another layout count as in use.
+    /// </summary>
+    static bool IsAbandoned(char const* path);
+#endif
+
+    Header* header = nullptr;
+    size_t mappedBytes = 0;
+    bool owner = false;
+
+private:
+    std::string name;
+#ifdef _WIN32
+    HANDLE mapping = nullptr;
+    HANDLE event = nullptr;
+#endif
+};
+
+/// <summary>
+///   Producer end of a <see cref="SharedFrameRing"/>. Frames are written into
+///   the slot returned by <see cref="BeginFrame"/> and handed to the consumer
+///   by <see cref="PublishFrame"/>; <see cref="WriteFrame"/> does both for
+///   frames that already exist elsewhere, such as presented frames.
+/// </summary>
+class SharedFrameWriter : public SharedFrameRing, public IFrameSink
+{
+public:
+    ~SharedFrameWriter();
+
+    /// <summary>
+    ///   Creates the ring <paramref name="name"/> for frames of the given
+    ///   size. Fails with <c>E_ACCESSDENIED</c> while another producer runs
+    ///   a ring of that name; one left behind by a producer that died is
+    ///   replaced.
+    /// </summary>
+    HRESULT Create(char const* name, unsigned width, unsigned height);
+
+    /// Slot to write the next frame into; its previous content is undefined.
+    image_view<uint32_t> BeginFrame();
+
+    /// Makes the frame written since <see cref="BeginFrame"/> the newest.
+    void PublishFrame();
+
+    /// Copies <paramref name="frame"/> into a slot and publishes it,
+    /// resampling it if its size differs from the size of the ring.
+    HRESULT WriteFrame(ImageBuffer const& frame) override;
+
+    /// Tells the consumer that no more frames follow and removes the ring.
+    void Close();
+
+    uint64_t GetPublishedFrames() const { return published; }
+
+private:
+    uint32_t producerSlot = 0;
+    uint64_t published = 0;
+};
+
+/// <summary>
+///   Consumer end of a <see cref="SharedFrameRing"/>. Lends the newest frame
+///   in place to backends whose render size matches the ring, and copies it
+///   otherwise.
+/// </summary>
+class SharedFrameSource : public SharedFrameRing, public IFrameSource
+{
+public:
+    /// <summary>
+    ///   Opens the ring <paramref name="name"/> of a running producer. The
+    ///   first capture waits up to <paramref name="timeoutMs"/> for the first
+    ///   frame; later ones return the newest frame right away, the same one
+    ///   again if nothing was published in between. Once the producer is gone
+    ///   and its last frame was captured, captures fail with <c>E_ABORT</c>.
+    /// </summary>
+    HRESULT Open(char const* name, unsigned timeoutMs = 5000);
+
+    void GetSize(unsigned& width, unsigned& height) const override;
+    HRESULT Capture(image_view<uint32_t> dest) override;
+    HRESULT MapFrame(unsigned width, unsigned height,
+                     cimage_view<uint32_t>& view) override;
+
+    /// Number of the frame returned by the last capture, and of the frames
+    /// the producer published in between that were never captured.
+    uint64_t GetFrame() const { return frame; }
+    uint64_t GetSkippedFrames() const { return skipped; }
+
+private:
+    /// Swaps the newest frame for the slot read so far, if there is a newer
+    /// one. Waits for the first frame.
+    HRESULT AcquireNewest();
+
+    unsigned timeoutMs = 0;
+    bool acquired = false;
+    uint64_t frame = 0;
+    uint64_t skipped = 0;
+};
+
+} // namespace gt
@@ -1,10 +1,15 @@
 #pragma once
 #include "TypeTraits.h"
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <iterator>
+#include <limits>
+#include <type_traits>
 #include <utility>
 
 namespace gt
@@ -580,6 +585,275 @@ constexpr cspan<T> make_cspan(T const (&array)[N])
     return cspan<T>(array);
 }
 
+/// <summary>
+///   Non-owning view of a two-dimensional array of pixels. Rows are
+///   <c>row_pitch()</c> bytes apart, which may be more than
+///   <c>width() * sizeof(PixelType)</c> (for example for mapped GPU textures
+///   or a subview of a larger image).
+/// </summary>
+/// <remarks>
+///   The pitch is always a multiple of <c>alignof(PixelType)</c>, so every row
+///   is suitably aligned for the pixel type and stepping between rows never
+///   needs casts at the call site. Stronger alignment (e.g. for vector loads)
+///   can be queried with <see cref="is_aligned"/>.
+/// </remarks>
+template<typename PixelType>
+class image_view
+{
+public:
+    using element_type = PixelType;
+    using value_type = std::remove_cv_t<PixelType>;
+    using index_type = std::size_t;
+    using pointer = element_type*;
+    using reference = element_type&;
+    using row_type = span<element_type>;
+
+    static_assert(is_complete_v<PixelType>, "Pixel type must be complete");
+    static_assert(!std::is_abstract_v<PixelType>, "Pixel type must not be abstract");
+
+    /// Forward iterator over the rows of a view, yielding a span per row.
+    class row_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = row_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = row_type;
+
+        constexpr row_iterator() noexcept = default;
+
+        constexpr row_iterator(image_view const& view, index_type y) noexcept
+            : view_(&view)
+            , y_(y)
+        {}
+
+        constexpr row_type operator*() const { return view_->row(y_); }
+
+        constexpr row_iterator& operator++() noexcept
+        {
+            ++y_;
+            return *this;
+        }
+
+        constexpr row_iterator operator++(int) noexcept
+        {
+            row_iterator result = *this;
+            ++y_;
+            return result;
+        }
+
+        constexpr bool operator==(row_iterator const& other) const noexcept
+        {
+            return y_ == other.y_;
+        }
+
+        constexpr bool operator!=(row_iterator const& other) const noexcept
+        {
+            return y_ != other.y_;
+        }
+
+    private:
+        image_view const* view_ = nullptr;
+        index_type y_ = 0;
+    };
+
+    // construction
+
+    constexpr image_view() noexcept = default;
+
+    /// Tightly packed image, rows <c>width * sizeof(PixelType)</c> bytes apart.
+    constexpr image_view(pointer data, index_type width, index_type height) noexcept
+        : image_view(data, width, height, width * sizeof(element_type))
+    {}
+
+    /// Image with rows <paramref name="row_pitch"/> bytes apart.
+    constexpr image_view(pointer data, index_type width, index_type height,
+                         index_type row_pitch) noexcept
+        : data_(data)
+        , width_(width)
+        , height_(height)
+        , row_pitch_(row_pitch)
+    {
+        assert((data != nullptr || width == 0 || height == 0) && "Null image data");
+        assert(row_pitch >= width * sizeof(element_type) && "Rows overlap");
+        assert(row_pitch % alignof(element_type) == 0 && "Misaligned row pitch");
+    }
+
+    template<typename OtherPixelType,
+             typename = std::enable_if_t<
+                 std::is_convertible_v<OtherPixelType (*)[], element_type (*)[]>>>
+    constexpr image_view(image_view<OtherPixelType> const& other) noexcept
+        : data_(other.data())
+        , width_(other.width())
+        , height_(other.height())
+        , row_pitch_(other.row_pitch())
+    {}
+
+    constexpr image_view(image_view const& other) noexcept = default;
+    constexpr image_view& operator=(image_view const& other) noexcept = default;
+
+    // observers
+
+    constexpr index_type width() const noexcept { return width_; }
+    constexpr index_type height() const noexcept { return height_; }
+
+    /// Distance between the starts of two consecutive rows, in bytes.
+    constexpr index_type row_pitch() const noexcept { return row_pitch_; }
+
+    /// Bytes of pixel data in one row, excluding padding.
+    constexpr index_type row_size_bytes() const noexcept
+    {
+        return width_ * sizeof(element_type);
+    }
+
+    /// Bytes spanned from the first pixel to the end of the last row. The
+    /// padding after the last row is not part of the view.
+    constexpr index_type size_bytes() const noexcept
+    {
+        return empty() ? 0 : (height_ - 1) * row_pitch_ + row_size_bytes();
+    }
+
+    [[nodiscard]] constexpr bool empty() const noexcept
+    {
+        return width_ == 0 || height_ == 0;
+    }
+
+    /// Whether the rows follow each other without padding, so that the whole
+    /// view can be treated as one span.
+    constexpr bool is_contiguous() const noexcept
+    {
+        return row_pitch_ == row_size_bytes() || height_ <= 1;
+    }
+
+    /// Whether the start of every row is aligned to <paramref name="alignment"/>
+    /// bytes, which must be a power of two.
+    bool is_aligned(index_type alignment) const noexcept
+    {
+        assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+        auto const address = reinterpret_cast<std::uintptr_t>(data_);
+        return ((address | (height_ > 1 ? row_pitch_ : 0)) & (alignment - 1)) == 0;
+    }
+
+    // element access
+
+    constexpr pointer data() const noexcept { return data_; }
+
+    constexpr row_type row(index_type y) const
+    {
+        assert(y < height_ && "Row out of range");
+        return {row_pointer(y), width_};
+    }
+
+    constexpr reference operator()(index_type x, index_type y) const
+    {
+        assert(x < width_ && y < height_ && "Pixel out of range");
+        return row_pointer(y)[x];
+    }
+
+    /// All pixels as one span. Only valid for contiguous views.
+    constexpr row_type pixels() const
+    {
+        assert(is_contiguous() && "Image rows are padded");
+        return {data_, width_ * height_};
+    }
+
+    // subviews
+
+    constexpr image_view subview(index_type x, index_type y, index_type width,
+                                 index_type height) const
+    {
+        assert(x <= width_ && width <= width_ - x && "Subview columns out of range");
+        assert(y <= height_ && height <= height_ - y && "Subview rows out of range");
+        if (width == 0 || height == 0)
+            return {data_, 0, 0, row_pitch_};
+        return {row_pointer(y) + x, width, height, row_pitch_};
+    }
+
+    /// Rows [<paramref name="begin"/>, <paramref name="end"/>) of the view.
+    constexpr image_view rows(index_type begin, index_type end) const
+    {
+        assert(begin <= end && "Invalid row range");
+        return subview(0, begin, width_, end - begin);
+    }
+
+    /// Number of tiles of the given size needed to cover the view.
+    constexpr index_type tiles_x(index_type tile_width) const
+    {
+        assert(tile_width != 0);
+        return (width_ + tile_width - 1) / tile_width;
+    }
+
+    constexpr index_type tiles_y(index_type tile_height) const
+    {
+        assert(tile_height != 0);
+        return (height_ + tile_height - 1) / tile_height;
+    }
+
+    /// Tile (<paramref name="tx"/>, <paramref name="ty"/>) of a grid of
+    /// <paramref name="tile_width"/> x <paramref name="tile_height"/> tiles
+    /// anchored at the top left corner. Tiles on the right and bottom edges
+    /// are clipped to the view.
+    constexpr image_view tile(index_type tx, index_type ty, index_type tile_width,
+                              index_type tile_height) const
+    {
+        assert(tx < tiles_x(tile_width) && ty < tiles_y(tile_height) &&
+               "Tile out of range");
+        index_type const x = tx * tile_width;
+        index_type const y = ty * tile_height;
+        return subview(x, y, std::min(tile_width, width_ - x),
+                       std::min(tile_height, height_ - y));
+    }
+
+    // row iteration
+
+    constexpr row_iterator begin() const noexcept { return {*this, 0}; }
+    constexpr row_iterator end() const noexcept { return {*this, height_}; }
+
+private:
+    using byte_pointer =
+        std::conditional_t<std::is_const_v<element_type>, std::byte const*, std::byte*>;
+
+    constexpr pointer row_pointer(index_type y) const noexcept
+    {
+        return reinterpret_cast<pointer>(reinterpret_cast<byte_pointer>(data_) +
+                                         y * row_pitch_);
+    }
+
+    pointer data_ = nullptr;
+    index_type width_ = 0;
+    index_type height_ = 0;
+    index_type row_pitch_ = 0;
+};
+
+template<typename T>
+using cimage_view = image_view<T const>;
+
+/// <summary>
+///   Copies the pixels of <paramref name="source"/> to <paramref name="dest"/>,
+///   which must have the same size. Views that are both contiguous are copied
+///   in one go, anything else row by row.
+/// </summary>
+template<typename T, typename U>
+void copy_pixels(image_view<T> source, image_view<U> dest)
+{
+    static_assert(std::is_same_v<std::remove_cv_t<T>, U>, "Pixel types differ");
+    static_assert(std::is_trivially_copyable_v<U>, "Pixels must be trivially copyable");
+    assert(source.width() == dest.width() && source.height() == dest.height() &&
+           "Image sizes differ");
+
+    if (source.empty())
+        return;
+
+    if (source.is_contiguous() && dest.is_contiguous()) {
+        std::memcpy(dest.data(), source.data(), source.size_bytes());
+        return;
+    }
+
+    for (std::size_t y = 0; y < source.height(); ++y)
+        std::memcpy(dest.row(y).data(), source.row(y).data(), source.row_size_bytes());
+}
+
 } // namespace gt
 
 namespace std
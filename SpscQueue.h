@@ -0,0 +1,290 @@
+#pragma once
+#include "Metrics.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace gt
+{
+
+/// Size of the cache lines that the two ends of a queue keep apart.
+constexpr size_t CacheLineSize = 64;
+
+/// What a producer does when its consumer falls behind.
+enum class OverflowPolicy
+{
+    /// Wait for the consumer to catch up.
+    Block,
+    /// Take back the oldest queued item and reuse it for the newest.
+    DropOldest,
+};
+
+/// <summary>Traffic and occupancy of an <see cref="SpscQueue"/>.</summary>
+struct QueueStats
+{
+    uint64_t pushes = 0;
+    uint64_t pops = 0;
+    uint64_t drops = 0;
+
+    /// Pushes that waited for space and pops that waited for items.
+    uint64_t producerWaits = 0;
+    uint64_t consumerWaits = 0;
+
+    /// Items queued right after each push, including the pushed one.
+    uint64_t maxOccupancy = 0;
+    double averageOccupancy = 0.0;
+};
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4324) // Padded due to alignment specifier
+#endif
+
+/// <summary>
+///   Bounded FIFO of handles, such as pointers to pooled frame buffers,
+///   between exactly one producer and one consumer thread. Transfers take
+///   no locks: each end owns an index and its counters on a cache line of
+///   its own, and the consumer only rereads the producer's index when its
+///   cached copy says the queue is empty.
+///   <see cref="Push"/> waits while the queue is full and <see cref="Pop"/>
+///   while it is empty. After <see cref="Close"/>, pushes fail and pops
+///   drain the remaining items before failing.
+/// </summary>
+/// <remarks>
+///   Whoever holds a handle owns the buffer behind it: the producer until it
+///   is pushed, the consumer once it is popped. The ring is allocated up
+///   front, so the queue never allocates after construction.
+/// </remarks>
+template<typename T>
+class SpscQueue
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Queue items are handles");
+
+public:
+    /// <summary>
+    ///   Creates a queue of <paramref name="capacity"/> items. Unless they are
+    ///   <c>Count</c>, the time every item spent queued is recorded as a
+    ///   sample of <paramref name="latencyStage"/>, and the occupancy after
+    ///   every push is published as <paramref name="occupancyGauge"/>.
+    /// </summary>
+    explicit SpscQueue(size_t capacity, MetricStage latencyStage = MetricStage::Count,
+                       MetricGauge occupancyGauge = MetricGauge::Count)
+        : capacity(capacity < 1 ? 1 : capacity)
+        , slots(std::make_unique<Slot[]>(this->capacity))
+        , latencyStage(latencyStage)
+        , occupancyGauge(occupancyGauge)
+    {}
+
+    SpscQueue(SpscQueue const&) = delete;
+    SpscQueue& operator=(SpscQueue const&) = delete;
+
+    /// Producer: appends <paramref name="item"/>, waiting while the queue is
+    /// full. Returns false once the queue is closed.
+    bool Push(T item)
+    {
+        uint64_t const t = producer.tail.load(std::memory_order_relaxed);
+        uint64_t h = consumer.head.load(std::memory_order_acquire);
+        for (bool waited = false;; waited = true) {
+            if (IsClosed(h))
+                return false;
+            if (Count(t) - Count(h) < capacity) {
+                if (waited)
+                    Bump(producer.waits);
+                break;
+            }
+            consumer.head.wait(h, std::memory_order_acquire);
+            h = consumer.head.load(std::memory_order_acquire);
+        }
+
+        Slot& slot = slots[Count(t) % capacity];
+        slot.item.store(item, std::memory_order_relaxed);
+        if (latencyStage != MetricStage::Count)
+            slot.pushedAt.store(Now(), std::memory_order_relaxed);
+
+        uint64_t const occupancy = Count(t) - Count(h) + 1;
+        Bump(producer.pushes);
+        Bump(producer.occupancySum, occupancy);
+        if (occupancy > producer.maxOccupancy.load(std::memory_order_relaxed))
+            producer.maxOccupancy.store(occupancy, std::memory_order_relaxed);
+        if (occupancyGauge != MetricGauge::Count)
+            SetGauge(occupancyGauge, static_cast<int64_t>(occupancy));
+
+        producer.tail.fetch_add(Step, std::memory_order_release);
+        producer.tail.notify_one();
+        return true;
+    }
+
+    /// Consumer: removes the oldest item, waiting while the queue is empty.
+    /// Returns false once the queue is closed and drained.
+    bool Pop(T& item)
+    {
+        bool waited = false;
+        for (;;) {
+            if (TryPop(item)) {
+                if (waited)
+                    Bump(consumer.waits);
+                return true;
+            }
+
+            uint64_t const t = producer.tail.load(std::memory_order_acquire);
+            if (Count(t) != Count(consumer.head.load(std::memory_order_acquire)))
+                continue;
+            if (IsClosed(t))
+                return false;
+            producer.tail.wait(t, std::memory_order_acquire);
+            waited = true;
+        }
+    }
+
+    /// Consumer: pops without waiting. Returns false if the queue is empty.
+    bool TryPop(T& item)
+    {
+        uint64_t h = consumer.head.load(std::memory_order_acquire);
+        // Dropped items may have taken the head past the cached tail.
+        if (Count(h) >= Count(consumer.cachedTail)) {
+            consumer.cachedTail = producer.tail.load(std::memory_order_acquire);
+            if (Count(h) == Count(consumer.cachedTail))
+                return false;
+        }
+
+        int64_t pushedAt = 0;
+        if (!TakeOldest(item, h, consumer.cachedTail, pushedAt))
+            return false;
+
+        Bump(consumer.pops);
+        if (latencyStage != MetricStage::Count)
+            RecordStageLatency(latencyStage, std::chrono::nanoseconds(Now() - pushedAt));
+        return true;
+    }
+
+    /// <summary>
+    ///   Producer: takes back the oldest item the consumer has not popped
+    ///   yet, e.g. to reuse its buffer for a newer frame when the consumer
+    ///   falls behind. Returns false if the queue is empty.
+    /// </summary>
+    bool DropOldest(T& item)
+    {
+        uint64_t const t = producer.tail.load(std::memory_order_relaxed);
+        uint64_t h = consumer.head.load(std::memory_order_acquire);
+        int64_t pushedAt = 0;
+        if (!TakeOldest(item, h, t, pushedAt))
+            return false;
+
+        Bump(producer.drops);
+        return true;
+    }
+
+    /// Wakes both ends; may be called from any thread.
+    void Close()
+    {
+        consumer.head.fetch_or(ClosedBit, std::memory_order_acq_rel);
+        producer.tail.fetch_or(ClosedBit, std::memory_order_acq_rel);
+        consumer.head.notify_all();
+        producer.tail.notify_all();
+    }
+
+    /// Snapshot of the counters; may be called from any thread.
+    QueueStats GetStats() const
+    {
+        QueueStats stats;
+        stats.pushes = producer.pushes.load(std::memory_order_relaxed);
+        stats.pops = consumer.pops.load(std::memory_order_relaxed);
+        stats.drops = producer.drops.load(std::memory_order_relaxed);
+        stats.producerWaits = producer.waits.load(std::memory_order_relaxed);
+        stats.consumerWaits = consumer.waits.load(std::memory_order_relaxed);
+        stats.maxOccupancy = producer.maxOccupancy.load(std::memory_order_relaxed);
+        if (stats.pushes > 0) {
+            uint64_t const sum = producer.occupancySum.load(std::memory_order_relaxed);
+            stats.averageOccupancy =
+                static_cast<double>(sum) / static_cast<double>(stats.pushes);
+        }
+        return stats;
+    }
+
+private:
+    // Indices count pushes and pops in steps of two; the low bit marks a
+    // closed queue, so that waiting on an index also wakes up on Close.
+    static constexpr uint64_t Step = 2;
+    static constexpr uint64_t ClosedBit = 1;
+
+    static uint64_t Count(uint64_t index) { return index / Step; }
+    static bool IsClosed(uint64_t index) { return (index & ClosedBit) != 0; }
+
+    static int64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    /// Counters only ever written by one thread need no read-modify-write.
+    static void Bump(std::atomic<uint64_t>& counter, uint64_t value = 1)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value,
+                      std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    ///   Advances the head past the oldest item, which both ends may try at
+    ///   once when the producer drops items. <paramref name="h"/> is the
+    ///   head last seen and is updated on failure; <paramref name="t"/> is a
+    ///   tail at least as old.
+    /// </summary>
+    bool TakeOldest(T& item, uint64_t& h, uint64_t t, int64_t& pushedAt)
+    {
+        while (Count(h) < Count(t)) {
+            Slot const& slot = slots[Count(h) % capacity];
+            T const value = slot.item.load(std::memory_order_relaxed);
+            pushedAt = slot.pushedAt.load(std::memory_order_relaxed);
+            if (consumer.head.compare_exchange_weak(
+                    h, h + Step, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                consumer.head.notify_one();
+                item = value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    struct Slot
+    {
+        std::atomic<T> item;
+        std::atomic<int64_t> pushedAt{0};
+    };
+
+    struct alignas(CacheLineSize) ProducerEnd
+    {
+        std::atomic<uint64_t> tail{0};
+        std::atomic<uint64_t> pushes{0};
+        std::atomic<uint64_t> drops{0};
+        std::atomic<uint64_t> waits{0};
+        std::atomic<uint64_t> occupancySum{0};
+        std::atomic<uint64_t> maxOccupancy{0};
+    };
+
+    struct alignas(CacheLineSize) ConsumerEnd
+    {
+        std::atomic<uint64_t> head{0};
+        uint64_t cachedTail = 0;
+        std::atomic<uint64_t> pops{0};
+        std::atomic<uint64_t> waits{0};
+    };
+
+    size_t const capacity;
+    std::unique_ptr<Slot[]> const slots;
+    MetricStage const latencyStage;
+    MetricGauge const occupancyGauge;
+
+    ProducerEnd producer;
+    ConsumerEnd consumer;
+};
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+} // namespace gt
@@ -0,0 +1,209 @@
+#include "SyntheticDesktop.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gt
+{
+
+namespace
+{
+
+uint32_t MakeColor(unsigned r, unsigned g, unsigned b)
+{
+    return std::min(b, 255u) | std::min(g, 255u) << 8 | std::min(r, 255u) << 16 |
+           0xFF000000u;
+}
+
+/// Cheap integer hash, used where the content has to look random but must not
+/// depend on the order it is drawn in.
+uint32_t Hash(uint32_t x, uint32_t y, uint32_t seed)
+{
+    uint32_t h = x * 0x8DA6B343u ^ y * 0xD8163841u ^ seed * 0xCB1AB31Fu;
+    h ^= h >> 13;
+    h *= 0x5BD1E995u;
+    return h ^ h >> 15;
+}
+
+constexpr unsigned GlyphWidth = 7;
+constexpr unsigned GlyphHeight = 12;
+constexpr unsigned LineHeight = 16;
+constexpr unsigned TitleBarHeight = 24;
+
+} // namespace
+
+SyntheticDesktopSource::SyntheticDesktopSource(SyntheticDesktopOptions const& options)
+    : options(options)
+    , rng(options.seed, options.seed ^ 0x9E3779B97F4A7C15ull)
+    , desktop(options.width, options.height)
+{
+    DrawWallpaper();
+
+    unsigned const width = options.width;
+    unsigned const height = options.height;
+    unsigned const windowCount = 3 + static_cast<unsigned>(rng() % 3);
+    for (unsigned i = 0; i < windowCount; ++i)
+        DrawTextWindow(RandomRect(width / 4, height / 4));
+    DrawPhoto(RandomRect(width / 5, height / 5));
+
+    // One video-like region takes most of the dirty area, the rest is spread
+    // over small animations such as spinners and cursors.
+    double const dirtyArea =
+        std::clamp(options.dirtyFraction, 0.0f, 1.0f) * double(width) * height;
+    if (dirtyArea <= 0.0)
+        return;
+
+    double const videoArea = dirtyArea * 0.8;
+    unsigned const videoWidth = std::min(
+        width, std::max(1u, static_cast<unsigned>(std::sqrt(videoArea * 16.0 / 9.0))));
+    unsigned const videoHeight = std::min(
+        height, std::max(1u, static_cast<unsigned>(videoArea / videoWidth)));
+    animatedRegions.push_back({static_cast<unsigned>(rng() % (width - videoWidth + 1)),
+                               static_cast<unsigned>(rng() % (height - videoHeight + 1)),
+                               videoWidth, videoHeight});
+
+    unsigned const smallSize = std::max(
+        1u,
+        std::min({width, height, static_cast<unsigned>(std::sqrt(dirtyArea * 0.05))}));
+    for (unsigned i = 0; i < 4; ++i) {
+        animatedRegions.push_back(
+            {static_cast<unsigned>(rng() % (width - smallSize + 1)),
+             static_cast<unsigned>(rng() % (height - smallSize + 1)), smallSize,
+             smallSize});
+    }
+}
+
+void SyntheticDesktopSource::GetSize(unsigned& width, unsigned& height) const
+{
+    width = options.width;
+    height = options.height;
+}
+
+HRESULT SyntheticDesktopSource::Capture(image_view<uint32_t> dest)
+{
+    for (Rect const& region : animatedRegions)
+        DrawAnimation(region, captures);
+    ++captures;
+
+    CopyImage(desktop.View(), dest);
+    return S_OK;
+}
+
+HRESULT SyntheticDesktopSource::CaptureRects(image_view<uint32_t> dest,
+                                             cspan<ImageRect> rects)
+{
+    if (dest.width() != desktop.Width() || dest.height() != desktop.Height())
+        return Capture(dest);
+
+    // The animations run on the whole screen either way, like they would on
+    // a real desktop.
+    for (Rect const& region : animatedRegions)
+        DrawAnimation(region, captures);
+    ++captures;
+
+    CopyImageRects(desktop.View(), dest, rects);
+    return S_OK;
+}
+
+SyntheticDesktopSource::Rect SyntheticDesktopSource::RandomRect(unsigned minWidth,
+                                                                unsigned minHeight)
+{
+    minWidth = std::max(1u, std::min(minWidth, options.width));
+    minHeight = std::max(1u, std::min(minHeight, options.height));
+    unsigned const width =
+        minWidth + static_cast<unsigned>(rng() % (options.width - minWidth + 1) / 2);
+    unsigned const height =
+        minHeight + static_cast<unsigned>(rng() % (options.height - minHeight + 1) / 2);
+    return {static_cast<unsigned>(rng() % (options.width - width + 1)),
+            static_cast<unsigned>(rng() % (options.height - height + 1)), width, height};
+}
+
+void SyntheticDesktopSource::DrawWallpaper()
+{
+    unsigned const width = desktop.Width();
+    unsigned const height = desktop.Height();
+    unsigned const tintR = static_cast<unsigned>(rng() % 96);
+    unsigned const tintB = static_cast<unsigned>(rng() % 96);
+    for (unsigned y = 0; y < height; ++y) {
+        uint32_t* const row = desktop.Row(y);
+        for (unsigned x = 0; x < width; ++x) {
+            unsigned const t = (x * 128 / width) + (y * 127 / height);
+            row[x] = MakeColor(tintR + t / 3, 40 + t / 2, tintB + t * 2 / 3);
+        }
+    }
+}
+
+void SyntheticDesktopSource::DrawTextWindow(Rect const& rect)
+{
+    bool const dark = rng() % 2 != 0;
+    uint32_t const background = dark ? MakeColor(30, 30, 34) : MakeColor(250, 250, 250);
+    uint32_t const ink = dark ? MakeColor(212, 212, 212) : MakeColor(20, 20, 20);
+    uint32_t const title = MakeColor(static_cast<unsigned>(rng() % 64),
+                                     96 + static_cast<unsigned>(rng() % 96), 200);
+    uint32_t const seed = static_cast<uint32_t>(rng());
+
+    for (unsigned y = 0; y < rect.height; ++y) {
+        uint32_t* const row = desktop.Row(rect.y + y) + rect.x;
+        if (y < TitleBarHeight) {
+            std::fill(row, row + rect.width, title);
+            continue;
+        }
+
+        // Lines of glyphs, each a random pattern of strokes, with blank glyphs
+        // here and there separating words.
+        unsigned const line = (y - TitleBarHeight) / LineHeight;
+        unsigned const glyphY = (y - TitleBarHeight) % LineHeight;
+        for (unsigned x = 0; x < rect.width; ++x) {
+            unsigned const column = x / GlyphWidth;
+            unsigned const glyphX = x % GlyphWidth;
+            bool const blank = glyphY >= GlyphHeight || glyphX == GlyphWidth - 1 ||
+                               Hash(column, line, seed) % 8 == 0 || x < 8 ||
+                               x + 8 >= rect.width;
+            uint32_t const strokes = Hash(x, line * GlyphHeight + glyphY / 2, seed);
+            row[x] = !blank && strokes % 3 == 0 ? ink : background;
+        }
+    }
+}
+
+void SyntheticDesktopSource::DrawPhoto(Rect const& rect)
+{
+    // Smooth shapes from a few low-frequency waves, plus sensor noise.
+    float const phase[3] = {static_cast<float>(rng() % 628) / 100.0f,
+                            static_cast<float>(rng() % 628) / 100.0f,
+                            static_cast<float>(rng() % 628) / 100.0f};
+    uint32_t const seed = static_cast<uint32_t>(rng());
+    float const scale =
+        6.2831853f / static_cast<float>(std::max(rect.width, rect.height));
+
+    for (unsigned y = 0; y < rect.height; ++y) {
+        uint32_t* const row = desktop.Row(rect.y + y) + rect.x;
+        float const fy = static_cast<float>(y) * scale;
+        for (unsigned x = 0; x < rect.width; ++x) {
+            float const fx = static_cast<float>(x) * scale;
+            float const shape =
+                std::sin(fx * 1.3f + phase[0]) * std::cos(fy * 0.9f + phase[1]) +
+                0.5f * std::sin((fx + fy) * 2.7f + phase[2]);
+            int const noise = static_cast<int>(Hash(x, y, seed) % 17) - 8;
+            int const base = static_cast<int>(110.0f + 70.0f * shape) + noise;
+            row[x] = MakeColor(static_cast<unsigned>(std::max(base + 30, 0)),
+                               static_cast<unsigned>(std::max(base, 0)),
+                               static_cast<unsigned>(std::max(base - 25, 0)));
+        }
+    }
+}
+
+void SyntheticDesktopSource::DrawAnimation(Rect const& rect, unsigned frame)
+{
+    // Moving bands with per-frame noise, so every pixel of the region changes
+    // from one capture to the next.
+    for (unsigned y = 0; y < rect.height; ++y) {
+        uint32_t* const row = desktop.Row(rect.y + y) + rect.x;
+        for (unsigned x = 0; x < rect.width; ++x) {
+            unsigned const band = (x + y + frame * 7) & 0xFF;
+            unsigned const noise = Hash(x, y, frame) & 0x1F;
+            row[x] = MakeColor(band, (band * 3 + noise) & 0xFF, 255 - band + noise / 2);
+        }
+    }
+}
+
+} // namespace gt
@@ -0,0 +1,62 @@
+#pragma once
+#include "FrameSource.h"
+#include "ImageBuffer.h"
+#include "Random.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace gt
+{
+
+struct SyntheticDesktopOptions
+{
+    unsigned width = 1920;
+    unsigned height = 1080;
+    /// Fraction of the screen redrawn between two captures, like a video or
+    /// an animation would.
+    float dirtyFraction = 0.1f;
+    uint64_t seed = 1;
+};
+
+/// <summary>
+///   Frame source producing desktop-like content for benchmarks: a gradient
+///   wallpaper, windows full of text, a photo and animated regions covering
+///   <see cref="SyntheticDesktopOptions::dirtyFraction"/> of the screen, which
+///   change on every capture. The layout only depends on the seed, so runs
+///   with the same options see the same desktop.
+/// </summary>
+class SyntheticDesktopSource : public IFrameSource
+{
+public:
+    explicit SyntheticDesktopSource(SyntheticDesktopOptions const& options);
+
+    void GetSize(unsigned& width, unsigned& height) const override;
+    HRESULT Capture(image_view<uint32_t> dest) override;
+    HRESULT CaptureRects(image_view<uint32_t> dest, cspan<ImageRect> rects) override;
+
+    unsigned GetCaptures() const { return captures; }
+
+private:
+    struct Rect
+    {
+        unsigned x;
+        unsigned y;
+        unsigned width;
+        unsigned height;
+    };
+
+    Rect RandomRect(unsigned minWidth, unsigned minHeight);
+    void DrawWallpaper();
+    void DrawTextWindow(Rect const& rect);
+    void DrawPhoto(Rect const& rect);
+    void DrawAnimation(Rect const& rect, unsigned frame);
+
+    SyntheticDesktopOptions options;
+    xorshift128_engine rng;
+    ImageBuffer desktop;
+    std::vector<Rect> animatedRegions;
+    unsigned captures = 0;
+};
+
+} // namespace gt
@@ -0,0 +1,104 @@
+#include "ThreadPool.h"
+
+#include "Trace.h"
+
+#include <algorithm>
+
+namespace gt
+{
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+    workers.reserve(threadCount - 1);
+    for (unsigned i = 1; i < threadCount; ++i)
+        workers.emplace_back([this] { WorkerMain(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeWorkers.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::Run(unsigned newCount, unsigned grain, RangeFunction newFunction,
+                     void* newContext)
+{
+    if (newCount == 0)
+        return;
+
+    // A few chunks per thread balance uneven rows without much overhead.
+    grain = std::max(grain, 1u);
+    unsigned const maxChunks = std::max(newCount / grain, 1u);
+    unsigned const chunks = std::min(maxChunks, ThreadCount() * 4);
+
+    if (workers.empty() || chunks == 1) {
+        newFunction(newContext, 0, newCount);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        function = newFunction;
+        context = newContext;
+        count = newCount;
+        chunkSize = (newCount + chunks - 1) / chunks;
+        chunkCount = (newCount + chunkSize - 1) / chunkSize;
+        nextChunk.store(0, std::memory_order_relaxed);
+        busyWorkers = static_cast<unsigned>(workers.size());
+        ++generation;
+    }
+    wakeWorkers.notify_all();
+
+    RunChunks();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    workersDone.wait(lock, [this] { return busyWorkers == 0; });
+}
+
+void ThreadPool::RunChunks()
+{
+    for (;;) {
+        unsigned const chunk = nextChunk.fetch_add(1, std::memory_order_relaxed);
+        if (chunk >= chunkCount)
+            break;
+
+        unsigned const begin = chunk * chunkSize;
+        unsigned const end = std::min(begin + chunkSize, count);
+        GT_TRACE_SCOPE("Task");
+        function(context, begin, end);
+    }
+}
+
+void ThreadPool::WorkerMain()
+{
+    SetTraceThreadName("ThreadPool worker");
+    uint64_t seenGeneration = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeWorkers.wait(lock,
+                             [&] { return stopping || generation != seenGeneration; });
+            if (stopping)
+                return;
+            seenGeneration = generation;
+        }
+
+        RunChunks();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busyWorkers == 0)
+            workersDone.notify_one();
+    }
+}
+
+} // namespace gt
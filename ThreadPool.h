@@ -0,0 +1,92 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace gt
+{
+
+/// <summary>
+///   Fixed set of worker threads executing data-parallel loops. The calling
+///   thread takes part in every loop, so a pool with one thread runs inline.
+/// </summary>
+class ThreadPool
+{
+public:
+    /// <summary>
+    ///   Creates a pool of <paramref name="threadCount"/> threads including the
+    ///   caller. Zero uses one thread per hardware thread.
+    /// </summary>
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    unsigned ThreadCount() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    /// <summary>
+    ///   Splits [0, <paramref name="count"/>) into ranges of at least
+    ///   <paramref name="grain"/> items and calls
+    ///   <c>body(begin, end)</c> for each of them across the pool. Returns when
+    ///   all ranges are done. Must not be called concurrently or recursively.
+    /// </summary>
+    template<typename Body>
+    void ParallelFor(unsigned count, unsigned grain, Body&& body)
+    {
+        using BodyType = std::remove_reference_t<Body>;
+        Run(count, grain,
+            [](void* context, unsigned begin, unsigned end) {
+                (*static_cast<BodyType*>(context))(begin, end);
+            },
+            const_cast<void*>(static_cast<void const*>(&body)));
+    }
+
+private:
+    using RangeFunction = void (*)(void* context, unsigned begin, unsigned end);
+
+    void Run(unsigned count, unsigned grain, RangeFunction function, void* context);
+    void RunChunks();
+    void WorkerMain();
+
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wakeWorkers;
+    std::condition_variable workersDone;
+    uint64_t generation = 0;
+    unsigned busyWorkers = 0;
+    bool stopping = false;
+
+    // Current loop, written by the caller before the generation is bumped.
+    RangeFunction function = nullptr;
+    void* context = nullptr;
+    unsigned count = 0;
+    unsigned chunkSize = 0;
+    unsigned chunkCount = 0;
+    std::atomic<unsigned> nextChunk{0};
+};
+
+/// Rows per task for image passes. Small enough to balance uneven glitch
+/// cells, large enough to amortize the scheduling.
+constexpr unsigned RowGrain = 16;
+
+/// <summary>
+///   Calls <c>body(rowBegin, rowEnd)</c> for bands of an image with
+///   <paramref name="height"/> rows, across <paramref name="pool"/> if there
+///   is one and on the calling thread otherwise.
+/// </summary>
+template<typename Body>
+void ForEachRowBand(ThreadPool* pool, unsigned height, Body&& body)
+{
+    if (pool)
+        pool->ParallelFor(height, RowGrain, body);
+    else
+        body(0u, height);
+}
+
+} // namespace gt
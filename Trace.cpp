@@ -0,0 +1,221 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace gt
+{
+
+#if GT_ENABLE_TRACING
+
+namespace
+{
+
+struct TraceEvent
+{
+    char const* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+/// <summary>
+///   Events of one thread. Only the owning thread writes; dumps read it from
+///   any thread, guarded like a sequence lock: <c>claimed</c> is bumped before
+///   a slot is overwritten and <c>published</c> after, so a reader can tell
+///   which of the slots it copied may have changed under it.
+/// </summary>
+struct TraceBuffer
+{
+    static constexpr size_t Capacity = 8192;
+
+    struct Slot
+    {
+        std::atomic<char const*> name{nullptr};
+        std::atomic<uint64_t> start{0};
+        std::atomic<uint64_t> end{0};
+    };
+
+    void Push(char const* name, uint64_t start, uint64_t end)
+    {
+        uint64_t const index = published.load(std::memory_order_relaxed);
+        claimed.store(index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        Slot& slot = slots[index % Capacity];
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.start.store(start, std::memory_order_relaxed);
+        slot.end.store(end, std::memory_order_relaxed);
+        published.store(index + 1, std::memory_order_release);
+    }
+
+    void Snapshot(std::vector<TraceEvent>& events) const
+    {
+        uint64_t const end = published.load(std::memory_order_acquire);
+        uint64_t const begin = end > Capacity ? end - Capacity : 0;
+        size_t const first = events.size();
+        for (uint64_t i = begin; i < end; ++i) {
+            Slot const& slot = slots[i % Capacity];
+            events.push_back({slot.name.load(std::memory_order_relaxed),
+                              slot.start.load(std::memory_order_relaxed),
+                              slot.end.load(std::memory_order_relaxed)});
+        }
+
+        // Drop the slots the owner started to overwrite while we copied.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t const overwritten = claimed.load(std::memory_order_relaxed);
+        uint64_t const valid = overwritten > Capacity ? overwritten - Capacity : 0;
+        if (valid > begin) {
+            size_t const stale = static_cast<size_t>(std::min(valid, end) - begin);
+            events.erase(events.begin() + first, events.begin() + first + stale);
+        }
+    }
+
+    unsigned threadId = 0;
+    std::atomic<char const*> threadName{nullptr};
+    std::atomic<uint64_t> claimed{0};
+    std::atomic<uint64_t> published{0};
+    std::array<Slot, Capacity> slots;
+};
+
+/// Threads that ever recorded an event. Buffers come from malloc rather than
+/// operator new, so that a thread recording its first event in the middle of
+/// a burst does not trip the allocation check, and are kept for the life of
+/// the process so that dumps include finished threads.
+constexpr unsigned MaxTraceThreads = 256;
+std::array<std::atomic<TraceBuffer*>, MaxTraceThreads> traceBuffers{};
+std::atomic<unsigned> traceBufferCount{0};
+
+thread_local TraceBuffer* threadBuffer = nullptr;
+thread_local char const* threadName = nullptr;
+
+auto const traceEpoch = std::chrono::steady_clock::now();
+
+TraceBuffer* GetThreadBuffer()
+{
+    if (threadBuffer)
+        return threadBuffer;
+
+    unsigned const index = traceBufferCount.fetch_add(1, std::memory_order_relaxed);
+    if (index >= MaxTraceThreads)
+        return nullptr;
+
+    void* const memory = std::malloc(sizeof(TraceBuffer));
+    if (!memory)
+        return nullptr;
+
+    threadBuffer = new (memory) TraceBuffer();
+    threadBuffer->threadId = index + 1;
+    threadBuffer->threadName.store(threadName, std::memory_order_relaxed);
+    traceBuffers[index].store(threadBuffer, std::memory_order_release);
+    return threadBuffer;
+}
+
+/// Escapes the few characters that can occur in event and thread names.
+void WriteJsonString(FILE* file, char const* text)
+{
+    fputc('"', file);
+    for (; *text; ++text) {
+        if (*text == '"' || *text == '\\')
+            fputc('\\', file);
+        if (static_cast<unsigned char>(*text) >= 0x20)
+            fputc(*text, file);
+    }
+    fputc('"', file);
+}
+
+} // namespace
+
+namespace detail
+{
+
+std::atomic<bool> tracingEnabled{false};
+
+uint64_t GetTraceTime()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now() - traceEpoch)
+                                     .count());
+}
+
+void RecordTraceEvent(char const* name, uint64_t start, uint64_t end)
+{
+    if (TraceBuffer* const buffer = GetThreadBuffer())
+        buffer->Push(name, start, end);
+}
+
+} // namespace detail
+
+void EnableTracing(bool enable)
+{
+    detail::tracingEnabled.store(enable, std::memory_order_relaxed);
+}
+
+void SetTraceThreadName(char const* name)
+{
+    threadName = name;
+    if (threadBuffer)
+        threadBuffer->threadName.store(name, std::memory_order_relaxed);
+}
+
+HRESULT WriteChromeTrace(FILE* file)
+{
+    unsigned const bufferCount =
+        std::min(traceBufferCount.load(std::memory_order_relaxed), MaxTraceThreads);
+
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    bool first = true;
+    std::vector<TraceEvent> events;
+    for (unsigned i = 0; i < bufferCount; ++i) {
+        TraceBuffer const* const buffer = traceBuffers[i].load(std::memory_order_acquire);
+        if (!buffer)
+            continue;
+
+        char const* const name = buffer->threadName.load(std::memory_order_relaxed);
+        fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, ",
+                first ? "" : ",\n");
+        fprintf(file, "\"tid\": %u, \"args\": {\"name\": ", buffer->threadId);
+        if (name)
+            WriteJsonString(file, name);
+        else
+            fprintf(file, "\"Thread %u\"", buffer->threadId);
+        fprintf(file, "}}");
+        first = false;
+
+        events.clear();
+        buffer->Snapshot(events);
+        for (TraceEvent const& event : events) {
+            fprintf(file, ",\n{\"name\": ");
+            WriteJsonString(file, event.name);
+            fprintf(file,
+                    ", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, "
+                    "\"dur\": %.3f}",
+                    buffer->threadId, event.start / 1000.0,
+                    (event.end - event.start) / 1000.0);
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    return ferror(file) ? E_FAIL : S_OK;
+}
+
+#else
+
+void EnableTracing(bool /*enable*/)
+{}
+
+void SetTraceThreadName(char const* /*name*/)
+{}
+
+HRESULT WriteChromeTrace(FILE* file)
+{
+    fprintf(file, "{\"traceEvents\": []}\n");
+    return ferror(file) ? E_FAIL : S_OK;
+}
+
+#endif
+
+} // namespace gt
@@ -0,0 +1,88 @@
+#pragma once
+#include "Platform.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+/// Compiles the trace scopes in. Without it they vanish entirely and the
+/// functions below do nothing.
+#ifndef GT_ENABLE_TRACING
+#define GT_ENABLE_TRACING 1
+#endif
+
+namespace gt
+{
+
+/// <summary>
+///   Starts or stops recording trace scopes. Scopes are recorded into one
+///   ring buffer per thread, so only the most recent events of each thread
+///   are kept; while disabled, a scope costs one relaxed load.
+/// </summary>
+void EnableTracing(bool enable);
+
+/// <summary>
+///   Names the calling thread in traces. <paramref name="name"/> must be a
+///   string literal or otherwise outlive the process.
+/// </summary>
+void SetTraceThreadName(char const* name);
+
+/// <summary>
+///   Writes the recorded events of all threads in the Chrome trace event
+///   format, for chrome://tracing or Perfetto. Can be called while other
+///   threads keep recording; events overwritten during the dump are left out.
+/// </summary>
+HRESULT WriteChromeTrace(FILE* file);
+
+#define GT_TRACE_CONCAT_(a, b) a##b
+#define GT_TRACE_CONCAT(a, b) GT_TRACE_CONCAT_(a, b)
+
+#if GT_ENABLE_TRACING
+
+namespace detail
+{
+
+extern std::atomic<bool> tracingEnabled;
+
+uint64_t GetTraceTime();
+void RecordTraceEvent(char const* name, uint64_t start, uint64_t end);
+
+} // namespace detail
+
+/// <summary>
+///   Records the time from construction to destruction under
+///   <paramref name="name"/>, which must be a string literal. Use
+///   <see cref="GT_TRACE_SCOPE"/> rather than this class directly.
+/// </summary>
+class TraceScope
+{
+public:
+    explicit TraceScope(char const* name)
+        : name(detail::tracingEnabled.load(std::memory_order_relaxed) ? name : nullptr)
+        , start(this->name ? detail::GetTraceTime() : 0)
+    {}
+
+    ~TraceScope()
+    {
+        if (name)
+            detail::RecordTraceEvent(name, start, detail::GetTraceTime());
+    }
+
+    TraceScope(TraceScope const&) = delete;
+    TraceScope& operator=(TraceScope const&) = delete;
+
+private:
+    char const* name;
+    uint64_t start;
+};
+
+#define GT_TRACE_SCOPE(name)                                                             \
+    ::gt::TraceScope const GT_TRACE_CONCAT(traceScope_, __LINE__)(name)
+
+#else
+
+#define GT_TRACE_SCOPE(name) ((void)0)
+
+#endif
+
+} // namespace gt
@@ -0,0 +1,123 @@
+#pragma once
+#include "SpscQueue.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace gt
+{
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4324) // Padded due to alignment specifier
+#endif
+
+/// <summary>
+///   Bounded work-stealing deque of task handles (Chase and Lev, with the
+///   memory orders of Lê et al.). Its owner thread pushes and pops at the
+///   bottom, so it keeps working on what it split up last while the data is
+///   still in its caches; any other thread steals the oldest task from the
+///   top. Takes no locks and never allocates after construction.
+/// </summary>
+template<typename T>
+class WorkStealingQueue
+{
+    static_assert(std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(uint64_t),
+                  "Queue items are handles");
+
+public:
+    /// Creates a queue of at least <paramref name="minCapacity"/> tasks.
+    explicit WorkStealingQueue(size_t minCapacity)
+    {
+        size_t capacity = 1;
+        while (capacity < minCapacity)
+            capacity *= 2;
+        mask = capacity - 1;
+        slots = std::make_unique<std::atomic<T>[]>(capacity);
+    }
+
+    WorkStealingQueue(WorkStealingQueue const&) = delete;
+    WorkStealingQueue& operator=(WorkStealingQueue const&) = delete;
+
+    /// Owner: adds a task at the bottom. Returns false if the queue is full.
+    bool Push(T item)
+    {
+        int64_t const b = bottom.load(std::memory_order_relaxed);
+        int64_t const t = top.load(std::memory_order_acquire);
+        if (b - t > static_cast<int64_t>(mask))
+            return false;
+
+        slots[b & mask].store(item, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Owner: takes the newest task. Returns false if the queue is empty.
+    bool Pop(T& item)
+    {
+        int64_t const b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        item = slots[b & mask].load(std::memory_order_relaxed);
+        if (t < b)
+            return true;
+
+        // Last task: race the thieves for it.
+        bool const won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                     std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    /// Any thread: takes the oldest task. Returns false if the queue is
+    /// empty or another thread took the task first.
+    bool Steal(T& item)
+    {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t const b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return false;
+
+        item = slots[t & mask].load(std::memory_order_relaxed);
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                           std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    ///   Any thread: the task <see cref="Steal"/> would take right now, to
+    ///   choose between victims. It may be gone by the time it is stolen.
+    /// </summary>
+    bool Peek(T& item) const
+    {
+        int64_t const t = top.load(std::memory_order_acquire);
+        int64_t const b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return false;
+
+        item = slots[t & mask].load(std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    alignas(CacheLineSize) std::atomic<int64_t> top{0};
+    alignas(CacheLineSize) std::atomic<int64_t> bottom{0};
+    std::unique_ptr<std::atomic<T>[]> slots;
+    size_t mask = 0;
+};
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+} // namespace gt
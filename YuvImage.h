@@ -0,0 +1,117 @@
+#pragma once
+#include "FramePool.h"
+#include "Span.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace gt
+{
+
+enum class YuvPlane
+{
+    Y,
+    U,
+    V,
+};
+
+/// <summary>
+///   8-bit planar Y'CbCr 4:2:0 image in system memory (I420 layout). The
+///   planes are stored back to back without padding, exactly like a Y4M
+///   frame, and the chroma planes have half the resolution rounded up. Like
+///   <see cref="ImageBuffer"/>, the storage comes from a frame pool.
+/// </summary>
+class YuvImage
+{
+public:
+    YuvImage() = default;
+    explicit YuvImage(FramePool& pool)
+        : pool(&pool)
+    {}
+    YuvImage(unsigned width, unsigned height) { Resize(width, height); }
+
+    /// Resizes the image and clears it to black, the Y'CbCr counterpart of a
+    /// zeroed <see cref="ImageBuffer"/>.
+    void Resize(unsigned newWidth, unsigned newHeight)
+    {
+        if (newWidth != width || newHeight != height) {
+            width = newWidth;
+            height = newHeight;
+            planes.Reset();
+            planes =
+                GetPool().Acquire(PlaneSize(YuvPlane::Y) + 2 * PlaneSize(YuvPlane::U));
+        }
+
+        size_t const lumaSize = PlaneSize(YuvPlane::Y);
+        if (planes) {
+            std::memset(Data(), 16, lumaSize);
+            std::memset(Data() + lumaSize, 128, planes.Size() - lumaSize);
+        }
+    }
+
+    void SetPool(FramePool& newPool) { pool = &newPool; }
+    FramePool& GetPool() const { return pool ? *pool : FramePool::Shared(); }
+
+    unsigned Width() const { return width; }
+    unsigned Height() const { return height; }
+    unsigned ChromaWidth() const { return (width + 1) / 2; }
+    unsigned ChromaHeight() const { return (height + 1) / 2; }
+    size_t SizeBytes() const { return planes.Size(); }
+    bool Empty() const { return planes.Size() == 0; }
+
+    unsigned PlaneWidth(YuvPlane plane) const
+    {
+        return plane == YuvPlane::Y ? width : ChromaWidth();
+    }
+
+    unsigned PlaneHeight(YuvPlane plane) const
+    {
+        return plane == YuvPlane::Y ? height : ChromaHeight();
+    }
+
+    size_t PlaneSize(YuvPlane plane) const
+    {
+        return static_cast<size_t>(PlaneWidth(plane)) * PlaneHeight(plane);
+    }
+
+    uint8_t* Data() { return reinterpret_cast<uint8_t*>(planes.Data()); }
+    uint8_t const* Data() const
+    {
+        return reinterpret_cast<uint8_t const*>(planes.Data());
+    }
+
+    uint8_t* Plane(YuvPlane plane) { return Data() + PlaneOffset(plane); }
+    uint8_t const* Plane(YuvPlane plane) const { return Data() + PlaneOffset(plane); }
+
+    image_view<uint8_t> PlaneView(YuvPlane plane)
+    {
+        return {Plane(plane), PlaneWidth(plane), PlaneHeight(plane)};
+    }
+
+    image_view<uint8_t const> PlaneView(YuvPlane plane) const
+    {
+        return {Plane(plane), PlaneWidth(plane), PlaneHeight(plane)};
+    }
+
+private:
+    size_t PlaneOffset(YuvPlane plane) const
+    {
+        switch (plane) {
+        case YuvPlane::Y:
+            return 0;
+        case YuvPlane::U:
+            return PlaneSize(YuvPlane::Y);
+        case YuvPlane::V:
+            return PlaneSize(YuvPlane::Y) + PlaneSize(YuvPlane::U);
+        }
+        return 0;
+    }
+
+    FramePool* pool = nullptr;
+    unsigned width = 0;
+    unsigned height = 0;
+    FrameBlock planes;
+};
+
+} // namespace gt